@@ -0,0 +1,345 @@
+// Frontend benchmarks: lexer, parser, semantic analysis and multi-file analysis
+//
+// Every stage runs on the same inputs and reports two throughputs: source
+// bytes (`<stage>/bytes/<input>`) and AST nodes (`<stage>/nodes/<input>`),
+// so stages can be compared per unit of input. Inputs come from the
+// `suru_lang::corpus` generator. The `slow_cases` group runs the minimized
+// inputs the fuzz targets flagged as superlinear (`fuzz/slow_cases/`), so
+// fixes show up as a drop in time per byte.
+//
+//     cargo bench --bench frontend
+//     cargo bench --bench frontend -- parse/nodes/wide_struct
+//
+// The harness is the `Runner` below rather than a benchmarking crate, so the
+// bench builds from the committed Cargo.lock alone. It reports the median of
+// the samples; without `--bench` (`cargo test --benches`) every case runs
+// once as a smoke test.
+
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+use suru_lang::ast::Ast;
+use suru_lang::corpus::CorpusShape;
+use suru_lang::lexer::{self, Tokens};
+use suru_lang::limits::CompilerLimits;
+use suru_lang::parser;
+use suru_lang::semantic::{MultiFileAnalyzer, SemanticAnalyzer, SourceFile};
+
+/// Fewest samples taken of a case
+const MIN_SAMPLES: usize = 20;
+/// Time spent sampling a case once it has `MIN_SAMPLES`
+const TARGET_TIME: Duration = Duration::from_secs(2);
+
+/// Amount of input one iteration processes
+#[derive(Clone, Copy)]
+enum Throughput {
+    Bytes(u64),
+    Elements(u64),
+}
+
+/// Runs the cases whose id contains the filter given on the command line
+struct Runner {
+    filter: Option<String>,
+    /// False under `cargo test`, which runs each case once
+    measure: bool,
+}
+
+impl Runner {
+    fn from_args() -> Self {
+        let args: Vec<String> = std::env::args().skip(1).collect();
+        Runner {
+            filter: args.iter().find(|arg| !arg.starts_with('-')).cloned(),
+            measure: args.iter().any(|arg| arg == "--bench"),
+        }
+    }
+
+    /// Times `routine` on a fresh `setup()` value per iteration; setup is
+    /// not timed
+    fn bench<S, O>(
+        &self,
+        id: &str,
+        throughput: Throughput,
+        mut setup: impl FnMut() -> S,
+        mut routine: impl FnMut(S) -> O,
+    ) {
+        if self
+            .filter
+            .as_ref()
+            .is_some_and(|filter| !id.contains(filter.as_str()))
+        {
+            return;
+        }
+        let mut sample = || {
+            let input = setup();
+            let start = Instant::now();
+            black_box(routine(black_box(input)));
+            start.elapsed()
+        };
+        let warmup = sample();
+        if !self.measure {
+            println!("{:<48} ok", id);
+            return;
+        }
+        let mut samples = vec![warmup];
+        let started = Instant::now();
+        while samples.len() < MIN_SAMPLES || started.elapsed() < TARGET_TIME {
+            samples.push(sample());
+        }
+        samples.sort_unstable();
+        let median = samples[samples.len() / 2];
+        let per_second = |units: u64| units as f64 / median.as_secs_f64();
+        let throughput = match throughput {
+            Throughput::Bytes(bytes) => format!("{:.1} MiB/s", per_second(bytes) / 1048576.0),
+            Throughput::Elements(nodes) => format!("{:.0} nodes/s", per_second(nodes)),
+        };
+        println!(
+            "{:<48} {:>12?} {:>18}   ({} samples)",
+            id,
+            median,
+            throughput,
+            samples.len()
+        );
+    }
+}
+
+/// Default limits with room for the larger synthetic inputs
+fn limits() -> CompilerLimits {
+    CompilerLimits {
+        max_token_count: 10_000_000,
+        ..CompilerLimits::default()
+    }
+}
+
+/// A single-file input with its size in bytes and AST nodes
+struct Input {
+    name: &'static str,
+    source: String,
+    nodes: u64,
+}
+
+impl Input {
+    /// Panics unless the source passes the whole frontend
+    fn new(name: &'static str, source: String) -> Self {
+        let ast = parse(lex(&source));
+        let nodes = ast.nodes.len() as u64;
+        if let Err(err) = SemanticAnalyzer::new(ast).analyze_with_types() {
+            panic!(
+                "benchmark input '{}' does not check: {:?}",
+                name, err.errors
+            );
+        }
+        Input {
+            name,
+            source,
+            nodes,
+        }
+    }
+
+    fn throughputs(&self) -> [(&'static str, Throughput); 2] {
+        [
+            ("bytes", Throughput::Bytes(self.source.len() as u64)),
+            ("nodes", Throughput::Elements(self.nodes)),
+        ]
+    }
+}
+
+fn lex(source: &str) -> Tokens {
+    lexer::lex(source, &limits()).expect("lex failed")
+}
+
+fn parse(tokens: Tokens) -> Ast {
+    parser::parse(tokens, &limits()).expect("parse failed")
+}
+
+fn single_file_inputs() -> Vec<Input> {
+    vec![
+        Input::new(
+            "representative",
+            CorpusShape {
+                modules: 60,
+                ..Default::default()
+            }
+            .single_file(),
+        ),
+        Input::new(
+            "deep_nesting",
+            CorpusShape {
+                modules: 50,
+                match_depth: 40,
+                ..CorpusShape::minimal()
+            }
+            .single_file(),
+        ),
+        Input::new(
+            "wide_struct",
+            CorpusShape {
+                structs: 1,
+                struct_fields: 2_000,
+                ..CorpusShape::minimal()
+            }
+            .single_file(),
+        ),
+        Input::new(
+            "long_lists",
+            CorpusShape {
+                modules: 20,
+                lists: 1,
+                list_length: 1_000,
+                ..CorpusShape::minimal()
+            }
+            .single_file(),
+        ),
+    ]
+}
+
+/// Minimized slow inputs found by the fuzz targets
+fn slow_case_inputs() -> Vec<Input> {
+    macro_rules! slow_case {
+        ($name:literal) => {
+            Input::new(
+                $name,
+                include_str!(concat!("../../fuzz/slow_cases/", $name, ".suru")).to_string(),
+            )
+        };
+    }
+    vec![
+        slow_case!("distinct_strings"),
+        slow_case!("long_list"),
+        slow_case!("wide_struct"),
+        slow_case!("many_declarations"),
+    ]
+}
+
+fn bench_lex(runner: &Runner) {
+    for input in &single_file_inputs() {
+        for (unit, throughput) in input.throughputs() {
+            runner.bench(
+                &format!("lex/{}/{}", unit, input.name),
+                throughput,
+                || (),
+                |()| lex(black_box(&input.source)),
+            );
+        }
+    }
+}
+
+fn bench_parse(runner: &Runner) {
+    for input in &single_file_inputs() {
+        let tokens = lex(&input.source);
+        for (unit, throughput) in input.throughputs() {
+            runner.bench(
+                &format!("parse/{}/{}", unit, input.name),
+                throughput,
+                || tokens.clone(),
+                parse,
+            );
+        }
+    }
+}
+
+fn bench_analyze(runner: &Runner) {
+    for input in &single_file_inputs() {
+        let tokens = lex(&input.source);
+        for (unit, throughput) in input.throughputs() {
+            runner.bench(
+                &format!("analyze_with_types/{}/{}", unit, input.name),
+                throughput,
+                || parse(tokens.clone()),
+                |ast| SemanticAnalyzer::new(ast).analyze_with_types().is_ok(),
+            );
+        }
+    }
+}
+
+fn bench_slow_cases(runner: &Runner) {
+    for input in &slow_case_inputs() {
+        let tokens = lex(&input.source);
+        let throughput = Throughput::Bytes(input.source.len() as u64);
+        runner.bench(
+            &format!("slow_cases/lex/{}", input.name),
+            throughput,
+            || (),
+            |()| lex(black_box(&input.source)),
+        );
+        runner.bench(
+            &format!("slow_cases/parse/{}", input.name),
+            throughput,
+            || tokens.clone(),
+            parse,
+        );
+        runner.bench(
+            &format!("slow_cases/analyze/{}", input.name),
+            throughput,
+            || parse(tokens.clone()),
+            |ast| SemanticAnalyzer::new(ast).analyze_with_types().is_ok(),
+        );
+    }
+}
+
+fn bench_multi_file(runner: &Runner) {
+    let package = |shape: CorpusShape| -> Vec<(String, String)> {
+        shape
+            .modules()
+            .into_iter()
+            .map(|f| (f.name, f.source))
+            .collect()
+    };
+    let packages = [
+        (
+            "many_imports",
+            package(CorpusShape {
+                modules: 200,
+                functions: 1,
+                ..CorpusShape::minimal()
+            }),
+        ),
+        (
+            "representative_modules",
+            package(CorpusShape {
+                modules: 20,
+                ..Default::default()
+            }),
+        ),
+    ];
+
+    for (name, files) in &packages {
+        let bytes: usize = files.iter().map(|(_, s)| s.len()).sum();
+        let nodes: usize = files.iter().map(|(_, s)| parse(lex(s)).nodes.len()).sum();
+        let sources = || {
+            files
+                .iter()
+                .map(|(name, source)| SourceFile {
+                    name: name.clone(),
+                    source: source.clone(),
+                })
+                .collect::<Vec<_>>()
+        };
+        let results = MultiFileAnalyzer::new(sources()).analyze();
+        assert!(
+            results.values().all(|r| r.errors.is_empty()),
+            "benchmark package '{}' does not check",
+            name
+        );
+
+        for (unit, throughput) in [
+            ("bytes", Throughput::Bytes(bytes as u64)),
+            ("nodes", Throughput::Elements(nodes as u64)),
+        ] {
+            runner.bench(
+                &format!("multi_file_analyze/{}/{}", unit, name),
+                throughput,
+                || MultiFileAnalyzer::new(sources()),
+                |analyzer| analyzer.analyze(),
+            );
+        }
+    }
+}
+
+fn main() {
+    let runner = Runner::from_args();
+    bench_lex(&runner);
+    bench_parse(&runner);
+    bench_analyze(&runner);
+    bench_multi_file(&runner);
+    bench_slow_cases(&runner);
+}
@@ -0,0 +1,16 @@
+#![no_main]
+
+use libfuzzer_sys::fuzz_target;
+use suru_lang::driver;
+use suru_lang_fuzz::{limits, timed};
+
+// The whole `suru check` pipeline: lex, parse and semantic analysis
+fuzz_target!(|data: &[u8]| {
+    let Ok(source) = std::str::from_utf8(data) else {
+        return;
+    };
+    let limits = limits();
+    let _ = timed("check", source.len(), || {
+        driver::check_source(source, &limits)
+    });
+});
@@ -0,0 +1,13 @@
+#![no_main]
+
+use libfuzzer_sys::fuzz_target;
+use suru_lang::lexer;
+use suru_lang_fuzz::{limits, timed};
+
+fuzz_target!(|data: &[u8]| {
+    let Ok(source) = std::str::from_utf8(data) else {
+        return;
+    };
+    let limits = limits();
+    let _ = timed("lex", source.len(), || lexer::lex(source, &limits));
+});
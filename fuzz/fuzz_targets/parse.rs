@@ -0,0 +1,17 @@
+#![no_main]
+
+use libfuzzer_sys::fuzz_target;
+use suru_lang::{lexer, parser};
+use suru_lang_fuzz::{limits, timed};
+
+// Times the parser alone; lexing cost is the lex target's concern
+fuzz_target!(|data: &[u8]| {
+    let Ok(source) = std::str::from_utf8(data) else {
+        return;
+    };
+    let limits = limits();
+    let Ok(tokens) = lexer::lex(source, &limits) else {
+        return;
+    };
+    let _ = timed("parse", source.len(), || parser::parse(tokens, &limits));
+});
@@ -0,0 +1,68 @@
+// Worst-case complexity detection for the fuzz targets
+//
+// `CompilerLimits` bounds input size, token count and nesting depth, but
+// not time. Each target runs its stage through `timed`, which fails the
+// input when the stage spends more than a threshold per input byte; libFuzzer
+// then saves it under `artifacts/<target>/` like any other crash, ready for
+// `cargo fuzz tmin`. Linear-time stages run at tens of ns per byte, so the
+// default threshold only trips on superlinear behavior:
+//
+//     cargo fuzz run parse -- -max_len=65536
+//     SURU_FUZZ_MAX_NS_PER_BYTE=500 cargo fuzz run check -- -max_len=65536
+//
+// Small inputs are dominated by fixed costs and are not checked; the floor is
+// `SURU_FUZZ_MIN_BYTES`. Minimized slow inputs found this way are kept in
+// `fuzz/slow_cases/` and benchmarked by `cargo bench --bench frontend`.
+
+use std::sync::OnceLock;
+use std::time::Instant;
+
+use suru_lang::limits::CompilerLimits;
+
+/// Default time budget per input byte for one stage
+pub const DEFAULT_MAX_NS_PER_BYTE: u128 = 250;
+
+/// Default size below which inputs are not timed
+pub const DEFAULT_MIN_BYTES: usize = 4096;
+
+struct Threshold {
+    max_ns_per_byte: u128,
+    min_bytes: usize,
+}
+
+fn threshold() -> &'static Threshold {
+    static THRESHOLD: OnceLock<Threshold> = OnceLock::new();
+    THRESHOLD.get_or_init(|| {
+        let var = |name: &str| std::env::var(name).ok().and_then(|v| v.parse().ok());
+        Threshold {
+            max_ns_per_byte: var("SURU_FUZZ_MAX_NS_PER_BYTE").unwrap_or(DEFAULT_MAX_NS_PER_BYTE),
+            min_bytes: var("SURU_FUZZ_MIN_BYTES")
+                .map(|n: u128| n as usize)
+                .unwrap_or(DEFAULT_MIN_BYTES),
+        }
+    })
+}
+
+/// Limits for fuzzing: the defaults, so slow inputs are ones users can hit
+pub fn limits() -> CompilerLimits {
+    CompilerLimits::default()
+}
+
+/// Runs `stage` on an input of `len` bytes, panicking when it is too slow
+pub fn timed<R>(stage: &str, len: usize, run: impl FnOnce() -> R) -> R {
+    let start = Instant::now();
+    let result = run();
+    let elapsed = start.elapsed();
+
+    let threshold = threshold();
+    if len >= threshold.min_bytes {
+        let ns_per_byte = elapsed.as_nanos() / len as u128;
+        if ns_per_byte > threshold.max_ns_per_byte {
+            panic!(
+                "slow input: {} took {:?} for {} bytes ({} ns/byte, threshold {})",
+                stage, elapsed, len, ns_per_byte, threshold.max_ns_per_byte
+            );
+        }
+    }
+    result
+}
@@ -0,0 +1,123 @@
+// Allocation budgets for tests
+//
+// The test build installs `BudgetAllocator` as the global allocator. It
+// forwards to `stats::CountingAllocator` and also counts allocations per
+// thread, so a test can bound the allocations of the code it runs without
+// interference from tests running in parallel:
+//
+//     let tokens = assert_allocations_at_most(64, || lex(&fixture));
+//     assert_no_allocations(|| storage.intern("seen"));
+//
+// Reallocations count as allocations; frees are not counted.
+
+use std::alloc::{GlobalAlloc, Layout};
+use std::cell::Cell;
+
+use crate::stats::CountingAllocator;
+
+#[global_allocator]
+static ALLOCATOR: BudgetAllocator = BudgetAllocator;
+
+thread_local! {
+    // Const-initialized and without a destructor, so the allocator can use
+    // it without allocating
+    static THREAD_ALLOCATIONS: Cell<u64> = const { Cell::new(0) };
+}
+
+struct BudgetAllocator;
+
+fn count() {
+    let _ = THREAD_ALLOCATIONS.try_with(|n| n.set(n.get() + 1));
+}
+
+unsafe impl GlobalAlloc for BudgetAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        count();
+        unsafe { CountingAllocator.alloc(layout) }
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        count();
+        unsafe { CountingAllocator.alloc_zeroed(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { CountingAllocator.dealloc(ptr, layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        count();
+        unsafe { CountingAllocator.realloc(ptr, layout, new_size) }
+    }
+}
+
+/// Runs `f`, returning its result and the allocations it made on this thread
+pub fn count_allocations<R>(f: impl FnOnce() -> R) -> (R, u64) {
+    let before = THREAD_ALLOCATIONS.with(Cell::get);
+    let result = f();
+    let after = THREAD_ALLOCATIONS.with(Cell::get);
+    (result, after - before)
+}
+
+/// Runs `f` and fails the test if it allocates more than `budget` times
+#[track_caller]
+pub fn assert_allocations_at_most<R>(budget: u64, f: impl FnOnce() -> R) -> R {
+    let (result, allocations) = count_allocations(f);
+    assert!(
+        allocations <= budget,
+        "allocation budget exceeded: {} allocations (budget: {})",
+        allocations,
+        budget
+    );
+    result
+}
+
+/// Runs `f` and fails the test if it allocates at all
+#[track_caller]
+pub fn assert_no_allocations<R>(f: impl FnOnce() -> R) -> R {
+    assert_allocations_at_most(0, f)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_counts_this_thread_only() {
+        use std::sync::{Arc, Barrier};
+
+        let (start, done) = (Arc::new(Barrier::new(2)), Arc::new(Barrier::new(2)));
+        let worker = {
+            let (start, done) = (Arc::clone(&start), Arc::clone(&done));
+            std::thread::spawn(move || {
+                start.wait();
+                let blocks: Vec<Vec<u8>> = (0..100).map(|i| vec![0u8; i + 1]).collect();
+                done.wait();
+                blocks.len()
+            })
+        };
+
+        // The worker allocates between the two waits; none of it is ours
+        let (_, n) = count_allocations(|| {
+            start.wait();
+            done.wait();
+        });
+        assert_eq!(n, 0);
+        assert_eq!(worker.join().unwrap(), 100);
+    }
+
+    #[test]
+    fn test_budget_assertions() {
+        assert_no_allocations(|| 1 + 1);
+        let v = assert_allocations_at_most(2, || {
+            let mut v = Vec::with_capacity(1);
+            v.push(1);
+            v.push(2); // grows once
+            v
+        });
+        assert_eq!(v, vec![1, 2]);
+
+        let over = std::panic::catch_unwind(|| assert_no_allocations(|| Box::new(5)));
+        assert!(over.is_err());
+    }
+}
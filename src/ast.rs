@@ -20,6 +20,24 @@ pub struct Ast {
     limits: crate::limits::CompilerLimits,
 }
 
+/// `Ast::add_node` on an AST that already holds `max_ast_nodes` nodes
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct NodeLimitExceeded {
+    pub max: usize,
+}
+
+impl std::fmt::Display for NodeLimitExceeded {
+    fn fmt(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
+        write!(
+            f,
+            "AST node limit exceeded (max: {} nodes). File is too complex.",
+            self.max
+        )
+    }
+}
+
+impl std::error::Error for NodeLimitExceeded {}
+
 // Node types in the parse tree
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum NodeType {
@@ -176,14 +194,28 @@ impl AstNode {
 
 impl Ast {
     pub fn new(string_storage: StringStorage, limits: crate::limits::CompilerLimits) -> Self {
+        Self::with_capacity(string_storage, limits, 0)
+    }
+
+    /// Empty AST with room for `nodes` nodes (capped at `max_ast_nodes`)
+    pub fn with_capacity(
+        string_storage: StringStorage,
+        limits: crate::limits::CompilerLimits,
+        nodes: usize,
+    ) -> Self {
         Self {
-            nodes: Vec::new(),
+            nodes: Vec::with_capacity(nodes.min(limits.max_ast_nodes)),
             string_storage,
             root: None,
             limits,
         }
     }
 
+    /// Limits the AST was built under (analysis budgets come from here too)
+    pub fn limits(&self) -> &crate::limits::CompilerLimits {
+        &self.limits
+    }
+
     /// Iterate over direct children of a node (first-child/next-sibling traversal)
     pub fn children(&self, node_idx: usize) -> ChildIter<'_> {
         ChildIter {
@@ -202,6 +234,11 @@ impl Ast {
         FunctionDeclView { ast: self, idx: node_idx }
     }
 
+    /// Get a typed view over a Param node
+    pub fn param(&self, node_idx: usize) -> ParamView<'_> {
+        ParamView { ast: self, idx: node_idx }
+    }
+
     /// Get a typed view over a Match node
     pub fn match_expr(&self, node_idx: usize) -> MatchView<'_> {
         MatchView { ast: self, idx: node_idx }
@@ -213,19 +250,24 @@ impl Ast {
     }
 
     // Add node and return its index
-    pub fn add_node(&mut self, node: AstNode) -> usize {
-        // Check AST node limit before adding
-        if self.nodes.len() >= self.limits.max_ast_nodes {
-            panic!(
-                "AST node limit exceeded: {} nodes (max: {}). File is too complex.",
-                self.nodes.len(),
-                self.limits.max_ast_nodes
-            );
-        }
-
+    //
+    // Fails once the AST holds `max_ast_nodes` nodes; the parser turns that
+    // into a ParseError at the current token.
+    #[inline]
+    pub fn add_node(&mut self, node: AstNode) -> Result<usize, NodeLimitExceeded> {
         let idx = self.nodes.len();
+        if idx >= self.limits.max_ast_nodes {
+            return Err(self.node_limit_exceeded());
+        }
         self.nodes.push(node);
-        idx
+        Ok(idx)
+    }
+
+    #[cold]
+    fn node_limit_exceeded(&self) -> NodeLimitExceeded {
+        NodeLimitExceeded {
+            max: self.limits.max_ast_nodes,
+        }
     }
 
     // Link child to parent (adds as last child)
@@ -657,3 +699,49 @@ impl<'a> MatchArmView<'a> {
         self.ast.nodes[pattern_idx].next_sibling
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::alloc_budget::count_allocations;
+    use crate::limits::CompilerLimits;
+
+    #[test]
+    fn test_add_node_allocation_budget() {
+        let mut ast = Ast::new(StringStorage::new(), CompilerLimits::default());
+
+        // Amortized growth only: ~log2(n) reallocations for n nodes
+        let (_, allocations) = count_allocations(|| {
+            for _ in 0..100_000 {
+                ast.add_node(AstNode::new(NodeType::Block)).unwrap();
+            }
+        });
+        assert_eq!(ast.nodes.len(), 100_000);
+        assert!(allocations <= 20, "{} allocations for 100k nodes", allocations);
+    }
+
+    #[test]
+    fn test_add_node_limit() {
+        let limits = CompilerLimits {
+            max_ast_nodes: 2,
+            ..Default::default()
+        };
+        // Preallocation is capped at the node limit
+        let mut ast = Ast::with_capacity(StringStorage::new(), limits, 1000);
+        assert_eq!(ast.nodes.capacity(), 2);
+
+        let (added, allocations) = count_allocations(|| {
+            (0..2)
+                .map(|_| ast.add_node(AstNode::new(NodeType::Block)))
+                .collect::<Result<Vec<_>, _>>()
+                .map(|v| v.len())
+        });
+        assert_eq!(added, Ok(2));
+        assert_eq!(allocations, 1); // the collected Vec only
+        assert_eq!(
+            ast.add_node(AstNode::new(NodeType::Block)),
+            Err(NodeLimitExceeded { max: 2 })
+        );
+        assert_eq!(ast.nodes.len(), 2);
+    }
+}
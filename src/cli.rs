@@ -1,5 +1,7 @@
 use clap::{Parser, Subcommand};
 
+use crate::codegen::OptLevel;
+
 #[derive(Parser)]
 #[command(name = "suru")]
 #[command(about = "Suru language compiler")]
@@ -12,18 +14,163 @@ pub struct Cli {
 pub enum Commands {
     /// Parse a Suru source file and print the AST
     Parse(ParseArgs),
-    /// Type-check a Suru source file
+    /// Type-check a Suru source file, or a directory tree with --watch
     Check(CheckArgs),
+    /// Type-check a Suru source file and print its lowered IR
+    Lower(LowerArgs),
+    /// Compile a Suru source file into a native executable
+    Build(BuildArgs),
+    /// Compile a Suru source file and run it
+    Run(RunArgs),
+    /// Run a long-lived compiler daemon that answers check/parse requests
+    Daemon(DaemonArgs),
+    /// Start a language server over stdio
+    Lsp,
 }
 
 #[derive(clap::Args)]
 pub struct CheckArgs {
     /// Input file path
-    pub file: String,
+    #[arg(required_unless_present = "watch")]
+    pub file: Option<String>,
+
+    /// Check every .suru file under DIR, then re-check on changes
+    #[arg(long, value_name = "DIR", conflicts_with = "file")]
+    pub watch: Option<String>,
+
+    /// Number of checker threads in watch mode (default: available cores)
+    #[arg(long)]
+    pub jobs: Option<usize>,
+
+    /// Detect changes by rescanning instead of inotify in watch mode
+    #[arg(long)]
+    pub poll: bool,
+
+    /// Print wall time, allocations and peak memory of each compiler pass
+    #[arg(long, conflicts_with = "watch")]
+    pub time_passes: bool,
+
+    /// Print token, node, string, type, constraint and type variable counts
+    #[arg(long, conflicts_with = "watch")]
+    pub stats: bool,
+
+    /// Print the heap bytes held by each major compiler structure
+    #[arg(long, conflicts_with = "watch")]
+    pub mem_report: bool,
+
+    /// Write a Chrome trace of the compiler passes to FILE (needs the
+    /// `trace` feature); in watch mode it is rewritten after every round
+    #[arg(long, value_name = "FILE")]
+    pub trace: Option<String>,
 }
 
 #[derive(clap::Args)]
 pub struct ParseArgs {
     /// Input file path
     pub file: String,
+
+    /// Print wall time, allocations and peak memory of each compiler pass
+    #[arg(long)]
+    pub time_passes: bool,
+
+    /// Print token, node, string, type, constraint and type variable counts
+    #[arg(long)]
+    pub stats: bool,
+
+    /// Print the heap bytes held by each major compiler structure
+    #[arg(long)]
+    pub mem_report: bool,
+
+    /// Write a Chrome trace of the compiler passes to FILE (needs the
+    /// `trace` feature)
+    #[arg(long, value_name = "FILE")]
+    pub trace: Option<String>,
+}
+
+#[derive(clap::Args)]
+pub struct LowerArgs {
+    /// Input file path
+    pub file: String,
+
+    /// Print wall time, allocations and peak memory of each compiler pass
+    #[arg(long)]
+    pub time_passes: bool,
+
+    /// Print the heap bytes held by each major compiler structure
+    #[arg(long)]
+    pub mem_report: bool,
+
+    /// Share one body between specializations whose type arguments have the
+    /// same layout, instead of one body per type. Affects the printed IR
+    /// only: `suru build` does not compile generic functions yet.
+    #[arg(long)]
+    pub share_generics: bool,
+}
+
+#[derive(clap::Args)]
+pub struct BuildArgs {
+    /// Input file path
+    pub file: String,
+
+    /// Executable path (default: target/dev/<file stem>)
+    #[arg(short, long, value_name = "PATH")]
+    pub output: Option<String>,
+
+    /// Optimization level: 0 (fast builds), 1, 2, 3 (fast code) or s (small code)
+    #[arg(short = 'O', long = "opt-level", value_name = "LEVEL", default_value = "0")]
+    pub opt_level: OptLevel,
+
+    /// CPU to generate code for; `native` uses the host CPU and all its
+    /// features (default: a generic CPU of the host architecture)
+    #[arg(long, value_name = "CPU")]
+    pub target_cpu: Option<String>,
+
+    /// Split code generation into N LLVM modules optimized in parallel
+    /// (default: one per 32 functions, up to the number of cores)
+    #[arg(long, value_name = "N")]
+    pub codegen_units: Option<usize>,
+
+    /// Regenerate every codegen unit instead of reusing object files from
+    /// target/dev/cache
+    #[arg(long)]
+    pub no_cache: bool,
+
+    /// Print wall time, allocations and peak memory of each compiler pass
+    #[arg(long)]
+    pub time_passes: bool,
+
+    /// Print token, node, string, type, constraint and type variable counts
+    #[arg(long)]
+    pub stats: bool,
+}
+
+#[derive(clap::Args)]
+pub struct RunArgs {
+    /// Input file path
+    pub file: String,
+
+    /// Build an executable with the system linker and run it, instead of
+    /// compiling in memory and running in process
+    #[arg(long)]
+    pub native: bool,
+
+    /// Print wall time, allocations and peak memory of each compiler pass
+    #[arg(long)]
+    pub time_passes: bool,
+}
+
+#[derive(clap::Args)]
+pub struct DaemonArgs {
+    /// Unix socket path (default: $SURU_DAEMON_SOCKET, then
+    /// target/dev/suru-daemon.sock); clients resolve it the same way
+    #[arg(long)]
+    pub socket: Option<String>,
+
+    /// Interval in milliseconds between file change scans
+    #[arg(long, default_value_t = 200)]
+    pub poll_ms: u64,
+
+    /// Stop the daemon listening on the socket instead of starting one
+    #[arg(long)]
+    pub stop: bool,
 }
@@ -0,0 +1,332 @@
+// Object cache - reuses a codegen unit's object file from an earlier build
+// when nothing the unit was generated from has changed
+//
+// A unit's key hashes, with `StableHasher`:
+//   - the compiler version and the build options that shape machine code
+//     (optimization level, resolved CPU and features, unit index and count)
+//   - the interface every unit declares: each function's symbol, resolved
+//     parameter and return types, mutation bits and parameter attributes,
+//     the top-level globals, and the tag of every named unit
+//   - the body of each function the unit emits: node kinds, flags, token
+//     text and resolved type of every node, and the locals it keeps in the
+//     frame; plus the top-level statements for the entry unit
+// Source positions are left out, so moving code does not invalidate it.
+// Entries are `<key>.o` files and are never evicted.
+
+use std::collections::{HashMap, HashSet};
+use std::path::{Path, PathBuf};
+
+use super::{BuildOptions, Codegen, native};
+use crate::ast::NodeType;
+use crate::semantic::{Type, TypeId};
+use crate::stable_hash::StableHasher;
+
+/// Bumped whenever code generation changes what it emits for the same input
+const CACHE_FORMAT: u32 = 3;
+
+/// Object files of earlier builds, by unit key
+pub(super) struct ObjectCache {
+    dir: PathBuf,
+}
+
+impl ObjectCache {
+    pub fn new(dir: &Path) -> Self {
+        ObjectCache {
+            dir: dir.to_path_buf(),
+        }
+    }
+
+    fn entry(&self, key: u128) -> PathBuf {
+        self.dir.join(format!("{:032x}.o", key))
+    }
+
+    /// Puts the cached object for `key` at `object`; false on a miss
+    pub fn restore(&self, key: u128, object: &Path) -> bool {
+        let entry = self.entry(key);
+        if !entry.is_file() {
+            return false;
+        }
+        let _ = std::fs::remove_file(object);
+        link_or_copy(&entry, object).is_ok()
+    }
+
+    /// Saves `object` under `key`. The entry appears atomically, so a
+    /// concurrent build never reads a partial file; failing to store only
+    /// costs a later rebuild.
+    pub fn store(&self, key: u128, object: &Path) {
+        if std::fs::create_dir_all(&self.dir).is_err() {
+            return;
+        }
+        let partial = self
+            .dir
+            .join(format!("{:032x}.{}.partial", key, std::process::id()));
+        let _ = std::fs::remove_file(&partial);
+        if link_or_copy(object, &partial).is_ok() {
+            if std::fs::rename(&partial, self.entry(key)).is_err() {
+                let _ = std::fs::remove_file(&partial);
+            }
+        }
+    }
+}
+
+/// Hard links `from` to `to`, or copies it across file systems. A restored
+/// object may share its inode with a cache entry, so `emit_unit` removes a
+/// unit's object before writing a new one rather than rewriting it in place
+fn link_or_copy(from: &Path, to: &Path) -> std::io::Result<()> {
+    std::fs::hard_link(from, to).or_else(|_| std::fs::copy(from, to).map(|_| ()))
+}
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    /// Cache key of this unit; valid once `declare` has run
+    pub(super) fn unit_key(&self, options: &BuildOptions) -> u128 {
+        let mut hasher = StableHasher::new();
+        let mut types = TypeHashes::default();
+
+        hasher.u64(CACHE_FORMAT as u64);
+        hasher.str(env!("CARGO_PKG_VERSION"));
+        hasher.str(options.opt_level.pipeline());
+        let (cpu, features) = native::cpu_and_features(options);
+        hasher.str(&cpu);
+        hasher.str(&features);
+        hasher.u64(self.unit.index as u64);
+        hasher.u64(self.unit.count as u64);
+
+        let mut decls = self.decls.clone();
+        decls.sort_by(|a, b| self.symbols[a].cmp(&self.symbols[b]));
+        for decl in &decls {
+            let signature = &self.signatures[decl];
+            hasher.str(&self.symbols[decl]);
+            for (name, ty) in &signature.params {
+                hasher.str(name);
+                hasher.u128(types.hash(self, *ty));
+            }
+            hasher.u128(types.hash(self, signature.return_type));
+            if let Some(this_type) = signature.this_type {
+                hasher.u128(types.hash(self, this_type));
+            }
+            hasher.u64(signature.mutations);
+            for (index, attribute) in &signature.param_attributes {
+                hasher.u64(*index as u64);
+                hasher.str(attribute);
+            }
+        }
+        let mut globals: Vec<_> = self.globals.iter().collect();
+        globals.sort_by(|a, b| a.0.cmp(b.0));
+        for (name, global) in globals {
+            hasher.str(name);
+            hasher.u128(types.hash(self, global.ty));
+        }
+        // `print` of a unit value selects among every unit in the program
+        for (id, ty) in self.output.type_registry.iter() {
+            if let Type::NamedUnit(name) = ty {
+                hasher.str(name);
+                hasher.u64(id.index() as u64);
+            }
+        }
+
+        for decl in &decls {
+            if self.unit.owns(&self.symbols[decl]) {
+                self.hash_subtree(&mut hasher, &mut types, *decl);
+                // Escape analysis looks across functions, so an edit elsewhere
+                // can move a local between the heap and the frame
+                let stack_locals = self.stack_locals.of_decl(*decl);
+                hasher.u64(stack_locals.len() as u64);
+                for name in stack_locals {
+                    hasher.str(name);
+                }
+            }
+        }
+        if self.unit.is_entry() {
+            if let Some(root) = self.output.ast.root {
+                let ast = self.ast();
+                for child in ast.children(root) {
+                    if ast.nodes[child].node_type != NodeType::FunctionDecl {
+                        self.hash_subtree(&mut hasher, &mut types, child);
+                    }
+                }
+            }
+        }
+        hasher.finish()
+    }
+
+    /// Hashes the shape, text and resolved types of the subtree at `node`
+    fn hash_subtree(&self, hasher: &mut StableHasher, types: &mut TypeHashes, node: usize) {
+        let ast = self.ast();
+        let ast_node = &ast.nodes[node];
+        hasher.bytes(&[ast_node.node_type as u8, ast_node.flags.bits()]);
+        hasher.str(ast.node_text(node).unwrap_or(""));
+        let ty = self
+            .output
+            .type_of(node)
+            .map_or(0, |ty| types.hash(self, ty));
+        hasher.u128(ty);
+        for child in ast.children(node) {
+            self.hash_subtree(hasher, types, child);
+        }
+        // Closes the child list, so sibling and child nodes hash differently
+        hasher.bytes(&[0xff]);
+    }
+}
+
+/// Structural hashes of resolved types, memoized per TypeId
+///
+/// TypeIds themselves depend on the order types were registered in, which
+/// unrelated edits change, so types are hashed by their contents. Named
+/// units are the exception: their TypeId index is the tag compiled code
+/// compares against.
+#[derive(Default)]
+struct TypeHashes {
+    hashes: HashMap<TypeId, u128>,
+    /// Types being hashed, to cut recursion through recursive types
+    active: HashSet<TypeId>,
+}
+
+impl TypeHashes {
+    fn hash(&mut self, codegen: &Codegen, ty: TypeId) -> u128 {
+        let output = codegen.output;
+        let ty = output.substitution.apply(ty, &output.type_registry);
+        if let Some(hash) = self.hashes.get(&ty) {
+            return *hash;
+        }
+        let mut hasher = StableHasher::new();
+        if !self.active.insert(ty) {
+            hasher.str("recursive");
+            return hasher.finish();
+        }
+        match codegen.resolve(ty) {
+            Type::NamedUnit(name) => {
+                hasher.str(name);
+                hasher.u64(ty.index() as u64);
+            }
+            Type::Struct(struct_type) => {
+                hasher.str("struct");
+                for field in &struct_type.fields {
+                    hasher.str(&field.name);
+                    hasher.bytes(&[field.is_private as u8]);
+                    hasher.u128(self.hash(codegen, field.type_id));
+                }
+                for method in &struct_type.methods {
+                    hasher.str(&method.name);
+                    hasher.u128(self.hash(codegen, method.function_type));
+                }
+            }
+            Type::Union(members) => {
+                hasher.str("union");
+                for member in members {
+                    hasher.u128(self.hash(codegen, *member));
+                }
+            }
+            Type::Function(function_type) => {
+                hasher.str("function");
+                for param in &function_type.params {
+                    hasher.str(&param.name);
+                    hasher.u128(self.hash(codegen, param.type_id));
+                }
+                hasher.u128(self.hash(codegen, function_type.return_type));
+            }
+            Type::Array(element) => {
+                hasher.str("array");
+                hasher.u128(self.hash(codegen, *element));
+            }
+            Type::Option(inner) => {
+                hasher.str("option");
+                hasher.u128(self.hash(codegen, *inner));
+            }
+            Type::Result(ok, err) => {
+                hasher.str("result");
+                hasher.u128(self.hash(codegen, *ok));
+                hasher.u128(self.hash(codegen, *err));
+            }
+            Type::Generic { type_params, inner } => {
+                hasher.str("generic");
+                for param in type_params {
+                    hasher.u128(self.hash(codegen, *param));
+                }
+                hasher.u128(self.hash(codegen, *inner));
+            }
+            Type::TypeParameter { name, constraint } => {
+                hasher.str("type parameter");
+                hasher.str(name);
+                if let Some(constraint) = constraint {
+                    hasher.u128(self.hash(codegen, *constraint));
+                }
+            }
+            // An unbound variable's id is as order-dependent as a TypeId
+            Type::Var(_) => hasher.str("var"),
+            // The remaining types hold no TypeIds
+            other => hasher.str(&format!("{:?}", other)),
+        }
+        self.active.remove(&ty);
+        let hash = hasher.finish();
+        self.hashes.insert(ty, hash);
+        hash
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_type_hashes_ignore_registration_order() {
+        use crate::semantic::{SemanticAnalyzer, StructField, StructType};
+        use inkwell::context::Context;
+
+        // The same types, registered after a varying number of others, so
+        // every TypeId below differs between the two registries
+        let register = |filler: usize| {
+            let limits = crate::limits::CompilerLimits::default();
+            let tokens = crate::lexer::lex("", &limits).unwrap();
+            let ast = crate::parser::parse(tokens, &limits).unwrap();
+            let mut output = SemanticAnalyzer::new(ast).analyze_with_types().unwrap();
+            let registry = &mut output.type_registry;
+            for index in 0..filler {
+                registry.intern(Type::NamedUnit(format!("Filler{}", index)));
+            }
+            let number = registry.intern(Type::Number);
+            let point = registry.intern(Type::Struct(StructType {
+                fields: vec![StructField {
+                    name: "x".to_string(),
+                    type_id: number,
+                    is_private: false,
+                }],
+                methods: Vec::new(),
+            }));
+            let array = registry.intern(Type::Array(point));
+            let option = registry.intern(Type::Option(array));
+            let result = registry.intern(Type::Result(option, point));
+            (output, [array, option, result])
+        };
+        let hashes = |filler: usize| {
+            let (output, types) = register(filler);
+            let context = Context::create();
+            let unit = super::super::units::CodegenUnit { index: 0, count: 1 };
+            let stack_locals = super::super::storage::StackLocals::default();
+            let codegen = Codegen::new(&context, &output, "test", unit, &stack_locals);
+            let mut hashes = TypeHashes::default();
+            (types, types.map(|ty| hashes.hash(&codegen, ty)))
+        };
+        let (near, near_hashes) = hashes(0);
+        let (far, far_hashes) = hashes(3);
+        assert_ne!(near, far);
+        assert_eq!(near_hashes, far_hashes);
+    }
+
+    #[test]
+    fn test_object_cache_store_and_restore() {
+        let dir = std::env::temp_dir().join(format!("suru-object-cache-{}", std::process::id()));
+        let cache = ObjectCache::new(&dir.join("cache"));
+        std::fs::create_dir_all(&dir).unwrap();
+        let object = dir.join("unit.o");
+        std::fs::write(&object, b"object code").unwrap();
+
+        assert!(!cache.restore(7, &object));
+        cache.store(7, &object);
+        std::fs::remove_file(&object).unwrap();
+        assert!(cache.restore(7, &object));
+        let restored = std::fs::read(&object).unwrap();
+        assert!(!cache.restore(8, &object));
+        std::fs::remove_dir_all(&dir).unwrap();
+        assert_eq!(restored, b"object code");
+    }
+}
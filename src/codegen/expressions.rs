@@ -0,0 +1,1029 @@
+// Expression emission - literals, variables, operators, calls, pipes, match
+// and struct literals
+
+use std::rc::Rc;
+
+use inkwell::basic_block::BasicBlock;
+use inkwell::types::{BasicMetadataTypeEnum, BasicTypeEnum};
+use inkwell::values::{BasicMetadataValueEnum, BasicValue, BasicValueEnum, IntValue, PointerValue};
+use inkwell::{FloatPredicate, IntPredicate};
+
+use super::types::StructLayout;
+use super::{Codegen, CodegenError, Value};
+use crate::ast::NodeType;
+use crate::lexer::{StringKind, TokenKind};
+use crate::semantic::{Type, TypeId};
+
+/// An argument evaluated at a call site
+struct Arg<'ctx> {
+    value: Value<'ctx>,
+    node: usize,
+    /// The argument reads an existing variable or field rather than a fresh value
+    place: bool,
+}
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    pub(super) fn expr(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        match ast.nodes[node].node_type {
+            NodeType::LiteralNumber => self.number_literal(node),
+            NodeType::LiteralString => self.string_literal(node),
+            NodeType::LiteralBoolean => {
+                let is_true = matches!(
+                    ast.nodes[node].token.as_ref().map(|t| &t.kind),
+                    Some(TokenKind::True)
+                );
+                let ty = self.output.type_of(node).unwrap_or(self.void);
+                let value = self.context.bool_type().const_int(is_true as u64, false);
+                Ok(Value {
+                    llvm: Some(value.into()),
+                    ty,
+                })
+            }
+            NodeType::Identifier => self.identifier(node),
+            NodeType::This => self
+                .frame()
+                .this
+                .ok_or_else(|| self.error(node, "'this' outside a struct method".to_string())),
+            NodeType::Not => {
+                let operand = self.operand(node)?;
+                let result = self.builder.build_not(operand.into_int_value(), "not")?;
+                Ok(Value {
+                    llvm: Some(result.into()),
+                    ty: self.operand_type(node)?,
+                })
+            }
+            NodeType::Negate => {
+                let operand = self.operand(node)?;
+                let result: BasicValueEnum = match operand {
+                    BasicValueEnum::FloatValue(v) => self.builder.build_float_neg(v, "neg")?.into(),
+                    other => self
+                        .builder
+                        .build_int_neg(other.into_int_value(), "neg")?
+                        .into(),
+                };
+                Ok(Value {
+                    llvm: Some(result),
+                    ty: self.operand_type(node)?,
+                })
+            }
+            NodeType::And => self.logical(node, true),
+            NodeType::Or => self.logical(node, false),
+            NodeType::FunctionCall => self.function_call(node),
+            NodeType::MethodCall => self.method_call(node),
+            NodeType::PropertyAccess => self.property_access(node),
+            NodeType::Pipe => self.pipe(node),
+            NodeType::Match => self.match_expr(node),
+            NodeType::StructInit => self.struct_init(node),
+            NodeType::Partial | NodeType::Placeholder => Err(self.error(
+                node,
+                "Partial application is not supported by code generation yet".to_string(),
+            )),
+            NodeType::Compose => Err(self.error(
+                node,
+                "Composition is not supported by code generation yet".to_string(),
+            )),
+            NodeType::List => Err(self.error(
+                node,
+                "List literals are not supported by code generation yet".to_string(),
+            )),
+            NodeType::Try => Err(self.error(
+                node,
+                "'try' is not supported by code generation yet".to_string(),
+            )),
+            other => Err(self.error(node, format!("Unexpected {:?} in an expression", other))),
+        }
+    }
+
+    /// Emits an expression whose struct value is about to be stored somewhere
+    /// new, copying it when it is read from an existing place
+    pub(super) fn owned_expr(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let value = self.expr(node)?;
+        if self.is_place(node) && self.is_struct(value.ty) {
+            return self.copy_struct(value, node);
+        }
+        Ok(value)
+    }
+
+    /// True when `node` reads an existing variable, field or `this`
+    pub(super) fn is_place(&self, node: usize) -> bool {
+        let ast = self.ast();
+        match ast.nodes[node].node_type {
+            NodeType::This | NodeType::PropertyAccess => true,
+            NodeType::Identifier => ast
+                .node_text(node)
+                .is_some_and(|n| self.lookup_variable(n).is_some()),
+            _ => false,
+        }
+    }
+
+    /// True when `node` reads a value the current function does not own:
+    /// a parameter, a global, a field or `this`
+    pub(super) fn is_borrowed_place(&self, node: usize) -> bool {
+        let ast = self.ast();
+        match ast.nodes[node].node_type {
+            NodeType::This | NodeType::PropertyAccess => true,
+            NodeType::Identifier => ast
+                .node_text(node)
+                .and_then(|n| self.lookup_variable(n))
+                .is_some_and(|variable| !variable.owned),
+            _ => false,
+        }
+    }
+
+    /// Drops a struct value nothing else owns: an unused fresh result, or an
+    /// argument made for a call once the call returns. Callees copy whatever
+    /// they keep, so they never hold on to an argument.
+    pub(super) fn drop_temporary(
+        &mut self,
+        value: Value<'ctx>,
+        node: usize,
+    ) -> Result<(), CodegenError> {
+        if value.llvm.is_none() || !self.is_struct(value.ty) {
+            return Ok(());
+        }
+        self.drop_struct(value, node)
+    }
+
+    fn lookup_variable(&self, name: &str) -> Option<super::Variable<'ctx>> {
+        let frame = self.frame();
+        frame
+            .locals
+            .get(name)
+            .or_else(|| self.globals.get(name))
+            .copied()
+    }
+
+    /// Reinterprets a value as type `ty`, which must share its representation
+    pub(super) fn coerce(
+        &mut self,
+        value: Value<'ctx>,
+        ty: crate::semantic::TypeId,
+        node: usize,
+    ) -> Result<Value<'ctx>, CodegenError> {
+        if value.ty == ty {
+            return Ok(value);
+        }
+        let from = self.llvm_type(value.ty, node)?;
+        let to = self.llvm_type(ty, node)?;
+        if from != to {
+            return Err(self.error(
+                node,
+                format!(
+                    "Cannot use a value of type '{}' as '{}' in generated code",
+                    self.type_name(value.ty),
+                    self.type_name(ty)
+                ),
+            ));
+        }
+        if self.is_struct(value.ty) && self.is_struct(ty) {
+            let from_layout = self.struct_layout(value.ty, node)?;
+            let to_layout = self.struct_layout(ty, node)?;
+            if from_layout.key != to_layout.key {
+                return Err(self.error(
+                    node,
+                    format!(
+                        "Cannot use a struct of type '{}' as '{}': structs with different fields or methods are not supported by code generation yet",
+                        self.type_name(value.ty),
+                        self.type_name(ty)
+                    ),
+                ));
+            }
+        }
+        Ok(Value {
+            llvm: value.llvm,
+            ty,
+        })
+    }
+
+    fn number_literal(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let text = self.ast().node_text(node).unwrap_or("0");
+        let Some(number) = parse_number(text) else {
+            return Err(self.error(node, format!("Invalid number literal '{}'", text)));
+        };
+        let ty = self.output.type_of(node).unwrap_or(self.void);
+        let value: BasicValueEnum = match self.value_type(ty, node)? {
+            BasicTypeEnum::FloatType(float) => float.const_float(number).into(),
+            BasicTypeEnum::IntType(int) => int.const_int(number as u64, false).into(),
+            _ => return Err(self.error(node, format!("Invalid number literal '{}'", text))),
+        };
+        Ok(Value {
+            llvm: Some(value),
+            ty,
+        })
+    }
+
+    fn string_literal(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        if let Some(TokenKind::String(StringKind::Interpolated)) =
+            ast.nodes[node].token.as_ref().map(|t| &t.kind)
+        {
+            return Err(self.error(
+                node,
+                "String interpolation is not supported by code generation yet".to_string(),
+            ));
+        }
+        let text = unescape(ast.node_text(node).unwrap_or(""));
+        let ptr = self.string_constant(&text)?;
+        let ty = self.output.type_of(node).unwrap_or(self.void);
+        Ok(Value {
+            llvm: Some(ptr.into()),
+            ty,
+        })
+    }
+
+    /// A variable read, a function used as a value, or a named unit
+    fn identifier(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let name = self.ast().node_text(node).unwrap_or("");
+        if let Some(variable) = self.lookup_variable(name) {
+            let llvm_type = self.value_type(variable.ty, node)?;
+            let value = self.builder.build_load(llvm_type, variable.ptr, name)?;
+            return Ok(Value {
+                llvm: Some(value),
+                ty: variable.ty,
+            });
+        }
+        if let Some(decl) = self.resolve_function(node, name) {
+            let signature = self.signature(decl)?;
+            let ptr = signature.function.as_global_value().as_pointer_value();
+            let ty = self.output.function_types[&decl];
+            return Ok(Value {
+                llvm: Some(ptr.into()),
+                ty,
+            });
+        }
+        if let Some(ty) = self
+            .output
+            .type_registry
+            .lookup(&Type::NamedUnit(name.to_string()))
+        {
+            let tag = self.context.i64_type().const_int(ty.index() as u64, false);
+            return Ok(Value {
+                llvm: Some(tag.into()),
+                ty,
+            });
+        }
+        if name == "print" {
+            return Err(self.error(
+                node,
+                "The built-in 'print' cannot be used as a value yet".to_string(),
+            ));
+        }
+        Err(self.error(
+            node,
+            format!(
+                "'{}' is not available here; capturing variables of an enclosing function is not supported by code generation yet",
+                name
+            ),
+        ))
+    }
+
+    /// Value of a unary operator's operand
+    fn operand(&mut self, node: usize) -> Result<BasicValueEnum<'ctx>, CodegenError> {
+        let child = self.ast().nodes[node]
+            .first_child
+            .expect("unary operator has an operand");
+        let value = self.expr(child)?;
+        value
+            .llvm
+            .ok_or_else(|| self.error(child, "Expected a value, found Void".to_string()))
+    }
+
+    fn operand_type(&mut self, node: usize) -> Result<crate::semantic::TypeId, CodegenError> {
+        match self.static_type(node)? {
+            Some(ty) => Ok(ty),
+            None => Err(self.error(
+                node,
+                "Cannot determine the type of this expression".to_string(),
+            )),
+        }
+    }
+
+    /// Short-circuiting `and` / `or`
+    fn logical(&mut self, node: usize, is_and: bool) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let left = ast.nodes[node]
+            .first_child
+            .expect("binary operator has a left operand");
+        let right = ast.nodes[left]
+            .next_sibling
+            .expect("binary operator has a right operand");
+        let function = self.frame().function;
+        let (rhs_name, end_name) = if is_and {
+            ("and.rhs", "and.end")
+        } else {
+            ("or.rhs", "or.end")
+        };
+
+        let lhs = self
+            .expr(left)?
+            .llvm
+            .expect("logical operands are Bool")
+            .into_int_value();
+        let lhs_block = self.current_block();
+        let rhs_block = self.context.append_basic_block(function, rhs_name);
+        let end_block = self.context.append_basic_block(function, end_name);
+        if is_and {
+            self.builder
+                .build_conditional_branch(lhs, rhs_block, end_block)?;
+        } else {
+            self.builder
+                .build_conditional_branch(lhs, end_block, rhs_block)?;
+        }
+
+        self.builder.position_at_end(rhs_block);
+        let rhs = self
+            .expr(right)?
+            .llvm
+            .expect("logical operands are Bool")
+            .into_int_value();
+        let rhs_end = self.current_block();
+        self.builder.build_unconditional_branch(end_block)?;
+
+        self.builder.position_at_end(end_block);
+        let bool_type = self.context.bool_type();
+        let short_circuit = bool_type.const_int(!is_and as u64, false);
+        let phi = self
+            .builder
+            .build_phi(bool_type, if is_and { "and" } else { "or" })?;
+        phi.add_incoming(&[(&short_circuit, lhs_block), (&rhs, rhs_end)]);
+        let ty = self.operand_type(node)?;
+        Ok(Value {
+            llvm: Some(phi.as_basic_value()),
+            ty,
+        })
+    }
+
+    fn current_block(&self) -> BasicBlock<'ctx> {
+        self.builder
+            .get_insert_block()
+            .expect("builder is positioned in a block")
+    }
+
+    /// Argument nodes of a FunctionCall or MethodCall's ArgList
+    fn call_arguments(&self, arg_list: Option<usize>) -> Vec<usize> {
+        arg_list
+            .map(|list| self.ast().children(list).collect())
+            .unwrap_or_default()
+    }
+
+    fn arg(&mut self, node: usize) -> Result<Arg<'ctx>, CodegenError> {
+        let value = self.expr(node)?;
+        Ok(Arg {
+            value,
+            node,
+            place: self.is_place(node),
+        })
+    }
+
+    fn function_call(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let ident = ast.nodes[node]
+            .first_child
+            .expect("FunctionCall has a name");
+        let name = ast.node_text(ident).unwrap_or("");
+        let arg_nodes = self.call_arguments(ast.nodes[ident].next_sibling);
+        if arg_nodes
+            .iter()
+            .any(|&a| ast.nodes[a].node_type == NodeType::Placeholder)
+        {
+            return Err(self.error(
+                node,
+                "Partial application is not supported by code generation yet".to_string(),
+            ));
+        }
+        let mut args = Vec::with_capacity(arg_nodes.len());
+        for arg_node in arg_nodes {
+            args.push(self.arg(arg_node)?);
+        }
+        self.call_named(node, name, args)
+    }
+
+    /// Calls the function `name` visible at `node`, or the built-in `print`
+    fn call_named(
+        &mut self,
+        node: usize,
+        name: &str,
+        args: Vec<Arg<'ctx>>,
+    ) -> Result<Value<'ctx>, CodegenError> {
+        if let Some(decl) = self.resolve_function(node, name) {
+            return self.call_decl(decl, args, node);
+        }
+        if name == "print" && args.len() == 1 {
+            self.print(args[0].value, args[0].node)?;
+            return Ok(self.void_value());
+        }
+        Err(self.error(
+            node,
+            format!("Cannot resolve function '{}' for code generation", name),
+        ))
+    }
+
+    fn call_decl(
+        &mut self,
+        decl: usize,
+        args: Vec<Arg<'ctx>>,
+        node: usize,
+    ) -> Result<Value<'ctx>, CodegenError> {
+        let signature = self.signature(decl)?;
+        if args.len() != signature.params.len() {
+            return Err(self.error(
+                node,
+                format!(
+                    "Expected {} arguments, found {}",
+                    signature.params.len(),
+                    args.len()
+                ),
+            ));
+        }
+        let mut llvm_args: Vec<BasicMetadataValueEnum<'ctx>> = Vec::with_capacity(args.len());
+        let mut temporaries = Vec::new();
+        for (index, (arg, (_, param_ty))) in args.iter().zip(&signature.params).enumerate() {
+            let mut value = arg.value;
+            let mutated = index < 64 && signature.mutations & (1 << index) != 0;
+            if mutated && arg.place && self.is_struct(value.ty) {
+                value = self.copy_struct(value, arg.node)?;
+            }
+            if mutated || !arg.place {
+                temporaries.push((value, arg.node));
+            }
+            let value = self.coerce(value, *param_ty, arg.node)?;
+            llvm_args.push(self.argument_value(value, arg.node)?);
+        }
+        let name = if self.llvm_type(signature.return_type, node)?.is_some() {
+            "call"
+        } else {
+            ""
+        };
+        let call = self
+            .builder
+            .build_call(signature.function, &llvm_args, name)?;
+        for (value, node) in temporaries {
+            self.drop_temporary(value, node)?;
+        }
+        Ok(Value {
+            llvm: call.try_as_basic_value().left(),
+            ty: signature.return_type,
+        })
+    }
+
+    fn argument_value(
+        &self,
+        value: Value<'ctx>,
+        node: usize,
+    ) -> Result<BasicMetadataValueEnum<'ctx>, CodegenError> {
+        value
+            .llvm
+            .map(Into::into)
+            .ok_or_else(|| self.error(node, "Cannot pass a Void value as an argument".to_string()))
+    }
+
+    /// `receiver.method(args)`: loads the method's slot and calls it with
+    /// the receiver as `this`
+    fn method_call(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let receiver = ast.nodes[node]
+            .first_child
+            .expect("MethodCall has a receiver");
+        let method = ast.nodes[receiver]
+            .next_sibling
+            .expect("MethodCall has a method name");
+        let name = ast.node_text(method).unwrap_or("");
+        let arg_nodes = self.call_arguments(ast.nodes[method].next_sibling);
+
+        let target = self.expr(receiver)?;
+        let layout = self.struct_layout(target.ty, receiver)?;
+        let Some(slot) = layout.method_index(name) else {
+            return Err(self.error(method, format!("Struct has no method '{}'", name)));
+        };
+        let method_ty = layout.methods[slot as usize - layout.fields.len()].1;
+        let Type::Function(function_type) = self.resolve(method_ty) else {
+            return Err(self.error(method, format!("Method '{}' has no function type", name)));
+        };
+        let return_type = if matches!(self.resolve(function_type.return_type), Type::Unknown) {
+            match self
+                .method_returns
+                .get(&(layout.key.clone(), name.to_string()))
+            {
+                Some(ty) => *ty,
+                None => {
+                    return Err(self.error(
+                        method,
+                        format!(
+                            "Cannot infer the return type of method '{}'; add a return type annotation",
+                            name
+                        ),
+                    ));
+                }
+            }
+        } else {
+            function_type.return_type
+        };
+        if arg_nodes.len() != function_type.params.len() {
+            return Err(self.error(
+                node,
+                format!(
+                    "Expected {} arguments, found {}",
+                    function_type.params.len(),
+                    arg_nodes.len()
+                ),
+            ));
+        }
+
+        let this = target.llvm.expect("struct values are pointers");
+        let mut param_types: Vec<BasicMetadataTypeEnum<'ctx>> = vec![self.ptr_type().into()];
+        let mut llvm_args: Vec<BasicMetadataValueEnum<'ctx>> = vec![this.into()];
+        // A method returns copies of `this` and its fields, so a fresh
+        // receiver is released with the arguments
+        let mut temporaries = Vec::new();
+        if !self.is_place(receiver) {
+            temporaries.push((target, receiver));
+        }
+        for (arg_node, param) in arg_nodes.into_iter().zip(&function_type.params) {
+            // The slot may hold any implementation, so struct arguments are
+            // copied whenever the callee could mutate them
+            let arg = self.arg(arg_node)?;
+            let mut value = arg.value;
+            if arg.place && self.is_struct(value.ty) {
+                value = self.copy_struct(value, arg_node)?;
+            }
+            temporaries.push((value, arg_node));
+            let value = self.coerce(value, param.type_id, arg_node)?;
+            param_types.push(self.value_type(param.type_id, arg_node)?.into());
+            llvm_args.push(self.argument_value(value, arg_node)?);
+        }
+
+        let slot_ptr =
+            self.builder
+                .build_struct_gep(layout.llvm, this.into_pointer_value(), slot, name)?;
+        let function_ptr = self.builder.build_load(self.ptr_type(), slot_ptr, name)?;
+        let llvm_type = self.function_type(&param_types, return_type, node)?;
+        let call_name = if llvm_type.get_return_type().is_some() {
+            "call"
+        } else {
+            ""
+        };
+        let call = self.builder.build_indirect_call(
+            llvm_type,
+            function_ptr.into_pointer_value(),
+            &llvm_args,
+            call_name,
+        )?;
+        for (value, node) in temporaries {
+            self.drop_temporary(value, node)?;
+        }
+        Ok(Value {
+            llvm: call.try_as_basic_value().left(),
+            ty: return_type,
+        })
+    }
+
+    fn property_access(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let receiver = ast.nodes[node]
+            .first_child
+            .expect("PropertyAccess has a receiver");
+        let field = ast.nodes[receiver]
+            .next_sibling
+            .and_then(|f| ast.node_text(f))
+            .unwrap_or("");
+
+        let target = self.expr(receiver)?;
+        let layout = self.struct_layout(target.ty, receiver)?;
+        let Some(index) = layout.field_index(field) else {
+            let message = match layout.method_index(field) {
+                Some(_) => format!("Method '{}' cannot be used as a value yet", field),
+                None => format!("Struct has no field '{}'", field),
+            };
+            return Err(self.error(node, message));
+        };
+        let field_ty = layout.fields[index as usize].1;
+        let llvm_type = self.value_type(field_ty, node)?;
+        let ptr = target
+            .llvm
+            .expect("struct values are pointers")
+            .into_pointer_value();
+        let slot = self
+            .builder
+            .build_struct_gep(layout.llvm, ptr, index, field)?;
+        let value = self.builder.build_load(llvm_type, slot, field)?;
+        // A struct field read off a fresh receiver still points into it, so
+        // only receivers of other fields are released here
+        if !self.is_place(receiver) && !self.is_struct(field_ty) {
+            self.drop_temporary(target, receiver)?;
+        }
+        Ok(Value {
+            llvm: Some(value),
+            ty: field_ty,
+        })
+    }
+
+    /// `value | f`, `value | f(a, _)` and `value | f()` (where `f()` returns
+    /// the function to call)
+    fn pipe(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let left = ast.nodes[node].first_child.expect("Pipe has a left side");
+        let right = ast.nodes[left].next_sibling.expect("Pipe has a right side");
+        let piped = self.arg(left)?;
+
+        match ast.nodes[right].node_type {
+            NodeType::Identifier => {
+                let name = ast.node_text(right).unwrap_or("");
+                self.call_named(right, name, vec![piped])
+            }
+            NodeType::FunctionCall => {
+                let ident = ast.nodes[right]
+                    .first_child
+                    .expect("FunctionCall has a name");
+                let name = ast.node_text(ident).unwrap_or("");
+                let arg_nodes = self.call_arguments(ast.nodes[ident].next_sibling);
+                let has_placeholder = arg_nodes
+                    .iter()
+                    .any(|&a| ast.nodes[a].node_type == NodeType::Placeholder);
+                if !has_placeholder {
+                    let callee = self.function_call(right)?;
+                    return self.call_function_value(callee, piped, right);
+                }
+
+                let mut piped = Some(piped);
+                let mut args = Vec::with_capacity(arg_nodes.len());
+                for arg_node in arg_nodes {
+                    if ast.nodes[arg_node].node_type == NodeType::Placeholder {
+                        match piped.take() {
+                            Some(arg) => args.push(arg),
+                            None => {
+                                return Err(self.error(
+                                    arg_node,
+                                    "Only one '_' can receive the piped value".to_string(),
+                                ));
+                            }
+                        }
+                    } else {
+                        args.push(self.arg(arg_node)?);
+                    }
+                }
+                self.call_named(right, name, args)
+            }
+            _ => Err(self.error(
+                right,
+                "Piping into this expression is not supported by code generation yet".to_string(),
+            )),
+        }
+    }
+
+    /// Calls a function pointer with a single argument
+    fn call_function_value(
+        &mut self,
+        callee: Value<'ctx>,
+        arg: Arg<'ctx>,
+        node: usize,
+    ) -> Result<Value<'ctx>, CodegenError> {
+        let Type::Function(function_type) = self.resolve(callee.ty) else {
+            return Err(self.error(node, "Expected a function to pipe into".to_string()));
+        };
+        let [param] = function_type.params.as_slice() else {
+            return Err(self.error(
+                node,
+                "Piped functions must take exactly one parameter".to_string(),
+            ));
+        };
+        if matches!(self.resolve(function_type.return_type), Type::Unknown) {
+            return Err(self.error(
+                node,
+                "Cannot determine what the piped function returns; add a return type annotation"
+                    .to_string(),
+            ));
+        }
+        let mut value = arg.value;
+        if arg.place && self.is_struct(value.ty) {
+            value = self.copy_struct(value, arg.node)?;
+        }
+        let temporary = value;
+        let value = self.coerce(value, param.type_id, arg.node)?;
+        let param_type = self.value_type(param.type_id, arg.node)?;
+        let llvm_type =
+            self.function_type(&[param_type.into()], function_type.return_type, node)?;
+        let call_name = if llvm_type.get_return_type().is_some() {
+            "call"
+        } else {
+            ""
+        };
+        let call = self.builder.build_indirect_call(
+            llvm_type,
+            callee
+                .llvm
+                .expect("function values are pointers")
+                .into_pointer_value(),
+            &[self.argument_value(value, arg.node)?],
+            call_name,
+        )?;
+        self.drop_temporary(temporary, arg.node)?;
+        Ok(Value {
+            llvm: call.try_as_basic_value().left(),
+            ty: function_type.return_type,
+        })
+    }
+
+    /// Tests the arms in order; the result of a non-Void match is a phi of
+    /// the arm results
+    fn match_expr(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let view = ast.match_expr(node);
+        let subject_idx = view.subject_expr_idx().expect("Match has a subject");
+        let subject = self.expr(subject_idx)?;
+        let Some(result_ty) = self.static_type(node)? else {
+            return Err(self.error(node, "Cannot determine the type of this match".to_string()));
+        };
+        let result_type = self.llvm_type(result_ty, node)?;
+
+        let function = self.frame().function;
+        let end_block = self.context.append_basic_block(function, "match.end");
+        let mut incoming: Vec<(BasicValueEnum<'ctx>, BasicBlock<'ctx>)> = Vec::new();
+        let mut exhausted = false;
+
+        for arm in view.arm_indices() {
+            let arm_view = ast.match_arm(arm);
+            let pattern = arm_view
+                .pattern_child_idx()
+                .expect("MatchArm has a pattern");
+            let result = arm_view.result_expr_idx().expect("MatchArm has a result");
+            let arm_block = self.context.append_basic_block(function, "match.arm");
+
+            if ast.nodes[pattern].node_type == NodeType::Placeholder {
+                self.builder.build_unconditional_branch(arm_block)?;
+                exhausted = true;
+            } else {
+                let matches = self.pattern_test(subject, pattern)?;
+                let next_block = self.context.append_basic_block(function, "match.next");
+                self.builder
+                    .build_conditional_branch(matches, arm_block, next_block)?;
+                self.builder.position_at_end(arm_block);
+                self.emit_arm(result, result_ty, end_block, &mut incoming)?;
+                self.builder.position_at_end(next_block);
+                continue;
+            }
+
+            self.builder.position_at_end(arm_block);
+            self.emit_arm(result, result_ty, end_block, &mut incoming)?;
+            break;
+        }
+        if !exhausted {
+            // Exhaustiveness was checked by the analyzer
+            self.builder.build_unreachable()?;
+        }
+
+        self.builder.position_at_end(end_block);
+        let Some(result_type) = result_type else {
+            return Ok(Value {
+                llvm: None,
+                ty: result_ty,
+            });
+        };
+        let phi = self.builder.build_phi(result_type, "match")?;
+        let incoming_refs: Vec<(&dyn BasicValue<'ctx>, BasicBlock<'ctx>)> = incoming
+            .iter()
+            .map(|(v, b)| (v as &dyn BasicValue<'ctx>, *b))
+            .collect();
+        phi.add_incoming(&incoming_refs);
+        Ok(Value {
+            llvm: Some(phi.as_basic_value()),
+            ty: result_ty,
+        })
+    }
+
+    fn emit_arm(
+        &mut self,
+        result: usize,
+        result_ty: crate::semantic::TypeId,
+        end_block: BasicBlock<'ctx>,
+        incoming: &mut Vec<(BasicValueEnum<'ctx>, BasicBlock<'ctx>)>,
+    ) -> Result<(), CodegenError> {
+        let value = self.owned_expr(result)?;
+        let value = self.coerce(value, result_ty, result)?;
+        if let Some(v) = value.llvm {
+            incoming.push((v, self.current_block()));
+        }
+        self.builder.build_unconditional_branch(end_block)?;
+        Ok(())
+    }
+
+    /// i1 that is true when `subject` matches a literal or named unit pattern
+    fn pattern_test(
+        &mut self,
+        subject: Value<'ctx>,
+        pattern: usize,
+    ) -> Result<IntValue<'ctx>, CodegenError> {
+        let ast = self.ast();
+        let subject_value = subject.llvm.expect("match subjects are values");
+        match ast.nodes[pattern].node_type {
+            NodeType::LiteralString => {
+                let literal = self
+                    .string_literal(pattern)?
+                    .llvm
+                    .expect("strings are pointers");
+                self.string_equals(
+                    subject_value.into_pointer_value(),
+                    literal.into_pointer_value(),
+                )
+            }
+            NodeType::LiteralNumber | NodeType::LiteralBoolean => {
+                let literal = self.expr(pattern)?.llvm.expect("literals are values");
+                let literal = self.coerce(
+                    Value {
+                        llvm: Some(literal),
+                        ty: subject.ty,
+                    },
+                    subject.ty,
+                    pattern,
+                )?;
+                match (subject_value, literal.llvm.expect("literals are values")) {
+                    (BasicValueEnum::FloatValue(s), BasicValueEnum::FloatValue(l)) => Ok(self
+                        .builder
+                        .build_float_compare(FloatPredicate::OEQ, s, l, "is")?),
+                    (BasicValueEnum::IntValue(s), BasicValueEnum::IntValue(l)) => Ok(self
+                        .builder
+                        .build_int_compare(IntPredicate::EQ, s, l, "is")?),
+                    _ => Err(self.error(
+                        pattern,
+                        "Pattern does not match the subject type".to_string(),
+                    )),
+                }
+            }
+            NodeType::Identifier => {
+                let name = ast.node_text(pattern).unwrap_or("");
+                let Some(unit) = self
+                    .output
+                    .type_registry
+                    .lookup(&Type::NamedUnit(name.to_string()))
+                else {
+                    return Err(
+                        self.error(pattern, format!("Pattern '{}' is not a unit type", name))
+                    );
+                };
+                let tag = self
+                    .context
+                    .i64_type()
+                    .const_int(unit.index() as u64, false);
+                Ok(self.builder.build_int_compare(
+                    IntPredicate::EQ,
+                    subject_value.into_int_value(),
+                    tag,
+                    "is",
+                )?)
+            }
+            _ => Err(self.error(pattern, "Unsupported match pattern".to_string())),
+        }
+    }
+
+    /// `{ field: value, method: () { ... } }` allocated on the heap, owning
+    /// its struct fields
+    fn struct_init(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let (ty, layout) = self.struct_init_layout(node)?;
+        let cell = self.builder.build_malloc(layout.llvm, "struct")?;
+        self.init_struct(node, ty, &layout, cell)
+    }
+
+    /// A struct literal built in a cell of the current frame, for a local
+    /// escape analysis proved does not outlive the call
+    pub(super) fn stack_struct_init(&mut self, node: usize) -> Result<Value<'ctx>, CodegenError> {
+        let (ty, layout) = self.struct_init_layout(node)?;
+        let cell = self.entry_alloca(layout.llvm.into(), "struct")?;
+        self.init_struct(node, ty, &layout, cell)
+    }
+
+    fn struct_init_layout(
+        &mut self,
+        node: usize,
+    ) -> Result<(TypeId, Rc<StructLayout<'ctx>>), CodegenError> {
+        let Some(ty) = self.output.type_of(node) else {
+            return Err(self.error(node, "Struct literal has no resolved type".to_string()));
+        };
+        Ok((ty, self.struct_layout(ty, node)?))
+    }
+
+    /// Stores a struct literal's members into `cell`
+    fn init_struct(
+        &mut self,
+        node: usize,
+        ty: TypeId,
+        layout: &StructLayout<'ctx>,
+        cell: PointerValue<'ctx>,
+    ) -> Result<Value<'ctx>, CodegenError> {
+        let ast = self.ast();
+        for member in ast.children(node) {
+            let name_idx = ast.nodes[member]
+                .first_child
+                .expect("struct members are named");
+            let name = ast.node_text(name_idx).unwrap_or("");
+            let value_idx = ast.nodes[name_idx]
+                .next_sibling
+                .expect("struct members have a value");
+            let (slot, value) = match ast.nodes[member].node_type {
+                NodeType::StructInitField => {
+                    let index = layout
+                        .field_index(name)
+                        .expect("literal fields are in its layout");
+                    let value = self.owned_expr(value_idx)?;
+                    let value = self.coerce(value, layout.fields[index as usize].1, value_idx)?;
+                    (index, value.llvm)
+                }
+                NodeType::StructInitMethod => {
+                    let index = layout
+                        .method_index(name)
+                        .expect("literal methods are in its layout");
+                    let function = self.signature(value_idx)?.function;
+                    (
+                        index,
+                        Some(function.as_global_value().as_pointer_value().into()),
+                    )
+                }
+                _ => continue,
+            };
+            if let Some(value) = value {
+                let ptr = self
+                    .builder
+                    .build_struct_gep(layout.llvm, cell, slot, name)?;
+                self.builder.build_store(ptr, value)?;
+            }
+        }
+        Ok(Value {
+            llvm: Some(cell.into()),
+            ty,
+        })
+    }
+}
+
+/// Value of a number literal's text: decimal, float, `0b`/`0o`/`0x` with
+/// `_` separators and an optional type suffix (`42i32`, `1.5f32`)
+fn parse_number(text: &str) -> Option<f64> {
+    let digits: String = text.chars().filter(|&c| c != '_').collect();
+    let (radix, body) = match digits.get(..2) {
+        Some("0b" | "0B") => (2, &digits[2..]),
+        Some("0o" | "0O") => (8, &digits[2..]),
+        Some("0x" | "0X") => (16, &digits[2..]),
+        _ => (10, digits.as_str()),
+    };
+    // 'f' is a hex digit, so hex literals only take integer suffixes
+    let is_suffix = |c: char| c == 'i' || c == 'u' || (c == 'f' && radix != 16);
+    let end = body.find(is_suffix).unwrap_or(body.len());
+    if radix == 10 {
+        body[..end].parse::<f64>().ok()
+    } else {
+        u64::from_str_radix(&body[..end], radix)
+            .ok()
+            .map(|v| v as f64)
+    }
+}
+
+/// Resolves the escape sequences kept raw in string tokens
+fn unescape(raw: &str) -> String {
+    let mut result = String::with_capacity(raw.len());
+    let mut chars = raw.chars();
+    while let Some(c) = chars.next() {
+        if c != '\\' {
+            result.push(c);
+            continue;
+        }
+        match chars.next() {
+            Some('n') => result.push('\n'),
+            Some('t') => result.push('\t'),
+            Some('r') => result.push('\r'),
+            Some('0') => result.push('\0'),
+            Some(escaped @ ('\\' | '"' | '\'' | '`')) => result.push(escaped),
+            Some(other) => {
+                result.push('\\');
+                result.push(other);
+            }
+            None => result.push('\\'),
+        }
+    }
+    result
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_parse_number() {
+        assert_eq!(parse_number("42"), Some(42.0));
+        assert_eq!(parse_number("1_000_000"), Some(1_000_000.0));
+        assert_eq!(parse_number("3.14"), Some(3.14));
+        assert_eq!(parse_number("2.5e-3"), Some(0.0025));
+        assert_eq!(parse_number("0b1010"), Some(10.0));
+        assert_eq!(parse_number("0o755"), Some(493.0));
+        assert_eq!(parse_number("0xDEAD_BEEF"), Some(3_735_928_559.0));
+        assert_eq!(parse_number("0xFF"), Some(255.0));
+        assert_eq!(parse_number("42i32"), Some(42.0));
+        assert_eq!(parse_number("3.14f32"), Some(3.14));
+        assert_eq!(parse_number("0xFFu8"), Some(255.0));
+    }
+
+    #[test]
+    fn test_unescape() {
+        assert_eq!(unescape(r"hello\nworld"), "hello\nworld");
+        assert_eq!(unescape(r#"say \"hi\"\t\\"#), "say \"hi\"\t\\");
+        assert_eq!(unescape(r"it\'s"), "it's");
+        assert_eq!(unescape(r"\q"), r"\q");
+    }
+}
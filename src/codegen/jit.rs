@@ -0,0 +1,42 @@
+// JIT execution - runs a module's `main` in the compiler's own process,
+// with no object file and no linker
+
+use std::ffi::{c_int, c_void};
+
+use inkwell::OptimizationLevel;
+use inkwell::execution_engine::ExecutionEngine;
+use inkwell::module::Module;
+
+use super::CodegenError;
+
+/// Signature of the C `main` the code generator emits
+type MainFunction = unsafe extern "C" fn() -> i32;
+
+unsafe extern "C" {
+    /// `fflush(NULL)` flushes every C stdio stream
+    fn fflush(stream: *mut c_void) -> c_int;
+}
+
+/// Compiles `module` to machine code in memory and calls its `main`,
+/// returning main's result as the exit code
+///
+/// The program shares this process's stdio, so its C streams are flushed
+/// before returning; output written with `printf` would otherwise land
+/// after anything the compiler prints next.
+pub(super) fn execute(module: &Module) -> Result<i32, CodegenError> {
+    let _span = crate::trace_span!("codegen", "jit_execute");
+    ExecutionEngine::link_in_mc_jit();
+    super::native::initialize_native()?;
+    let engine = module
+        .create_jit_execution_engine(OptimizationLevel::None)
+        .map_err(|e| CodegenError::new(format!("Cannot create a JIT: {}", e.to_string())))?;
+    // SAFETY: the code generator emits `main` as `i32 ()`
+    let main = unsafe { engine.get_function::<MainFunction>("main") }
+        .map_err(|e| CodegenError::new(format!("JIT lookup of 'main' failed: {}", e)))?;
+    // SAFETY: the module was verified and `main` takes no arguments
+    let exit_code = unsafe { main.call() };
+    unsafe {
+        fflush(std::ptr::null_mut());
+    }
+    Ok(exit_code)
+}
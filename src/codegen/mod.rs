@@ -0,0 +1,1111 @@
+// Code generation module - lowers a typed `AnalysisOutput` into an LLVM module
+//
+// Every FunctionDecl (top-level, nested, or a struct literal method) becomes
+// one LLVM function named after its lexical path (`suru.outer.inner`).
+// Top-level statements run in the C `main`, which then calls the program's
+// own `main` function when it declares one.
+//
+// Value representation:
+//   - Number -> double; Bool -> i1; sized ints and floats -> their LLVM width
+//   - String -> pointer to a NUL-terminated constant
+//   - named units, and unions of them -> i64 tag (the unit's TypeId index)
+//   - struct -> pointer to a heap cell laid out by `types::StructLayout`, or
+//     to a stack cell for the locals escape analysis keeps in the frame
+//   - function value -> function pointer
+//
+// Structs have value semantics: a copy is made whenever a struct is bound
+// from an existing place, or passed to a parameter the callee mutates.
+// Every heap cell has one owner - a local, a struct field, or the expression
+// that made it - which frees it when the function returns, the value is
+// overwritten, or the temporary has been used.
+mod cache;
+mod expressions;
+mod jit;
+mod native;
+mod optimize;
+mod runtime;
+mod statements;
+mod storage;
+mod types;
+mod units;
+
+use std::collections::{HashMap, HashSet};
+use std::path::{Path, PathBuf};
+use std::rc::Rc;
+
+use inkwell::builder::{Builder, BuilderError};
+use inkwell::context::Context;
+use inkwell::module::Module;
+use inkwell::types::BasicMetadataTypeEnum;
+use inkwell::values::{BasicValueEnum, FunctionValue, PointerValue};
+
+use crate::ast::{Ast, NodeType};
+use crate::semantic::{AnalysisOutput, Type, TypeId, type_to_display_string};
+use crate::stats::Profile;
+use cache::ObjectCache;
+use storage::StackLocals;
+use types::StructLayout;
+use units::CodegenUnit;
+
+pub use optimize::OptLevel;
+
+/// Error raised while lowering a program or producing its executable
+#[derive(Debug, Clone, PartialEq)]
+pub struct CodegenError {
+    pub message: String,
+    /// Source position; 0 when the error is not tied to a node
+    pub line: usize,
+    pub column: usize,
+}
+
+impl CodegenError {
+    pub fn new(message: String) -> Self {
+        CodegenError {
+            message,
+            line: 0,
+            column: 0,
+        }
+    }
+
+    /// Error positioned at the first token of `node_idx`'s subtree
+    pub fn at_node(message: String, ast: &Ast, node_idx: usize) -> Self {
+        let mut stack = vec![node_idx];
+        while let Some(idx) = stack.pop() {
+            if let Some(token) = &ast.nodes[idx].token {
+                return CodegenError {
+                    message,
+                    line: token.line,
+                    column: token.column,
+                };
+            }
+            let mut children: Vec<usize> = ast.children(idx).collect();
+            children.reverse();
+            stack.extend(children);
+        }
+        CodegenError::new(message)
+    }
+}
+
+impl std::fmt::Display for CodegenError {
+    fn fmt(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
+        if self.line == 0 {
+            write!(f, "Codegen error: {}", self.message)
+        } else {
+            write!(
+                f,
+                "Codegen error at {}:{}: {}",
+                self.line, self.column, self.message
+            )
+        }
+    }
+}
+
+impl std::error::Error for CodegenError {}
+
+impl From<BuilderError> for CodegenError {
+    fn from(e: BuilderError) -> Self {
+        CodegenError::new(format!("LLVM builder failed: {}", e))
+    }
+}
+
+/// Lowers an analyzed program into a verified LLVM module
+pub fn compile_module<'ctx>(
+    context: &'ctx Context,
+    output: &AnalysisOutput,
+    name: &str,
+) -> Result<Module<'ctx>, CodegenError> {
+    let stack_locals = StackLocals::of(output);
+    compile_unit(context, output, name, CodegenUnit::WHOLE, &stack_locals)
+}
+
+/// Lowers one codegen unit of an analyzed program into a verified module
+fn compile_unit<'ctx>(
+    context: &'ctx Context,
+    output: &AnalysisOutput,
+    name: &str,
+    unit: CodegenUnit,
+    stack_locals: &StackLocals,
+) -> Result<Module<'ctx>, CodegenError> {
+    let _span = crate::trace_span!("codegen", "compile_unit", unit.index);
+    let mut codegen = Codegen::new(context, output, name, unit, stack_locals);
+    codegen.declare()?;
+    codegen.define()
+}
+
+/// Options of `suru build`
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct BuildOptions {
+    pub opt_level: OptLevel,
+    /// CPU to tune and select instructions for; "native" for the host's.
+    /// None targets a generic CPU of the host architecture.
+    pub target_cpu: Option<String>,
+    /// Number of LLVM modules to generate and optimize in parallel; None
+    /// picks one per 32 functions, up to the available cores
+    pub codegen_units: Option<usize>,
+    /// Directory of the object cache; None always regenerates every unit
+    pub cache_dir: Option<PathBuf>,
+}
+
+/// Compiles an analyzed program into a native executable at `path`
+///
+/// Object files are written next to it with an `.o` extension (`.N.o` per
+/// codegen unit) and removed once linked.
+pub fn build_executable(
+    output: &AnalysisOutput,
+    path: &Path,
+    options: &BuildOptions,
+    profile: &mut Profile,
+) -> Result<(), CodegenError> {
+    native::initialize_native()?;
+    let stack_locals = profile.time("escape analysis", || StackLocals::of(output));
+    let count = units::unit_count(output, options.codegen_units);
+    let objects = if count == 1 {
+        let object = units::object_path(path, CodegenUnit::WHOLE);
+        let unit = CodegenUnit::WHOLE;
+        emit_unit(output, path, unit, options, &stack_locals, &object, profile)?;
+        vec![object]
+    } else {
+        profile.time("codegen units", || {
+            units::emit_units(output, path, options, &stack_locals, count)
+        })?
+    };
+    let linked = profile.time("link", || native::link_executable(&objects, path));
+    for object in &objects {
+        let _ = std::fs::remove_file(object);
+    }
+    linked
+}
+
+/// Generates, optimizes and emits one codegen unit of the executable at
+/// `path` as the object file `object`, or restores the object from the
+/// cache when the unit's key is unchanged
+fn emit_unit(
+    output: &AnalysisOutput,
+    path: &Path,
+    unit: CodegenUnit,
+    options: &BuildOptions,
+    stack_locals: &StackLocals,
+    object: &Path,
+    profile: &mut Profile,
+) -> Result<(), CodegenError> {
+    let stem = path.file_stem().and_then(|s| s.to_str()).unwrap_or("main");
+    let name = match unit.count {
+        1 => stem.to_string(),
+        _ => format!("{}.{}", stem, unit.index),
+    };
+    let context = Context::create();
+    let mut codegen = Codegen::new(&context, output, &name, unit, stack_locals);
+    profile.time("declare", || codegen.declare())?;
+    let cache = options.cache_dir.as_deref().map(ObjectCache::new);
+    let mut key = None;
+    if let Some(cache) = &cache {
+        let (unit_key, hit) = profile.time("object cache", || {
+            let unit_key = codegen.unit_key(options);
+            (unit_key, cache.restore(unit_key, object))
+        });
+        if hit {
+            return Ok(());
+        }
+        key = Some(unit_key);
+    }
+    let module = profile.time("codegen", || codegen.define())?;
+    let machine = native::host_target_machine(options)?;
+    native::configure_module(&module, &machine);
+    profile.time("optimize", || {
+        optimize::run_pipeline(&module, &machine, options.opt_level)
+    })?;
+    // A leftover object from an interrupted build may still be a hard link
+    // to a cache entry; writing through it would corrupt that entry
+    let _ = std::fs::remove_file(object);
+    profile.time("emit object", || {
+        native::emit_object(&module, &machine, object)
+    })?;
+    if let (Some(cache), Some(key)) = (cache, key) {
+        cache.store(key, object);
+    }
+    Ok(())
+}
+
+/// Compiles an analyzed program and runs it in process (`suru run`),
+/// returning the exit code of its `main`
+pub fn run_jit(
+    output: &AnalysisOutput,
+    name: &str,
+    profile: &mut Profile,
+) -> Result<i32, CodegenError> {
+    let context = Context::create();
+    let module = profile.time("codegen", || compile_module(&context, output, name))?;
+    profile.time("jit", || jit::execute(&module))
+}
+
+/// A lowered value with the Suru type it carries (`llvm` is None for Void)
+#[derive(Clone, Copy)]
+struct Value<'ctx> {
+    llvm: Option<BasicValueEnum<'ctx>>,
+    ty: TypeId,
+}
+
+/// Storage of a named variable: a stack slot, or a global at top level
+#[derive(Clone, Copy)]
+struct Variable<'ctx> {
+    ptr: PointerValue<'ctx>,
+    ty: TypeId,
+    /// False for parameters and globals, whose struct values belong to
+    /// someone else and must be copied before they escape
+    owned: bool,
+    /// The struct cell is in the frame; dropping it releases only its fields
+    on_stack: bool,
+}
+
+/// Lowered signature of one FunctionDecl
+struct Signature<'ctx> {
+    function: FunctionValue<'ctx>,
+    /// Declared parameters (the implicit `this` of methods comes first in LLVM)
+    params: Vec<(String, TypeId)>,
+    return_type: TypeId,
+    /// Struct type of `this` for struct literal methods
+    this_type: Option<TypeId>,
+    /// Bit i set when the body mutates parameter i
+    mutations: u64,
+    /// `readonly`/`readnone` by LLVM parameter index, derived from the body;
+    /// callers in other codegen units rely on them too
+    param_attributes: Vec<(u32, &'static str)>,
+}
+
+/// Per-function emission state
+struct Frame<'ctx> {
+    function: FunctionValue<'ctx>,
+    locals: HashMap<String, Variable<'ctx>>,
+    this: Option<Value<'ctx>>,
+    return_type: TypeId,
+    /// True while emitting the C `main`, where VarDecls store into globals
+    top_level: bool,
+    /// Locals to give a stack cell when they are declared
+    stack_names: HashSet<String>,
+    /// Stack locals to drop after each body statement, their last use
+    stack_drops: HashMap<usize, Vec<String>>,
+}
+
+struct Codegen<'a, 'ctx> {
+    context: &'ctx Context,
+    module: Module<'ctx>,
+    builder: Builder<'ctx>,
+    output: &'a AnalysisOutput,
+    /// FunctionDecl nodes in source order
+    decls: Vec<usize>,
+    /// LLVM symbol of each FunctionDecl
+    symbols: HashMap<usize, String>,
+    /// Struct type of `this` for each struct literal method's FunctionDecl
+    method_this: HashMap<usize, TypeId>,
+    signatures: HashMap<usize, Rc<Signature<'ctx>>>,
+    /// FunctionDecls whose return type is being inferred (recursion guard)
+    inferring: HashSet<usize>,
+    layouts: HashMap<TypeId, Rc<StructLayout<'ctx>>>,
+    /// Return types of struct literal methods, by layout key and method name
+    method_returns: HashMap<(String, String), TypeId>,
+    globals: HashMap<String, Variable<'ctx>>,
+    /// Which functions this module defines
+    unit: CodegenUnit,
+    stack_locals: &'a StackLocals,
+    runtime: runtime::Runtime<'ctx>,
+    frame: Option<Frame<'ctx>>,
+    void: TypeId,
+}
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    fn new(
+        context: &'ctx Context,
+        output: &'a AnalysisOutput,
+        name: &str,
+        unit: CodegenUnit,
+        stack_locals: &'a StackLocals,
+    ) -> Self {
+        Codegen {
+            context,
+            module: context.create_module(name),
+            builder: context.create_builder(),
+            output,
+            decls: Vec::new(),
+            symbols: HashMap::new(),
+            method_this: HashMap::new(),
+            signatures: HashMap::new(),
+            inferring: HashSet::new(),
+            layouts: HashMap::new(),
+            method_returns: HashMap::new(),
+            globals: HashMap::new(),
+            unit,
+            stack_locals,
+            runtime: runtime::Runtime::default(),
+            frame: None,
+            void: output
+                .type_registry
+                .lookup(&Type::Void)
+                .expect("Void is registered with the built-in functions"),
+        }
+    }
+
+    /// Declares every function and global: everything a unit's code may
+    /// refer to, and all the object cache needs to key the unit
+    fn declare(&mut self) -> Result<(), CodegenError> {
+        if let Some(root) = self.output.ast.root {
+            self.collect_functions(root, &mut Vec::new(), &mut HashSet::new());
+            for decl in self.decls.clone() {
+                self.signature(decl)?;
+            }
+            self.declare_globals(root)?;
+        }
+        Ok(())
+    }
+
+    /// Emits the bodies of this unit's functions (and the C `main` in the
+    /// entry unit), returning the verified module
+    fn define(mut self) -> Result<Module<'ctx>, CodegenError> {
+        for decl in self.decls.clone() {
+            if self.unit.owns(&self.symbols[&decl]) {
+                self.emit_function(decl)?;
+            }
+        }
+        if self.unit.is_entry() {
+            self.emit_entry()?;
+        }
+        self.module
+            .verify()
+            .map_err(|e| CodegenError::new(format!("Invalid LLVM module: {}", e.to_string())))?;
+        Ok(self.module)
+    }
+
+    /// The analyzed AST, borrowed for the output's lifetime rather than `self`'s
+    fn ast(&self) -> &'a Ast {
+        &self.output.ast
+    }
+
+    fn error(&self, node: usize, message: String) -> CodegenError {
+        CodegenError::at_node(message, &self.output.ast, node)
+    }
+
+    fn type_name(&self, ty: TypeId) -> String {
+        let resolved = self
+            .output
+            .substitution
+            .apply(ty, &self.output.type_registry);
+        type_to_display_string(resolved, &self.output.type_registry)
+    }
+
+    fn frame(&self) -> &Frame<'ctx> {
+        self.frame
+            .as_ref()
+            .expect("emitting code outside a function")
+    }
+
+    fn frame_mut(&mut self) -> &mut Frame<'ctx> {
+        self.frame
+            .as_mut()
+            .expect("emitting code outside a function")
+    }
+
+    fn void_value(&self) -> Value<'ctx> {
+        Value {
+            llvm: None,
+            ty: self.void,
+        }
+    }
+
+    /// Records every FunctionDecl with a symbol built from its lexical path.
+    /// Struct literal methods are named after the variable holding the literal.
+    fn collect_functions(
+        &mut self,
+        node: usize,
+        path: &mut Vec<String>,
+        used: &mut HashSet<String>,
+    ) {
+        let ast = self.ast();
+        match ast.nodes[node].node_type {
+            NodeType::FunctionDecl => {
+                let decl = ast.function_decl(node);
+                path.push(decl.name().unwrap_or("anonymous").to_string());
+                let base = format!("suru.{}", path.join("."));
+                let mut symbol = base.clone();
+                let mut suffix = 1;
+                while !used.insert(symbol.clone()) {
+                    symbol = format!("{}.{}", base, suffix);
+                    suffix += 1;
+                }
+                self.decls.push(node);
+                self.symbols.insert(node, symbol);
+                if let Some(body) = decl.body_idx() {
+                    self.collect_functions(body, path, used);
+                }
+                path.pop();
+                return;
+            }
+            NodeType::VarDecl => {
+                let decl = ast.var_decl(node);
+                if let (Some(name), Some(value)) = (decl.name(), decl.value_expr_idx()) {
+                    if ast.nodes[value].node_type == NodeType::StructInit {
+                        path.push(name.to_string());
+                        self.collect_functions(value, path, used);
+                        path.pop();
+                        return;
+                    }
+                }
+            }
+            NodeType::StructInit => {
+                if let Some(struct_ty) = self.output.type_of(node) {
+                    for member in ast.children(node) {
+                        if ast.nodes[member].node_type == NodeType::StructInitMethod {
+                            if let Some(decl) = ast.children(member).nth(1) {
+                                self.method_this.insert(decl, struct_ty);
+                            }
+                        }
+                    }
+                }
+            }
+            _ => {}
+        }
+        for child in ast.children(node) {
+            self.collect_functions(child, path, used);
+        }
+    }
+
+    /// Lowered signature of a FunctionDecl, declaring its LLVM function on first use
+    fn signature(&mut self, decl: usize) -> Result<Rc<Signature<'ctx>>, CodegenError> {
+        if let Some(signature) = self.signatures.get(&decl) {
+            return Ok(Rc::clone(signature));
+        }
+
+        let view = self.ast().function_decl(decl);
+        let name = view.name().unwrap_or("anonymous");
+        if view.type_params_idx().is_some() {
+            return Err(self.error(
+                decl,
+                format!(
+                    "Generic function '{}' is not supported by code generation yet",
+                    name
+                ),
+            ));
+        }
+        let function_type = self
+            .output
+            .function_types
+            .get(&decl)
+            .map(|ty| self.resolve(*ty));
+        let Some(Type::Function(function_type)) = function_type else {
+            return Err(self.error(decl, format!("Function '{}' has no resolved type", name)));
+        };
+
+        let this_type = self.method_this.get(&decl).copied();
+        let mut llvm_params: Vec<BasicMetadataTypeEnum<'ctx>> = Vec::new();
+        if this_type.is_some() {
+            llvm_params.push(self.ptr_type().into());
+        }
+        let mut params = Vec::with_capacity(function_type.params.len());
+        for (param, param_view) in function_type.params.iter().zip(view.params()) {
+            if matches!(self.resolve(param.type_id), Type::Unknown) {
+                return Err(self.error(
+                    param_view.idx(),
+                    format!(
+                        "Parameter '{}' of '{}' needs a type annotation to be compiled",
+                        param.name, name
+                    ),
+                ));
+            }
+            llvm_params.push(self.value_type(param.type_id, param_view.idx())?.into());
+            params.push((param.name.clone(), param.type_id));
+        }
+
+        let return_type = if matches!(self.resolve(function_type.return_type), Type::Unknown) {
+            self.infer_return_type(decl)?
+        } else {
+            function_type.return_type
+        };
+        let llvm_type = self.function_type(&llvm_params, return_type, decl)?;
+        let function = self
+            .module
+            .add_function(&self.symbols[&decl], llvm_type, None);
+
+        if let Some(this_type) = this_type {
+            let layout = self.struct_layout(this_type, decl)?;
+            self.method_returns
+                .insert((layout.key.clone(), name.to_string()), return_type);
+        }
+
+        let mutations = self
+            .output
+            .function_mutations
+            .get(&decl)
+            .copied()
+            .unwrap_or(0);
+        let param_attributes =
+            self.add_function_attributes(decl, function, this_type.is_some(), mutations);
+
+        let signature = Rc::new(Signature {
+            function,
+            params,
+            return_type,
+            this_type,
+            mutations,
+            param_attributes,
+        });
+        self.signatures.insert(decl, Rc::clone(&signature));
+        Ok(signature)
+    }
+
+    /// Return type of a function declared without an annotation: the type of
+    /// its first `return` with a value, or Void when there is none
+    fn infer_return_type(&mut self, decl: usize) -> Result<TypeId, CodegenError> {
+        let ast = self.ast();
+        let view = ast.function_decl(decl);
+        let name = view.name().unwrap_or("anonymous");
+        if !self.inferring.insert(decl) {
+            return Err(self.error(
+                decl,
+                format!(
+                    "Cannot infer the return type of recursive function '{}'; add a return type annotation",
+                    name
+                ),
+            ));
+        }
+
+        let mut returns = Vec::new();
+        if let Some(body) = view.body_idx() {
+            collect_returns(ast, body, &mut returns);
+        }
+        let mut result = Ok(self.void);
+        for ret in returns {
+            if let Some(expr) = ast.nodes[ret].first_child {
+                result = match self.static_type(expr) {
+                    Ok(Some(ty)) => Ok(ty),
+                    Ok(None) => Err(self.error(
+                        ret,
+                        format!(
+                            "Cannot infer the return type of '{}'; add a return type annotation",
+                            name
+                        ),
+                    )),
+                    Err(e) => Err(e),
+                };
+                break;
+            }
+        }
+        self.inferring.remove(&decl);
+        result
+    }
+
+    /// Type of an expression known without emitting it. Falls back to callee
+    /// signatures where the analyzer left a call's type unknown.
+    fn static_type(&mut self, node: usize) -> Result<Option<TypeId>, CodegenError> {
+        if let Some(ty) = self.output.type_of(node) {
+            if self.is_concrete(ty) {
+                return Ok(Some(ty));
+            }
+        }
+        let ast = self.ast();
+        match ast.nodes[node].node_type {
+            NodeType::FunctionCall => {
+                let name = ast.nodes[node].first_child.and_then(|i| ast.node_text(i));
+                if let Some(decl) = name.and_then(|n| self.resolve_function(node, n)) {
+                    return Ok(Some(self.signature(decl)?.return_type));
+                }
+            }
+            NodeType::Pipe => {
+                let right = ast.nodes[node]
+                    .first_child
+                    .and_then(|l| ast.nodes[l].next_sibling);
+                if let Some(right) = right {
+                    let name = match ast.nodes[right].node_type {
+                        NodeType::Identifier => ast.node_text(right),
+                        NodeType::FunctionCall => {
+                            ast.nodes[right].first_child.and_then(|i| ast.node_text(i))
+                        }
+                        _ => None,
+                    };
+                    if let Some(decl) = name.and_then(|n| self.resolve_function(node, n)) {
+                        return Ok(Some(self.signature(decl)?.return_type));
+                    }
+                }
+            }
+            NodeType::Match => {
+                let first_arm = ast.match_expr(node).arm_indices().next();
+                if let Some(result) = first_arm.and_then(|arm| ast.match_arm(arm).result_expr_idx())
+                {
+                    return self.static_type(result);
+                }
+            }
+            NodeType::Identifier => {
+                if let Some(value) = self.declaration_value(node) {
+                    return self.static_type(value);
+                }
+            }
+            _ => {}
+        }
+        Ok(None)
+    }
+
+    /// Initializer of the latest VarDecl before `ident_idx` that declares the
+    /// identifier's name in the same block
+    fn declaration_value(&self, ident_idx: usize) -> Option<usize> {
+        let ast = self.ast();
+        let name = ast.node_text(ident_idx)?;
+        let mut statement = ident_idx;
+        let block = loop {
+            let parent = ast.nodes[statement].parent?;
+            if matches!(
+                ast.nodes[parent].node_type,
+                NodeType::Block | NodeType::Program
+            ) {
+                break parent;
+            }
+            statement = parent;
+        };
+        ast.children(block)
+            .take_while(|&child| child != statement)
+            .filter(|&child| ast.nodes[child].node_type == NodeType::VarDecl)
+            .filter(|&child| ast.var_decl(child).name() == Some(name))
+            .last()
+            .and_then(|child| ast.var_decl(child).value_expr_idx())
+    }
+
+    /// FunctionDecl a call at `node` refers to: the nearest enclosing block or
+    /// the program declaring a function of that name
+    fn resolve_function(&self, node: usize, name: &str) -> Option<usize> {
+        let ast = self.ast();
+        let mut current = ast.nodes[node].parent;
+        while let Some(idx) = current {
+            if matches!(
+                ast.nodes[idx].node_type,
+                NodeType::Block | NodeType::Program
+            ) {
+                let found = ast.children(idx).find(|&child| {
+                    ast.nodes[child].node_type == NodeType::FunctionDecl
+                        && ast.function_decl(child).name() == Some(name)
+                });
+                if found.is_some() {
+                    return found;
+                }
+            }
+            current = ast.nodes[idx].parent;
+        }
+        None
+    }
+
+    /// Declares an LLVM global for each top-level variable
+    fn declare_globals(&mut self, root: usize) -> Result<(), CodegenError> {
+        let ast = self.ast();
+        for child in ast.children(root) {
+            if ast.nodes[child].node_type != NodeType::VarDecl {
+                continue;
+            }
+            let view = ast.var_decl(child);
+            let Some(name) = view.name() else {
+                continue;
+            };
+            if self.globals.contains_key(name) {
+                continue;
+            }
+            let ty = self.var_decl_type(child)?;
+            let llvm_type = self.value_type(ty, child)?;
+            let global = self
+                .module
+                .add_global(llvm_type, None, &format!("suru.global.{}", name));
+            // Defined by the entry unit, which runs the initializers
+            if self.unit.is_entry() {
+                global.set_initializer(&llvm_type.const_zero());
+            }
+            self.globals.insert(
+                name.to_string(),
+                Variable {
+                    ptr: global.as_pointer_value(),
+                    ty,
+                    owned: false,
+                    on_stack: false,
+                },
+            );
+        }
+        Ok(())
+    }
+
+    /// Declared type of a variable: the analyzer's type of the declaration,
+    /// else the static type of its initializer
+    fn var_decl_type(&mut self, node: usize) -> Result<TypeId, CodegenError> {
+        if let Some(ty) = self.output.type_of(node) {
+            if self.is_concrete(ty) {
+                return Ok(ty);
+            }
+        }
+        let view = self.ast().var_decl(node);
+        let inferred = match view.value_expr_idx() {
+            Some(value) => self.static_type(value)?,
+            None => None,
+        };
+        inferred.ok_or_else(|| {
+            self.error(
+                node,
+                format!(
+                    "Cannot determine the type of '{}'; add a type annotation",
+                    view.name().unwrap_or("")
+                ),
+            )
+        })
+    }
+}
+
+/// ReturnStmt nodes of a function body, not descending into nested functions
+fn collect_returns(ast: &Ast, node: usize, returns: &mut Vec<usize>) {
+    for child in ast.children(node) {
+        match ast.nodes[child].node_type {
+            NodeType::ReturnStmt => returns.push(child),
+            NodeType::FunctionDecl | NodeType::StructInit => {}
+            _ => collect_returns(ast, child, returns),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::limits::CompilerLimits;
+    use crate::parser::parse;
+    use crate::semantic::SemanticAnalyzer;
+
+    fn analyze(source: &str) -> AnalysisOutput {
+        let limits = CompilerLimits::default();
+        let tokens = lex(source, &limits).unwrap();
+        let ast = parse(tokens, &limits).unwrap();
+        match SemanticAnalyzer::new(ast).analyze_with_types() {
+            Ok(output) => output,
+            Err(e) => panic!("analysis failed: {:?}", e.errors),
+        }
+    }
+
+    /// Lowers `source` and returns the verified module's IR
+    fn compile_ir(source: &str) -> Result<String, CodegenError> {
+        let output = analyze(source);
+        let context = Context::create();
+        let module = compile_module(&context, &output, "test")?;
+        Ok(module.print_to_string().to_string())
+    }
+
+    #[test]
+    fn test_hello_world() {
+        let ir = compile_ir("main: () {\n    print(\"Hello, World!\")\n}\n").unwrap();
+        assert!(ir.contains("define i32 @main()"), "{}", ir);
+        assert!(ir.contains("@suru.main"), "{}", ir);
+        assert!(ir.contains("Hello, World!"), "{}", ir);
+        assert!(ir.contains("@puts"), "{}", ir);
+    }
+
+    #[test]
+    fn test_run_jit_returns_main_exit_code() {
+        let output = analyze("answer: () Number {\n    return 42\n}\nx: answer()\n");
+        let mut profile = Profile::enabled();
+        assert_eq!(run_jit(&output, "test", &mut profile).unwrap(), 0);
+        let names: Vec<&str> = profile.passes.iter().map(|p| p.name).collect();
+        assert_eq!(names, vec!["codegen", "jit"]);
+    }
+
+    #[test]
+    fn test_codegen_units_split_function_bodies() {
+        let source = "a: () Number {\n    return 1\n}\nb: () Number {\n    return a()\n}\nc: () Number {\n    return b()\n}\nd: () Number {\n    return c()\n}\nx: d()\n";
+        let output = analyze(source);
+        let context = Context::create();
+        let stack_locals = StackLocals::of(&output);
+        let units: Vec<String> = (0..3)
+            .map(|index| {
+                let unit = CodegenUnit { index, count: 3 };
+                let module = compile_unit(&context, &output, "test", unit, &stack_locals).unwrap();
+                module.print_to_string().to_string()
+            })
+            .collect();
+        for name in ["a", "b", "c", "d"] {
+            let define = format!("define double @suru.{}()", name);
+            let defined = units.iter().filter(|ir| ir.contains(&define)).count();
+            assert_eq!(defined, 1, "{} defined {} times", name, defined);
+        }
+        assert!(units[0].contains("define i32 @main()"), "{}", units[0]);
+        assert!(
+            units[0].contains("@suru.global.x = global double 0"),
+            "{}",
+            units[0]
+        );
+        for ir in &units[1..] {
+            assert!(!ir.contains("@main()"), "{}", ir);
+            assert!(!ir.contains("@suru.global.x = global"), "{}", ir);
+        }
+    }
+
+    /// Object cache key of each of `count` units of `source`
+    fn unit_keys(source: &str, count: usize) -> Vec<u128> {
+        let output = analyze(source);
+        let options = BuildOptions::default();
+        (0..count)
+            .map(|index| {
+                let context = Context::create();
+                let unit = CodegenUnit { index, count };
+                let stack_locals = StackLocals::of(&output);
+                let mut codegen = Codegen::new(&context, &output, "test", unit, &stack_locals);
+                codegen.declare().unwrap();
+                codegen.unit_key(&options)
+            })
+            .collect()
+    }
+
+    #[test]
+    fn test_unit_keys_follow_function_edits() {
+        let functions = |a_body: &str, a_type: &str| {
+            format!(
+                "a: () {} {{\n    return {}\n}}\nb: () Number {{\n    return 2\n}}\nc: () Number {{\n    return 3\n}}\nd: () Number {{\n    return 4\n}}\n",
+                a_type, a_body
+            )
+        };
+        let owner = (0..4)
+            .find(|&index| CodegenUnit { index, count: 4 }.owns("suru.a"))
+            .unwrap();
+        let base = unit_keys(&functions("1", "Number"), 4);
+        assert_eq!(base, unit_keys(&functions("1", "Number"), 4));
+
+        // A body edit only invalidates the unit that emits it
+        let edited = unit_keys(&functions("10", "Number"), 4);
+        for index in 0..4 {
+            assert_eq!(
+                base[index] == edited[index],
+                index != owner,
+                "unit {}",
+                index
+            );
+        }
+
+        // A signature change reaches every unit, since all of them declare it
+        let retyped = unit_keys(&functions("\"one\"", "String"), 4);
+        assert!((0..4).all(|index| base[index] != retyped[index]));
+
+        // Moving code around changes nothing
+        let source = functions("1", "Number");
+        let (first, rest) = source.split_at(source.find("b:").unwrap());
+        assert_eq!(base, unit_keys(&format!("{}{}", rest, first), 4));
+    }
+
+    #[test]
+    fn test_empty_program_has_entry_point() {
+        let ir = compile_ir("").unwrap();
+        assert!(ir.contains("define i32 @main()"), "{}", ir);
+    }
+
+    #[test]
+    fn test_functions_are_named_by_lexical_path() {
+        let source = "outer: () Number {\n    inner: () Number {\n        return 1\n    }\n    return inner()\n}\nx: outer()\n";
+        let ir = compile_ir(source).unwrap();
+        assert!(ir.contains("define double @suru.outer()"), "{}", ir);
+        assert!(ir.contains("define double @suru.outer.inner()"), "{}", ir);
+        assert!(ir.contains("@suru.global.x"), "{}", ir);
+    }
+
+    #[test]
+    fn test_inferred_return_type() {
+        let source = "greeting: () {\n    return \"hi\"\n}\nmain: () {\n    g: greeting()\n    print(g)\n}\n";
+        let ir = compile_ir(source).unwrap();
+        assert!(ir.contains("define ptr @suru.greeting()"), "{}", ir);
+    }
+
+    #[test]
+    fn test_struct_methods_and_copies() {
+        let source = "\
+type Person: {
+    name String
+    age Number
+    greet: () String
+}
+make: (name String) Person {
+    return {
+        name: name
+        age: 3
+        greet: () String {
+            return this.name
+        }
+    }
+}
+main: () {
+    p: make(\"Ann\")
+    q: p
+    p.age: 4
+    g: q.greet()
+    print(g)
+}
+";
+        let ir = compile_ir(source).unwrap();
+        // Fields sorted by name (age, name), then the greet slot
+        assert!(ir.contains("{ double, ptr, ptr }"), "{}", ir);
+        assert!(ir.contains("@suru.make.greet"), "{}", ir);
+        // `q: p` copies the struct
+        assert!(ir.contains("@suru.copy.0"), "{}", ir);
+    }
+
+    #[test]
+    fn test_owned_structs_are_dropped() {
+        let source = "\
+type Point: { x Number, y Number }
+make: (x Number) Point {
+    p: { x: x, y: 2 }
+    return p
+}
+first: () Number {
+    a: make(1)
+    b: make(2)
+    a: b
+    return a.x
+}
+";
+        let ir = compile_ir(source).unwrap();
+        let body = |name: &str| {
+            let start = ir.find(&format!("@suru.{}(", name)).unwrap();
+            let end = ir[start..].find("\n}").unwrap();
+            ir[start..start + end].to_string()
+        };
+        // The returned local moves out; nothing else is released
+        assert!(!body("make").contains("@suru.drop"), "{}", ir);
+        // `a: b` drops the old `a` and the copy of `b` it stores is dropped
+        // on return with `b`
+        assert_eq!(body("first").matches("@suru.drop.0(").count(), 3, "{}", ir);
+        assert!(ir.contains("@free("), "{}", ir);
+    }
+
+    #[test]
+    fn test_stack_locals_get_frame_cells() {
+        let source = "\
+type Inner: { v Number }
+type Point: { x Number, inner Inner }
+norm: (p Point) Number {
+    return p.x
+}
+make: () Point {
+    kept: { x: 1, inner: { v: 7 } }
+    n: norm(kept)
+    out: { x: n, inner: { v: 0 } }
+    return out
+}
+";
+        let ir = compile_ir(source).unwrap();
+        let start = ir.find("@suru.make(").unwrap();
+        let end = ir[start..].find("\n}").unwrap();
+        let make = &ir[start..start + end];
+        // `kept` lives in the frame; `out` is returned, so it is mallocd
+        assert_eq!(make.matches("alloca { ptr, double }").count(), 1, "{}", ir);
+        assert_eq!(make.matches("@malloc(").count(), 3, "{}", ir);
+        // Only its `inner` field is released, right after the call to `norm`
+        let call = make.find("@suru.norm(").unwrap();
+        let drops: Vec<usize> = make.match_indices("@suru.drop.").map(|(i, _)| i).collect();
+        assert_eq!(drops.len(), 1, "{}", ir);
+        assert!(
+            drops[0] > call && !make[call..].contains("@free("),
+            "{}",
+            ir
+        );
+    }
+
+    #[test]
+    fn test_match_on_units_and_literals() {
+        let source = "\
+type Success
+type Failure
+type Status: Success, Failure
+label: (s Status) String {
+    return match s {
+        Success: \"ok\"
+        _: \"bad\"
+    }
+}
+main: () {
+    x: Success
+    l: label(x)
+    print(l)
+    n: match l {
+        \"ok\": 1
+        _: 2
+    }
+    print(n)
+}
+";
+        let ir = compile_ir(source).unwrap();
+        assert!(ir.contains("phi ptr"), "{}", ir);
+        assert!(ir.contains("@strcmp"), "{}", ir);
+    }
+
+    #[test]
+    fn test_function_attributes() {
+        let source = "\
+type Point: {
+    x Number
+    y Number
+}
+getx: (p Point) Number {
+    return p.x
+}
+setx: (p Point) Number {
+    p.x: 2
+    return p.x
+}
+ignore: (p Point, s String) Number {
+    return 1
+}
+";
+        let ir = compile_ir(source).unwrap();
+        assert!(ir.contains("nounwind"), "{}", ir);
+        assert!(ir.contains("@suru.getx(ptr readonly"), "{}", ir);
+        assert!(!ir.contains("@suru.setx(ptr readonly"), "{}", ir);
+        assert!(ir.contains("@suru.ignore(ptr readnone"), "{}", ir);
+        assert!(
+            !ir.contains("double readonly") && !ir.contains("double readnone"),
+            "{}",
+            ir
+        );
+    }
+
+    #[test]
+    fn test_optimization_pipeline() {
+        let source = "twice: (x Number) Number {\n    return x\n}\nmain: () {\n    n: twice(2)\n    print(n)\n}\n";
+        let output = analyze(source);
+        let context = Context::create();
+        let module = compile_module(&context, &output, "test").unwrap();
+        let options = BuildOptions {
+            opt_level: OptLevel::O2,
+            ..Default::default()
+        };
+        native::initialize_native().unwrap();
+        let machine = native::host_target_machine(&options).unwrap();
+        native::configure_module(&module, &machine);
+        optimize::run_pipeline(&module, &machine, options.opt_level).unwrap();
+        module.verify().unwrap();
+
+        let ir = module.print_to_string().to_string();
+        let main = &ir[ir.find("define i32 @main").expect("main survives")..];
+        let main = &main[..main.find("\n}\n").unwrap()];
+        assert!(
+            !main.contains("@suru.twice("),
+            "call should be inlined: {}",
+            ir
+        );
+    }
+
+    #[test]
+    fn test_unannotated_parameter_is_an_error() {
+        let err = compile_ir("twice: (x) {\n    return x\n}\n").unwrap_err();
+        assert!(err.message.contains("needs a type annotation"), "{}", err);
+        assert_eq!((err.line, err.column), (1, 9));
+    }
+
+    #[test]
+    fn test_unsupported_expression_is_an_error() {
+        let err = compile_ir("xs: [1, 2]\n").unwrap_err();
+        assert!(
+            err.to_string().starts_with("Codegen error at 1:"),
+            "{}",
+            err
+        );
+    }
+
+    #[test]
+    fn test_codegen_error_display_without_position() {
+        let err = CodegenError::new("No linker found".to_string());
+        assert_eq!(err.to_string(), "Codegen error: No linker found");
+    }
+}
@@ -0,0 +1,120 @@
+// Native output - writes object files for the host target and links them
+// with the system C compiler
+
+use std::path::{Path, PathBuf};
+use std::process::Command;
+use std::sync::OnceLock;
+
+use inkwell::module::Module;
+use inkwell::targets::{
+    CodeModel, FileType, InitializationConfig, RelocMode, Target, TargetMachine,
+};
+
+use super::{BuildOptions, CodegenError};
+
+/// C compiler drivers tried, in order, to link an object into an executable
+const LINKERS: [&str; 2] = ["clang-18", "cc"];
+
+/// Registers the host target with LLVM, once per process: target
+/// registration is not safe to race, and codegen units run on many threads
+pub(super) fn initialize_native() -> Result<(), CodegenError> {
+    static INITIALIZED: OnceLock<Result<(), String>> = OnceLock::new();
+    INITIALIZED
+        .get_or_init(|| Target::initialize_native(&InitializationConfig::default()))
+        .clone()
+        .map_err(|e| CodegenError::new(format!("Failed to initialize the native target: {}", e)))
+}
+
+/// Target machine for the host (after `initialize_native`), producing
+/// position independent code for the CPU selected in `options`
+pub(super) fn host_target_machine(options: &BuildOptions) -> Result<TargetMachine, CodegenError> {
+    let triple = TargetMachine::get_default_triple();
+    let target = Target::from_triple(&triple).map_err(|e| {
+        CodegenError::new(format!(
+            "Unsupported target '{}': {}",
+            triple.as_str().to_string_lossy(),
+            e
+        ))
+    })?;
+    let (cpu, features) = cpu_and_features(options);
+    target
+        .create_target_machine(
+            &triple,
+            &cpu,
+            &features,
+            options.opt_level.codegen_level(),
+            RelocMode::PIC,
+            CodeModel::Default,
+        )
+        .ok_or_else(|| {
+            CodegenError::new(format!(
+                "Cannot create a target machine for '{}'",
+                triple.as_str().to_string_lossy()
+            ))
+        })
+}
+
+/// CPU name and feature string selected by `options`: "generic" unless
+/// given, the host's own CPU and features for "native"
+pub(super) fn cpu_and_features(options: &BuildOptions) -> (String, String) {
+    match options.target_cpu.as_deref() {
+        None => ("generic".to_string(), String::new()),
+        Some("native") => (
+            TargetMachine::get_host_cpu_name().to_string(),
+            TargetMachine::get_host_cpu_features().to_string(),
+        ),
+        Some(cpu) => (cpu.to_string(), String::new()),
+    }
+}
+
+/// Sets the module's triple and data layout to the target machine's, which
+/// the pass pipeline needs for target-aware optimizations
+pub(super) fn configure_module(module: &Module, machine: &TargetMachine) {
+    module.set_triple(&machine.get_triple());
+    module.set_data_layout(&machine.get_target_data().get_data_layout());
+}
+
+/// Writes `module` as an object file at `path`
+pub(super) fn emit_object(
+    module: &Module,
+    machine: &TargetMachine,
+    path: &Path,
+) -> Result<(), CodegenError> {
+    if let Some(parent) = path.parent().filter(|p| !p.as_os_str().is_empty()) {
+        std::fs::create_dir_all(parent).map_err(|e| {
+            CodegenError::new(format!("Cannot create '{}': {}", parent.display(), e))
+        })?;
+    }
+    machine
+        .write_to_file(module, FileType::Object, path)
+        .map_err(|e| CodegenError::new(format!("Failed to write '{}': {}", path.display(), e)))
+}
+
+/// Links object files into an executable with the first C compiler found
+pub(super) fn link_executable(objects: &[PathBuf], output: &Path) -> Result<(), CodegenError> {
+    for linker in LINKERS {
+        let result = Command::new(linker)
+            .args(objects)
+            .arg("-o")
+            .arg(output)
+            .output();
+        match result {
+            Ok(out) if out.status.success() => return Ok(()),
+            Ok(out) => {
+                return Err(CodegenError::new(format!(
+                    "Linking with '{}' failed: {}",
+                    linker,
+                    String::from_utf8_lossy(&out.stderr).trim()
+                )));
+            }
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => continue,
+            Err(e) => {
+                return Err(CodegenError::new(format!("Cannot run '{}': {}", linker, e)));
+            }
+        }
+    }
+    Err(CodegenError::new(format!(
+        "No linker found; install one of: {}",
+        LINKERS.join(", ")
+    )))
+}
@@ -0,0 +1,241 @@
+// Optimization - optimization levels, the LLVM pass pipeline and the
+// function attributes that feed it
+
+use inkwell::OptimizationLevel;
+use inkwell::attributes::{Attribute, AttributeLoc};
+use inkwell::module::Module;
+use inkwell::passes::PassBuilderOptions;
+use inkwell::targets::TargetMachine;
+use inkwell::values::FunctionValue;
+
+use super::{Codegen, CodegenError};
+use crate::ast::{Ast, NodeType};
+use crate::semantic::Type;
+
+/// Optimization level selected with `-O0` .. `-O3` / `-Os`
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum OptLevel {
+    /// No optimization: fastest compile, for edit-run loops
+    #[default]
+    O0,
+    O1,
+    O2,
+    /// Aggressive optimization, for production binaries
+    O3,
+    /// Optimize for size
+    Os,
+}
+
+impl OptLevel {
+    /// New pass manager pipeline run over each module
+    pub fn pipeline(self) -> &'static str {
+        match self {
+            OptLevel::O0 => "default<O0>",
+            OptLevel::O1 => "default<O1>",
+            OptLevel::O2 => "default<O2>",
+            OptLevel::O3 => "default<O3>",
+            OptLevel::Os => "default<Os>",
+        }
+    }
+
+    /// Level of the target machine's instruction selection and scheduling
+    pub fn codegen_level(self) -> OptimizationLevel {
+        match self {
+            OptLevel::O0 => OptimizationLevel::None,
+            OptLevel::O1 => OptimizationLevel::Less,
+            OptLevel::O2 | OptLevel::Os => OptimizationLevel::Default,
+            OptLevel::O3 => OptimizationLevel::Aggressive,
+        }
+    }
+
+    /// Loop and SLP vectorization, as clang enables them from -O2 and at -Os
+    fn vectorize(self) -> bool {
+        matches!(self, OptLevel::O2 | OptLevel::O3 | OptLevel::Os)
+    }
+
+    /// Loop unrolling, which -Os leaves off to keep code small
+    fn unroll(self) -> bool {
+        matches!(self, OptLevel::O2 | OptLevel::O3)
+    }
+}
+
+impl std::str::FromStr for OptLevel {
+    type Err = String;
+
+    /// Parses the level after `-O`: `0`, `1`, `2`, `3` or `s`
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        match s {
+            "0" => Ok(OptLevel::O0),
+            "1" => Ok(OptLevel::O1),
+            "2" => Ok(OptLevel::O2),
+            "3" => Ok(OptLevel::O3),
+            "s" => Ok(OptLevel::Os),
+            _ => Err(format!(
+                "invalid optimization level '{}' (expected 0, 1, 2, 3 or s)",
+                s
+            )),
+        }
+    }
+}
+
+/// Runs the pass pipeline for `level` over a verified module
+pub(super) fn run_pipeline(
+    module: &Module,
+    machine: &TargetMachine,
+    level: OptLevel,
+) -> Result<(), CodegenError> {
+    let _span = crate::trace_span!("codegen", "run_pipeline", level.pipeline());
+    let options = PassBuilderOptions::create();
+    options.set_loop_vectorization(level.vectorize());
+    options.set_loop_slp_vectorization(level.vectorize());
+    options.set_loop_unrolling(level.unroll());
+    module
+        .run_passes(level.pipeline(), machine, options)
+        .map_err(|e| CodegenError::new(format!("LLVM pass pipeline failed: {}", e.to_string())))
+}
+
+/// How a function body uses a pointer parameter (or `this`)
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+enum PointerUse {
+    Unused,
+    /// Only fields are read; anything bound or returned from it is copied
+    Read,
+    /// Fields are assigned, or the pointer reaches a call that may write it
+    Write,
+}
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    /// Marks a FunctionDecl's LLVM function `nounwind` (Suru has no
+    /// unwinding) and its unwritten pointer parameters `readonly`, or
+    /// `readnone` when the body never touches them. Returns the parameter
+    /// attributes added, by LLVM parameter index.
+    pub(super) fn add_function_attributes(
+        &self,
+        decl: usize,
+        function: FunctionValue<'ctx>,
+        has_this: bool,
+        mutations: u64,
+    ) -> Vec<(u32, &'static str)> {
+        function.add_attribute(AttributeLoc::Function, self.enum_attribute("nounwind"));
+
+        let mut added = Vec::new();
+        let ast = self.ast();
+        let view = ast.function_decl(decl);
+        let Some(body) = view.body_idx() else {
+            return added;
+        };
+        if has_this {
+            let usage = pointer_use(ast, body, &|n| ast.nodes[n].node_type == NodeType::This);
+            added.extend(self.add_pointer_attribute(function, 0, usage));
+        }
+        let first = has_this as u32;
+        let function_type = self
+            .output
+            .function_types
+            .get(&decl)
+            .map(|ty| self.resolve(*ty));
+        let Some(Type::Function(function_type)) = function_type else {
+            return added;
+        };
+        for (index, param) in function_type.params.iter().enumerate() {
+            let is_pointer = matches!(self.resolve(param.type_id), Type::String | Type::Struct(_));
+            let mutated = index >= 64 || mutations & (1 << index) != 0;
+            if !is_pointer || mutated {
+                continue;
+            }
+            let name = param.name.as_str();
+            let usage = pointer_use(ast, body, &|n| {
+                ast.nodes[n].node_type == NodeType::Identifier && ast.node_text(n) == Some(name)
+            });
+            added.extend(self.add_pointer_attribute(function, first + index as u32, usage));
+        }
+        added
+    }
+
+    fn add_pointer_attribute(
+        &self,
+        function: FunctionValue<'ctx>,
+        index: u32,
+        usage: PointerUse,
+    ) -> Option<(u32, &'static str)> {
+        let name = match usage {
+            PointerUse::Unused => "readnone",
+            PointerUse::Read => "readonly",
+            PointerUse::Write => return None,
+        };
+        function.add_attribute(AttributeLoc::Param(index), self.enum_attribute(name));
+        Some((index, name))
+    }
+
+    pub(super) fn enum_attribute(&self, name: &str) -> Attribute {
+        self.context
+            .create_enum_attribute(Attribute::get_named_enum_kind_id(name), 0)
+    }
+}
+
+/// Strongest use of the pointer named by `is_pointer` nodes in a function
+/// body, not descending into nested functions. Anything other than a field
+/// read, or a binding the code generator copies, counts as a write.
+fn pointer_use(ast: &Ast, body: usize, is_pointer: &dyn Fn(usize) -> bool) -> PointerUse {
+    let mut strongest = PointerUse::Unused;
+    let mut stack: Vec<usize> = ast.children(body).collect();
+    while let Some(node) = stack.pop() {
+        if ast.nodes[node].node_type == NodeType::FunctionDecl {
+            continue;
+        }
+        stack.extend(ast.children(node));
+        if !is_pointer(node) {
+            continue;
+        }
+        let Some(parent) = ast.nodes[node].parent else {
+            continue;
+        };
+        let first_child = ast.nodes[parent].first_child == Some(node);
+        let usage = match ast.nodes[parent].node_type {
+            // Rebinding the name does not touch the pointee
+            NodeType::VarDecl if first_child => PointerUse::Unused,
+            NodeType::PropertyAccess if first_child => {
+                let assigned = ast.nodes[parent].parent.is_some_and(|grand| {
+                    ast.nodes[grand].node_type == NodeType::PropertyAssignment
+                        && ast.nodes[grand].first_child == Some(parent)
+                });
+                if assigned {
+                    PointerUse::Write
+                } else {
+                    PointerUse::Read
+                }
+            }
+            NodeType::VarDecl | NodeType::ReturnStmt | NodeType::StructInitField => {
+                PointerUse::Read
+            }
+            _ => PointerUse::Write,
+        };
+        strongest = strongest.max(usage);
+    }
+    strongest
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_opt_level_pipelines() {
+        assert_eq!(OptLevel::default(), OptLevel::O0);
+        assert_eq!(OptLevel::O0.pipeline(), "default<O0>");
+        assert_eq!(OptLevel::O3.pipeline(), "default<O3>");
+        assert_eq!(OptLevel::Os.pipeline(), "default<Os>");
+        assert_eq!(OptLevel::O0.codegen_level(), OptimizationLevel::None);
+        assert_eq!(OptLevel::O3.codegen_level(), OptimizationLevel::Aggressive);
+        assert!(OptLevel::Os.vectorize() && !OptLevel::Os.unroll());
+        assert!(!OptLevel::O1.vectorize());
+    }
+
+    #[test]
+    fn test_opt_level_from_str() {
+        assert_eq!("0".parse::<OptLevel>(), Ok(OptLevel::O0));
+        assert_eq!("3".parse::<OptLevel>(), Ok(OptLevel::O3));
+        assert_eq!("s".parse::<OptLevel>(), Ok(OptLevel::Os));
+        assert!("4".parse::<OptLevel>().unwrap_err().contains("'4'"));
+    }
+}
@@ -0,0 +1,357 @@
+// Runtime support - C library declarations, string constants, `print` and
+// struct copy and drop helpers
+
+use std::collections::HashMap;
+
+use inkwell::attributes::AttributeLoc;
+use inkwell::module::Linkage;
+use inkwell::types::{BasicMetadataTypeEnum, BasicTypeEnum};
+use inkwell::values::{BasicMetadataValueEnum, BasicValueEnum, FunctionValue, PointerValue};
+
+use super::types::StructLayout;
+use super::{Codegen, CodegenError, Value};
+use crate::semantic::{FloatSize, Type};
+
+/// Values emitted once per module and reused
+#[derive(Default)]
+pub(super) struct Runtime<'ctx> {
+    /// Global string constants by content
+    strings: HashMap<String, PointerValue<'ctx>>,
+    /// Copy helper of each struct layout, by layout key
+    copies: HashMap<String, FunctionValue<'ctx>>,
+    /// Drop helper of each struct layout, by layout key
+    drops: HashMap<String, FunctionValue<'ctx>>,
+}
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    /// Pointer to a NUL-terminated constant holding `text`
+    pub(super) fn string_constant(
+        &mut self,
+        text: &str,
+    ) -> Result<PointerValue<'ctx>, CodegenError> {
+        if let Some(ptr) = self.runtime.strings.get(text) {
+            return Ok(*ptr);
+        }
+        let name = format!("suru.str.{}", self.runtime.strings.len());
+        let ptr = self
+            .builder
+            .build_global_string_ptr(text, &name)?
+            .as_pointer_value();
+        self.runtime.strings.insert(text.to_string(), ptr);
+        Ok(ptr)
+    }
+
+    /// Declares a C library function, reusing an existing declaration
+    fn libc_function(
+        &self,
+        name: &str,
+        params: &[BasicMetadataTypeEnum<'ctx>],
+        variadic: bool,
+    ) -> FunctionValue<'ctx> {
+        if let Some(function) = self.module.get_function(name) {
+            return function;
+        }
+        let i32_type = self.context.i32_type();
+        self.module
+            .add_function(name, i32_type.fn_type(params, variadic), None)
+    }
+
+    /// i1 that is true when two strings have equal contents
+    pub(super) fn string_equals(
+        &mut self,
+        left: PointerValue<'ctx>,
+        right: PointerValue<'ctx>,
+    ) -> Result<inkwell::values::IntValue<'ctx>, CodegenError> {
+        let strcmp = self.libc_function(
+            "strcmp",
+            &[self.ptr_type().into(), self.ptr_type().into()],
+            false,
+        );
+        let order = self
+            .builder
+            .build_call(strcmp, &[left.into(), right.into()], "strcmp")?;
+        let order = order
+            .try_as_basic_value()
+            .left()
+            .expect("strcmp returns i32")
+            .into_int_value();
+        let zero = self.context.i32_type().const_int(0, false);
+        Ok(self
+            .builder
+            .build_int_compare(inkwell::IntPredicate::EQ, order, zero, "streq")?)
+    }
+
+    /// The built-in `print`: writes a value and a newline to stdout
+    pub(super) fn print(&mut self, value: Value<'ctx>, node: usize) -> Result<(), CodegenError> {
+        let Some(llvm) = value.llvm else {
+            return Err(self.error(node, "Cannot print a Void value".to_string()));
+        };
+        match self.resolve(value.ty) {
+            Type::String => self.puts(llvm.into_pointer_value()),
+            Type::Bool => {
+                let yes = self.string_constant("true")?;
+                let no = self.string_constant("false")?;
+                let text = self
+                    .builder
+                    .build_select(llvm.into_int_value(), yes, no, "bool")?;
+                self.puts(text.into_pointer_value())
+            }
+            Type::Number | Type::Float(FloatSize::F64) => self.printf("%.15g\n", llvm),
+            Type::Float(FloatSize::F32) => {
+                let wide = self.builder.build_float_ext(
+                    llvm.into_float_value(),
+                    self.context.f64_type(),
+                    "fpext",
+                )?;
+                self.printf("%.15g\n", wide.into())
+            }
+            Type::Int(_) => {
+                let wide = self.widen(llvm, true)?;
+                self.printf("%lld\n", wide)
+            }
+            Type::UInt(_) => {
+                let wide = self.widen(llvm, false)?;
+                self.printf("%llu\n", wide)
+            }
+            Type::NamedUnit(_) | Type::Union(_) if llvm.is_int_value() => {
+                let name = self.unit_name(llvm.into_int_value())?;
+                self.puts(name)
+            }
+            _ => Err(self.error(
+                node,
+                format!(
+                    "Printing values of type '{}' is not supported by code generation yet",
+                    self.type_name(value.ty)
+                ),
+            )),
+        }
+    }
+
+    fn puts(&mut self, text: PointerValue<'ctx>) -> Result<(), CodegenError> {
+        let puts = self.libc_function("puts", &[self.ptr_type().into()], false);
+        self.builder.build_call(puts, &[text.into()], "")?;
+        Ok(())
+    }
+
+    fn printf(&mut self, format: &str, value: BasicValueEnum<'ctx>) -> Result<(), CodegenError> {
+        let printf = self.libc_function("printf", &[self.ptr_type().into()], true);
+        let format = self.string_constant(format)?;
+        let args: [BasicMetadataValueEnum<'ctx>; 2] = [format.into(), value.into()];
+        self.builder.build_call(printf, &args, "")?;
+        Ok(())
+    }
+
+    /// Extends an integer to the 64 bits printf expects for `%lld`/`%llu`
+    fn widen(
+        &mut self,
+        value: BasicValueEnum<'ctx>,
+        signed: bool,
+    ) -> Result<BasicValueEnum<'ctx>, CodegenError> {
+        let int = value.into_int_value();
+        let i64_type = self.context.i64_type();
+        if int.get_type().get_bit_width() >= 64 {
+            return Ok(value);
+        }
+        Ok(match signed {
+            true => self
+                .builder
+                .build_int_s_extend(int, i64_type, "sext")?
+                .into(),
+            false => self
+                .builder
+                .build_int_z_extend(int, i64_type, "zext")?
+                .into(),
+        })
+    }
+
+    /// Name of the unit whose tag is `tag`, selected from every unit in the program
+    fn unit_name(
+        &mut self,
+        tag: inkwell::values::IntValue<'ctx>,
+    ) -> Result<PointerValue<'ctx>, CodegenError> {
+        let units: Vec<(usize, String)> = self
+            .output
+            .type_registry
+            .iter()
+            .filter_map(|(id, ty)| match ty {
+                Type::NamedUnit(name) => Some((id.index(), name.clone())),
+                _ => None,
+            })
+            .collect();
+        let mut name = self.string_constant("?")?;
+        for (index, unit) in units {
+            let text = self.string_constant(&unit)?;
+            let expected = self.context.i64_type().const_int(index as u64, false);
+            let is_unit =
+                self.builder
+                    .build_int_compare(inkwell::IntPredicate::EQ, tag, expected, "is")?;
+            name = self
+                .builder
+                .build_select(is_unit, text, name, "unit")?
+                .into_pointer_value();
+        }
+        Ok(name)
+    }
+
+    /// Copies a struct value into a new heap cell
+    pub(super) fn copy_struct(
+        &mut self,
+        value: Value<'ctx>,
+        node: usize,
+    ) -> Result<Value<'ctx>, CodegenError> {
+        let layout = self.struct_layout(value.ty, node)?;
+        let copy = self.copy_function(&layout, node)?;
+        let source = value.llvm.expect("struct values are pointers");
+        let call = self.builder.build_call(copy, &[source.into()], "copy")?;
+        Ok(Value {
+            llvm: call.try_as_basic_value().left(),
+            ty: value.ty,
+        })
+    }
+
+    /// `ptr suru.copy.N(ptr)`: deep copy of one struct layout. Nested struct
+    /// fields are copied too, so the result shares nothing with its source.
+    fn copy_function(
+        &mut self,
+        layout: &StructLayout<'ctx>,
+        node: usize,
+    ) -> Result<FunctionValue<'ctx>, CodegenError> {
+        if let Some(function) = self.runtime.copies.get(&layout.key) {
+            return Ok(*function);
+        }
+        let ptr_type = self.ptr_type();
+        let name = format!("suru.copy.{}", self.runtime.copies.len());
+        let function = self.module.add_function(
+            &name,
+            ptr_type.fn_type(&[ptr_type.into()], false),
+            Some(Linkage::Internal),
+        );
+        function.add_attribute(AttributeLoc::Function, self.enum_attribute("nounwind"));
+        function.add_attribute(AttributeLoc::Param(0), self.enum_attribute("readonly"));
+        // Registered before the body so self-referential layouts terminate
+        self.runtime.copies.insert(layout.key.clone(), function);
+
+        let builder = self.context.create_builder();
+        builder.position_at_end(self.context.append_basic_block(function, "entry"));
+        let source = function
+            .get_nth_param(0)
+            .expect("copy helpers take the source")
+            .into_pointer_value();
+        let cell = builder.build_malloc(layout.llvm, "copy")?;
+        let contents = builder.build_load(layout.llvm, source, "contents")?;
+        builder.build_store(cell, contents)?;
+
+        for (index, (field, field_ty)) in layout.fields.iter().enumerate() {
+            if !self.is_struct(*field_ty) {
+                continue;
+            }
+            let field_layout = self.struct_layout(*field_ty, node)?;
+            let field_copy = self.copy_function(&field_layout, node)?;
+            let slot = builder.build_struct_gep(layout.llvm, cell, index as u32, field)?;
+            let inner: BasicTypeEnum<'ctx> = ptr_type.into();
+            let inner = builder.build_load(inner, slot, field)?;
+            let copied = builder.build_call(field_copy, &[inner.into()], "copy")?;
+            let copied = copied
+                .try_as_basic_value()
+                .left()
+                .expect("copy helpers return a pointer");
+            builder.build_store(slot, copied)?;
+        }
+        builder.build_return(Some(&cell))?;
+        Ok(function)
+    }
+    /// Frees a struct value the current function owns, with everything it owns
+    pub(super) fn drop_struct(
+        &mut self,
+        value: Value<'ctx>,
+        node: usize,
+    ) -> Result<(), CodegenError> {
+        let layout = self.struct_layout(value.ty, node)?;
+        let drop = self.drop_function(&layout, node)?;
+        let cell = value.llvm.expect("struct values are pointers");
+        self.builder.build_call(drop, &[cell.into()], "")?;
+        Ok(())
+    }
+
+    /// Drops the struct fields of a cell in the frame, which is not freed
+    pub(super) fn drop_struct_contents(
+        &mut self,
+        value: Value<'ctx>,
+        node: usize,
+    ) -> Result<(), CodegenError> {
+        let layout = self.struct_layout(value.ty, node)?;
+        let cell = value
+            .llvm
+            .expect("struct values are pointers")
+            .into_pointer_value();
+        for (index, (field, field_ty)) in layout.fields.iter().enumerate() {
+            if !self.is_struct(*field_ty) {
+                continue;
+            }
+            let slot = self
+                .builder
+                .build_struct_gep(layout.llvm, cell, index as u32, field)?;
+            let inner = self.builder.build_load(self.ptr_type(), slot, field)?;
+            let inner = Value {
+                llvm: Some(inner),
+                ty: *field_ty,
+            };
+            self.drop_struct(inner, node)?;
+        }
+        Ok(())
+    }
+
+    /// `void suru.drop.N(ptr)`: frees one struct layout's cell after its
+    /// nested struct fields. A null cell, what a function returning a struct
+    /// yields when it ends without `return`, is left alone.
+    fn drop_function(
+        &mut self,
+        layout: &StructLayout<'ctx>,
+        node: usize,
+    ) -> Result<FunctionValue<'ctx>, CodegenError> {
+        if let Some(function) = self.runtime.drops.get(&layout.key) {
+            return Ok(*function);
+        }
+        let ptr_type = self.ptr_type();
+        let name = format!("suru.drop.{}", self.runtime.drops.len());
+        let function = self.module.add_function(
+            &name,
+            self.context.void_type().fn_type(&[ptr_type.into()], false),
+            Some(Linkage::Internal),
+        );
+        function.add_attribute(AttributeLoc::Function, self.enum_attribute("nounwind"));
+        // Registered before the body so self-referential layouts terminate
+        self.runtime.drops.insert(layout.key.clone(), function);
+
+        let builder = self.context.create_builder();
+        let entry = self.context.append_basic_block(function, "entry");
+        let release = self.context.append_basic_block(function, "release");
+        let done = self.context.append_basic_block(function, "done");
+        builder.position_at_end(entry);
+        let cell = function
+            .get_nth_param(0)
+            .expect("drop helpers take the cell")
+            .into_pointer_value();
+        let is_null = builder.build_is_null(cell, "null")?;
+        builder.build_conditional_branch(is_null, done, release)?;
+
+        builder.position_at_end(release);
+        for (index, (field, field_ty)) in layout.fields.iter().enumerate() {
+            if !self.is_struct(*field_ty) {
+                continue;
+            }
+            let field_layout = self.struct_layout(*field_ty, node)?;
+            let field_drop = self.drop_function(&field_layout, node)?;
+            let slot = builder.build_struct_gep(layout.llvm, cell, index as u32, field)?;
+            let inner: BasicTypeEnum<'ctx> = ptr_type.into();
+            let inner = builder.build_load(inner, slot, field)?;
+            builder.build_call(field_drop, &[inner.into()], "")?;
+        }
+        builder.build_free(cell)?;
+        builder.build_unconditional_branch(done)?;
+
+        builder.position_at_end(done);
+        builder.build_return(None)?;
+        Ok(function)
+    }
+}
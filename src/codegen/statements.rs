@@ -0,0 +1,406 @@
+// Statement emission - function bodies, the program entry point and the
+// statements of a block
+
+use std::collections::{HashMap, HashSet};
+
+use inkwell::types::BasicTypeEnum;
+use inkwell::values::PointerValue;
+
+use super::{Codegen, CodegenError, Frame, Value, Variable, storage};
+use crate::ast::NodeType;
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    /// Emits the body of a FunctionDecl into its declared LLVM function
+    pub(super) fn emit_function(&mut self, decl: usize) -> Result<(), CodegenError> {
+        let signature = self.signature(decl)?;
+        let function = signature.function;
+        let entry = self.context.append_basic_block(function, "entry");
+        self.builder.position_at_end(entry);
+
+        let body = self.ast().function_decl(decl).body_idx();
+        let stack_names = self.stack_locals.of_decl(decl);
+        let stack_drops = match body {
+            Some(body) => storage::last_uses(self.ast(), body, &stack_names),
+            None => HashMap::new(),
+        };
+        let mut frame = Frame {
+            function,
+            locals: HashMap::new(),
+            this: None,
+            return_type: signature.return_type,
+            top_level: false,
+            stack_names: stack_names.into_iter().map(String::from).collect(),
+            stack_drops,
+        };
+        let mut param_index = 0;
+        if let Some(this_type) = signature.this_type {
+            frame.this = Some(Value {
+                llvm: function.get_nth_param(0),
+                ty: this_type,
+            });
+            param_index = 1;
+        }
+        self.frame = Some(frame);
+
+        // Parameters live in stack slots so the body may reassign them
+        for (name, ty) in &signature.params {
+            let llvm_type = self.value_type(*ty, decl)?;
+            let slot = self.entry_alloca(llvm_type, name)?;
+            let param = function
+                .get_nth_param(param_index)
+                .expect("LLVM function has one parameter per declared parameter");
+            self.builder.build_store(slot, param)?;
+            self.frame_mut().locals.insert(
+                name.clone(),
+                Variable {
+                    ptr: slot,
+                    ty: *ty,
+                    owned: false,
+                    on_stack: false,
+                },
+            );
+            param_index += 1;
+        }
+
+        if let Some(body) = body {
+            self.emit_block(body)?;
+        }
+        if !self.block_terminated() {
+            self.drop_locals(None, decl)?;
+            match self.llvm_type(signature.return_type, decl)? {
+                None => self.builder.build_return(None)?,
+                Some(ty) => self.builder.build_return(Some(&ty.const_zero()))?,
+            };
+        }
+        self.frame = None;
+        Ok(())
+    }
+
+    /// Emits the C `main`: top-level statements, then the program's `main`
+    pub(super) fn emit_entry(&mut self) -> Result<(), CodegenError> {
+        let i32_type = self.context.i32_type();
+        let function = self
+            .module
+            .add_function("main", i32_type.fn_type(&[], false), None);
+        let entry = self.context.append_basic_block(function, "entry");
+        self.builder.position_at_end(entry);
+        self.frame = Some(Frame {
+            function,
+            locals: HashMap::new(),
+            this: None,
+            return_type: self.void,
+            top_level: true,
+            stack_names: HashSet::new(),
+            stack_drops: HashMap::new(),
+        });
+
+        if let Some(root) = self.output.ast.root {
+            self.emit_block(root)?;
+
+            let ast = self.ast();
+            let user_main = ast.children(root).find(|&child| {
+                ast.nodes[child].node_type == NodeType::FunctionDecl
+                    && ast.function_decl(child).name() == Some("main")
+            });
+            if let Some(decl) = user_main {
+                let signature = self.signature(decl)?;
+                if !signature.params.is_empty() {
+                    return Err(self.error(decl, "'main' must not take parameters".to_string()));
+                }
+                if !self.block_terminated() {
+                    self.builder.build_call(signature.function, &[], "")?;
+                }
+            }
+        }
+        if !self.block_terminated() {
+            self.builder
+                .build_return(Some(&i32_type.const_int(0, false)))?;
+        }
+        self.frame = None;
+        Ok(())
+    }
+
+    /// Emits a block's statements, stopping after a terminator. Stack locals
+    /// are dropped right after the statement that last uses them.
+    fn emit_block(&mut self, block: usize) -> Result<(), CodegenError> {
+        for statement in self.ast().children(block) {
+            if self.block_terminated() {
+                break;
+            }
+            self.emit_statement(statement)?;
+            if self.block_terminated() {
+                break;
+            }
+            let Some(names) = self.frame().stack_drops.get(&statement).cloned() else {
+                continue;
+            };
+            for name in names {
+                let Some(variable) = self.frame().locals.get(&name).copied() else {
+                    continue;
+                };
+                if variable.owned {
+                    self.drop_variable(variable, statement)?;
+                }
+                if let Some(local) = self.frame_mut().locals.get_mut(&name) {
+                    local.owned = false;
+                }
+            }
+        }
+        Ok(())
+    }
+
+    fn emit_statement(&mut self, node: usize) -> Result<(), CodegenError> {
+        let ast = self.ast();
+        match ast.nodes[node].node_type {
+            NodeType::VarDecl => self.emit_var_decl(node),
+            NodeType::ReturnStmt => self.emit_return(node),
+            NodeType::PropertyAssignment => self.emit_property_assignment(node),
+            NodeType::ExprStmt => match ast.nodes[node].first_child {
+                Some(expr) => self.emit_expr_statement(expr),
+                None => Ok(()),
+            },
+            // Lifted to their own LLVM functions, or compile-time only
+            NodeType::FunctionDecl
+            | NodeType::TypeDecl
+            | NodeType::ModuleDecl
+            | NodeType::Export => Ok(()),
+            NodeType::Import => Err(self.error(
+                node,
+                "Imports are not supported by code generation yet".to_string(),
+            )),
+            _ => self.emit_expr_statement(node),
+        }
+    }
+
+    /// Evaluates an expression for its effects, dropping a fresh struct result
+    fn emit_expr_statement(&mut self, expr: usize) -> Result<(), CodegenError> {
+        let value = self.expr(expr)?;
+        if self.is_place(expr) {
+            return Ok(());
+        }
+        self.drop_temporary(value, expr)
+    }
+
+    /// Declares a variable, or stores into it when the name already exists
+    fn emit_var_decl(&mut self, node: usize) -> Result<(), CodegenError> {
+        let view = self.ast().var_decl(node);
+        let (Some(name), Some(value_idx)) = (view.name(), view.value_expr_idx()) else {
+            return Ok(());
+        };
+        let existing = match self.frame().top_level {
+            true => self.globals.get(name).copied(),
+            false => self.frame().locals.get(name).copied(),
+        };
+        // A struct literal escape analysis kept in the frame gets a stack cell
+        let on_stack = existing.is_none()
+            && self.frame().stack_names.contains(name)
+            && self.ast().nodes[value_idx].node_type == NodeType::StructInit;
+        let value = match on_stack {
+            true => self.stack_struct_init(value_idx)?,
+            false => self.owned_expr(value_idx)?,
+        };
+        if value.llvm.is_none() {
+            return Err(self.error(
+                value_idx,
+                format!(
+                    "Cannot assign the result of a Void expression to '{}'",
+                    name
+                ),
+            ));
+        }
+
+        let variable = match existing {
+            Some(variable) => variable,
+            None => {
+                let declared = self.var_decl_type(node).unwrap_or(value.ty);
+                let llvm_type = self.value_type(declared, node)?;
+                let slot = self.entry_alloca(llvm_type, name)?;
+                let variable = Variable {
+                    ptr: slot,
+                    ty: declared,
+                    owned: true,
+                    on_stack,
+                };
+                self.frame_mut().locals.insert(name.to_string(), variable);
+                variable
+            }
+        };
+        let value = self.coerce(value, variable.ty, value_idx)?;
+        if existing.is_some_and(|variable| variable.owned) && self.is_struct(variable.ty) {
+            self.drop_variable(variable, node)?;
+        }
+        if existing.is_some() && !self.frame().top_level {
+            // A reassigned parameter now holds a value of this function's;
+            // the caller still owns, and drops, the one passed in. A stack
+            // local now holds a heap cell.
+            if let Some(local) = self.frame_mut().locals.get_mut(name) {
+                local.owned = true;
+                local.on_stack = false;
+            }
+        }
+        self.store(variable.ptr, value)
+    }
+
+    fn emit_return(&mut self, node: usize) -> Result<(), CodegenError> {
+        if self.frame().top_level {
+            return Err(self.error(node, "'return' outside a function".to_string()));
+        }
+        let Some(expr) = self.ast().nodes[node].first_child else {
+            self.drop_locals(None, node)?;
+            self.builder.build_return(None)?;
+            return Ok(());
+        };
+
+        // A struct reachable from the caller must not be handed back by
+        // reference. An owned local is moved out instead, so it is not dropped.
+        let mut value = self.expr(expr)?;
+        if self.is_borrowed_place(expr) && self.is_struct(value.ty) {
+            value = self.copy_struct(value, expr)?;
+        }
+        let ast = self.ast();
+        let mut moved = match ast.nodes[expr].node_type {
+            NodeType::Identifier => ast.node_text(expr),
+            _ => None,
+        };
+        // A frame cell does not survive the return, so it is copied out
+        let stack_local = moved
+            .and_then(|name| self.frame().locals.get(name))
+            .is_some_and(|variable| variable.on_stack && variable.owned);
+        if stack_local {
+            value = self.copy_struct(value, expr)?;
+            moved = None;
+        }
+        let value = self.coerce(value, self.frame().return_type, expr)?;
+        self.drop_locals(moved, node)?;
+        match value.llvm {
+            Some(v) => self.builder.build_return(Some(&v))?,
+            None => self.builder.build_return(None)?,
+        };
+        Ok(())
+    }
+
+    /// `receiver.field: value`
+    fn emit_property_assignment(&mut self, node: usize) -> Result<(), CodegenError> {
+        let ast = self.ast();
+        let access = ast.nodes[node]
+            .first_child
+            .expect("PropertyAssignment has a target");
+        let value_idx = ast.nodes[access]
+            .next_sibling
+            .expect("PropertyAssignment has a value");
+        let receiver = ast.nodes[access]
+            .first_child
+            .expect("PropertyAccess has a receiver");
+        let field = ast.nodes[receiver]
+            .next_sibling
+            .and_then(|f| ast.node_text(f))
+            .unwrap_or("");
+
+        let target = self.expr(receiver)?;
+        let layout = self.struct_layout(target.ty, receiver)?;
+        let Some(index) = layout.field_index(field) else {
+            return Err(self.error(access, format!("Struct has no field '{}'", field)));
+        };
+        let field_ty = layout.fields[index as usize].1;
+        let value = self.owned_expr(value_idx)?;
+        let value = self.coerce(value, field_ty, value_idx)?;
+        let slot = self.builder.build_struct_gep(
+            layout.llvm,
+            target
+                .llvm
+                .expect("struct values are pointers")
+                .into_pointer_value(),
+            index,
+            field,
+        )?;
+        // The struct owns its struct fields, so the replaced one is released
+        if self.is_struct(field_ty) {
+            let old = self.builder.build_load(self.ptr_type(), slot, field)?;
+            let old = Value {
+                llvm: Some(old),
+                ty: field_ty,
+            };
+            self.drop_struct(old, value_idx)?;
+        }
+        self.store(slot, value)
+    }
+
+    fn store(&mut self, ptr: PointerValue<'ctx>, value: Value<'ctx>) -> Result<(), CodegenError> {
+        if let Some(v) = value.llvm {
+            self.builder.build_store(ptr, v)?;
+        }
+        Ok(())
+    }
+
+    /// Drops the struct locals the function owns as it returns, except
+    /// `moved`, the one being returned. Bodies are straight-line statement
+    /// lists, so every local declared so far has been stored.
+    fn drop_locals(&mut self, moved: Option<&str>, node: usize) -> Result<(), CodegenError> {
+        let mut owned: Vec<(&String, Variable<'ctx>)> = self
+            .frame()
+            .locals
+            .iter()
+            .filter(|(name, variable)| variable.owned && Some(name.as_str()) != moved)
+            .map(|(name, variable)| (name, *variable))
+            .collect();
+        // By name, so the emitted code does not depend on hash order
+        owned.sort_by(|a, b| a.0.cmp(b.0));
+        let owned: Vec<Variable<'ctx>> = owned
+            .into_iter()
+            .map(|(_, variable)| variable)
+            .filter(|variable| self.is_struct(variable.ty))
+            .collect();
+        for variable in owned {
+            self.drop_variable(variable, node)?;
+        }
+        Ok(())
+    }
+
+    /// Drops the struct an owned variable holds: the whole heap cell, or
+    /// only the fields of a stack cell
+    fn drop_variable(&mut self, variable: Variable<'ctx>, node: usize) -> Result<(), CodegenError> {
+        let value = self.load_variable(variable)?;
+        match variable.on_stack {
+            true => self.drop_struct_contents(value, node),
+            false => self.drop_struct(value, node),
+        }
+    }
+
+    fn load_variable(&mut self, variable: Variable<'ctx>) -> Result<Value<'ctx>, CodegenError> {
+        let value = self
+            .builder
+            .build_load(self.ptr_type(), variable.ptr, "local")?;
+        Ok(Value {
+            llvm: Some(value),
+            ty: variable.ty,
+        })
+    }
+
+    /// Stack slot in the current function's entry block, so every slot is
+    /// allocated once regardless of where the variable is declared
+    pub(super) fn entry_alloca(
+        &self,
+        ty: BasicTypeEnum<'ctx>,
+        name: &str,
+    ) -> Result<PointerValue<'ctx>, CodegenError> {
+        let entry = self
+            .frame()
+            .function
+            .get_first_basic_block()
+            .expect("functions are emitted starting from an entry block");
+        let builder = self.context.create_builder();
+        match entry.get_first_instruction() {
+            Some(first) => builder.position_before(&first),
+            None => builder.position_at_end(entry),
+        }
+        Ok(builder.build_alloca(ty, name)?)
+    }
+
+    /// True when the current block already ends in a terminator
+    pub(super) fn block_terminated(&self) -> bool {
+        self.builder
+            .get_insert_block()
+            .and_then(|block| block.get_terminator())
+            .is_some()
+    }
+}
@@ -0,0 +1,143 @@
+// Frame storage - struct locals escape analysis placed in the frame
+//
+// Escape analysis runs on the lowered IR and marks the locals that never
+// outlive their function `on_stack`. Code generation still compiles from the
+// AST, so the decision is carried over by name, per FunctionDecl: a struct
+// local initialized by a literal gets an alloca'd cell, and its contents
+// (the heap cells of its struct fields) are dropped after the last statement
+// that mentions it, where the lowered IR puts its `Drop`. The cell itself is
+// the frame's.
+//
+// A FunctionDecl lowers to one function per pass-mode variant; a local is
+// only placed in the frame when every variant agrees. When lowering fails
+// nothing is, and every struct keeps its heap cell.
+
+use std::collections::{HashMap, HashSet};
+
+use crate::ast::{Ast, NodeType};
+use crate::lower::{self, LoweredStmt};
+use crate::semantic::AnalysisOutput;
+
+/// Names of the frame-allocated locals of each FunctionDecl
+#[derive(Debug, Default)]
+pub(super) struct StackLocals {
+    by_decl: HashMap<usize, HashSet<String>>,
+}
+
+impl StackLocals {
+    /// Lowers `output` and collects the locals escape analysis kept on the stack
+    pub fn of(output: &AnalysisOutput) -> Self {
+        let Ok(program) = lower::lower(output) else {
+            return StackLocals::default();
+        };
+        let mut by_decl: HashMap<usize, HashSet<String>> = HashMap::new();
+        for function in &program.functions {
+            let names: HashSet<String> = program.stmt_lists[function.body.indices()]
+                .iter()
+                .filter_map(|stmt| match program.stmts[stmt.0 as usize] {
+                    LoweredStmt::VarDecl {
+                        name,
+                        on_stack: true,
+                        ..
+                    } => Some(program.names.resolve(name).to_string()),
+                    _ => None,
+                })
+                .collect();
+            match by_decl.get_mut(&function.decl) {
+                Some(agreed) => agreed.retain(|name| names.contains(name)),
+                None => {
+                    by_decl.insert(function.decl, names);
+                }
+            }
+        }
+        StackLocals { by_decl }
+    }
+
+    /// Frame-allocated locals of `decl`, sorted by name
+    pub fn of_decl(&self, decl: usize) -> Vec<&str> {
+        let mut names: Vec<&str> = self
+            .by_decl
+            .get(&decl)
+            .map(|names| names.iter().map(String::as_str).collect())
+            .unwrap_or_default();
+        names.sort_unstable();
+        names
+    }
+}
+
+/// The statement of `body` that last mentions each of `names`, by statement
+/// node. Nested functions are skipped: they cannot capture locals.
+pub(super) fn last_uses(ast: &Ast, body: usize, names: &[&str]) -> HashMap<usize, Vec<String>> {
+    let mut last: HashMap<&str, usize> = HashMap::new();
+    for statement in ast.children(body) {
+        for name in names {
+            if mentions(ast, statement, name) {
+                last.insert(name, statement);
+            }
+        }
+    }
+    let mut drops: HashMap<usize, Vec<String>> = HashMap::new();
+    for name in names {
+        if let Some(statement) = last.get(name) {
+            drops.entry(*statement).or_default().push(name.to_string());
+        }
+    }
+    drops
+}
+
+fn mentions(ast: &Ast, node: usize, name: &str) -> bool {
+    match ast.nodes[node].node_type {
+        NodeType::FunctionDecl => false,
+        NodeType::Identifier if ast.node_text(node) == Some(name) => true,
+        _ => ast.children(node).any(|child| mentions(ast, child, name)),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::limits::CompilerLimits;
+    use crate::parser::parse;
+    use crate::semantic::SemanticAnalyzer;
+
+    #[test]
+    fn test_stack_locals_follow_escape_analysis() {
+        let source = "\
+type Point: { x Number, y Number }
+norm: (p Point) Number {
+    return p.x
+}
+make: () Point {
+    kept: { x: 1, y: 2 }
+    n: norm(kept)
+    out: { x: n, y: 0 }
+    return out
+}
+";
+        let limits = CompilerLimits::default();
+        let ast = parse(lex(source, &limits).unwrap(), &limits).unwrap();
+        let output = SemanticAnalyzer::new(ast).analyze_with_types().unwrap();
+        let ast = &output.ast;
+        let make = ast
+            .nodes
+            .iter()
+            .enumerate()
+            .position(|(i, node)| {
+                node.node_type == NodeType::FunctionDecl
+                    && ast.function_decl(i).name() == Some("make")
+            })
+            .unwrap();
+
+        // `out` is returned, so only `kept` stays in the frame
+        let stack = StackLocals::of(&output);
+        assert_eq!(stack.of_decl(make), vec!["kept"]);
+
+        // Its last use is the call to `norm`, the body's second statement
+        let body = ast.function_decl(make).body_idx().unwrap();
+        let drops = last_uses(ast, body, &stack.of_decl(make));
+        let call = ast.children(body).nth(1).unwrap();
+        assert_eq!(drops.get(&call), Some(&vec!["kept".to_string()]));
+        assert_eq!(drops.len(), 1);
+    }
+}
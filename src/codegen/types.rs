@@ -0,0 +1,204 @@
+// Type lowering - maps resolved Suru types to LLVM types and lays out structs
+
+use std::rc::Rc;
+
+use inkwell::AddressSpace;
+use inkwell::types::{BasicMetadataTypeEnum, BasicType, BasicTypeEnum, FunctionType, StructType};
+
+use super::{Codegen, CodegenError};
+use crate::semantic::{FloatSize, IntSize, Type, TypeId, UIntSize};
+
+/// Memory layout of a struct value: fields sorted by name, followed by one
+/// function pointer slot per method, also sorted by name
+pub(super) struct StructLayout<'ctx> {
+    pub llvm: StructType<'ctx>,
+    pub fields: Vec<(String, TypeId)>,
+    pub methods: Vec<(String, TypeId)>,
+    /// Field names with their LLVM representation, then method names.
+    /// Two struct types can share values exactly when their keys are equal.
+    pub key: String,
+}
+
+impl StructLayout<'_> {
+    /// Slot index of a field
+    pub fn field_index(&self, name: &str) -> Option<u32> {
+        self.fields
+            .iter()
+            .position(|(n, _)| n == name)
+            .map(|i| i as u32)
+    }
+
+    /// Slot index of a method's function pointer
+    pub fn method_index(&self, name: &str) -> Option<u32> {
+        let position = self.methods.iter().position(|(n, _)| n == name)?;
+        Some((self.fields.len() + position) as u32)
+    }
+}
+
+impl<'a, 'ctx> Codegen<'a, 'ctx> {
+    /// Resolves a TypeId through the final substitution
+    pub(super) fn resolve(&self, ty: TypeId) -> &'a Type {
+        self.output.resolve(ty)
+    }
+
+    /// True for types code generation can lower (no unresolved inference types)
+    pub(super) fn is_concrete(&self, ty: TypeId) -> bool {
+        !matches!(
+            self.resolve(ty),
+            Type::Var(_)
+                | Type::Unknown
+                | Type::TypeVar(_)
+                | Type::TypeParameter { .. }
+                | Type::Error
+        )
+    }
+
+    pub(super) fn is_struct(&self, ty: TypeId) -> bool {
+        matches!(self.resolve(ty), Type::Struct(_))
+    }
+
+    /// LLVM type of a value of type `ty`, `None` for Void
+    pub(super) fn llvm_type(
+        &mut self,
+        ty: TypeId,
+        node: usize,
+    ) -> Result<Option<BasicTypeEnum<'ctx>>, CodegenError> {
+        let context = self.context;
+        let lowered: BasicTypeEnum<'ctx> = match self.resolve(ty) {
+            Type::Void | Type::Unit => return Ok(None),
+            Type::Number => context.f64_type().into(),
+            Type::Bool => context.bool_type().into(),
+            Type::Int(size) => match size {
+                IntSize::I8 => context.i8_type().into(),
+                IntSize::I16 => context.i16_type().into(),
+                IntSize::I32 => context.i32_type().into(),
+                IntSize::I64 => context.i64_type().into(),
+            },
+            Type::UInt(size) => match size {
+                UIntSize::U8 => context.i8_type().into(),
+                UIntSize::U16 => context.i16_type().into(),
+                UIntSize::U32 => context.i32_type().into(),
+                UIntSize::U64 => context.i64_type().into(),
+            },
+            Type::Float(FloatSize::F32) => context.f32_type().into(),
+            Type::Float(FloatSize::F64) => context.f64_type().into(),
+            Type::String | Type::Struct(_) | Type::Function(_) => self.ptr_type().into(),
+            Type::NamedUnit(_) => context.i64_type().into(),
+            Type::Union(members)
+                if members
+                    .iter()
+                    .all(|m| matches!(self.resolve(*m), Type::NamedUnit(_))) =>
+            {
+                context.i64_type().into()
+            }
+            _ if !self.is_concrete(ty) => {
+                return Err(self.error(
+                    node,
+                    "Cannot determine the type of this value; add a type annotation".to_string(),
+                ));
+            }
+            _ => {
+                return Err(self.error(
+                    node,
+                    format!(
+                        "Values of type '{}' are not supported by code generation yet",
+                        self.type_name(ty)
+                    ),
+                ));
+            }
+        };
+        Ok(Some(lowered))
+    }
+
+    /// LLVM type of a value that must not be Void
+    pub(super) fn value_type(
+        &mut self,
+        ty: TypeId,
+        node: usize,
+    ) -> Result<BasicTypeEnum<'ctx>, CodegenError> {
+        self.llvm_type(ty, node)?
+            .ok_or_else(|| self.error(node, "Expected a value, found Void".to_string()))
+    }
+
+    /// LLVM function type for the given parameter and return types
+    pub(super) fn function_type(
+        &mut self,
+        params: &[BasicMetadataTypeEnum<'ctx>],
+        return_type: TypeId,
+        node: usize,
+    ) -> Result<FunctionType<'ctx>, CodegenError> {
+        Ok(match self.llvm_type(return_type, node)? {
+            Some(ty) => ty.fn_type(params, false),
+            None => self.context.void_type().fn_type(params, false),
+        })
+    }
+
+    pub(super) fn ptr_type(&self) -> inkwell::types::PointerType<'ctx> {
+        self.context.ptr_type(AddressSpace::default())
+    }
+
+    /// Layout of the struct type `ty`
+    pub(super) fn struct_layout(
+        &mut self,
+        ty: TypeId,
+        node: usize,
+    ) -> Result<Rc<StructLayout<'ctx>>, CodegenError> {
+        let resolved = self
+            .output
+            .substitution
+            .apply(ty, &self.output.type_registry);
+        if let Some(layout) = self.layouts.get(&resolved) {
+            return Ok(Rc::clone(layout));
+        }
+
+        let Type::Struct(struct_type) = self.resolve(resolved) else {
+            return Err(self.error(
+                node,
+                format!("Expected a struct value, found '{}'", self.type_name(ty)),
+            ));
+        };
+        let mut fields: Vec<(String, TypeId)> = struct_type
+            .fields
+            .iter()
+            .map(|f| (f.name.clone(), f.type_id))
+            .collect();
+        let mut methods: Vec<(String, TypeId)> = struct_type
+            .methods
+            .iter()
+            .map(|m| (m.name.clone(), m.function_type))
+            .collect();
+        fields.sort_by(|a, b| a.0.cmp(&b.0));
+        methods.sort_by(|a, b| a.0.cmp(&b.0));
+
+        let mut slots = Vec::with_capacity(fields.len() + methods.len());
+        let mut key = String::new();
+        for (name, field_ty) in &fields {
+            let slot = self.value_type(*field_ty, node)?;
+            key.push_str(&format!("{}:{} ", name, self.representation(slot)));
+            slots.push(slot);
+        }
+        for (name, _) in &methods {
+            slots.push(self.ptr_type().into());
+            key.push_str(&format!("{}() ", name));
+        }
+
+        let layout = Rc::new(StructLayout {
+            llvm: self.context.struct_type(&slots, false),
+            fields,
+            methods,
+            key,
+        });
+        self.layouts.insert(resolved, Rc::clone(&layout));
+        Ok(layout)
+    }
+
+    /// Short name of an LLVM type's machine representation
+    fn representation(&self, ty: BasicTypeEnum<'ctx>) -> String {
+        match ty {
+            BasicTypeEnum::FloatType(f) if f == self.context.f32_type() => "f32".to_string(),
+            BasicTypeEnum::FloatType(_) => "f64".to_string(),
+            BasicTypeEnum::IntType(i) => format!("i{}", i.get_bit_width()),
+            _ => "ptr".to_string(),
+        }
+    }
+}
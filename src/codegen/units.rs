@@ -0,0 +1,167 @@
+// Codegen units - splits a program's functions across several LLVM modules
+// that are generated, optimized and emitted to object files in parallel
+//
+// Each unit runs the whole front half of code generation (symbols,
+// signatures, struct layouts) so every unit can declare what it calls, but
+// only emits the bodies of the functions hashed to it. The entry unit also
+// defines the C `main` and the top-level globals; the other units declare
+// them. Every unit lives in its own `Context` on its own thread.
+
+use std::path::{Path, PathBuf};
+
+use crate::ast::NodeType;
+use crate::semantic::AnalysisOutput;
+use crate::stable_hash::StableHasher;
+use crate::stats::Profile;
+
+use super::storage::StackLocals;
+use super::{BuildOptions, CodegenError};
+
+/// Functions per unit below which another unit costs more than it saves
+const FUNCTIONS_PER_UNIT: usize = 32;
+
+/// One of `count` LLVM modules a program is split into
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub(super) struct CodegenUnit {
+    pub index: usize,
+    pub count: usize,
+}
+
+impl CodegenUnit {
+    /// The single unit of an unsplit program
+    pub const WHOLE: CodegenUnit = CodegenUnit { index: 0, count: 1 };
+
+    /// The entry unit defines the C `main` and the top-level globals
+    pub fn is_entry(self) -> bool {
+        self.index == 0
+    }
+
+    /// Whether the function with LLVM symbol `symbol` is emitted here
+    pub fn owns(self, symbol: &str) -> bool {
+        self.count == 1 || partition(symbol, self.count) == self.index
+    }
+}
+
+/// Unit of a function symbol: a stable hash, so the split is the same on
+/// every build and platform and an edit only moves the functions it touches
+fn partition(symbol: &str, count: usize) -> usize {
+    let mut hasher = StableHasher::new();
+    hasher.bytes(symbol.as_bytes());
+    (hasher.finish_u64() % count as u64) as usize
+}
+
+/// Number of units to split `output` into: `requested`, or one per
+/// `FUNCTIONS_PER_UNIT` functions up to the available cores. Never more
+/// units than functions.
+pub(super) fn unit_count(output: &AnalysisOutput, requested: Option<usize>) -> usize {
+    let functions = output
+        .ast
+        .nodes
+        .iter()
+        .filter(|node| node.node_type == NodeType::FunctionDecl)
+        .count();
+    let wanted = match requested {
+        Some(count) => count,
+        None => {
+            let cores = std::thread::available_parallelism().map_or(1, |n| n.get());
+            cores.min(functions.div_ceil(FUNCTIONS_PER_UNIT))
+        }
+    };
+    wanted.min(functions).max(1)
+}
+
+/// Object file of unit `index` of the executable at `path`
+pub(super) fn object_path(path: &Path, unit: CodegenUnit) -> PathBuf {
+    match unit.count {
+        1 => path.with_extension("o"),
+        _ => path.with_extension(format!("{}.o", unit.index)),
+    }
+}
+
+/// Generates, optimizes and emits `count` units on one thread each,
+/// returning their object files in unit order
+///
+/// Per-unit passes are not timed; the caller times the whole parallel phase.
+pub(super) fn emit_units(
+    output: &AnalysisOutput,
+    path: &Path,
+    options: &BuildOptions,
+    stack_locals: &StackLocals,
+    count: usize,
+) -> Result<Vec<PathBuf>, CodegenError> {
+    let results: Vec<Result<PathBuf, CodegenError>> = std::thread::scope(|scope| {
+        let handles: Vec<_> = (0..count)
+            .map(|index| {
+                let unit = CodegenUnit { index, count };
+                scope.spawn(move || {
+                    let object = object_path(path, unit);
+                    super::emit_unit(
+                        output,
+                        path,
+                        unit,
+                        options,
+                        stack_locals,
+                        &object,
+                        &mut Profile::default(),
+                    )
+                    .map(|()| object)
+                })
+            })
+            .collect();
+        handles
+            .into_iter()
+            .map(|handle| handle.join().expect("codegen unit thread panicked"))
+            .collect()
+    });
+    let mut objects = Vec::with_capacity(count);
+    let mut first_error = None;
+    for result in results {
+        match result {
+            Ok(object) => objects.push(object),
+            Err(e) => {
+                first_error.get_or_insert(e);
+            }
+        }
+    }
+    match first_error {
+        None => Ok(objects),
+        Some(e) => {
+            for object in &objects {
+                let _ = std::fs::remove_file(object);
+            }
+            Err(e)
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_partition_is_stable_and_in_range() {
+        for count in 1..8 {
+            for symbol in ["suru.main", "suru.a", "suru.outer.inner", "suru.p.get"] {
+                let unit = partition(symbol, count);
+                assert!(unit < count);
+                assert_eq!(unit, partition(symbol, count));
+            }
+        }
+        assert!(CodegenUnit::WHOLE.owns("suru.anything"));
+        let units: Vec<CodegenUnit> = (0..3)
+            .map(|index| CodegenUnit { index, count: 3 })
+            .collect();
+        assert_eq!(units.iter().filter(|u| u.owns("suru.main")).count(), 1);
+    }
+
+    #[test]
+    fn test_object_paths() {
+        let path = Path::new("target/dev/app");
+        assert_eq!(
+            object_path(path, CodegenUnit::WHOLE),
+            Path::new("target/dev/app.o")
+        );
+        let unit = CodegenUnit { index: 2, count: 4 };
+        assert_eq!(object_path(path, unit), Path::new("target/dev/app.2.o"));
+    }
+}
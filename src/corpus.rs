@@ -0,0 +1,433 @@
+// Synthetic Suru corpus generator
+//
+// Emits valid Suru programs of configurable size and shape for benchmarks
+// and scale tests. A `CorpusShape` describes one "unit" of declarations:
+//   - generic struct types and generic functions
+//   - a union of K variant types and a match over every variant
+//   - a chain of functions, each calling the previous one
+//   - a match tree nested `match_depth` levels deep
+//   - pipe (`x | f | g`) and compose (`f + g`) chains
+//   - struct types with methods, instances, field reads and composition
+//   - list literals
+//
+// Every name in a unit carries a suffix, so units can be repeated in one
+// file (`single_file`, `sized`) or spread over modules that import each
+// other (`modules`). The output always passes `check`; the tests below
+// hold the generator to that.
+
+use crate::limits::CompilerLimits;
+use crate::semantic::SourceFile;
+use crate::{lexer, parser};
+
+/// Size and shape of the generated declarations
+#[derive(Debug, Clone)]
+pub struct CorpusShape {
+    /// Modules for `modules`, units for `single_file`
+    pub modules: usize,
+    /// Functions per unit; pipe and compose chains cycle through them
+    pub functions: usize,
+    /// Generic struct types (each with a generic function) per unit
+    pub generic_types: usize,
+    /// Variants of the unit's union type (at least one)
+    pub union_variants: usize,
+    /// Nesting depth of the unit's match tree
+    pub match_depth: usize,
+    /// Stages of the pipe chain and terms of the compose chain
+    pub chain_length: usize,
+    /// Struct types (each with an instance) per unit
+    pub structs: usize,
+    /// Fields per struct type
+    pub struct_fields: usize,
+    /// List literals per unit
+    pub lists: usize,
+    /// Elements per list literal
+    pub list_length: usize,
+}
+
+impl Default for CorpusShape {
+    fn default() -> Self {
+        Self {
+            modules: 4,
+            functions: 8,
+            generic_types: 2,
+            union_variants: 4,
+            match_depth: 8,
+            chain_length: 8,
+            structs: 2,
+            struct_fields: 6,
+            lists: 2,
+            list_length: 16,
+        }
+    }
+}
+
+/// What `sized` measures a generated file by
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Measure {
+    Bytes,
+    Tokens,
+    Nodes,
+}
+
+impl CorpusShape {
+    /// One unit per file holding only a one-variant union and its match;
+    /// a base for shapes that stress a single construct
+    pub fn minimal() -> Self {
+        Self {
+            modules: 1,
+            functions: 0,
+            generic_types: 0,
+            union_variants: 1,
+            match_depth: 0,
+            chain_length: 0,
+            structs: 0,
+            struct_fields: 0,
+            lists: 0,
+            list_length: 0,
+        }
+    }
+
+    /// One unit of declarations; `suffix` is appended to every name
+    pub fn unit(&self, suffix: &str) -> String {
+        let mut out = String::new();
+        self.write_generics(&mut out, suffix);
+        self.write_union(&mut out, suffix);
+        self.write_functions(&mut out, suffix);
+        self.write_match_tree(&mut out, suffix);
+        self.write_chains(&mut out, suffix);
+        self.write_structs(&mut out, suffix);
+        self.write_lists(&mut out, suffix);
+        out
+    }
+
+    /// `modules` units in one file
+    pub fn single_file(&self) -> String {
+        (0..self.modules)
+            .map(|u| self.unit(&format!("U{u}")))
+            .collect()
+    }
+
+    /// `modules` files declaring `module m<k>`, each importing the previous
+    /// module and exporting its functions, plus `main.suru` importing them all
+    pub fn modules(&self) -> Vec<SourceFile> {
+        let mut files: Vec<SourceFile> = (0..self.modules)
+            .map(|k| {
+                let suffix = format!("M{k}");
+                let mut source = format!("module m{k}\n");
+                if k > 0 {
+                    source.push_str(&format!("import {{ m{} }}\n", k - 1));
+                }
+                source.push_str(&self.unit(&suffix));
+                if self.functions > 0 {
+                    let exports: Vec<String> = (0..self.functions)
+                        .map(|i| format!("fn{i}{suffix}"))
+                        .collect();
+                    source.push_str(&format!("export {{ {} }}\n", exports.join(", ")));
+                }
+                SourceFile {
+                    name: format!("m{k}.suru"),
+                    source,
+                }
+            })
+            .collect();
+
+        let mut main = String::new();
+        if self.modules > 0 {
+            let imports: Vec<String> = (0..self.modules).map(|k| format!("m{k}")).collect();
+            main.push_str(&format!("import {{ {} }}\n", imports.join(", ")));
+        }
+        main.push_str(&self.unit("Main"));
+        files.push(SourceFile {
+            name: "main.suru".to_string(),
+            source: main,
+        });
+        files
+    }
+
+    /// Single file of repeated units measuring at least `target`
+    ///
+    /// With `target` one past a `CompilerLimits` value (10 MB input,
+    /// 100k tokens, 1M nodes by default) the result reproduces that limit.
+    pub fn sized(&self, measure: Measure, target: usize) -> String {
+        let mut out = String::new();
+        if measure == Measure::Bytes {
+            let mut u = 0;
+            while out.len() < target {
+                out.push_str(&self.unit(&format!("U{u}")));
+                u += 1;
+            }
+            return out;
+        }
+
+        // Units differ only in their suffix, so they all have the same
+        // token and node counts; measure one and repeat it
+        let per_unit = measure_source(&self.unit("U0"), measure).max(1);
+        let units = target.div_ceil(per_unit);
+        for u in 0..units {
+            out.push_str(&self.unit(&format!("U{u}")));
+        }
+        out
+    }
+
+    fn write_generics(&self, out: &mut String, s: &str) {
+        for g in 0..self.generic_types {
+            out.push_str(&format!(
+                "type Box{g}{s}<T>: {{\n    item T\n}}\n\
+                 pick{g}{s}<T>: (a T, b T) T {{ return a }}\n\
+                 picked{g}{s}: pick{g}{s}({g}, 1)\n"
+            ));
+        }
+    }
+
+    fn write_union(&self, out: &mut String, s: &str) {
+        let variants = self.union_variants.max(1);
+        for k in 0..variants {
+            let base = ["Number", "String", "Bool"][k % 3];
+            out.push_str(&format!("type Variant{k}{s}: {base}\n"));
+        }
+        let names: Vec<String> = (0..variants).map(|k| format!("Variant{k}{s}")).collect();
+        out.push_str(&format!("type Union{s}: {}\n", names.join(", ")));
+
+        out.push_str(&format!(
+            "describe{s}: (u Union{s}) String {{\n    return match u {{\n"
+        ));
+        for (k, name) in names.iter().enumerate() {
+            out.push_str(&format!("        {name}: \"v{k}\"\n"));
+        }
+        out.push_str("        _: \"other\"\n    }\n}\n");
+    }
+
+    fn write_functions(&self, out: &mut String, s: &str) {
+        for i in 0..self.functions {
+            let body = if i == 0 {
+                "x".to_string()
+            } else {
+                format!("fn{}{s}(x)", i - 1)
+            };
+            out.push_str(&format!(
+                "fn{i}{s}: (x Number) Number {{ return {body} }}\n"
+            ));
+        }
+    }
+
+    fn write_match_tree(&self, out: &mut String, s: &str) {
+        out.push_str(&format!("classify{s}: (n Number) String {{\n    return "));
+        for level in 0..self.match_depth {
+            let indent = "    ".repeat(level + 2);
+            out.push_str(&format!(
+                "match n {{\n{indent}{level}: \"level {level}\"\n{indent}_: "
+            ));
+        }
+        out.push_str("\"leaf\"");
+        for level in (0..self.match_depth).rev() {
+            out.push_str(&format!("\n{}}}", "    ".repeat(level + 1)));
+        }
+        out.push_str("\n}\n");
+    }
+
+    fn write_chains(&self, out: &mut String, s: &str) {
+        if self.functions == 0 || self.chain_length == 0 {
+            return;
+        }
+        let stages: Vec<String> = (0..self.chain_length)
+            .map(|i| format!("fn{}{s}", i % self.functions))
+            .collect();
+        out.push_str(&format!("piped{s}: 0 | {}\n", stages.join(" | ")));
+        out.push_str(&format!("composed{s}: {}\n", stages.join(" + ")));
+    }
+
+    fn write_structs(&self, out: &mut String, s: &str) {
+        // field0 is always a Number so every method can return it
+        let field_type = |f: usize| ["Number", "String", "Bool"][f % 3];
+        let field_value = |f: usize| match f % 3 {
+            0 => f.to_string(),
+            1 => format!("\"field {f}\""),
+            _ => "true".to_string(),
+        };
+
+        for j in 0..self.structs {
+            out.push_str(&format!("type Record{j}{s}: {{\n"));
+            for f in 0..self.struct_fields {
+                out.push_str(&format!("    field{f} {}\n", field_type(f)));
+            }
+            out.push_str(&format!("    total{j}{s}: () Number\n}}\n"));
+
+            out.push_str(&format!("record{j}{s} Record{j}{s}: {{\n"));
+            for f in 0..self.struct_fields {
+                out.push_str(&format!("    field{f}: {}\n", field_value(f)));
+            }
+            let result = if self.struct_fields > 0 {
+                "this.field0"
+            } else {
+                "0"
+            };
+            out.push_str(&format!(
+                "    total{j}{s}: () Number {{ return {result} }}\n}}\n"
+            ));
+
+            for f in 0..self.struct_fields {
+                out.push_str(&format!("read{j}x{f}{s}: record{j}{s}.field{f}\n"));
+            }
+        }
+
+        if self.structs > 0 {
+            out.push_str(&format!(
+                "type Tag{s}: {{\n    tag String\n}}\n\
+                 type Tagged{s}: Record0{s} + Tag{s}\n\
+                 tagged{s} Tagged{s}: record0{s} + {{ tag: \"{s}\" }}\n"
+            ));
+        }
+    }
+
+    fn write_lists(&self, out: &mut String, s: &str) {
+        for l in 0..self.lists {
+            let items: Vec<String> = (0..self.list_length).map(|i| i.to_string()).collect();
+            out.push_str(&format!("values{l}{s}: [{}]\n", items.join(", ")));
+        }
+    }
+}
+
+/// Limits that never trip, for measuring generated sources
+fn unbounded() -> CompilerLimits {
+    CompilerLimits {
+        max_input_size: usize::MAX,
+        max_token_count: usize::MAX,
+        max_identifier_length: usize::MAX,
+        max_string_length: usize::MAX,
+        max_comment_length: usize::MAX,
+        max_expr_depth: usize::MAX,
+        max_ast_nodes: usize::MAX,
+        max_analysis_millis: usize::MAX,
+        max_type_vars: usize::MAX,
+        max_constraints: usize::MAX,
+        max_memory_bytes: usize::MAX,
+    }
+}
+
+/// Size of a source by the given measure
+pub fn measure_source(source: &str, measure: Measure) -> usize {
+    let limits = unbounded();
+    match measure {
+        Measure::Bytes => source.len(),
+        Measure::Tokens => lexer::lex(source, &limits).map_or(0, |t| t.list.len()),
+        Measure::Nodes => lexer::lex(source, &limits)
+            .ok()
+            .and_then(|t| parser::parse(t, &limits).ok())
+            .map_or(0, |ast| ast.nodes.len()),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::semantic::{MultiFileAnalyzer, SemanticAnalyzer};
+
+    fn assert_checks(source: &str) {
+        let limits = unbounded();
+        let tokens = lexer::lex(source, &limits).expect("lex failed");
+        let ast = parser::parse(tokens, &limits).expect("parse failed");
+        if let Err(err) = SemanticAnalyzer::new(ast).analyze_with_types() {
+            panic!(
+                "generated source does not check: {:?}\n{}",
+                err.errors, source
+            );
+        }
+    }
+
+    #[test]
+    fn test_single_file_checks_across_shapes() {
+        assert_checks(&CorpusShape::default().single_file());
+
+        // Degenerate and lopsided shapes are still valid programs
+        let shapes = [
+            CorpusShape::minimal(),
+            CorpusShape {
+                structs: 3,
+                struct_fields: 0,
+                ..CorpusShape::default()
+            },
+            CorpusShape {
+                functions: 1,
+                chain_length: 1,
+                ..CorpusShape::default()
+            },
+            CorpusShape {
+                modules: 1,
+                union_variants: 12,
+                match_depth: 60,
+                chain_length: 50,
+                struct_fields: 40,
+                list_length: 500,
+                ..CorpusShape::default()
+            },
+        ];
+        for shape in &shapes {
+            assert_checks(&shape.single_file());
+        }
+    }
+
+    #[test]
+    fn test_modules_check_together() {
+        let files = CorpusShape {
+            modules: 6,
+            ..CorpusShape::default()
+        }
+        .modules();
+        assert_eq!(files.len(), 7);
+        assert!(files[3].source.starts_with("module m3\nimport { m2 }\n"));
+
+        let results = MultiFileAnalyzer::new(files).analyze();
+        assert_eq!(results.len(), 7);
+        for (name, result) in &results {
+            assert!(result.errors.is_empty(), "{}: {:?}", name, result.errors);
+        }
+    }
+
+    #[test]
+    fn test_sized_reaches_target() {
+        let shape = CorpusShape::default();
+        for (measure, target) in [
+            (Measure::Bytes, 50_000),
+            (Measure::Tokens, 20_000),
+            (Measure::Nodes, 20_000),
+        ] {
+            let source = shape.sized(measure, target);
+            let size = measure_source(&source, measure);
+            let unit = measure_source(&shape.unit("U0"), measure);
+            assert!(size >= target, "{:?}: {} < {}", measure, size, target);
+            assert!(
+                size < target + 2 * unit,
+                "{:?}: overshoot {}",
+                measure,
+                size
+            );
+        }
+    }
+
+    #[test]
+    fn test_sized_reproduces_default_limits() {
+        let limits = CompilerLimits::default();
+        let shape = CorpusShape::default();
+
+        let source = shape.sized(Measure::Bytes, limits.max_input_size + 1);
+        let err = lexer::lex(&source, &limits).unwrap_err();
+        assert!(err.to_string().contains("Input too large"), "{}", err);
+
+        let source = shape.sized(Measure::Tokens, limits.max_token_count + 1);
+        let err = lexer::lex(&source, &limits).unwrap_err();
+        assert!(err.to_string().contains("Token limit"), "{}", err);
+
+        // Same shape under the token limit checks cleanly
+        assert_checks(&shape.sized(Measure::Tokens, limits.max_token_count / 2));
+
+        // Node limit, scaled down to keep the test fast
+        let scaled = CompilerLimits {
+            max_ast_nodes: 20_000,
+            ..limits
+        };
+        let source = shape.sized(Measure::Nodes, scaled.max_ast_nodes + 1);
+        let tokens = lexer::lex(&source, &scaled).unwrap();
+        let err = parser::parse(tokens, &scaled).unwrap_err();
+        assert!(err.message.contains("AST node limit exceeded"), "{}", err);
+    }
+}
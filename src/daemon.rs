@@ -0,0 +1,509 @@
+// Compiler daemon module
+//
+// A long-lived `suru daemon` process keeps the compiler limits and the
+// analysis results of every file it has seen in memory, and answers
+// `check`/`parse` requests over a local Unix socket. A background thread
+// polls the files it knows about and re-analyzes them as soon as they change,
+// so the next request is served from a warm cache.
+//
+// The `suru` CLI transparently forwards `check`/`parse` to a running daemon
+// when its socket exists; both sides take the socket path from
+// `SURU_DAEMON_SOCKET`, falling back to `target/dev/suru-daemon.sock` in the
+// current directory. Set `SURU_NO_DAEMON=1` to force in-process compilation.
+//
+// Wire protocol (one request per connection):
+//   request:  "<verb> [path]\n"   verb = check | parse | ping | shutdown
+//   response: "<exit_code> <stdout_len> <stderr_len>\n" <stdout> <stderr>
+
+use std::collections::HashMap;
+use std::io::{self, BufRead, BufReader, Read, Write};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+
+use crate::driver::{self, CommandOutput};
+use crate::file_stamp::FileStamp;
+use crate::limits::CompilerLimits;
+
+/// Socket path used when none is given, relative to the workspace root
+pub const DEFAULT_SOCKET_PATH: &str = "target/dev/suru-daemon.sock";
+
+/// Environment variable that overrides the socket path for the daemon and
+/// its clients
+pub const SOCKET_ENV: &str = "SURU_DAEMON_SOCKET";
+
+/// Environment variable that disables forwarding requests to a daemon
+pub const NO_DAEMON_ENV: &str = "SURU_NO_DAEMON";
+
+/// Longest accepted request line in bytes
+const MAX_REQUEST_LEN: usize = 64 * 1024;
+
+/// Timeout for reading a request or writing a response
+const IO_TIMEOUT: Duration = Duration::from_secs(30);
+
+/// Which pipeline a request runs
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum RequestKind {
+    Check,
+    Parse,
+}
+
+/// A single daemon request
+#[derive(Debug, Clone, PartialEq)]
+pub enum Request {
+    Run(RequestKind, PathBuf),
+    Ping,
+    Shutdown,
+}
+
+impl Request {
+    /// Encodes the request as a protocol line
+    fn encode(&self) -> String {
+        match self {
+            Request::Run(RequestKind::Check, path) => format!("check {}\n", path.display()),
+            Request::Run(RequestKind::Parse, path) => format!("parse {}\n", path.display()),
+            Request::Ping => "ping\n".to_string(),
+            Request::Shutdown => "shutdown\n".to_string(),
+        }
+    }
+
+    /// Decodes a protocol line (without the trailing newline)
+    fn decode(line: &str) -> Result<Self, String> {
+        let (verb, arg) = match line.split_once(' ') {
+            Some((verb, arg)) => (verb, Some(arg)),
+            None => (line, None),
+        };
+
+        match (verb, arg) {
+            ("check", Some(path)) if !path.is_empty() => {
+                Ok(Request::Run(RequestKind::Check, PathBuf::from(path)))
+            }
+            ("parse", Some(path)) if !path.is_empty() => {
+                Ok(Request::Run(RequestKind::Parse, PathBuf::from(path)))
+            }
+            ("ping", None) => Ok(Request::Ping),
+            ("shutdown", None) => Ok(Request::Shutdown),
+            _ => Err(format!("Malformed daemon request: '{}'", line)),
+        }
+    }
+}
+
+// ========== Workspace State ==========
+
+/// Cached analysis results for one file
+#[derive(Debug)]
+struct CachedFile {
+    stamp: FileStamp,
+    check: Option<CommandOutput>,
+    parse: Option<CommandOutput>,
+}
+
+impl CachedFile {
+    fn slot(&mut self, kind: RequestKind) -> &mut Option<CommandOutput> {
+        match kind {
+            RequestKind::Check => &mut self.check,
+            RequestKind::Parse => &mut self.parse,
+        }
+    }
+}
+
+/// In-memory state of a workspace served by the daemon
+pub struct Workspace {
+    root: PathBuf,
+    limits: Result<CompilerLimits, String>,
+    limits_stamp: Option<FileStamp>,
+    files: HashMap<PathBuf, CachedFile>,
+}
+
+impl Workspace {
+    /// Creates the workspace state for `root`, loading `project.toml` once
+    pub fn new<P: Into<PathBuf>>(root: P) -> Self {
+        let root = root.into();
+        let limits_stamp = FileStamp::of(&root.join("project.toml"));
+        let limits = driver::load_limits(&root).map_err(|e| e.to_string());
+        Self {
+            root,
+            limits,
+            limits_stamp,
+            files: HashMap::new(),
+        }
+    }
+
+    /// Number of files with cached results
+    pub fn cached_files(&self) -> usize {
+        self.files.len()
+    }
+
+    /// Answers a check/parse request, reusing cached results when the file is unchanged
+    pub fn handle(&mut self, kind: RequestKind, path: &Path) -> CommandOutput {
+        self.reload_limits_if_changed();
+
+        let limits = match &self.limits {
+            Ok(l) => l.clone(),
+            Err(e) => return CommandOutput::error(e),
+        };
+
+        let path = self.resolve(path);
+        let Some(stamp) = FileStamp::of(&path) else {
+            self.files.remove(&path);
+            return run(kind, &path, &limits);
+        };
+
+        let entry = self.files.entry(path.clone()).or_insert(CachedFile {
+            stamp,
+            check: None,
+            parse: None,
+        });
+        if entry.stamp != stamp {
+            *entry = CachedFile { stamp, check: None, parse: None };
+        }
+
+        entry
+            .slot(kind)
+            .get_or_insert_with(|| run(kind, &path, &limits))
+            .clone()
+    }
+
+    /// Re-analyzes cached files that changed on disk and drops deleted ones
+    ///
+    /// Returns the number of files that were refreshed or evicted.
+    pub fn refresh_changed(&mut self) -> usize {
+        if self.reload_limits_if_changed() {
+            let evicted = self.files.len();
+            self.files.clear();
+            return evicted;
+        }
+
+        let Ok(limits) = self.limits.clone() else {
+            return 0;
+        };
+
+        let mut refreshed = 0;
+        self.files.retain(|path, entry| {
+            let Some(stamp) = FileStamp::of(path) else {
+                refreshed += 1;
+                return false;
+            };
+            if stamp != entry.stamp {
+                // Re-warm only the results that were requested before
+                let had_check = entry.check.is_some();
+                let had_parse = entry.parse.is_some();
+                *entry = CachedFile { stamp, check: None, parse: None };
+                if had_check {
+                    entry.check = Some(run(RequestKind::Check, path, &limits));
+                }
+                if had_parse {
+                    entry.parse = Some(run(RequestKind::Parse, path, &limits));
+                }
+                refreshed += 1;
+            }
+            true
+        });
+        refreshed
+    }
+
+    /// Reloads `project.toml` if it changed; returns true when it did
+    fn reload_limits_if_changed(&mut self) -> bool {
+        let stamp = FileStamp::of(&self.root.join("project.toml"));
+        if stamp == self.limits_stamp {
+            return false;
+        }
+        self.limits_stamp = stamp;
+        self.limits = driver::load_limits(&self.root).map_err(|e| e.to_string());
+        self.files.clear();
+        true
+    }
+
+    fn resolve(&self, path: &Path) -> PathBuf {
+        if path.is_absolute() {
+            path.to_path_buf()
+        } else {
+            self.root.join(path)
+        }
+    }
+}
+
+/// Runs the requested pipeline on a file
+fn run(kind: RequestKind, path: &Path, limits: &CompilerLimits) -> CommandOutput {
+    match kind {
+        RequestKind::Check => driver::check_file(path, limits),
+        RequestKind::Parse => driver::parse_file(path, limits),
+    }
+}
+
+// ========== Server ==========
+
+/// Runs the daemon until a `shutdown` request arrives
+///
+/// The workspace root is the current directory. A stale socket left behind by
+/// a crashed daemon is removed; a live one is reported as an error.
+pub fn serve(socket_path: &Path, poll_interval: Duration) -> io::Result<()> {
+    if socket_path.exists() {
+        if UnixStream::connect(socket_path).is_ok() {
+            return Err(io::Error::new(
+                io::ErrorKind::AddrInUse,
+                format!("A daemon is already listening on '{}'", socket_path.display()),
+            ));
+        }
+        std::fs::remove_file(socket_path)?;
+    }
+    if let Some(parent) = socket_path.parent() {
+        if !parent.as_os_str().is_empty() {
+            std::fs::create_dir_all(parent)?;
+        }
+    }
+
+    let listener = UnixListener::bind(socket_path)?;
+    let workspace = Arc::new(Mutex::new(Workspace::new(std::env::current_dir()?)));
+    let shutdown = Arc::new(AtomicBool::new(false));
+
+    // File watcher: keep cached results in sync with the files on disk
+    let watcher = {
+        let workspace = Arc::clone(&workspace);
+        let shutdown = Arc::clone(&shutdown);
+        std::thread::spawn(move || {
+            while !shutdown.load(Ordering::Relaxed) {
+                std::thread::sleep(poll_interval);
+                if let Ok(mut ws) = workspace.lock() {
+                    ws.refresh_changed();
+                }
+            }
+        })
+    };
+
+    let result = accept_loop(&listener, &workspace);
+
+    shutdown.store(true, Ordering::Relaxed);
+    let _ = watcher.join();
+    let _ = std::fs::remove_file(socket_path);
+    result
+}
+
+fn accept_loop(listener: &UnixListener, workspace: &Mutex<Workspace>) -> io::Result<()> {
+    for stream in listener.incoming() {
+        let mut stream = match stream {
+            Ok(s) => s,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e),
+        };
+        stream.set_read_timeout(Some(IO_TIMEOUT))?;
+        stream.set_write_timeout(Some(IO_TIMEOUT))?;
+
+        let request = match read_request(&mut stream) {
+            Ok(r) => r,
+            Err(e) => {
+                let _ = write_response(&mut stream, &CommandOutput::error(e));
+                continue;
+            }
+        };
+
+        let (output, stop) = match request {
+            Request::Run(kind, path) => {
+                let mut ws = workspace.lock().unwrap_or_else(|e| e.into_inner());
+                (ws.handle(kind, &path), false)
+            }
+            Request::Ping => (CommandOutput::default(), false),
+            Request::Shutdown => (CommandOutput::default(), true),
+        };
+
+        // A client that went away must not take the daemon down with it
+        let _ = write_response(&mut stream, &output);
+        if stop {
+            return Ok(());
+        }
+    }
+    Ok(())
+}
+
+fn read_request(stream: &mut UnixStream) -> Result<Request, String> {
+    let mut line = String::new();
+    BufReader::new(stream.take(MAX_REQUEST_LEN as u64))
+        .read_line(&mut line)
+        .map_err(|e| format!("Failed to read daemon request: {}", e))?;
+    Request::decode(line.trim_end_matches(['\n', '\r']))
+}
+
+fn write_response(stream: &mut UnixStream, output: &CommandOutput) -> io::Result<()> {
+    let header = format!(
+        "{} {} {}\n",
+        output.exit_code,
+        output.stdout.len(),
+        output.stderr.len()
+    );
+    stream.write_all(header.as_bytes())?;
+    stream.write_all(output.stdout.as_bytes())?;
+    stream.write_all(output.stderr.as_bytes())?;
+    stream.flush()
+}
+
+// ========== Client ==========
+
+/// Sends a request to the daemon listening on `socket_path`
+pub fn request(socket_path: &Path, request: &Request) -> io::Result<CommandOutput> {
+    let mut stream = UnixStream::connect(socket_path)?;
+    stream.set_read_timeout(Some(IO_TIMEOUT))?;
+    stream.set_write_timeout(Some(IO_TIMEOUT))?;
+    stream.write_all(request.encode().as_bytes())?;
+
+    let mut reader = BufReader::new(stream);
+    let mut header = String::new();
+    reader.read_line(&mut header)?;
+
+    let invalid = || io::Error::new(io::ErrorKind::InvalidData, "Malformed daemon response");
+    let mut fields = header.split_whitespace();
+    let exit_code: i32 = fields.next().and_then(|f| f.parse().ok()).ok_or_else(invalid)?;
+    let stdout_len: usize = fields.next().and_then(|f| f.parse().ok()).ok_or_else(invalid)?;
+    let stderr_len: usize = fields.next().and_then(|f| f.parse().ok()).ok_or_else(invalid)?;
+
+    let mut stdout = vec![0; stdout_len];
+    reader.read_exact(&mut stdout)?;
+    let mut stderr = vec![0; stderr_len];
+    reader.read_exact(&mut stderr)?;
+
+    Ok(CommandOutput {
+        stdout: String::from_utf8(stdout).map_err(|_| invalid())?,
+        stderr: String::from_utf8(stderr).map_err(|_| invalid())?,
+        exit_code,
+    })
+}
+
+/// Resolves the daemon socket path: an explicit `--socket` first, then
+/// `SURU_DAEMON_SOCKET`, then the default
+pub fn socket_path(explicit: Option<&str>) -> PathBuf {
+    match explicit {
+        Some(path) => PathBuf::from(path),
+        None => std::env::var_os(SOCKET_ENV)
+            .filter(|path| !path.is_empty())
+            .map(PathBuf::from)
+            .unwrap_or_else(|| PathBuf::from(DEFAULT_SOCKET_PATH)),
+    }
+}
+
+/// Forwards a check/parse to the workspace daemon if one is running
+///
+/// Returns `None` (so the caller compiles in-process) when forwarding is
+/// disabled, no daemon socket exists, the file cannot be resolved, or the
+/// daemon does not answer.
+pub fn try_forward(kind: RequestKind, file: &str) -> Option<CommandOutput> {
+    if std::env::var_os(NO_DAEMON_ENV).is_some() {
+        return None;
+    }
+    let socket_path = socket_path(None);
+    if !socket_path.exists() {
+        return None;
+    }
+    let path = std::fs::canonicalize(file).ok()?;
+    request(&socket_path, &Request::Run(kind, path)).ok()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn temp_dir(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("suru_daemon_{}_{}", name, std::process::id()));
+        let _ = std::fs::remove_dir_all(&dir);
+        std::fs::create_dir_all(&dir).unwrap();
+        dir
+    }
+
+    #[test]
+    fn test_request_roundtrip() {
+        let requests = [
+            Request::Run(RequestKind::Check, PathBuf::from("/tmp/a b.suru")),
+            Request::Run(RequestKind::Parse, PathBuf::from("main.suru")),
+            Request::Ping,
+            Request::Shutdown,
+        ];
+        for request in requests {
+            let line = request.encode();
+            assert_eq!(Request::decode(line.trim_end()).unwrap(), request);
+        }
+    }
+
+    #[test]
+    fn test_request_decode_rejects_garbage() {
+        assert!(Request::decode("").is_err());
+        assert!(Request::decode("check").is_err());
+        assert!(Request::decode("compile main.suru").is_err());
+    }
+
+    #[test]
+    fn test_explicit_socket_path_wins() {
+        assert_eq!(socket_path(Some("run/d.sock")), PathBuf::from("run/d.sock"));
+    }
+
+    #[test]
+    fn test_workspace_caches_until_file_changes() {
+        let dir = temp_dir("cache");
+        let file = dir.join("main.suru");
+        std::fs::write(&file, "x: 42\n").unwrap();
+
+        let mut ws = Workspace::new(&dir);
+        let first = ws.handle(RequestKind::Check, &file);
+        assert_eq!(first.exit_code, 0);
+        assert_eq!(ws.cached_files(), 1);
+        assert_eq!(ws.refresh_changed(), 0);
+
+        // Different length guarantees a new stamp even with coarse mtimes
+        std::fs::write(&file, "x: undefined_var\n").unwrap();
+        assert_eq!(ws.refresh_changed(), 1);
+        let second = ws.handle(RequestKind::Check, &file);
+        assert_eq!(second.exit_code, 1);
+        assert!(second.stderr.contains("undefined_var"));
+
+        std::fs::remove_file(&file).unwrap();
+        assert_eq!(ws.refresh_changed(), 1);
+        assert_eq!(ws.cached_files(), 0);
+
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_workspace_relative_paths_resolve_against_root() {
+        let dir = temp_dir("relative");
+        std::fs::write(dir.join("main.suru"), "x: 42\n").unwrap();
+
+        let mut ws = Workspace::new(&dir);
+        let out = ws.handle(RequestKind::Parse, Path::new("main.suru"));
+        assert_eq!(out.exit_code, 0);
+        assert!(out.stdout.contains("VarDecl"));
+
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_serve_and_request() {
+        let dir = temp_dir("serve");
+        let file = dir.join("main.suru");
+        std::fs::write(&file, "x: 42\n").unwrap();
+        let socket = dir.join("daemon.sock");
+
+        let server = {
+            let socket = socket.clone();
+            std::thread::spawn(move || serve(&socket, Duration::from_millis(20)))
+        };
+
+        // Wait for the daemon to come up
+        let mut ready = false;
+        for _ in 0..200 {
+            if request(&socket, &Request::Ping).is_ok() {
+                ready = true;
+                break;
+            }
+            std::thread::sleep(Duration::from_millis(10));
+        }
+        assert!(ready, "daemon did not start");
+
+        let out = request(&socket, &Request::Run(RequestKind::Check, file.clone())).unwrap();
+        assert_eq!(out, driver::check_file(&file, &CompilerLimits::default()));
+
+        request(&socket, &Request::Shutdown).unwrap();
+        server.join().unwrap().unwrap();
+        assert!(!socket.exists());
+
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+}
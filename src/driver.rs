@@ -0,0 +1,568 @@
+// Command driver module
+//
+// Runs the `check` and `parse` pipelines (lex → parse → semantic analysis)
+// and captures everything the CLI would print into a `CommandOutput`.
+// `lower` continues to the lowered IR (src/lower/); `build` and `run`
+// continue through code generation (src/codegen/) to a native executable.
+//
+// Keeping the pipelines free of direct printing lets the one-shot CLI and the
+// long-lived daemon (src/daemon.rs) share exactly the same behaviour.
+
+use std::path::{Path, PathBuf};
+
+use crate::ast::Ast;
+use crate::codegen::BuildOptions;
+use crate::limits::{CompilerLimits, LimitError};
+use crate::lower::LowerOptions;
+use crate::stats::Profile;
+use crate::{codegen, lexer, lower, parser, semantic};
+
+/// Captured result of running a CLI command
+#[derive(Debug, Clone, PartialEq, Default)]
+pub struct CommandOutput {
+    pub stdout: String,
+    pub stderr: String,
+    pub exit_code: i32,
+}
+
+impl CommandOutput {
+    /// Failed command with a single `Error: ...` line on stderr
+    pub fn error(message: impl std::fmt::Display) -> Self {
+        Self {
+            stdout: String::new(),
+            stderr: format!("Error: {}\n", message),
+            exit_code: 1,
+        }
+    }
+
+    /// Writes the captured output to the process stdout/stderr
+    pub fn emit(&self) {
+        use std::io::Write;
+        let mut stdout = std::io::stdout();
+        let _ = stdout.write_all(self.stdout.as_bytes());
+        let _ = stdout.flush();
+        let mut stderr = std::io::stderr();
+        let _ = stderr.write_all(self.stderr.as_bytes());
+        let _ = stderr.flush();
+    }
+}
+
+/// Loads limits from `project.toml` in `dir`, falling back to defaults
+///
+/// A malformed file silently falls back to defaults; limits that parse but
+/// fail validation are reported as an error.
+pub fn load_limits<P: AsRef<Path>>(dir: P) -> Result<CompilerLimits, LimitError> {
+    match CompilerLimits::from_project_toml(dir.as_ref().join("project.toml")) {
+        Ok(l) => {
+            l.validate()?;
+            Ok(l)
+        }
+        Err(_) => Ok(CompilerLimits::default()),
+    }
+}
+
+/// Reads a source file and enforces the input size limit
+pub fn read_source<P: AsRef<Path>>(path: P, limits: &CompilerLimits) -> Result<String, String> {
+    let path = path.as_ref();
+    let source = std::fs::read_to_string(path)
+        .map_err(|e| format!("Failed to read '{}': {}", path.display(), e))?;
+
+    if source.len() > limits.max_input_size {
+        return Err(format!(
+            "Input too large: {} bytes (max: {})",
+            source.len(),
+            limits.max_input_size
+        ));
+    }
+
+    Ok(source)
+}
+
+/// Type-checks a source string (`suru check`)
+pub fn check_source(source: &str, limits: &CompilerLimits) -> CommandOutput {
+    check_source_profiled(source, limits, &mut Profile::default())
+}
+
+/// Type-checks a source string, timing each pass into `profile`
+pub fn check_source_profiled(
+    source: &str,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let ast = match lex_and_parse(source, limits, profile) {
+        Ok(a) => a,
+        Err(output) => return output,
+    };
+    let analyzer = semantic::SemanticAnalyzer::new(ast);
+
+    match analyzer.analyze_profiled(profile) {
+        Ok(_) => CommandOutput {
+            stdout: "No errors found.\n".to_string(),
+            ..Default::default()
+        },
+        Err(err) => {
+            let mut stderr = String::new();
+            for error in &err.errors {
+                stderr.push_str(&format!("{error}\n"));
+            }
+            CommandOutput { stdout: String::new(), stderr, exit_code: 1 }
+        }
+    }
+}
+
+/// Parses and analyzes a source string, rendering the annotated AST (`suru parse`)
+pub fn parse_source(source: &str, limits: &CompilerLimits) -> CommandOutput {
+    parse_source_profiled(source, limits, &mut Profile::default())
+}
+
+/// Parses and analyzes a source string, timing each pass into `profile`
+pub fn parse_source_profiled(
+    source: &str,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let ast = match lex_and_parse(source, limits, profile) {
+        Ok(a) => a,
+        Err(output) => return output,
+    };
+
+    let analyzer = semantic::SemanticAnalyzer::new(ast);
+    match analyzer.analyze_profiled(profile) {
+        Ok(output) => CommandOutput {
+            stdout: output.to_annotated_string(),
+            ..Default::default()
+        },
+        Err(err) => {
+            // Show the plain AST so the parse structure is still visible
+            let mut stderr = String::from("\nSemantic errors:\n");
+            for error in &err.errors {
+                stderr.push_str(&format!("  {error}\n"));
+            }
+            CommandOutput { stdout: err.ast.to_string(), stderr, exit_code: 1 }
+        }
+    }
+}
+
+/// Lexes and parses, recording the token, node and string counts
+fn lex_and_parse(
+    source: &str,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> Result<Ast, CommandOutput> {
+    let tokens = profile
+        .time("lex", || lexer::lex(source, limits))
+        .map_err(CommandOutput::error)?;
+    profile.counts.tokens = tokens.list.len();
+
+    let ast = profile
+        .time("parse", || parser::parse(tokens, limits))
+        .map_err(CommandOutput::error)?;
+    profile.counts.ast_nodes = ast.nodes.len();
+    profile.counts.interned_strings = ast.string_storage.len();
+    Ok(ast)
+}
+
+/// Reads and type-checks a file
+pub fn check_file<P: AsRef<Path>>(path: P, limits: &CompilerLimits) -> CommandOutput {
+    check_file_profiled(path, limits, &mut Profile::default())
+}
+
+/// Reads and type-checks a file, timing each pass into `profile`
+pub fn check_file_profiled<P: AsRef<Path>>(
+    path: P,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let _span = crate::trace_span!("driver", "check_file", path.as_ref().display());
+    match read_source(path, limits) {
+        Ok(source) => check_source_profiled(&source, limits, profile),
+        Err(e) => CommandOutput::error(e),
+    }
+}
+
+/// Reads, parses and analyzes a file
+pub fn parse_file<P: AsRef<Path>>(path: P, limits: &CompilerLimits) -> CommandOutput {
+    parse_file_profiled(path, limits, &mut Profile::default())
+}
+
+/// Reads, parses and analyzes a file, timing each pass into `profile`
+pub fn parse_file_profiled<P: AsRef<Path>>(
+    path: P,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let _span = crate::trace_span!("driver", "parse_file", path.as_ref().display());
+    match read_source(path, limits) {
+        Ok(source) => parse_source_profiled(&source, limits, profile),
+        Err(e) => CommandOutput::error(e),
+    }
+}
+
+/// Analyzes a source string and prints its lowered IR (`suru lower`)
+pub fn lower_source(source: &str, limits: &CompilerLimits) -> CommandOutput {
+    lower_source_profiled(source, &LowerOptions::default(), limits, &mut Profile::default())
+}
+
+/// Analyzes and lowers a source string, timing each pass into `profile`
+pub fn lower_source_profiled(
+    source: &str,
+    options: &LowerOptions,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let analysis = match analyze_source(source, limits, profile) {
+        Ok(a) => a,
+        Err(output) => return output,
+    };
+    match lower::lower_profiled(&analysis, options, profile) {
+        Ok(program) => {
+            if let Some(memory) = &mut profile.memory {
+                memory.push("lowered IR", program.exprs.len(), program.heap_bytes());
+            }
+            CommandOutput {
+                stdout: lower::dump(&program, &analysis.type_registry),
+                ..Default::default()
+            }
+        }
+        Err(e) => CommandOutput { stdout: String::new(), stderr: format!("{e}\n"), exit_code: 1 },
+    }
+}
+
+/// Reads a file and prints its lowered IR
+pub fn lower_file<P: AsRef<Path>>(path: P, limits: &CompilerLimits) -> CommandOutput {
+    lower_file_profiled(path, &LowerOptions::default(), limits, &mut Profile::default())
+}
+
+/// Reads and lowers a file, timing each pass into `profile`
+pub fn lower_file_profiled<P: AsRef<Path>>(
+    path: P,
+    options: &LowerOptions,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let _span = crate::trace_span!("driver", "lower_file", path.as_ref().display());
+    match read_source(path, limits) {
+        Ok(source) => lower_source_profiled(&source, options, limits, profile),
+        Err(e) => CommandOutput::error(e),
+    }
+}
+
+/// Lexes, parses and analyzes a source string for code generation,
+/// reporting errors the way `check` does
+fn analyze_source(
+    source: &str,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> Result<semantic::AnalysisOutput, CommandOutput> {
+    let ast = lex_and_parse(source, limits, profile)?;
+    semantic::SemanticAnalyzer::new(ast).analyze_profiled(profile).map_err(|err| {
+        let mut stderr = String::new();
+        for error in &err.errors {
+            stderr.push_str(&format!("{error}\n"));
+        }
+        CommandOutput { stdout: String::new(), stderr, exit_code: 1 }
+    })
+}
+
+/// Executable path `suru build` uses without `-o`: `target/dev/<file stem>`
+pub fn default_executable_path<P: AsRef<Path>>(source: P) -> PathBuf {
+    let stem = source.as_ref().file_stem().unwrap_or("main".as_ref());
+    Path::new("target/dev").join(stem)
+}
+
+/// Object cache directory of `suru build`: `target/dev/cache`
+pub fn default_cache_dir() -> PathBuf {
+    Path::new("target/dev").join("cache")
+}
+
+/// Compiles a file into a native executable at `output` (`suru build`)
+pub fn build_file<P: AsRef<Path>>(
+    path: P,
+    output: &Path,
+    options: &BuildOptions,
+    limits: &CompilerLimits,
+) -> CommandOutput {
+    build_file_profiled(path, output, options, limits, &mut Profile::default())
+}
+
+/// Compiles a file into a native executable, timing each pass into `profile`
+pub fn build_file_profiled<P: AsRef<Path>>(
+    path: P,
+    output: &Path,
+    options: &BuildOptions,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let _span = crate::trace_span!("driver", "build_file", path.as_ref().display());
+    let source = match read_source(&path, limits) {
+        Ok(s) => s,
+        Err(e) => return CommandOutput::error(e),
+    };
+    let analysis = match analyze_source(&source, limits, profile) {
+        Ok(a) => a,
+        Err(output) => return output,
+    };
+    match codegen::build_executable(&analysis, output, options, profile) {
+        Ok(()) => CommandOutput {
+            stdout: format!("Built {}\n", output.display()),
+            ..Default::default()
+        },
+        Err(e) => CommandOutput { stdout: String::new(), stderr: format!("{e}\n"), exit_code: 1 },
+    }
+}
+
+/// How `suru run` executes a program
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum RunMode {
+    /// Compile in memory and call `main` in the compiler's process
+    #[default]
+    Jit,
+    /// Build an executable in `target/dev` with the system linker and run it
+    Native,
+}
+
+/// Compiles a file without optimization and runs it (`suru run`)
+///
+/// The program inherits stdin/stdout/stderr; the returned output only
+/// carries compile errors and the program's exit code.
+pub fn run_file<P: AsRef<Path>>(path: P, mode: RunMode, limits: &CompilerLimits) -> CommandOutput {
+    run_file_profiled(path, mode, limits, &mut Profile::default())
+}
+
+/// Compiles and runs a file, timing each compiler pass into `profile`
+pub fn run_file_profiled<P: AsRef<Path>>(
+    path: P,
+    mode: RunMode,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    match mode {
+        RunMode::Jit => jit_run_file(path, limits, profile),
+        RunMode::Native => native_run_file(path, limits, profile),
+    }
+}
+
+/// Runs a file in process: no object file, no linker
+fn jit_run_file<P: AsRef<Path>>(
+    path: P,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let _span = crate::trace_span!("driver", "jit_run_file", path.as_ref().display());
+    let source = match read_source(&path, limits) {
+        Ok(s) => s,
+        Err(e) => return CommandOutput::error(e),
+    };
+    let analysis = match analyze_source(&source, limits, profile) {
+        Ok(a) => a,
+        Err(output) => return output,
+    };
+    let stem = path.as_ref().file_stem().unwrap_or("main".as_ref()).to_string_lossy();
+    match codegen::run_jit(&analysis, &stem, profile) {
+        Ok(exit_code) => CommandOutput { exit_code, ..Default::default() },
+        Err(e) => CommandOutput { stdout: String::new(), stderr: format!("{e}\n"), exit_code: 1 },
+    }
+}
+
+/// Builds a file to `target/dev/<stem>-run-<pid>`, runs it and removes it
+fn native_run_file<P: AsRef<Path>>(
+    path: P,
+    limits: &CompilerLimits,
+    profile: &mut Profile,
+) -> CommandOutput {
+    let stem = path.as_ref().file_stem().unwrap_or("main".as_ref()).to_string_lossy();
+    let executable = Path::new("target/dev").join(format!("{}-run-{}", stem, std::process::id()));
+    let options = BuildOptions { cache_dir: Some(default_cache_dir()), ..Default::default() };
+    let mut built = build_file_profiled(&path, &executable, &options, limits, profile);
+    if built.exit_code != 0 {
+        return built;
+    }
+    built.stdout.clear();
+
+    let status = std::process::Command::new(&executable).status();
+    let _ = std::fs::remove_file(&executable);
+    match status {
+        Ok(status) => CommandOutput { exit_code: status.code().unwrap_or(1), ..built },
+        Err(e) => CommandOutput::error(format!("Failed to run '{}': {}", executable.display(), e)),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_check_source_ok() {
+        let out = check_source("x: 42\n", &CompilerLimits::default());
+        assert_eq!(out.exit_code, 0);
+        assert_eq!(out.stdout, "No errors found.\n");
+        assert!(out.stderr.is_empty());
+    }
+
+    #[test]
+    fn test_check_source_profiled_times_every_pass() {
+        let mut profile = Profile::enabled();
+        let source = "pick<T>: (a T, b T) T { return a }\nn: pick(1, 2)\nempty: []\n";
+        let out = check_source_profiled(source, &CompilerLimits::default(), &mut profile);
+        assert_eq!(out.exit_code, 0);
+
+        let names: Vec<&str> = profile.passes.iter().map(|p| p.name).collect();
+        assert_eq!(
+            names,
+            vec![
+                "lex",
+                "parse",
+                "constraint collection",
+                "unification",
+                "deferred checks",
+                "match exhaustiveness",
+                "substitution",
+                "mutation analysis",
+            ]
+        );
+        let counts = profile.counts;
+        assert!(counts.tokens > 20 && counts.ast_nodes > 10);
+        assert!(counts.interned_strings >= 5); // pick, T, a, b, n, empty, digits
+        assert!(counts.types > 0 && counts.constraints > 0 && counts.type_variables > 0);
+    }
+
+    #[test]
+    fn test_check_source_semantic_error() {
+        let out = check_source("x: undefined_var\n", &CompilerLimits::default());
+        assert_eq!(out.exit_code, 1);
+        assert!(out.stderr.contains("undefined_var"), "stderr: {}", out.stderr);
+    }
+
+    #[test]
+    fn test_check_source_lex_error() {
+        let out = check_source("x: 1 / 2\n", &CompilerLimits::default());
+        assert_eq!(out.exit_code, 1);
+        assert!(out.stderr.starts_with("Error: Lexical error"), "stderr: {}", out.stderr);
+    }
+
+    #[test]
+    fn test_parse_source_annotates_types() {
+        let out = parse_source("x: 42\n", &CompilerLimits::default());
+        assert_eq!(out.exit_code, 0);
+        assert!(out.stdout.contains("LiteralNumber '42' [Number]"), "stdout: {}", out.stdout);
+    }
+
+    #[test]
+    fn test_lower_source_prints_lowered_ir() {
+        let mut profile = Profile::enabled();
+        let source = "shout: (s String) String {\n    return s\n}\nx: \"hi\" | shout\n";
+        let options = LowerOptions::default();
+        let out = lower_source_profiled(source, &options, &CompilerLimits::default(), &mut profile);
+        assert_eq!(out.exit_code, 0, "stderr: {}", out.stderr);
+        assert!(out.stdout.contains("let x: String [heap] = shout__o(\"hi\")"), "{}", out.stdout);
+        let names: Vec<&str> = profile.passes.iter().map(|p| p.name).collect();
+        let expected = [
+            "lower",
+            "specialize",
+            "escape analysis",
+            "drop insertion",
+            "copy insertion",
+            "drop elision",
+        ];
+        assert!(names.ends_with(&expected), "passes: {:?}", names);
+
+        let source = "f: (a Number) Number {\n    return a\n}\ng: f(_)\n";
+        let out = lower_source(source, &CompilerLimits::default());
+        assert_eq!(out.exit_code, 1);
+        assert!(out.stderr.starts_with("Lowering error at 4:"), "stderr: {}", out.stderr);
+    }
+
+    #[test]
+    fn test_build_file_reports_codegen_errors() {
+        let dir = std::env::temp_dir().join(format!("suru-build-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let source = dir.join("twice.suru");
+        std::fs::write(&source, "twice: (x) {\n    return x\n}\n").unwrap();
+
+        let options = BuildOptions::default();
+        let out = build_file(&source, &dir.join("twice"), &options, &CompilerLimits::default());
+        std::fs::remove_dir_all(&dir).unwrap();
+        assert_eq!(out.exit_code, 1);
+        assert!(out.stderr.starts_with("Codegen error at 1:9:"), "stderr: {}", out.stderr);
+    }
+
+    #[test]
+    fn test_build_file_reuses_cached_objects() {
+        let dir = std::env::temp_dir().join(format!("suru-cache-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let source = dir.join("cached.suru");
+        std::fs::write(&source, "main: () {\n    print(\"cached\")\n}\n").unwrap();
+
+        let options = BuildOptions { cache_dir: Some(dir.join("cache")), ..Default::default() };
+        let executable = dir.join("cached");
+        let limits = CompilerLimits::default();
+        let passes = |profile: &Profile| profile.passes.iter().map(|p| p.name).collect::<Vec<_>>();
+        let mut first = Profile::enabled();
+        let out = build_file_profiled(&source, &executable, &options, &limits, &mut first);
+        assert_eq!(out.exit_code, 0, "stderr: {}", out.stderr);
+        let mut second = Profile::enabled();
+        let out = build_file_profiled(&source, &executable, &options, &limits, &mut second);
+        assert_eq!(out.exit_code, 0, "stderr: {}", out.stderr);
+        let run = std::process::Command::new(&executable).output().unwrap();
+        std::fs::remove_dir_all(&dir).unwrap();
+
+        assert!(passes(&first).contains(&"codegen"));
+        assert!(passes(&second).contains(&"object cache"));
+        assert!(!passes(&second).contains(&"codegen"));
+        assert_eq!(String::from_utf8_lossy(&run.stdout), "cached\n");
+    }
+
+    #[test]
+    fn test_build_file_links_codegen_units() {
+        let dir = std::env::temp_dir().join(format!("suru-units-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let source = dir.join("units.suru");
+        let program = "one: () Number {\n    return 1\n}\ntwo: () String {\n    return \"two\"\n}\nthree: () Bool {\n    return true\n}\nmain: () {\n    a: one()\n    b: two()\n    c: three()\n    print(a)\n    print(b)\n    print(c)\n}\n";
+        std::fs::write(&source, program).unwrap();
+
+        let options = BuildOptions { codegen_units: Some(3), ..Default::default() };
+        let executable = dir.join("units");
+        let out = build_file(&source, &executable, &options, &CompilerLimits::default());
+        assert_eq!(out.exit_code, 0, "stderr: {}", out.stderr);
+        let run = std::process::Command::new(&executable).output().unwrap();
+        let leftovers: Vec<_> = std::fs::read_dir(&dir)
+            .unwrap()
+            .filter_map(|e| e.ok())
+            .filter(|e| e.path().extension().is_some_and(|ext| ext == "o"))
+            .collect();
+        std::fs::remove_dir_all(&dir).unwrap();
+        assert_eq!(String::from_utf8_lossy(&run.stdout), "1\ntwo\ntrue\n");
+        assert!(leftovers.is_empty());
+    }
+
+    #[test]
+    fn test_run_file_jit() {
+        let dir = std::env::temp_dir().join(format!("suru-jit-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let ok = dir.join("ok.suru");
+        std::fs::write(&ok, "main: () {\n    n: 42\n}\n").unwrap();
+        let bad = dir.join("bad.suru");
+        std::fs::write(&bad, "twice: (x) {\n    return x\n}\n").unwrap();
+
+        let limits = CompilerLimits::default();
+        let ok = run_file(&ok, RunMode::Jit, &limits);
+        let bad = run_file(&bad, RunMode::Jit, &limits);
+        std::fs::remove_dir_all(&dir).unwrap();
+        assert_eq!(ok.exit_code, 0, "stderr: {}", ok.stderr);
+        assert!(ok.stdout.is_empty());
+        assert_eq!(bad.exit_code, 1);
+        assert!(bad.stderr.starts_with("Codegen error at 1:9:"), "stderr: {}", bad.stderr);
+    }
+
+    #[test]
+    fn test_default_executable_path() {
+        assert_eq!(default_executable_path("src/hello.suru"), Path::new("target/dev/hello"));
+    }
+
+    #[test]
+    fn test_check_file_missing() {
+        let out = check_file("/nonexistent/file.suru", &CompilerLimits::default());
+        assert_eq!(out.exit_code, 1);
+        assert!(out.stderr.contains("Failed to read"));
+    }
+}
@@ -0,0 +1,30 @@
+// File modification stamps
+//
+// The daemon and watch mode both notice edits by comparing a file's
+// modification time and length with the ones seen last; any difference
+// counts as a change.
+
+use std::fs::Metadata;
+use std::path::Path;
+use std::time::SystemTime;
+
+/// Modification stamp of a file
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FileStamp {
+    modified: Option<SystemTime>,
+    len: u64,
+}
+
+impl FileStamp {
+    /// Stamps the file at `path`, or `None` when it cannot be read
+    pub fn of(path: &Path) -> Option<Self> {
+        std::fs::metadata(path).ok().map(|meta| Self::from_metadata(&meta))
+    }
+
+    pub fn from_metadata(meta: &Metadata) -> Self {
+        Self {
+            modified: meta.modified().ok(),
+            len: meta.len(),
+        }
+    }
+}
@@ -686,6 +686,7 @@ fn is_ident_continue(c: char) -> bool {
 // Public API
 
 pub fn lex(source: &str, limits: &crate::limits::CompilerLimits) -> Result<Tokens, LexError> {
+    let _span = crate::trace_span!("lexer", "lex");
     let mut lexer = Lexer::new(source, limits)?;
     let mut tokens = Vec::new();
 
@@ -911,6 +912,55 @@ mod tests {
         let (tok, storage) = lex_single(source).unwrap();
         assert_eq!(tok.text(&storage), Some(r#"quote: \"hi\""#));
     }
+
+    #[test]
+    fn test_next_token_allocation_budget() {
+        use crate::alloc_budget::{assert_allocations_at_most, assert_no_allocations};
+
+        let limits = crate::limits::CompilerLimits::default();
+        let source = "total: add(count, 42) | twice\n".repeat(100);
+        let mut lexer = Lexer::new(&source, &limits).unwrap();
+
+        // First line: only the new identifiers and numbers allocate
+        let first_line = assert_allocations_at_most(16, || {
+            (0..11).map(|_| lexer.next_token().unwrap()).collect::<Vec<_>>()
+        });
+        assert_eq!(first_line.last().unwrap().kind, TokenKind::Newline);
+
+        // Every later token's text is already interned
+        assert_no_allocations(|| {
+            loop {
+                if lexer.next_token().unwrap().kind == TokenKind::Eof {
+                    break;
+                }
+            }
+        });
+    }
+
+    #[test]
+    fn test_lex_1mb_allocation_budget() {
+        use crate::alloc_budget::count_allocations;
+        use crate::corpus::CorpusShape;
+
+        let unit = CorpusShape::default().unit("A");
+        let fixture = unit.repeat(1_000_000 / unit.len() + 1);
+        let limits = crate::limits::CompilerLimits {
+            max_token_count: usize::MAX,
+            ..Default::default()
+        };
+
+        // Allocations: one per distinct string plus the amortized growth of
+        // the token and string vectors, independent of the token count
+        let (tokens, allocations) = count_allocations(|| lex(&fixture, &limits).unwrap());
+        assert!(tokens.list.len() > 200_000);
+        let budget = tokens.string_storage.len() as u64 + 48;
+        assert!(
+            allocations <= budget,
+            "lexing 1 MB: {} allocations (budget: {})",
+            allocations,
+            budget
+        );
+    }
 }
 
 #[cfg(test)]
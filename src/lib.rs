@@ -1,8 +1,22 @@
+#[cfg(test)]
+mod alloc_budget;
 pub mod ast;
 pub mod cli;
 pub mod codegen;
+pub mod corpus;
+#[cfg(unix)]
+pub mod daemon;
+pub mod driver;
+mod file_stamp;
 pub mod lexer;
 pub mod limits;
+pub mod lower;
+pub mod lsp;
 pub mod parser;
 pub mod semantic;
+pub mod spans;
+mod stable_hash;
+pub mod stats;
 pub mod string_storage;
+pub mod trace;
+pub mod watch;
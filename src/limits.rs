@@ -5,6 +5,10 @@
 // - Memory exhaustion from very large source files
 // - Denial of service from pathological input
 //
+// Structural limits are enforced where the structure grows. Analysis budgets
+// (time, type variables, constraints, memory) are polled cooperatively by
+// the semantic analyzer, which stops with an error when one runs out.
+//
 // All limits have sensible defaults and can be overridden via project.toml
 
 use serde::Deserialize;
@@ -26,6 +30,12 @@ pub struct CompilerLimits {
 
     // AST limits
     pub max_ast_nodes: usize, // Maximum AST nodes per file
+
+    // Analysis budgets
+    pub max_analysis_millis: usize, // Maximum wall time of semantic analysis per file
+    pub max_type_vars: usize,       // Maximum type variables per file
+    pub max_constraints: usize,     // Maximum type constraints per file
+    pub max_memory_bytes: usize,    // Maximum estimated analyzer memory per file
 }
 
 // Default limits (permissive for developer productivity)
@@ -39,6 +49,10 @@ impl Default for CompilerLimits {
             max_comment_length: 100_000,   // 100k bytes
             max_expr_depth: 256,
             max_ast_nodes: 1_000_000, // 1M nodes
+            max_analysis_millis: 60_000,      // 1 minute
+            max_type_vars: 1_000_000,         // 1M type variables
+            max_constraints: 10_000_000,      // 10M constraints
+            max_memory_bytes: 2_000_000_000, // 2 GB
         }
     }
 }
@@ -95,6 +109,18 @@ impl CompilerLimits {
             if let Some(v) = limits_config.max_ast_nodes {
                 limits.max_ast_nodes = v;
             }
+            if let Some(v) = limits_config.max_analysis_millis {
+                limits.max_analysis_millis = v;
+            }
+            if let Some(v) = limits_config.max_type_vars {
+                limits.max_type_vars = v;
+            }
+            if let Some(v) = limits_config.max_constraints {
+                limits.max_constraints = v;
+            }
+            if let Some(v) = limits_config.max_memory_bytes {
+                limits.max_memory_bytes = v;
+            }
         }
 
         Ok(limits)
@@ -141,6 +167,29 @@ impl CompilerLimits {
             return Err(LimitError::invalid("max_ast_nodes", self.max_ast_nodes));
         }
 
+        if self.max_analysis_millis == 0 {
+            return Err(LimitError::invalid(
+                "max_analysis_millis",
+                self.max_analysis_millis,
+            ));
+        }
+
+        // Type variable ids are 32-bit
+        if self.max_type_vars == 0 || self.max_type_vars > u32::MAX as usize {
+            return Err(LimitError::invalid("max_type_vars", self.max_type_vars));
+        }
+
+        if self.max_constraints == 0 {
+            return Err(LimitError::invalid("max_constraints", self.max_constraints));
+        }
+
+        if self.max_memory_bytes == 0 {
+            return Err(LimitError::invalid(
+                "max_memory_bytes",
+                self.max_memory_bytes,
+            ));
+        }
+
         Ok(())
     }
 }
@@ -160,6 +209,10 @@ struct LimitsConfig {
     max_comment_length: Option<usize>,
     max_expr_depth: Option<usize>,
     max_ast_nodes: Option<usize>,
+    max_analysis_millis: Option<usize>,
+    max_type_vars: Option<usize>,
+    max_constraints: Option<usize>,
+    max_memory_bytes: Option<usize>,
 }
 
 /// Error type for limit validation and loading
@@ -207,6 +260,10 @@ mod tests {
         assert_eq!(limits.max_comment_length, 100_000);
         assert_eq!(limits.max_expr_depth, 256);
         assert_eq!(limits.max_ast_nodes, 1_000_000);
+        assert_eq!(limits.max_analysis_millis, 60_000);
+        assert_eq!(limits.max_type_vars, 1_000_000);
+        assert_eq!(limits.max_constraints, 10_000_000);
+        assert_eq!(limits.max_memory_bytes, 2_000_000_000);
     }
 
     #[test]
@@ -222,6 +279,14 @@ mod tests {
         limits = CompilerLimits::default();
         limits.max_identifier_length = 0;
         assert!(limits.validate().is_err());
+
+        limits = CompilerLimits::default();
+        limits.max_analysis_millis = 0;
+        assert!(limits.validate().is_err());
+
+        limits = CompilerLimits::default();
+        limits.max_memory_bytes = 0;
+        assert!(limits.validate().is_err());
     }
 
     #[test]
@@ -249,6 +314,8 @@ mod tests {
 [limits]
 max_input_size = 2000000
 max_expr_depth = 128
+max_analysis_millis = 500
+max_memory_bytes = 268435456
 "#;
         let temp_path = "/tmp/test_limits.toml";
         fs::write(temp_path, toml_content).unwrap();
@@ -256,6 +323,9 @@ max_expr_depth = 128
         let limits = CompilerLimits::from_project_toml(temp_path).unwrap();
         assert_eq!(limits.max_input_size, 2_000_000); // Overridden
         assert_eq!(limits.max_expr_depth, 128); // Overridden
+        assert_eq!(limits.max_analysis_millis, 500); // Overridden
+        assert_eq!(limits.max_memory_bytes, 268_435_456); // Overridden
+        assert_eq!(limits.max_type_vars, 1_000_000); // Default
         assert_eq!(limits.max_token_count, 100_000); // Default
         assert_eq!(limits.max_identifier_length, 1_000); // Default
 
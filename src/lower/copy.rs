@@ -0,0 +1,228 @@
+// Copy insertion - copies a heap value read from a place before something
+// takes ownership of it (Phase 8 in todo.md)
+//
+// A variable, a field or `this` keeps its value after being read, so a read
+// that hands the value to a new owner is wrapped in `Copy`: a variable
+// declaration, a field store, a struct field or list element, an argument
+// for a `ByOwnership` parameter or a function value, and a returned value
+// the function does not own. A match in one of those positions copies the
+// arms that read a place. Temporaries (calls, literals) are fresh and never
+// copied, and a returned owned variable moves out.
+//
+// Like drop insertion this copies even at a last use, where moving would do;
+// elision.rs turns those copies into moves and removes the drops they make
+// redundant. It runs after drop insertion so the `$ret` and `$name.N`
+// bindings that pass introduces get their copies too.
+
+use std::collections::{HashMap, HashSet};
+
+use super::heap_analysis::is_heap_type;
+use super::ir::*;
+use crate::semantic::AnalysisOutput;
+use crate::string_storage::StringId;
+
+/// Inserts copies into every function and the entry statements, returning
+/// how many were inserted
+pub fn insert_copies(program: &mut LoweredProgram, output: &AnalysisOutput) -> usize {
+    let by_name: HashMap<StringId, usize> = program
+        .functions
+        .iter()
+        .enumerate()
+        .map(|(i, f)| (f.name, i))
+        .collect();
+    let mut copies = Copies {
+        program,
+        output,
+        by_name,
+        owned: HashSet::new(),
+        inserted: 0,
+    };
+    for function in 0..copies.program.functions.len() {
+        copies.owned = owned_variables(copies.program, function);
+        let body = copies.program.functions[function].body;
+        copies.block(body);
+    }
+    // Globals are never owned by the statement that returns them
+    copies.owned.clear();
+    let entry = copies.program.entry;
+    copies.block(entry);
+    copies.inserted
+}
+
+/// Heap variables a function owns: owned parameters and heap locals
+fn owned_variables(program: &LoweredProgram, function: usize) -> HashSet<StringId> {
+    let function = &program.functions[function];
+    let params = program
+        .params_of(function)
+        .iter()
+        .filter(|param| param.is_heap && param.pass_mode == PassMode::ByOwnership)
+        .map(|param| param.name);
+    let locals =
+        program
+            .stmt_list(function.body)
+            .iter()
+            .filter_map(|stmt| match *program.stmt(*stmt) {
+                LoweredStmt::VarDecl {
+                    name,
+                    is_heap: true,
+                    ..
+                } => Some(name),
+                _ => None,
+            });
+    params.chain(locals).collect()
+}
+
+struct Copies<'a> {
+    program: &'a mut LoweredProgram,
+    output: &'a AnalysisOutput,
+    by_name: HashMap<StringId, usize>,
+    /// Variables of the current function a `return` moves out
+    owned: HashSet<StringId>,
+    inserted: usize,
+}
+
+impl Copies<'_> {
+    fn block(&mut self, body: ListRange) {
+        for i in body.indices() {
+            let stmt = self.program.stmt_lists[i];
+            self.stmt(stmt);
+        }
+    }
+
+    fn stmt(&mut self, stmt: StmtId) {
+        let rewritten = match *self.program.stmt(stmt) {
+            LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap,
+                on_stack,
+            } => LoweredStmt::VarDecl {
+                name,
+                value: self.owning(value),
+                is_heap,
+                on_stack,
+            },
+            LoweredStmt::Assign { name, value } => LoweredStmt::Assign {
+                name,
+                value: self.owning(value),
+            },
+            LoweredStmt::FieldAssign {
+                receiver,
+                field,
+                value,
+            } => {
+                self.visit(receiver);
+                LoweredStmt::FieldAssign {
+                    receiver,
+                    field,
+                    value: self.owning(value),
+                }
+            }
+            LoweredStmt::ExprStmt(expr) => {
+                self.visit(expr);
+                return;
+            }
+            LoweredStmt::Return(Some(value)) => match *self.program.expr(value) {
+                LoweredExpr::Identifier(name) if self.owned.contains(&name) => return,
+                _ => LoweredStmt::Return(Some(self.owning(value))),
+            },
+            LoweredStmt::Return(None) | LoweredStmt::Drop(_) => return,
+        };
+        self.program.stmts[stmt.0 as usize] = rewritten;
+    }
+
+    /// `expr` in a position that takes ownership of its value: the value
+    /// itself, or a copy when it is read from a place
+    fn owning(&mut self, expr: ExprId) -> ExprId {
+        let ty = self.program.expr_type(expr);
+        match *self.program.expr(expr) {
+            LoweredExpr::Identifier(_) | LoweredExpr::This | LoweredExpr::FieldAccess { .. } => {
+                self.visit(expr);
+                if !ty.is_some_and(|ty| is_heap_type(ty, self.output)) {
+                    return expr;
+                }
+                self.inserted += 1;
+                self.program.add_expr(LoweredExpr::Copy(expr), ty)
+            }
+            LoweredExpr::Match { subject, arms } => {
+                self.visit(subject);
+                for i in arms.indices() {
+                    let result = self.program.match_arms[i].result;
+                    self.program.match_arms[i].result = self.owning(result);
+                }
+                expr
+            }
+            _ => {
+                self.visit(expr);
+                expr
+            }
+        }
+    }
+
+    /// Inserts copies into the owning positions nested in `expr`
+    fn visit(&mut self, expr: ExprId) {
+        match *self.program.expr(expr) {
+            LoweredExpr::Literal(_) | LoweredExpr::Identifier(_) | LoweredExpr::This => {}
+            LoweredExpr::Call { callee, args } => {
+                let function = self.by_name.get(&callee).copied();
+                for (i, slot) in args.indices().enumerate() {
+                    let owned = function.is_some_and(|f| {
+                        let function = &self.program.functions[f];
+                        self.program
+                            .params_of(function)
+                            .get(i)
+                            .is_some_and(|param| param.pass_mode == PassMode::ByOwnership)
+                    });
+                    self.arg(slot, owned);
+                }
+            }
+            LoweredExpr::CallValue { callee, args } => {
+                self.visit(callee);
+                for slot in args.indices() {
+                    self.arg(slot, true);
+                }
+            }
+            LoweredExpr::MethodCall { receiver, args, .. } => {
+                self.visit(receiver);
+                for slot in args.indices() {
+                    self.arg(slot, false);
+                }
+            }
+            LoweredExpr::FieldAccess { receiver, .. } => self.visit(receiver),
+            LoweredExpr::StructInit { fields, .. } => {
+                for i in fields.indices() {
+                    let value = self.program.field_inits[i].1;
+                    self.program.field_inits[i].1 = self.owning(value);
+                }
+            }
+            LoweredExpr::List { elements } => {
+                for slot in elements.indices() {
+                    self.arg(slot, true);
+                }
+            }
+            LoweredExpr::Match { subject, arms } => {
+                self.visit(subject);
+                for i in arms.indices() {
+                    let result = self.program.match_arms[i].result;
+                    self.visit(result);
+                }
+            }
+            LoweredExpr::BoolOp { lhs, rhs, .. } => {
+                self.visit(lhs);
+                self.visit(rhs);
+            }
+            LoweredExpr::Not(operand)
+            | LoweredExpr::Negate(operand)
+            | LoweredExpr::Copy(operand) => self.visit(operand),
+        }
+    }
+
+    /// The expression at `expr_lists[slot]`, taken by ownership when `owned`
+    fn arg(&mut self, slot: usize, owned: bool) {
+        let arg = self.program.expr_lists[slot];
+        match owned {
+            true => self.program.expr_lists[slot] = self.owning(arg),
+            false => self.visit(arg),
+        }
+    }
+}
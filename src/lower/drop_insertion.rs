@@ -0,0 +1,146 @@
+// Drop insertion - ends the life of every heap value a function owns
+// (Phase 7 in todo.md)
+//
+// A function owns its heap locals and the heap parameters it takes
+// `ByOwnership`. Insertion is naive on purpose: every exit drops every owned
+// variable declared so far, in reverse declaration order, whether or not it
+// was moved or escape analysis already dropped it; the end of the body is an
+// exit even after a `return`. elision.rs then removes the drops of moved
+// values, repeated drops and the unreachable ones.
+//
+// A returned owned variable moves out and is not dropped. Any other returned
+// value is computed into `$ret` first when it could read a variable about to
+// be dropped. Redeclaring an owned variable drops its old value before the
+// new one is stored; when the new value reads the old one it is computed
+// into a `$name.N` temporary first, which the redeclaration then reads.
+//
+// The entry statements get no drops: their variables are the globals that
+// functions read, alive until the program ends. A `FieldAssign` releases the
+// field's old value itself, and a temporary passed by reference is released
+// by the statement that made it, so only variables need a `Drop`.
+
+use std::collections::HashSet;
+
+use super::heap_analysis::is_heap_type;
+use super::ir::*;
+use crate::semantic::AnalysisOutput;
+use crate::string_storage::StringId;
+
+/// Inserts drops into every function, returning how many were inserted
+pub fn insert_drops(program: &mut LoweredProgram, output: &AnalysisOutput) -> usize {
+    let mut inserted = 0;
+    for function in 0..program.functions.len() {
+        inserted += insert_function_drops(program, function, output);
+    }
+    inserted
+}
+
+fn insert_function_drops(
+    program: &mut LoweredProgram,
+    function: usize,
+    output: &AnalysisOutput,
+) -> usize {
+    let mut owned: Vec<StringId> = program
+        .params_of(&program.functions[function])
+        .iter()
+        .filter(|param| param.is_heap && param.pass_mode == PassMode::ByOwnership)
+        .map(|param| param.name)
+        .collect();
+    let body = program.stmt_list(program.functions[function].body).to_vec();
+    let mut stmts = Vec::with_capacity(body.len() + owned.len());
+    let mut inserted = 0;
+    let mut temporaries = 0;
+
+    for stmt in body {
+        match *program.stmt(stmt) {
+            LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap: true,
+                on_stack,
+            } => {
+                if !owned.contains(&name) {
+                    owned.push(name);
+                    stmts.push(stmt);
+                    continue;
+                }
+                // The old value is released once the new one is computed
+                if mentions(program, value, &[name]) {
+                    temporaries += 1;
+                    let temp = format!("${}.{}", program.name(name), temporaries);
+                    let temp = program.names.intern(&temp);
+                    stmts.push(program.add_stmt(LoweredStmt::VarDecl {
+                        name: temp,
+                        value,
+                        is_heap: true,
+                        on_stack: false,
+                    }));
+                    owned.push(temp);
+                    let ty = program.expr_type(value);
+                    let read = program.add_expr(LoweredExpr::Identifier(temp), ty);
+                    program.stmts[stmt.0 as usize] = LoweredStmt::VarDecl {
+                        name,
+                        value: read,
+                        is_heap: true,
+                        on_stack,
+                    };
+                }
+                stmts.push(program.add_stmt(LoweredStmt::Drop(name)));
+                stmts.push(stmt);
+                inserted += 1;
+            }
+            LoweredStmt::Return(value) => {
+                let moved = value.and_then(|value| match *program.expr(value) {
+                    LoweredExpr::Identifier(name) if owned.contains(&name) => Some(name),
+                    _ => None,
+                });
+                let drops: Vec<StringId> = owned
+                    .iter()
+                    .rev()
+                    .copied()
+                    .filter(|name| Some(*name) != moved)
+                    .collect();
+                let value = match value {
+                    Some(value) if moved.is_none() && mentions(program, value, &drops) => {
+                        let ty = program.expr_type(value);
+                        let ret = program.names.intern("$ret");
+                        stmts.push(program.add_stmt(LoweredStmt::VarDecl {
+                            name: ret,
+                            value,
+                            is_heap: ty.is_some_and(|ty| is_heap_type(ty, output)),
+                            on_stack: false,
+                        }));
+                        Some(program.add_expr(LoweredExpr::Identifier(ret), ty))
+                    }
+                    _ => value,
+                };
+                inserted += drops.len();
+                for name in drops {
+                    stmts.push(program.add_stmt(LoweredStmt::Drop(name)));
+                }
+                stmts.push(program.add_stmt(LoweredStmt::Return(value)));
+            }
+            _ => stmts.push(stmt),
+        }
+    }
+
+    // Falling off the end is an exit too
+    inserted += owned.len();
+    for name in owned.into_iter().rev() {
+        stmts.push(program.add_stmt(LoweredStmt::Drop(name)));
+    }
+    program.functions[function].body = LoweredProgram::push_list(&mut program.stmt_lists, stmts);
+    inserted
+}
+
+/// Whether `expr` reads any of `names`
+fn mentions(program: &LoweredProgram, expr: ExprId, names: &[StringId]) -> bool {
+    let names: HashSet<&StringId> = names.iter().collect();
+    let mut found = false;
+    program.visit_exprs(expr, |expr| {
+        if let LoweredExpr::Identifier(name) = program.expr(expr) {
+            found |= names.contains(name);
+        }
+    });
+    found
+}
@@ -0,0 +1,244 @@
+// Lowered IR dump - the text `suru lower` prints
+//
+//   fn greet(name: String [ref heap]) -> String
+//     let message: String [heap] = name
+//     return message
+//   entry
+//     greet("Ada")
+//
+// Expressions print inline in source-like form; compiler-inserted nodes show
+// as `copy(x)` and `drop x`.
+
+use std::fmt::Write;
+
+use super::ir::*;
+use crate::semantic::{TypeId, TypeRegistry, type_to_display_string};
+
+pub fn dump(program: &LoweredProgram, registry: &TypeRegistry) -> String {
+    let dumper = Dumper { program, registry };
+    let mut out = String::new();
+    for function in &program.functions {
+        dumper.function(&mut out, function);
+    }
+    out.push_str("entry\n");
+    dumper.block(&mut out, program.entry);
+    out
+}
+
+struct Dumper<'a> {
+    program: &'a LoweredProgram,
+    registry: &'a TypeRegistry,
+}
+
+impl Dumper<'_> {
+    fn type_name(&self, ty: TypeId) -> String {
+        type_to_display_string(ty, self.registry)
+    }
+
+    fn function(&self, out: &mut String, function: &LoweredFunction) {
+        let program = self.program;
+        let params: Vec<String> = program
+            .params_of(function)
+            .iter()
+            .map(|param| {
+                let mode = match param.pass_mode {
+                    PassMode::ByRef => "ref",
+                    PassMode::ByOwnership => "own",
+                };
+                let heap = if param.is_heap { " heap" } else { "" };
+                format!(
+                    "{}: {} [{}{}]",
+                    program.name(param.name),
+                    self.type_name(param.ty),
+                    mode,
+                    heap
+                )
+            })
+            .collect();
+        let _ = write!(
+            out,
+            "fn {}({})",
+            program.name(function.name),
+            params.join(", ")
+        );
+        if let Some(ty) = function.return_type {
+            let _ = write!(out, " -> {}", self.type_name(ty));
+        }
+        if let Some(ty) = function.this_type {
+            let _ = write!(out, " this {}", self.type_name(ty));
+        }
+        out.push('\n');
+        self.block(out, function.body);
+    }
+
+    fn block(&self, out: &mut String, body: ListRange) {
+        for stmt in self.program.stmt_list(body) {
+            out.push_str("  ");
+            self.stmt(out, *stmt);
+            out.push('\n');
+        }
+    }
+
+    fn stmt(&self, out: &mut String, stmt: StmtId) {
+        let program = self.program;
+        match *program.stmt(stmt) {
+            LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap,
+                on_stack,
+            } => {
+                let _ = write!(out, "let {}", program.name(name));
+                if let Some(ty) = program.expr_type(value) {
+                    let _ = write!(out, ": {}", self.type_name(ty));
+                }
+                if on_stack {
+                    out.push_str(" [stack]");
+                } else if is_heap {
+                    out.push_str(" [heap]");
+                }
+                out.push_str(" = ");
+                self.expr(out, value);
+            }
+            LoweredStmt::Assign { name, value } => {
+                let _ = write!(out, "{} = ", program.name(name));
+                self.expr(out, value);
+            }
+            LoweredStmt::FieldAssign {
+                receiver,
+                field,
+                value,
+            } => {
+                self.expr(out, receiver);
+                let _ = write!(out, ".{} = ", program.name(field));
+                self.expr(out, value);
+            }
+            LoweredStmt::ExprStmt(expr) => self.expr(out, expr),
+            LoweredStmt::Return(None) => out.push_str("return"),
+            LoweredStmt::Return(Some(expr)) => {
+                out.push_str("return ");
+                self.expr(out, expr);
+            }
+            LoweredStmt::Drop(name) => {
+                let _ = write!(out, "drop {}", program.name(name));
+            }
+        }
+    }
+
+    fn list(&self, out: &mut String, items: ListRange) {
+        for (i, item) in self.program.expr_list(items).iter().enumerate() {
+            if i > 0 {
+                out.push_str(", ");
+            }
+            self.expr(out, *item);
+        }
+    }
+
+    fn literal(&self, out: &mut String, literal: Literal) {
+        match literal {
+            Literal::Bool(value) => {
+                let _ = write!(out, "{}", value);
+            }
+            Literal::Number(text) => out.push_str(self.program.name(text)),
+            Literal::String(text) => {
+                let _ = write!(out, "\"{}\"", self.program.name(text));
+            }
+        }
+    }
+
+    fn expr(&self, out: &mut String, expr: ExprId) {
+        let program = self.program;
+        match *program.expr(expr) {
+            LoweredExpr::Literal(literal) => self.literal(out, literal),
+            LoweredExpr::Identifier(name) => out.push_str(program.name(name)),
+            LoweredExpr::This => out.push_str("this"),
+            LoweredExpr::Call { callee, args } => {
+                let _ = write!(out, "{}(", program.name(callee));
+                self.list(out, args);
+                out.push(')');
+            }
+            LoweredExpr::CallValue { callee, args } => {
+                out.push('(');
+                self.expr(out, callee);
+                out.push_str(")(");
+                self.list(out, args);
+                out.push(')');
+            }
+            LoweredExpr::MethodCall {
+                receiver,
+                method,
+                args,
+            } => {
+                self.expr(out, receiver);
+                let _ = write!(out, ".{}(", program.name(method));
+                self.list(out, args);
+                out.push(')');
+            }
+            LoweredExpr::FieldAccess { receiver, field } => {
+                self.expr(out, receiver);
+                let _ = write!(out, ".{}", program.name(field));
+            }
+            LoweredExpr::StructInit { fields, methods } => {
+                out.push('{');
+                let mut first = true;
+                for (name, value) in &program.field_inits[fields.indices()] {
+                    out.push_str(if first { " " } else { ", " });
+                    first = false;
+                    let _ = write!(out, "{}: ", program.name(*name));
+                    self.expr(out, *value);
+                }
+                for (name, function) in &program.method_inits[methods.indices()] {
+                    out.push_str(if first { " " } else { ", " });
+                    first = false;
+                    let target = program.function(*function).name;
+                    let _ = write!(out, "{}: fn {}", program.name(*name), program.name(target));
+                }
+                out.push_str(if first { "}" } else { " }" });
+            }
+            LoweredExpr::List { elements } => {
+                out.push('[');
+                self.list(out, elements);
+                out.push(']');
+            }
+            LoweredExpr::Match { subject, arms } => {
+                out.push_str("match ");
+                self.expr(out, subject);
+                out.push_str(" {");
+                for arm in &program.match_arms[arms.indices()] {
+                    out.push(' ');
+                    match arm.pattern {
+                        Pattern::Wildcard => out.push('_'),
+                        Pattern::Literal(literal) => self.literal(out, literal),
+                        Pattern::Unit(name) => out.push_str(program.name(name)),
+                    }
+                    out.push_str(": ");
+                    self.expr(out, arm.result);
+                }
+                out.push_str(" }");
+            }
+            LoweredExpr::BoolOp { op, lhs, rhs } => {
+                out.push('(');
+                self.expr(out, lhs);
+                out.push_str(match op {
+                    BoolOp::And => " and ",
+                    BoolOp::Or => " or ",
+                });
+                self.expr(out, rhs);
+                out.push(')');
+            }
+            LoweredExpr::Not(operand) => {
+                out.push_str("not ");
+                self.expr(out, operand);
+            }
+            LoweredExpr::Negate(operand) => {
+                out.push('-');
+                self.expr(out, operand);
+            }
+            LoweredExpr::Copy(operand) => {
+                out.push_str("copy(");
+                self.expr(out, operand);
+                out.push(')');
+            }
+        }
+    }
+}
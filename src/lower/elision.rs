@@ -0,0 +1,451 @@
+// Drop and copy elision - removes the work naive drop and copy insertion
+// leaves behind
+//
+// Insertion (drop_insertion.rs and copy.rs) copies a heap value whenever a
+// place hands it to a new owner and drops every owned variable at every
+// exit, which is often more than needed:
+//
+//   let t = copy(s)        let t = s
+//   drop s            →
+//
+// A `Copy` of a temporary (a call result, a literal) is removed outright. A
+// `Copy` of an owned local that is never read again becomes a move, and the
+// local's later `Drop`s go with it, since its value now belongs to the copy's
+// destination. Bodies are flat statement lists, so "never read again" is a
+// scan of the statements that follow; it stops at a reassignment, after which
+// drops belong to the new value. Only a copy the statement always evaluates
+// becomes a move: one in a match arm or on the right of `and`/`or` runs on
+// some paths only, and the drop it would remove is needed on the others.
+// Borrowed parameters, stack variables and globals are never moved from; the
+// entry statements, whose variables are the globals functions read, get the
+// other rewrites only.
+//
+// On the return path, statements after a `return` never run, and a second
+// `Drop` of a variable not reassigned since is the same drop twice; both are
+// removed, leaving one run of drops before each exit. A `$ret` binding left
+// right before its `return`, with no drops between, is folded back into it.
+
+use std::collections::{HashMap, HashSet};
+
+use super::ir::*;
+use crate::string_storage::StringId;
+
+/// Elides copies and drops in every function and the entry statements,
+/// returning how many copies, drops and unreachable statements were removed
+pub fn elide(program: &mut LoweredProgram) -> usize {
+    let mut elided = 0;
+    for function in 0..program.functions.len() {
+        let owned = owned_locals(program, function);
+        let body = program.functions[function].body;
+        let (removed, body) = elide_body(program, body, &owned);
+        program.functions[function].body = body;
+        elided += removed;
+    }
+    let (removed, entry) = elide_body(program, program.entry, &HashSet::new());
+    program.entry = entry;
+    elided + removed
+}
+
+/// Elides copies and drops in one statement list, moving only from `owned`
+/// variables; returns the count and the rewritten list
+fn elide_body(
+    program: &mut LoweredProgram,
+    range: ListRange,
+    owned: &HashSet<StringId>,
+) -> (usize, ListRange) {
+    let mut body = program.stmt_list(range).to_vec();
+    let mut elided = 0;
+
+    // Statements after a return never run
+    if let Some(end) = body
+        .iter()
+        .position(|stmt| matches!(program.stmt(*stmt), LoweredStmt::Return(_)))
+    {
+        elided += body.len() - end - 1;
+        body.truncate(end + 1);
+    }
+
+    let mut removed = vec![false; body.len()];
+    for i in 0..body.len() {
+        let mut copies = Vec::new();
+        let mut always = HashSet::new();
+        for expr in stmt_exprs(program.stmt(body[i])) {
+            program.visit_exprs(expr, |expr| {
+                if let LoweredExpr::Copy(_) = program.expr(expr) {
+                    copies.push(expr);
+                }
+            });
+            always_evaluated_copies(program, expr, &mut always);
+        }
+        for copy in copies {
+            let LoweredExpr::Copy(operand) = *program.expr(copy) else {
+                continue;
+            };
+            let moved = match *program.expr(operand) {
+                LoweredExpr::Call { .. }
+                | LoweredExpr::CallValue { .. }
+                | LoweredExpr::MethodCall { .. }
+                | LoweredExpr::StructInit { .. }
+                | LoweredExpr::List { .. }
+                | LoweredExpr::Literal(_) => *program.expr(operand),
+                LoweredExpr::Identifier(name)
+                    if owned.contains(&name) && always.contains(&copy) =>
+                {
+                    let Some(drops) = last_use(program, &body, i, name, &removed) else {
+                        continue;
+                    };
+                    for drop in drops {
+                        removed[drop] = true;
+                        elided += 1;
+                    }
+                    LoweredExpr::Identifier(name)
+                }
+                _ => continue,
+            };
+            program.exprs[copy.0 as usize] = moved;
+            elided += 1;
+        }
+    }
+
+    // One drop per value: a second drop without a reassignment between
+    let mut dropped: HashSet<StringId> = HashSet::new();
+    for (i, stmt) in body.iter().enumerate() {
+        if removed[i] {
+            continue;
+        }
+        match *program.stmt(*stmt) {
+            LoweredStmt::Drop(name) => {
+                if !dropped.insert(name) {
+                    removed[i] = true;
+                    elided += 1;
+                }
+            }
+            LoweredStmt::VarDecl { name, .. } | LoweredStmt::Assign { name, .. } => {
+                dropped.remove(&name);
+            }
+            _ => {}
+        }
+    }
+
+    // A compiler-made binding the return reads straight away
+    let kept: Vec<usize> = (0..body.len()).filter(|i| !removed[*i]).collect();
+    for pair in kept.windows(2) {
+        let (LoweredStmt::VarDecl { name, value, .. }, LoweredStmt::Return(Some(ret))) =
+            (*program.stmt(body[pair[0]]), *program.stmt(body[pair[1]]))
+        else {
+            continue;
+        };
+        if program.name(name).starts_with('$')
+            && *program.expr(ret) == LoweredExpr::Identifier(name)
+        {
+            removed[pair[0]] = true;
+            body[pair[1]] = program.add_stmt(LoweredStmt::Return(Some(value)));
+            elided += 1;
+        }
+    }
+
+    if elided == 0 {
+        return (0, range);
+    }
+    let kept = body
+        .iter()
+        .zip(&removed)
+        .filter(|(_, removed)| !**removed)
+        .map(|(stmt, _)| *stmt);
+    (
+        elided,
+        LoweredProgram::push_list(&mut program.stmt_lists, kept),
+    )
+}
+
+/// Heap values the function owns and so may move from: owned parameters and
+/// heap locals not on the stack. A redeclared name qualifies when every value
+/// it holds is owned; the scan for a last use stops at the redeclaration.
+fn owned_locals(program: &LoweredProgram, function: usize) -> HashSet<StringId> {
+    let function = &program.functions[function];
+    let mut declared: HashMap<StringId, bool> = HashMap::new();
+    for param in program.params_of(function) {
+        let owned = param.is_heap && param.pass_mode == PassMode::ByOwnership;
+        declared.insert(param.name, owned);
+    }
+    for stmt in program.stmt_list(function.body) {
+        if let LoweredStmt::VarDecl {
+            name,
+            is_heap,
+            on_stack,
+            ..
+        } = *program.stmt(*stmt)
+        {
+            *declared.entry(name).or_insert(true) &= is_heap && !on_stack;
+        }
+    }
+    declared
+        .into_iter()
+        .filter(|(_, owned)| *owned)
+        .map(|(name, _)| name)
+        .collect()
+}
+
+/// The `Copy` nodes under `expr` that run whenever `expr` does: not those in
+/// a match arm or the right operand of `and`/`or`
+fn always_evaluated_copies(program: &LoweredProgram, expr: ExprId, out: &mut HashSet<ExprId>) {
+    let mut stack = vec![expr];
+    while let Some(expr) = stack.pop() {
+        match *program.expr(expr) {
+            LoweredExpr::Match { subject, .. } => stack.push(subject),
+            LoweredExpr::BoolOp { lhs, .. } => stack.push(lhs),
+            LoweredExpr::Copy(operand) => {
+                out.insert(expr);
+                stack.push(operand);
+            }
+            _ => program.visit_children(expr, |child| stack.push(child)),
+        }
+    }
+}
+
+/// The expressions a statement evaluates
+fn stmt_exprs(stmt: &LoweredStmt) -> Vec<ExprId> {
+    match *stmt {
+        LoweredStmt::VarDecl { value, .. }
+        | LoweredStmt::Assign { value, .. }
+        | LoweredStmt::ExprStmt(value)
+        | LoweredStmt::Return(Some(value)) => vec![value],
+        LoweredStmt::FieldAssign {
+            receiver, value, ..
+        } => vec![receiver, value],
+        LoweredStmt::Return(None) | LoweredStmt::Drop(_) => Vec::new(),
+    }
+}
+
+fn reads(program: &LoweredProgram, stmt: &LoweredStmt, name: StringId) -> usize {
+    let mut count = 0;
+    for expr in stmt_exprs(stmt) {
+        program.visit_exprs(expr, |expr| {
+            if *program.expr(expr) == LoweredExpr::Identifier(name) {
+                count += 1;
+            }
+        });
+    }
+    count
+}
+
+/// When the copy of `name` in statement `at` is its last read, the drops of
+/// `name` that follow (and so become redundant once it is moved)
+fn last_use(
+    program: &LoweredProgram,
+    body: &[StmtId],
+    at: usize,
+    name: StringId,
+    removed: &[bool],
+) -> Option<Vec<usize>> {
+    let stmt = program.stmt(body[at]);
+    let assigns = matches!(*stmt, LoweredStmt::VarDecl { name: n, .. }
+        | LoweredStmt::Assign { name: n, .. } if n == name);
+    if assigns || reads(program, stmt, name) != 1 {
+        return None;
+    }
+    let mut drops = Vec::new();
+    for (i, stmt) in body.iter().enumerate().skip(at + 1) {
+        if removed[i] {
+            continue;
+        }
+        let stmt = program.stmt(*stmt);
+        if reads(program, stmt, name) > 0 {
+            return None;
+        }
+        match *stmt {
+            LoweredStmt::Drop(dropped) if dropped == name => drops.push(i),
+            LoweredStmt::VarDecl { name: n, .. } | LoweredStmt::Assign { name: n, .. }
+                if n == name =>
+            {
+                break;
+            }
+            _ => {}
+        }
+    }
+    Some(drops)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lower::dump;
+    use crate::semantic::{Type, TypeRegistry};
+
+    /// Builds one function over hand-written statements, the way insertion
+    /// would leave them
+    struct Builder {
+        program: LoweredProgram,
+        registry: TypeRegistry,
+    }
+
+    impl Builder {
+        fn new() -> Self {
+            Builder {
+                program: LoweredProgram::default(),
+                registry: TypeRegistry::new(),
+            }
+        }
+
+        fn name(&mut self, text: &str) -> StringId {
+            self.program.names.intern(text)
+        }
+
+        fn var(&mut self, text: &str) -> ExprId {
+            let name = self.name(text);
+            self.program.add_expr(LoweredExpr::Identifier(name), None)
+        }
+
+        fn copy(&mut self, text: &str) -> ExprId {
+            let operand = self.var(text);
+            self.program.add_expr(LoweredExpr::Copy(operand), None)
+        }
+
+        fn call(&mut self, callee: &str, args: Vec<ExprId>) -> ExprId {
+            let callee = self.name(callee);
+            let args = LoweredProgram::push_list(&mut self.program.expr_lists, args);
+            self.program
+                .add_expr(LoweredExpr::Call { callee, args }, None)
+        }
+
+        fn let_(&mut self, text: &str, value: ExprId) -> StmtId {
+            let name = self.name(text);
+            self.program.add_stmt(LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap: true,
+                on_stack: false,
+            })
+        }
+
+        fn drop(&mut self, text: &str) -> StmtId {
+            let name = self.name(text);
+            self.program.add_stmt(LoweredStmt::Drop(name))
+        }
+
+        fn function(&mut self, params: &[(&str, PassMode)], body: Vec<StmtId>) -> String {
+            let ty = self.registry.intern(Type::String);
+            let params: Vec<LoweredParam> = params
+                .iter()
+                .map(|(text, pass_mode)| LoweredParam {
+                    name: self.program.names.intern(text),
+                    ty,
+                    pass_mode: *pass_mode,
+                    is_heap: true,
+                })
+                .collect();
+            let name = self.name("f");
+            let function = LoweredFunction {
+                name,
+                decl: 0,
+                params: LoweredProgram::push_list(&mut self.program.params, params),
+                return_type: None,
+                this_type: None,
+                body: LoweredProgram::push_list(&mut self.program.stmt_lists, body),
+                spec: None,
+            };
+            self.program.functions.push(function);
+            elide(&mut self.program);
+            dump(&self.program, &self.registry)
+        }
+    }
+
+    #[test]
+    fn test_last_copy_becomes_move() {
+        let mut b = Builder::new();
+        let hello = b.program.names.intern("hello");
+        let literal = b
+            .program
+            .add_expr(LoweredExpr::Literal(Literal::String(hello)), None);
+        let s = b.let_("s", literal);
+        let first = b.copy("s");
+        let first = b.call("show", vec![first]);
+        let first = b.program.add_stmt(LoweredStmt::ExprStmt(first));
+        let second = b.copy("s");
+        let t = b.let_("t", second);
+        let drop_s = b.drop("s");
+        let ret = b.var("t");
+        let ret = b.program.add_stmt(LoweredStmt::Return(Some(ret)));
+        let dead = b.drop("t");
+        let text = b.function(&[], vec![s, first, t, drop_s, ret, dead]);
+        assert_eq!(
+            text,
+            "fn f()\n\
+             \x20 let s [heap] = \"hello\"\n\
+             \x20 show(copy(s))\n\
+             \x20 let t [heap] = s\n\
+             \x20 return t\n\
+             entry\n"
+        );
+    }
+
+    #[test]
+    fn test_borrowed_and_temporary_copies() {
+        let mut b = Builder::new();
+        // A borrowed parameter is never moved from
+        let borrowed = b.copy("r");
+        let a = b.let_("a", borrowed);
+        // Copying a call result copies a temporary nobody else holds
+        let made = b.call("make", vec![]);
+        let made = b.program.add_expr(LoweredExpr::Copy(made), None);
+        let c = b.let_("c", made);
+        let owned = b.copy("o");
+        let d = b.let_("d", owned);
+        let drops = [b.drop("o"), b.drop("a"), b.drop("a")];
+        let mut body = vec![a, c, d];
+        body.extend(drops);
+        let text = b.function(
+            &[("r", PassMode::ByRef), ("o", PassMode::ByOwnership)],
+            body,
+        );
+        assert_eq!(
+            text,
+            "fn f(r: String [ref heap], o: String [own heap])\n\
+             \x20 let a [heap] = copy(r)\n\
+             \x20 let c [heap] = make()\n\
+             \x20 let d [heap] = o\n\
+             \x20 drop a\n\
+             entry\n"
+        );
+    }
+
+    #[test]
+    fn test_copy_in_match_arm_is_not_moved() {
+        let mut b = Builder::new();
+        // Only the first arm copies `o`; the other paths still need its drop
+        let subject = b.var("flag");
+        let copied = b.copy("o");
+        let made = b.call("make", vec![]);
+        let arms = [
+            MatchArm {
+                pattern: Pattern::Literal(Literal::Bool(true)),
+                result: copied,
+            },
+            MatchArm {
+                pattern: Pattern::Wildcard,
+                result: made,
+            },
+        ];
+        let arms = LoweredProgram::push_list(&mut b.program.match_arms, arms);
+        let value = b
+            .program
+            .add_expr(LoweredExpr::Match { subject, arms }, None);
+        let t = b.let_("t", value);
+        let drop_o = b.drop("o");
+        // The entry statements get the same clean-up
+        let entry = [b.drop("g"), b.drop("g")];
+        b.program.entry = LoweredProgram::push_list(&mut b.program.stmt_lists, entry);
+        let text = b.function(
+            &[("flag", PassMode::ByRef), ("o", PassMode::ByOwnership)],
+            vec![t, drop_o],
+        );
+        assert_eq!(
+            text,
+            "fn f(flag: String [ref heap], o: String [own heap])\n\
+             \x20 let t [heap] = match flag { true: copy(o) _: make() }\n\
+             \x20 drop o\n\
+             entry\n\
+             \x20 drop g\n"
+        );
+    }
+}
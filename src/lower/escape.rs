@@ -0,0 +1,409 @@
+// Escape analysis - heap-typed locals that can live in the frame
+//
+// Strings and structs are heap values, but most locals built from a literal
+// never outlive the function that builds them. A local escapes when it is
+// returned, aliased by another variable, reassigned, put in a list or a
+// struct (a struct's drop releases its fields, so they must own heap
+// storage), or passed `ByOwnership` or to a function value. Borrowing it
+// does not: `ByRef` arguments, method receivers and arguments (methods keep
+// their default, all-`ByRef` key), field reads and match subjects. A call's
+// result is a fresh value under the ownership rules (returning a borrowed
+// value copies it), so a borrow never escapes through the call.
+//
+// A move at a last use is not an escape when the callee also has a variant
+// borrowing that parameter: the call is redirected to it, since a stack
+// local is dropped by its own frame anyway.
+//
+// Locals that never escape are marked `on_stack` and get a `Drop` right after
+// their last use. Bodies are flat statement lists, so that point is static;
+// when it is the `return`, the returned value is bound to `$ret` first so the
+// drop runs before the function leaves. The entry statements are skipped:
+// their variables are globals that functions read.
+//
+// Code generation still compiles from the AST; codegen/storage.rs carries
+// the decision over by name, giving stack struct locals an alloca'd cell
+// whose fields are dropped after the same last use. String literals are
+// constants there, so stack strings change nothing yet.
+
+use std::collections::{HashMap, HashSet};
+
+use super::heap_analysis::is_heap_type;
+use super::ir::*;
+use super::specialization::SpecKey;
+use crate::semantic::{AnalysisOutput, Type};
+use crate::string_storage::StringId;
+
+/// Where a value flows
+#[derive(Clone, Copy, PartialEq)]
+enum Use {
+    Borrow,
+    Escape,
+}
+
+/// Gives every non-escaping string or struct local stack storage and a
+/// static `Drop`, returning how many locals moved to the stack
+pub fn stack_allocate(program: &mut LoweredProgram, output: &AnalysisOutput) -> usize {
+    let by_name: HashMap<StringId, usize> = program
+        .functions
+        .iter()
+        .enumerate()
+        .map(|(i, f)| (f.name, i))
+        .collect();
+    let mut moved = 0;
+    for index in 0..program.functions.len() {
+        let (stack, redirects) = {
+            let mut escapes = Escapes::new(program, &by_name, index, output);
+            escapes.analyze(index);
+            (escapes.stack_locals(), escapes.redirects())
+        };
+        for (call, name) in redirects {
+            if let LoweredExpr::Call { callee, .. } = &mut program.exprs[call.0 as usize] {
+                *callee = name;
+            }
+        }
+        if !stack.is_empty() {
+            moved += stack.len();
+            place(program, index, &stack, output);
+        }
+    }
+    moved
+}
+
+struct Escapes<'a> {
+    program: &'a LoweredProgram,
+    by_name: &'a HashMap<StringId, usize>,
+    /// String and struct locals initialized by a literal, in declaration
+    /// order
+    candidates: Vec<StringId>,
+    is_candidate: HashSet<StringId>,
+    escaped: HashSet<StringId>,
+    moves: Vec<Move>,
+}
+
+/// A call passing candidate locals to owned parameters. Locals that stay on
+/// the stack are dropped by the caller, so the call is redirected to the
+/// specialization borrowing them; without one, they escape.
+struct Move {
+    call: ExprId,
+    callee: usize,
+    /// (parameter index, local)
+    args: Vec<(usize, StringId)>,
+}
+
+impl<'a> Escapes<'a> {
+    fn new(
+        program: &'a LoweredProgram,
+        by_name: &'a HashMap<StringId, usize>,
+        function: usize,
+        output: &AnalysisOutput,
+    ) -> Self {
+        let function = &program.functions[function];
+        let mut declared: HashMap<StringId, u32> = program
+            .params_of(function)
+            .iter()
+            .map(|param| (param.name, 1))
+            .collect();
+        let mut candidates = Vec::new();
+        for stmt in program.stmt_list(function.body) {
+            let LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap,
+                on_stack,
+            } = *program.stmt(*stmt)
+            else {
+                continue;
+            };
+            *declared.entry(name).or_insert(0) += 1;
+            let literal = matches!(
+                program.expr(value),
+                LoweredExpr::StructInit { .. } | LoweredExpr::Literal(Literal::String(_))
+            );
+            let stackable = program
+                .expr_type(value)
+                .is_some_and(|ty| matches!(output.resolve(ty), Type::String | Type::Struct(_)));
+            if is_heap && !on_stack && literal && stackable {
+                candidates.push(name);
+            }
+        }
+        // A name declared twice (or shadowing a parameter) is left alone
+        candidates.retain(|name| declared[name] == 1);
+        Escapes {
+            program,
+            by_name,
+            is_candidate: candidates.iter().copied().collect(),
+            candidates,
+            escaped: HashSet::new(),
+            moves: Vec::new(),
+        }
+    }
+
+    fn analyze(&mut self, function: usize) {
+        if self.candidates.is_empty() {
+            return;
+        }
+        let program = self.program;
+        for stmt in program.stmt_list(program.functions[function].body) {
+            self.stmt(*stmt);
+        }
+        // A move that cannot borrow makes its locals escape, which can leave
+        // another move touching them with a different variant to look up
+        loop {
+            let mut changed = false;
+            for index in 0..self.moves.len() {
+                let clear = self.borrowed_bits(&self.moves[index]);
+                if clear != 0
+                    && self
+                        .borrowing_variant(self.moves[index].callee, clear)
+                        .is_none()
+                {
+                    for (_, name) in &self.moves[index].args {
+                        changed |= self.escaped.insert(*name);
+                    }
+                }
+            }
+            if !changed {
+                break;
+            }
+        }
+    }
+
+    /// Bits of the owned parameters a move can borrow instead
+    fn borrowed_bits(&self, call: &Move) -> u64 {
+        call.args
+            .iter()
+            .filter(|(_, name)| !self.escaped.contains(name))
+            .fold(0, |bits, (i, _)| bits | 1 << i)
+    }
+
+    /// Name of the specialization of `callee` taking the `clear` parameters
+    /// by reference, when it exists
+    fn borrowing_variant(&self, callee: usize, clear: u64) -> Option<StringId> {
+        let table = &self.program.specializations;
+        let key = table.key(self.program.functions[callee].spec?);
+        let id = table.get(SpecKey {
+            pass_modes: key.pass_modes & !clear,
+            ..key
+        })?;
+        let name = table.name(id);
+        self.by_name.contains_key(&name).then_some(name)
+    }
+
+    /// Calls to redirect to their borrowing variant
+    fn redirects(&self) -> Vec<(ExprId, StringId)> {
+        self.moves
+            .iter()
+            .filter_map(|call| {
+                let clear = self.borrowed_bits(call);
+                if clear == 0 {
+                    return None;
+                }
+                Some((call.call, self.borrowing_variant(call.callee, clear)?))
+            })
+            .collect()
+    }
+
+    fn stack_locals(&self) -> Vec<StringId> {
+        self.candidates
+            .iter()
+            .copied()
+            .filter(|name| !self.escaped.contains(name))
+            .collect()
+    }
+
+    fn stmt(&mut self, stmt: StmtId) {
+        match *self.program.stmt(stmt) {
+            LoweredStmt::VarDecl { value, .. } => self.expr(value, Use::Escape),
+            LoweredStmt::Assign { name, value } => {
+                self.escaped.insert(name);
+                self.expr(value, Use::Escape);
+            }
+            LoweredStmt::FieldAssign {
+                receiver, value, ..
+            } => {
+                self.expr(receiver, Use::Borrow);
+                self.expr(value, Use::Escape);
+            }
+            LoweredStmt::ExprStmt(expr) => self.expr(expr, Use::Borrow),
+            LoweredStmt::Return(Some(expr)) => self.expr(expr, Use::Escape),
+            LoweredStmt::Return(None) | LoweredStmt::Drop(_) => {}
+        }
+    }
+
+    fn list(&mut self, items: ListRange, target: Use) {
+        for item in self.program.expr_list(items) {
+            self.expr(*item, target);
+        }
+    }
+
+    fn expr(&mut self, expr: ExprId, target: Use) {
+        let program = self.program;
+        match *program.expr(expr) {
+            LoweredExpr::Identifier(name) => {
+                if target == Use::Escape && self.is_candidate.contains(&name) {
+                    self.escaped.insert(name);
+                }
+            }
+            LoweredExpr::Literal(_) | LoweredExpr::This => {}
+            LoweredExpr::Call { callee, args } => {
+                let function = self.by_name.get(&callee).copied();
+                let params = function.map(|f| program.params_of(&program.functions[f]));
+                let mut moved = Vec::new();
+                for (i, arg) in program.expr_list(args).iter().enumerate() {
+                    let owned = params
+                        .and_then(|params| params.get(i))
+                        .is_some_and(|param| param.pass_mode == PassMode::ByOwnership);
+                    match *program.expr(*arg) {
+                        LoweredExpr::Identifier(name)
+                            if owned && i < 64 && self.is_candidate.contains(&name) =>
+                        {
+                            moved.push((i, name))
+                        }
+                        _ => self.expr(*arg, if owned { Use::Escape } else { Use::Borrow }),
+                    }
+                }
+                if let (Some(callee), false) = (function, moved.is_empty()) {
+                    self.moves.push(Move {
+                        call: expr,
+                        callee,
+                        args: moved,
+                    });
+                }
+            }
+            LoweredExpr::CallValue { callee, args } => {
+                self.expr(callee, Use::Borrow);
+                self.list(args, Use::Escape);
+            }
+            LoweredExpr::MethodCall { receiver, args, .. } => {
+                self.expr(receiver, Use::Borrow);
+                self.list(args, Use::Borrow);
+            }
+            LoweredExpr::FieldAccess { receiver, .. } => self.expr(receiver, Use::Borrow),
+            LoweredExpr::StructInit { fields, .. } => {
+                for (_, value) in &program.field_inits[fields.indices()] {
+                    self.expr(*value, Use::Escape);
+                }
+            }
+            LoweredExpr::List { elements } => self.list(elements, Use::Escape),
+            LoweredExpr::Match { subject, arms } => {
+                self.expr(subject, Use::Borrow);
+                for arm in &program.match_arms[arms.indices()] {
+                    self.expr(arm.result, target);
+                }
+            }
+            LoweredExpr::BoolOp { lhs, rhs, .. } => {
+                self.expr(lhs, Use::Borrow);
+                self.expr(rhs, Use::Borrow);
+            }
+            LoweredExpr::Not(operand)
+            | LoweredExpr::Negate(operand)
+            | LoweredExpr::Copy(operand) => self.expr(operand, Use::Borrow),
+        }
+    }
+}
+
+/// Which of `names` `expr` reads
+fn mentions(program: &LoweredProgram, expr: ExprId, names: &HashSet<StringId>) -> Vec<StringId> {
+    let mut found = Vec::new();
+    program.visit_exprs(expr, |expr| {
+        if let LoweredExpr::Identifier(name) = *program.expr(expr)
+            && names.contains(&name)
+        {
+            found.push(name);
+        }
+    });
+    found
+}
+
+/// Marks `stack` locals `on_stack` and drops each after its last use
+fn place(
+    program: &mut LoweredProgram,
+    function: usize,
+    stack: &[StringId],
+    output: &AnalysisOutput,
+) {
+    let names: HashSet<StringId> = stack.iter().copied().collect();
+    let body = program.stmt_list(program.functions[function].body).to_vec();
+    let mut last_use: HashMap<StringId, usize> = HashMap::new();
+    for (i, stmt) in body.iter().enumerate() {
+        let used = match *program.stmt(*stmt) {
+            LoweredStmt::VarDecl { name, value, .. } => {
+                let mut used = mentions(program, value, &names);
+                if names.contains(&name) {
+                    used.push(name);
+                }
+                used
+            }
+            LoweredStmt::Assign { value, .. }
+            | LoweredStmt::ExprStmt(value)
+            | LoweredStmt::Return(Some(value)) => mentions(program, value, &names),
+            LoweredStmt::FieldAssign {
+                receiver, value, ..
+            } => {
+                let mut used = mentions(program, receiver, &names);
+                used.extend(mentions(program, value, &names));
+                used
+            }
+            LoweredStmt::Return(None) | LoweredStmt::Drop(_) => Vec::new(),
+        };
+        for name in used {
+            last_use.insert(name, i);
+        }
+    }
+
+    // Later declarations are dropped first
+    let mut drops: HashMap<usize, Vec<StringId>> = HashMap::new();
+    for name in stack.iter().rev() {
+        drops.entry(last_use[name]).or_default().push(*name);
+    }
+    let mut stmts = Vec::with_capacity(body.len() + stack.len() + 1);
+    for (i, stmt) in body.into_iter().enumerate() {
+        if let LoweredStmt::VarDecl {
+            name,
+            value,
+            is_heap,
+            ..
+        } = *program.stmt(stmt)
+            && names.contains(&name)
+        {
+            program.stmts[stmt.0 as usize] = LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap,
+                on_stack: true,
+            };
+        }
+        let Some(drops) = drops.remove(&i) else {
+            stmts.push(stmt);
+            continue;
+        };
+        let returned = match *program.stmt(stmt) {
+            LoweredStmt::Return(Some(value)) => Some(value),
+            _ => None,
+        };
+        match returned {
+            Some(value) => {
+                let ty = program.expr_type(value);
+                let ret = program.names.intern("$ret");
+                stmts.push(program.add_stmt(LoweredStmt::VarDecl {
+                    name: ret,
+                    value,
+                    is_heap: ty.is_some_and(|ty| is_heap_type(ty, output)),
+                    on_stack: false,
+                }));
+                for name in drops {
+                    stmts.push(program.add_stmt(LoweredStmt::Drop(name)));
+                }
+                let ret = program.add_expr(LoweredExpr::Identifier(ret), ty);
+                stmts.push(program.add_stmt(LoweredStmt::Return(Some(ret))));
+            }
+            None => {
+                stmts.push(stmt);
+                for name in drops {
+                    stmts.push(program.add_stmt(LoweredStmt::Drop(name)));
+                }
+            }
+        }
+    }
+    program.functions[function].body = LoweredProgram::push_list(&mut program.stmt_lists, stmts);
+}
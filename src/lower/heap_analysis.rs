@@ -0,0 +1,68 @@
+// Heap classification - which values live on the heap and so need explicit
+// `Drop`s and `Copy`s (Phase 5 in todo.md)
+
+use crate::semantic::{AnalysisOutput, Type, TypeId};
+
+/// Whether values of `ty` live on the heap
+///
+/// Stack: Number, Bool, sized integers and floats, units, Void and function
+/// values. Heap: String, structs and arrays, and unions, options and results
+/// with any heap member. Types still unresolved (generic parameters, type
+/// variables) count as heap, the conservative answer for drops and copies.
+pub fn is_heap_type(ty: TypeId, output: &AnalysisOutput) -> bool {
+    match output.resolve(ty) {
+        Type::Unit
+        | Type::NamedUnit(_)
+        | Type::Void
+        | Type::Number
+        | Type::Bool
+        | Type::Int(_)
+        | Type::UInt(_)
+        | Type::Float(_)
+        | Type::Function(_)
+        | Type::Error => false,
+        Type::String | Type::Struct(_) | Type::Array(_) => true,
+        Type::Union(members) => members.iter().any(|m| is_heap_type(*m, output)),
+        Type::Option(inner) => is_heap_type(*inner, output),
+        Type::Result(ok, err) => is_heap_type(*ok, output) || is_heap_type(*err, output),
+        Type::Generic { inner, .. } => is_heap_type(*inner, output),
+        Type::Var(_) | Type::TypeVar(_) | Type::TypeParameter { .. } | Type::Unknown => true,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::limits::CompilerLimits;
+    use crate::parser::parse;
+    use crate::semantic::SemanticAnalyzer;
+
+    fn analyze(source: &str) -> AnalysisOutput {
+        let limits = CompilerLimits::default();
+        let ast = parse(lex(source, &limits).unwrap(), &limits).unwrap();
+        SemanticAnalyzer::new(ast).analyze_with_types().unwrap()
+    }
+
+    #[test]
+    fn test_heap_classification() {
+        let mut output = analyze("type Ok\ntype Failed\n");
+        let registry = &mut output.type_registry;
+        let number = registry.intern(Type::Number);
+        let string = registry.intern(Type::String);
+        let ok = registry.intern(Type::NamedUnit("Ok".to_string()));
+        let failed = registry.intern(Type::NamedUnit("Failed".to_string()));
+        let status = registry.intern(Type::Union(vec![ok, failed]));
+        let message = registry.intern(Type::Union(vec![ok, string]));
+        let point = registry.intern(Type::Struct(crate::semantic::StructType {
+            fields: Vec::new(),
+            methods: Vec::new(),
+        }));
+
+        assert!(!is_heap_type(number, &output));
+        assert!(is_heap_type(string, &output));
+        assert!(is_heap_type(point, &output));
+        assert!(!is_heap_type(status, &output));
+        assert!(is_heap_type(message, &output));
+    }
+}
@@ -0,0 +1,362 @@
+// Lowered IR - flat, index-based functions, statements and expressions
+//
+// Like `Ast`, every node lives in a contiguous arena and refers to others by
+// index: `ExprId` and `StmtId` are `u32` positions in `LoweredProgram::exprs`
+// and `stmts`. Variable-length children (call arguments, block statements,
+// struct members, match arms, parameters) are `ListRange`s into shared pools,
+// so a node is a small fixed-size value and copying a function body (as
+// specialization does) appends to the same arenas instead of allocating per
+// node.
+
+use super::specialization::{SpecId, SpecTable};
+use crate::semantic::TypeId;
+use crate::string_storage::{StringId, StringStorage};
+
+/// Index of an expression in `LoweredProgram::exprs`
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct ExprId(pub u32);
+
+/// Index of a statement in `LoweredProgram::stmts`
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct StmtId(pub u32);
+
+/// Index of a function in `LoweredProgram::functions`
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct FunctionId(pub u32);
+
+/// A run of consecutive entries in one of the program's list pools
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct ListRange {
+    pub start: u32,
+    pub len: u32,
+}
+
+impl ListRange {
+    pub fn indices(self) -> std::ops::Range<usize> {
+        self.start as usize..(self.start + self.len) as usize
+    }
+
+    pub fn is_empty(self) -> bool {
+        self.len == 0
+    }
+}
+
+/// How a heap parameter is passed
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum PassMode {
+    /// The caller keeps ownership; the callee must not drop the value
+    ByRef,
+    /// Ownership moves to the callee, which drops the value unless it
+    /// returns or moves it
+    ByOwnership,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Literal {
+    Bool(bool),
+    /// Number text as written, with any type suffix (`42i32`)
+    Number(StringId),
+    /// String literal contents, escapes still unprocessed
+    String(StringId),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum BoolOp {
+    And,
+    Or,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum LoweredExpr {
+    Literal(Literal),
+    Identifier(StringId),
+    This,
+    /// Call of a function by name; pipes are lowered to calls
+    Call {
+        callee: StringId,
+        args: ListRange,
+    },
+    /// Call of a function value (`x | makeAdder()`)
+    CallValue {
+        callee: ExprId,
+        args: ListRange,
+    },
+    MethodCall {
+        receiver: ExprId,
+        method: StringId,
+        args: ListRange,
+    },
+    FieldAccess {
+        receiver: ExprId,
+        field: StringId,
+    },
+    /// `fields` index `field_inits`, `methods` index `method_inits`
+    StructInit {
+        fields: ListRange,
+        methods: ListRange,
+    },
+    List {
+        elements: ListRange,
+    },
+    /// `arms` index `match_arms`
+    Match {
+        subject: ExprId,
+        arms: ListRange,
+    },
+    BoolOp {
+        op: BoolOp,
+        lhs: ExprId,
+        rhs: ExprId,
+    },
+    Not(ExprId),
+    Negate(ExprId),
+    /// Inserted by the compiler: a deep copy of a heap value
+    Copy(ExprId),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum LoweredStmt {
+    VarDecl {
+        name: StringId,
+        value: ExprId,
+        is_heap: bool,
+        /// A heap-typed value escape analysis placed in the frame
+        on_stack: bool,
+    },
+    Assign {
+        name: StringId,
+        value: ExprId,
+    },
+    FieldAssign {
+        receiver: ExprId,
+        field: StringId,
+        value: ExprId,
+    },
+    ExprStmt(ExprId),
+    Return(Option<ExprId>),
+    /// Inserted by the compiler: ends the life of a heap variable. For
+    /// `on_stack` variables only the contents are released; the storage is
+    /// the frame's.
+    Drop(StringId),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Pattern {
+    /// `_`
+    Wildcard,
+    Literal(Literal),
+    /// A named unit type (`Success`)
+    Unit(StringId),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct MatchArm {
+    pub pattern: Pattern,
+    pub result: ExprId,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct LoweredParam {
+    pub name: StringId,
+    pub ty: TypeId,
+    pub pass_mode: PassMode,
+    pub is_heap: bool,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct LoweredFunction {
+    /// Lexical path (`outer.inner`, `point.get` for struct literal methods)
+    pub name: StringId,
+    /// The FunctionDecl this function was lowered from
+    pub decl: usize,
+    /// Range of `params`
+    pub params: ListRange,
+    pub return_type: Option<TypeId>,
+    /// Struct type of `this` for struct literal methods
+    pub this_type: Option<TypeId>,
+    /// Range of `stmt_lists`
+    pub body: ListRange,
+    /// The key this function was specialized for
+    pub spec: Option<SpecId>,
+}
+
+/// A lowered program: every function, plus the top-level statements that
+/// run before `main`
+#[derive(Debug, Clone, Default)]
+pub struct LoweredProgram {
+    pub functions: Vec<LoweredFunction>,
+    /// Range of `stmt_lists` holding the top-level statements
+    pub entry: ListRange,
+    pub exprs: Vec<LoweredExpr>,
+    /// Resolved type of each expression, parallel to `exprs`
+    pub expr_types: Vec<Option<TypeId>>,
+    pub stmts: Vec<LoweredStmt>,
+    pub expr_lists: Vec<ExprId>,
+    pub stmt_lists: Vec<StmtId>,
+    pub field_inits: Vec<(StringId, ExprId)>,
+    pub method_inits: Vec<(StringId, FunctionId)>,
+    pub match_arms: Vec<MatchArm>,
+    pub params: Vec<LoweredParam>,
+    pub names: StringStorage,
+    pub specializations: SpecTable,
+}
+
+impl LoweredProgram {
+    pub fn add_expr(&mut self, expr: LoweredExpr, ty: Option<TypeId>) -> ExprId {
+        let id = ExprId(self.exprs.len() as u32);
+        self.exprs.push(expr);
+        self.expr_types.push(ty);
+        id
+    }
+
+    pub fn add_stmt(&mut self, stmt: LoweredStmt) -> StmtId {
+        let id = StmtId(self.stmts.len() as u32);
+        self.stmts.push(stmt);
+        id
+    }
+
+    pub fn expr(&self, id: ExprId) -> &LoweredExpr {
+        &self.exprs[id.0 as usize]
+    }
+
+    pub fn expr_type(&self, id: ExprId) -> Option<TypeId> {
+        self.expr_types[id.0 as usize]
+    }
+
+    pub fn stmt(&self, id: StmtId) -> &LoweredStmt {
+        &self.stmts[id.0 as usize]
+    }
+
+    pub fn function(&self, id: FunctionId) -> &LoweredFunction {
+        &self.functions[id.0 as usize]
+    }
+
+    pub fn name(&self, id: StringId) -> &str {
+        self.names.resolve(id)
+    }
+
+    /// Expressions of an `expr_lists` range
+    pub fn expr_list(&self, range: ListRange) -> &[ExprId] {
+        &self.expr_lists[range.indices()]
+    }
+
+    /// Statements of a `stmt_lists` range
+    pub fn stmt_list(&self, range: ListRange) -> &[StmtId] {
+        &self.stmt_lists[range.indices()]
+    }
+
+    pub fn params_of(&self, function: &LoweredFunction) -> &[LoweredParam] {
+        &self.params[function.params.indices()]
+    }
+
+    /// Calls `f` on `expr` and every expression nested in it
+    pub fn visit_exprs(&self, expr: ExprId, mut f: impl FnMut(ExprId)) {
+        let mut stack = vec![expr];
+        while let Some(expr) = stack.pop() {
+            f(expr);
+            self.visit_children(expr, |child| stack.push(child));
+        }
+    }
+
+    /// Calls `f` on each direct operand of `expr`
+    pub fn visit_children(&self, expr: ExprId, mut f: impl FnMut(ExprId)) {
+        match *self.expr(expr) {
+            LoweredExpr::Literal(_) | LoweredExpr::Identifier(_) | LoweredExpr::This => {}
+            LoweredExpr::Call { args, .. } => self.expr_list(args).iter().copied().for_each(f),
+            LoweredExpr::CallValue { callee, args } => {
+                f(callee);
+                self.expr_list(args).iter().copied().for_each(f);
+            }
+            LoweredExpr::MethodCall { receiver, args, .. } => {
+                f(receiver);
+                self.expr_list(args).iter().copied().for_each(f);
+            }
+            LoweredExpr::FieldAccess { receiver, .. } => f(receiver),
+            LoweredExpr::StructInit { fields, .. } => self.field_inits[fields.indices()]
+                .iter()
+                .for_each(|(_, v)| f(*v)),
+            LoweredExpr::List { elements } => self.expr_list(elements).iter().copied().for_each(f),
+            LoweredExpr::Match { subject, arms } => {
+                f(subject);
+                self.match_arms[arms.indices()]
+                    .iter()
+                    .for_each(|a| f(a.result));
+            }
+            LoweredExpr::BoolOp { lhs, rhs, .. } => {
+                f(lhs);
+                f(rhs);
+            }
+            LoweredExpr::Not(operand)
+            | LoweredExpr::Negate(operand)
+            | LoweredExpr::Copy(operand) => f(operand),
+        }
+    }
+
+    /// Appends a list to a pool, returning its range
+    pub fn push_list<T>(pool: &mut Vec<T>, items: impl IntoIterator<Item = T>) -> ListRange {
+        let start = pool.len() as u32;
+        pool.extend(items);
+        ListRange {
+            start,
+            len: pool.len() as u32 - start,
+        }
+    }
+
+    /// Estimated heap bytes of the arenas and pools
+    pub fn heap_bytes(&self) -> usize {
+        use crate::stats::vec_bytes;
+        vec_bytes(&self.functions)
+            + vec_bytes(&self.exprs)
+            + vec_bytes(&self.expr_types)
+            + vec_bytes(&self.stmts)
+            + vec_bytes(&self.expr_lists)
+            + vec_bytes(&self.stmt_lists)
+            + vec_bytes(&self.field_inits)
+            + vec_bytes(&self.method_inits)
+            + vec_bytes(&self.match_arms)
+            + vec_bytes(&self.params)
+            + self.names.heap_bytes()
+            + self.specializations.heap_bytes()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_nodes_are_small() {
+        assert!(std::mem::size_of::<LoweredExpr>() <= 24);
+        assert!(std::mem::size_of::<LoweredStmt>() <= 24);
+        assert_eq!(std::mem::size_of::<ExprId>(), 4);
+    }
+
+    #[test]
+    fn test_minimal_program() {
+        let mut program = LoweredProgram::default();
+        let text = program.names.intern("hi");
+        let print = program.names.intern("print");
+        let literal = program.add_expr(LoweredExpr::Literal(Literal::String(text)), None);
+        let args = LoweredProgram::push_list(&mut program.expr_lists, [literal]);
+        let call = program.add_expr(
+            LoweredExpr::Call {
+                callee: print,
+                args,
+            },
+            None,
+        );
+        let stmt = program.add_stmt(LoweredStmt::ExprStmt(call));
+        program.entry = LoweredProgram::push_list(&mut program.stmt_lists, [stmt]);
+
+        let entry = program.stmt_list(program.entry);
+        assert_eq!(entry, &[stmt]);
+        let LoweredStmt::ExprStmt(call) = *program.stmt(entry[0]) else {
+            panic!("expected an expression statement");
+        };
+        let LoweredExpr::Call { callee, args } = *program.expr(call) else {
+            panic!("expected a call");
+        };
+        assert_eq!(program.name(callee), "print");
+        assert_eq!(program.expr_list(args), &[literal]);
+    }
+}
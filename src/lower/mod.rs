@@ -0,0 +1,472 @@
+// Lowering module - translates a typed `AnalysisOutput` into the lowered IR
+//
+// The lowered IR (`ir.rs`) is where the passes between analysis and code
+// generation run: specialization, escape analysis, drop and copy insertion
+// and their elision (see todo.md). It keeps only what those passes need: resolved types on every
+// expression, functions lifted out of their enclosing scopes, and pipes
+// desugared into calls.
+//
+// Lowering is run by `suru lower`, which prints the result.
+
+mod copy;
+mod drop_insertion;
+mod dump;
+mod elision;
+mod escape;
+mod heap_analysis;
+mod ir;
+mod sharing;
+mod specialization;
+mod translate;
+
+pub use dump::dump;
+pub use heap_analysis::is_heap_type;
+pub use ir::*;
+pub use sharing::{Layout, LayoutClass, layout_of};
+pub use specialization::{SpecId, SpecKey, SpecTable, mangled_name};
+
+use crate::ast::Ast;
+use crate::semantic::AnalysisOutput;
+use crate::stats::Profile;
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct LoweringError {
+    pub message: String,
+    /// Source position; 0 when the error is not tied to a node
+    pub line: usize,
+    pub column: usize,
+}
+
+impl LoweringError {
+    /// Error positioned at the first token of `node_idx`'s subtree
+    pub fn at_node(message: String, ast: &Ast, node_idx: usize) -> Self {
+        let mut stack = vec![node_idx];
+        while let Some(idx) = stack.pop() {
+            if let Some(token) = &ast.nodes[idx].token {
+                return LoweringError {
+                    message,
+                    line: token.line,
+                    column: token.column,
+                };
+            }
+            let mut children: Vec<usize> = ast.children(idx).collect();
+            children.reverse();
+            stack.extend(children);
+        }
+        LoweringError {
+            message,
+            line: 0,
+            column: 0,
+        }
+    }
+}
+
+impl std::fmt::Display for LoweringError {
+    fn fmt(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
+        if self.line == 0 {
+            write!(f, "Lowering error: {}", self.message)
+        } else {
+            write!(
+                f,
+                "Lowering error at {}:{}: {}",
+                self.line, self.column, self.message
+            )
+        }
+    }
+}
+
+impl std::error::Error for LoweringError {}
+
+#[derive(Debug, Clone, Default)]
+pub struct LowerOptions {
+    /// Emit one body for specializations of a generic function whose type
+    /// arguments have the same layout, instead of one per type
+    pub share_generics: bool,
+}
+
+/// Lowers an analyzed program and specializes its functions
+pub fn lower(output: &AnalysisOutput) -> Result<LoweredProgram, LoweringError> {
+    lower_profiled(output, &LowerOptions::default(), &mut Profile::default())
+}
+
+/// Lowers and specializes, timing each pass into `profile`
+pub fn lower_profiled(
+    output: &AnalysisOutput,
+    options: &LowerOptions,
+    profile: &mut Profile,
+) -> Result<LoweredProgram, LoweringError> {
+    let mut program = profile.time("lower", || {
+        let mut translator = translate::Translator::new(output);
+        translator.program().map(|()| translator.finish())
+    })?;
+    profile.time("specialize", || {
+        specialization::specialize(&mut program, output)
+    })?;
+    profile.time("escape analysis", || {
+        escape::stack_allocate(&mut program, output)
+    });
+    profile.time("drop insertion", || {
+        drop_insertion::insert_drops(&mut program, output)
+    });
+    profile.time("copy insertion", || {
+        copy::insert_copies(&mut program, output)
+    });
+    profile.time("drop elision", || elision::elide(&mut program));
+    if options.share_generics {
+        profile.time("share generics", || {
+            sharing::share_generics(&mut program, output)
+        });
+    }
+    Ok(program)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::limits::CompilerLimits;
+    use crate::parser::parse;
+    use crate::semantic::SemanticAnalyzer;
+
+    fn lower_source(source: &str) -> (AnalysisOutput, Result<LoweredProgram, LoweringError>) {
+        let limits = CompilerLimits::default();
+        let tokens = lex(source, &limits).unwrap();
+        let ast = parse(tokens, &limits).unwrap();
+        let output = match SemanticAnalyzer::new(ast).analyze_with_types() {
+            Ok(output) => output,
+            Err(e) => panic!("analysis failed: {:?}", e.errors),
+        };
+        let lowered = lower(&output);
+        (output, lowered)
+    }
+
+    fn lowered_text(source: &str) -> String {
+        let (output, lowered) = lower_source(source);
+        match lowered {
+            Ok(program) => dump(&program, &output.type_registry),
+            Err(e) => panic!("lowering failed: {}", e),
+        }
+    }
+
+    #[test]
+    fn test_lower_functions_and_entry() {
+        let text = lowered_text(
+            "greet: (name String) String {\n    message: name\n    return message\n}\n\
+             count: () Number {\n    return 3\n}\n\
+             greeting: greet(\"Ada\")\nprint(greeting)\n",
+        );
+        assert_eq!(
+            text,
+            "fn greet(name: String [ref heap]) -> String\n\
+             \x20 let message: String [heap] = copy(name)\n\
+             \x20 return message\n\
+             fn count() -> Number\n\
+             \x20 return 3\n\
+             fn greet__o(name: String [own heap]) -> String\n\
+             \x20 let message: String [heap] = name\n\
+             \x20 return message\n\
+             entry\n\
+             \x20 let greeting: String [heap] = greet__o(\"Ada\")\n\
+             \x20 print(greeting)\n"
+        );
+    }
+
+    #[test]
+    fn test_lower_nested_functions_and_methods() {
+        let (output, lowered) = lower_source(
+            "outer: () Number {\n    inner: () Number {\n        return 1\n    }\n    \
+             n: inner()\n    return n\n}\n\
+             p: {\n    x: 1\n    getx: () Number {\n        return this.x\n    }\n}\n",
+        );
+        let program = lowered.unwrap();
+        let names: Vec<&str> = program
+            .functions
+            .iter()
+            .map(|f| program.name(f.name))
+            .collect();
+        assert_eq!(names, ["outer", "p.getx", "outer.inner"]);
+        let method = &program.functions[1];
+        let this_type = method.this_type.expect("methods have a this type");
+        assert!(matches!(
+            output.resolve(this_type),
+            crate::semantic::Type::Struct(_)
+        ));
+        // Function bodies hold only their own statements
+        assert_eq!(program.stmt_list(program.functions[0].body).len(), 2);
+    }
+
+    #[test]
+    fn test_lower_pipes_to_calls() {
+        let text = lowered_text(
+            "double: (n Number) Number {\n    return n\n}\n\
+             add: (a Number, b Number) Number {\n    return a\n}\n\
+             x: 2 | double\ny: 2 | add(1, _)\n",
+        );
+        assert!(text.contains("let x: Number = double(2)\n"), "{}", text);
+        assert!(text.contains("let y: Number = add(1, 2)\n"), "{}", text);
+    }
+
+    #[test]
+    fn test_lower_match_patterns() {
+        let text = lowered_text(
+            "type Ok\ntype Failed\ntype Status: Ok, Failed\n\
+             describe: (s Status) String {\n    return match s {\n        Ok: \"ok\"\n        \
+             _: \"failed\"\n    }\n}\n",
+        );
+        assert!(
+            text.contains("return match s { Ok: \"ok\" _: \"failed\" }\n"),
+            "{}",
+            text
+        );
+        assert!(
+            text.contains("fn describe(s: Ok | Failed [ref])"),
+            "{}",
+            text
+        );
+    }
+
+    #[test]
+    fn test_specialize_generic_instantiations_once() {
+        let text = lowered_text(
+            "pick<T>: (a T, b T) T {\n    c: a\n    return c\n}\n\
+             twice<T>: (v T) T {\n    r: pick(v, v)\n    return r\n}\n\
+             n: twice(1)\nm: twice(2)\ns: twice(\"x\")\n",
+        );
+        assert_eq!(
+            text,
+            "fn twice__Number(v: Number [ref]) -> Number\n\
+             \x20 let r: Number = pick__Number(v, v)\n\
+             \x20 return r\n\
+             fn twice__String__o(v: String [own heap]) -> String\n\
+             \x20 let r: String [heap] = pick__String(v, v)\n\
+             \x20 drop v\n\
+             \x20 return r\n\
+             fn pick__Number(a: Number [ref], b: Number [ref]) -> Number\n\
+             \x20 let c: Number = a\n\
+             \x20 return c\n\
+             fn pick__String(a: String [ref heap], b: String [ref heap]) -> String\n\
+             \x20 let c: String [heap] = copy(a)\n\
+             \x20 return c\n\
+             entry\n\
+             \x20 let n: Number = twice__Number(1)\n\
+             \x20 let m: Number = twice__Number(2)\n\
+             \x20 let s: String [heap] = twice__String__o(\"x\")\n"
+        );
+    }
+
+    #[test]
+    fn test_specialize_recursion_terminates() {
+        let (_, lowered) = lower_source("spin<T>: (v T) T {\n    return spin(v)\n}\nn: spin(1)\n");
+        let program = lowered.unwrap();
+        assert_eq!(program.functions.len(), 1);
+        assert_eq!(program.specializations.len(), 1);
+        assert_eq!(program.name(program.functions[0].name), "spin__Number");
+    }
+
+    #[test]
+    fn test_specialize_moves_last_use() {
+        let text = lowered_text(
+            "greet: (name String) String {\n    return name\n}\n\
+             main: () {\n    s: greet(\"hi\")\n    a: greet(s)\n    b: greet(s)\n    print(a)\n}\n\
+             g: \"global\"\nc: greet(g)\n",
+        );
+        assert!(
+            text.contains("let a: String [heap] = greet(s)\n"),
+            "{}",
+            text
+        );
+        assert!(
+            text.contains("let b: String [heap] = greet__o(s)\n"),
+            "{}",
+            text
+        );
+        assert!(
+            text.contains("fn greet__o(name: String [own heap])"),
+            "{}",
+            text
+        );
+        // Globals are read by functions, so never moved
+        assert!(
+            text.contains("let c: String [heap] = greet(g)\n"),
+            "{}",
+            text
+        );
+    }
+
+    #[test]
+    fn test_escape_stack_allocates_local_literals() {
+        let text = lowered_text(
+            "type Box: {\n    w Number\n}\n\
+             width: (b Box) Number {\n    return b.w\n}\n\
+             main: () Number {\n    b Box: { w: 2 }\n    label: \"box\"\n    print(label)\n    \
+             return width(b)\n}\n",
+        );
+        // The move into `width` at the last use becomes a borrow, and the
+        // drop runs after the return value is computed
+        assert!(
+            text.contains(
+                "fn main() -> Number\n\
+                 \x20 let b: { w: Number } [stack] = { w: 2 }\n\
+                 \x20 let label: String [stack] = \"box\"\n\
+                 \x20 print(label)\n\
+                 \x20 drop label\n\
+                 \x20 let $ret: Number = width(b)\n\
+                 \x20 drop b\n\
+                 \x20 return $ret\n"
+            ),
+            "{}",
+            text
+        );
+    }
+
+    #[test]
+    fn test_escape_keeps_escaping_values_on_heap() {
+        let text = lowered_text(
+            "type Box: {\n    w Number\n}\n\
+             type Pair: {\n    name String\n}\n\
+             pass<T>: (v T) T {\n    return v\n}\n\
+             make: () Box {\n    m Box: { w: 1 }\n    return m\n}\n\
+             wrap: () Pair {\n    s: \"x\"\n    p Pair: { name: s }\n    return p\n}\n\
+             keep: () {\n    k: \"y\"\n    q Pair: { name: k }\n    print(q.name)\n}\n\
+             give: () Box {\n    g Box: { w: 3 }\n    return pass(g)\n}\n",
+        );
+        for heap in ["let m", "let s", "let k", "let g"] {
+            assert!(text.contains(&format!("{}: ", heap)), "{}", text);
+            assert!(!text.contains(&format!("{} [stack]", heap)), "{}", text);
+        }
+        // A struct holding a field can itself stay local
+        assert!(text.contains("let q: { name: String } [stack]"), "{}", text);
+        assert!(text.contains("print(q.name)\n  drop q\n"), "{}", text);
+        // `pass` has no borrowing variant to redirect the move to
+        assert!(text.contains("return pass___w_Number___o(g)\n"), "{}", text);
+    }
+
+    #[test]
+    fn test_insert_and_elide_copies_and_drops() {
+        let text = lowered_text(
+            "type Pair: {\n    name String\n}\n\
+             name: (p Pair) String {\n    return p.name\n}\n\
+             pair: (flag Bool) Pair {\n    s: name({ name: \"x\" })\n    \
+             c: match flag {\n        true: s\n        _: \"none\"\n    }\n    \
+             print(c)\n    c: \"done\"\n    print(c)\n    a Pair: { name: s }\n    \
+             return a\n}\n\
+             grow: () String {\n    t: \"a\"\n    t: name({ name: t })\n    return t\n}\n",
+        );
+        // The copy in a match arm stays and so does the drop of `s` it would
+        // have removed; the copy at the struct, its last use, becomes a move.
+        // `c` is dropped before it is redeclared and once more at the exit.
+        assert!(
+            text.contains(
+                "fn pair(flag: Bool [ref]) -> { name: String }\n\
+                 \x20 let s: String [heap] = name__o({ name: \"x\" })\n\
+                 \x20 let c: String [heap] = match flag { true: copy(s) _: \"none\" }\n\
+                 \x20 print(c)\n\
+                 \x20 drop c\n\
+                 \x20 let c: String [heap] = \"done\"\n\
+                 \x20 print(c)\n\
+                 \x20 let a: { name: String } [heap] = { name: s }\n\
+                 \x20 drop c\n\
+                 \x20 return a\n"
+            ),
+            "{}",
+            text
+        );
+        // A borrowed field is copied out; an owned parameter is dropped
+        // after the return value is computed
+        assert!(
+            text.contains(
+                "fn name(p: { name: String } [ref heap]) -> String\n  return copy(p.name)\n"
+            ),
+            "{}",
+            text
+        );
+        assert!(
+            text.contains(
+                "fn name__o(p: { name: String } [own heap]) -> String\n\
+                 \x20 let $ret: String [heap] = copy(p.name)\n\
+                 \x20 drop p\n\
+                 \x20 return $ret\n"
+            ),
+            "{}",
+            text
+        );
+        // A redeclaration reading the old value computes the new one first;
+        // the old value moves into it, so its drop goes
+        assert!(
+            text.contains(
+                "\x20 let $t.1: String [heap] = name__o({ name: t })\n\
+                 \x20 let t: String [heap] = $t.1\n\
+                 \x20 return t\n"
+            ),
+            "{}",
+            text
+        );
+    }
+
+    fn shared_text(source: &str) -> String {
+        let (output, _) = lower_source(source);
+        let options = LowerOptions {
+            share_generics: true,
+        };
+        match lower_profiled(&output, &options, &mut Profile::default()) {
+            Ok(program) => dump(&program, &output.type_registry),
+            Err(e) => panic!("lowering failed: {}", e),
+        }
+    }
+
+    #[test]
+    fn test_share_generics_merges_layout_identical() {
+        // Borrowed values are only read, so strings and structs share a body
+        let text = shared_text(
+            "first<T>: (a T, b T) Number {\n    return 1\n}\n\
+             twice<T>: (v T) Number {\n    return first(v, v)\n}\n\
+             s: \"x\"\np: { x: 1 }\nn: twice(1)\nm: twice(s)\nk: twice(p)\n",
+        );
+        assert_eq!(
+            text,
+            "fn twice__Number(v: Number [ref]) -> Number\n\
+             \x20 return first__Number(v, v)\n\
+             fn twice__box(v: String [ref heap]) -> Number\n\
+             \x20 return first__box(v, v)\n\
+             fn first__Number(a: Number [ref], b: Number [ref]) -> Number\n\
+             \x20 return 1\n\
+             fn first__box(a: String [ref heap], b: String [ref heap]) -> Number\n\
+             \x20 return 1\n\
+             entry\n\
+             \x20 let s: String [heap] = \"x\"\n\
+             \x20 let p: { x: Number } [heap] = { x: 1 }\n\
+             \x20 let n: Number = twice__Number(1)\n\
+             \x20 let m: Number = twice__box(s)\n\
+             \x20 let k: Number = twice__box(p)\n"
+        );
+
+        // Copying or dropping a value depends on its type, so those do not
+        let text = shared_text(
+            "pick<T>: (a T, b T) T {\n    return a\n}\n\
+             s: pick(\"x\", \"y\")\np: pick({ x: 1 }, { x: 2 })\n",
+        );
+        assert!(text.contains("fn pick__String__oo("), "{}", text);
+        assert!(!text.contains("box"), "{}", text);
+    }
+
+    #[test]
+    fn test_share_generics_keeps_type_dependent_bodies() {
+        // `print` is chosen by its argument's type, so the bodies differ
+        let text = shared_text(
+            "show<T>: (v T) T {\n    print(v)\n    return v\n}\n\
+             a: show(\"x\")\nb: show({ x: 1 })\n",
+        );
+        assert!(text.contains("fn show__String__o("), "{}", text);
+        assert!(text.contains("fn show___x_Number___o("), "{}", text);
+        assert!(!text.contains("box"), "{}", text);
+    }
+
+    #[test]
+    fn test_lower_reports_unsupported_expressions() {
+        let (_, lowered) =
+            lower_source("add: (a Number, b Number) Number {\n    return a\n}\nf: add(1, _)\n");
+        let error = lowered.unwrap_err();
+        assert!(error.message.contains("Partial application"), "{}", error);
+        assert_eq!(error.line, 4);
+    }
+}
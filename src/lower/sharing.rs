@@ -0,0 +1,665 @@
+// Generic sharing - one body for specializations whose machine code is the same
+//
+// Full monomorphization copies a generic function per type argument, yet
+// `first<String>` and `first<Point>` differ only in which pointer they read.
+// Sharing groups a function's specializations by the `Layout` of their type
+// arguments and their pass modes, then splits each group until its members'
+// bodies match node for node, with types compared by layout except where the
+// type decides the code (field and method lookups, struct and list
+// construction, built-in calls, copies and drops), which must be identical.
+// Calls compare equal when they reach the same group, so groups are refined
+// until no member differs from its group's first, which keeps its body under
+// a layout-mangled name (`pick__box`); calls to the others are redirected.
+//
+// Off by default: `suru lower --share-generics` runs it, so full
+// monomorphization stays available to compare against.
+//
+// Only the lowered IR is shared. Code generation compiles from the AST and
+// rejects generic functions, so no executable changes yet; the compile-time
+// and instruction-cache savings wait for generic code generation that emits
+// one LLVM function per group.
+
+use std::collections::{HashMap, VecDeque};
+
+use super::ir::*;
+use super::specialization::push_pass_modes;
+use crate::semantic::{AnalysisOutput, FloatSize, IntSize, Type, TypeId, UIntSize};
+use crate::string_storage::StringId;
+
+/// How a value is passed in registers
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum LayoutClass {
+    Int,
+    Float,
+    Bool,
+    Pointer,
+}
+
+/// Machine representation of a value, as code generation lays it out
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct Layout {
+    pub size: u8,
+    pub align: u8,
+    pub class: LayoutClass,
+    /// The pointee is owned and must be dropped (strings, structs)
+    pub needs_drop: bool,
+}
+
+impl Layout {
+    const fn scalar(size: u8, class: LayoutClass) -> Self {
+        Layout {
+            size,
+            align: size,
+            class,
+            needs_drop: false,
+        }
+    }
+
+    /// Short name used in shared function names: `i64`, `f64`, `bool`, and
+    /// `ptr` or, when owned, `box`
+    fn code(&self) -> String {
+        match self.class {
+            LayoutClass::Int => format!("i{}", self.size as u32 * 8),
+            LayoutClass::Float => format!("f{}", self.size as u32 * 8),
+            LayoutClass::Bool => "bool".to_string(),
+            LayoutClass::Pointer if self.needs_drop => "box".to_string(),
+            LayoutClass::Pointer => "ptr".to_string(),
+        }
+    }
+}
+
+/// Layout of values of `ty`; None for Void and for types code generation
+/// does not lower yet, which are never shared
+pub fn layout_of(ty: TypeId, output: &AnalysisOutput) -> Option<Layout> {
+    use LayoutClass::*;
+    let layout = match output.resolve(ty) {
+        Type::Number => Layout::scalar(8, Float),
+        Type::Float(FloatSize::F32) => Layout::scalar(4, Float),
+        Type::Float(FloatSize::F64) => Layout::scalar(8, Float),
+        Type::Bool => Layout::scalar(1, Bool),
+        Type::Int(IntSize::I8) | Type::UInt(UIntSize::U8) => Layout::scalar(1, Int),
+        Type::Int(IntSize::I16) | Type::UInt(UIntSize::U16) => Layout::scalar(2, Int),
+        Type::Int(IntSize::I32) | Type::UInt(UIntSize::U32) => Layout::scalar(4, Int),
+        Type::Int(IntSize::I64) | Type::UInt(UIntSize::U64) => Layout::scalar(8, Int),
+        Type::NamedUnit(_) => Layout::scalar(8, Int),
+        Type::Union(members)
+            if members
+                .iter()
+                .all(|m| matches!(output.resolve(*m), Type::NamedUnit(_))) =>
+        {
+            Layout::scalar(8, Int)
+        }
+        Type::Function(_) => Layout::scalar(8, Pointer),
+        Type::String | Type::Struct(_) => Layout {
+            needs_drop: true,
+            ..Layout::scalar(8, Pointer)
+        },
+        _ => return None,
+    };
+    Some(layout)
+}
+
+/// What must match for two specializations to start in the same group
+#[derive(PartialEq, Eq, Hash)]
+struct Signature {
+    base: StringId,
+    layouts: Vec<Layout>,
+    pass_modes: u64,
+}
+
+/// Merges layout-identical specializations of each generic function,
+/// returning how many bodies were removed
+pub fn share_generics(program: &mut LoweredProgram, output: &AnalysisOutput) -> usize {
+    let count = program.functions.len();
+    let mut classes: Vec<u32> = Vec::with_capacity(count);
+    let mut signatures: HashMap<Signature, u32> = HashMap::new();
+    let mut next_class = 0u32;
+    for function in &program.functions {
+        let signature = function.spec.and_then(|id| {
+            let key = program.specializations.key(id);
+            if key.type_args.is_empty() {
+                return None;
+            }
+            let layouts = key
+                .type_args
+                .iter()
+                .map(|ty| layout_of(*ty, output))
+                .collect::<Option<Vec<_>>>()?;
+            Some(Signature {
+                base: key.base,
+                layouts,
+                pass_modes: key.pass_modes,
+            })
+        });
+        classes.push(match signature {
+            Some(signature) => *signatures
+                .entry(signature)
+                .or_insert_with(|| fresh(&mut next_class)),
+            None => fresh(&mut next_class),
+        });
+    }
+
+    let by_name: HashMap<StringId, usize> = program
+        .functions
+        .iter()
+        .enumerate()
+        .map(|(i, f)| (f.name, i))
+        .collect();
+
+    let mut callers: Vec<Vec<usize>> = vec![Vec::new(); count];
+    for (i, function) in program.functions.iter().enumerate() {
+        for callee in callees(program, function, &by_name) {
+            callers[callee].push(i);
+        }
+    }
+
+    // Split groups whose members differ from their first; a split can make
+    // the callers of the split members differ, so their groups are rechecked
+    let mut members: Vec<Vec<usize>> = vec![Vec::new(); next_class as usize];
+    for (i, class) in classes.iter().enumerate() {
+        members[*class as usize].push(i);
+    }
+    let mut pending: VecDeque<u32> = (0..next_class)
+        .filter(|class| members[*class as usize].len() > 1)
+        .collect();
+    let mut queued = vec![true; next_class as usize];
+    while let Some(class) = pending.pop_front() {
+        queued[class as usize] = false;
+        let group = std::mem::take(&mut members[class as usize]);
+        let (first, rest) = match group.split_first() {
+            Some((first, rest)) if !rest.is_empty() => (*first, rest),
+            _ => {
+                members[class as usize] = group;
+                continue;
+            }
+        };
+        let (mut same, mut split) = (vec![first], Vec::new());
+        for &member in rest {
+            let mut compare = Compare {
+                program,
+                output,
+                classes: &classes,
+                by_name: &by_name,
+                types: (HashMap::new(), HashMap::new()),
+            };
+            if compare.functions(first, member) {
+                same.push(member);
+            } else {
+                split.push(member);
+            }
+        }
+        if split.is_empty() {
+            members[class as usize] = same;
+            continue;
+        }
+        let new_class = fresh(&mut next_class);
+        for member in &split {
+            classes[*member] = new_class;
+        }
+        members.push(split);
+        queued.push(false);
+        members[class as usize] = same;
+        let mut recheck = vec![class, new_class];
+        for member in &group {
+            recheck.extend(callers[*member].iter().map(|caller| classes[*caller]));
+        }
+        for class in recheck {
+            if !queued[class as usize] && members[class as usize].len() > 1 {
+                queued[class as usize] = true;
+                pending.push_back(class);
+            }
+        }
+    }
+
+    // The first of each group keeps its body under the shared name
+    let mut representative: Vec<Option<usize>> = vec![None; next_class as usize];
+    let mut renamed: HashMap<StringId, StringId> = HashMap::new();
+    let mut taken: HashMap<String, usize> = HashMap::new();
+    let mut remap: Vec<u32> = Vec::with_capacity(count);
+    let mut kept = 0u32;
+    for (i, class) in classes.iter().enumerate() {
+        match representative[*class as usize] {
+            Some(first) => remap.push(remap[first]),
+            None => {
+                representative[*class as usize] = Some(i);
+                remap.push(kept);
+                kept += 1;
+            }
+        }
+    }
+    for (i, class) in classes.iter().enumerate() {
+        if members[*class as usize].len() < 2 {
+            continue;
+        }
+        let first = representative[*class as usize].unwrap_or(i);
+        let shared = match renamed.get(&program.functions[first].name) {
+            Some(name) => *name,
+            None => {
+                // Groups split apart share a signature, so number repeats
+                let mut name = shared_name(program, first, output);
+                let seen = taken.entry(name.clone()).or_insert(0);
+                *seen += 1;
+                if *seen > 1 {
+                    name = format!("{}.{}", name, seen);
+                }
+                program.names.intern(&name)
+            }
+        };
+        renamed.insert(program.functions[i].name, shared);
+    }
+
+    let removed = count - kept as usize;
+    if removed == 0 {
+        return 0;
+    }
+    let functions = std::mem::take(&mut program.functions);
+    program.functions = functions
+        .into_iter()
+        .enumerate()
+        .filter(|(i, _)| representative[classes[*i] as usize] == Some(*i))
+        .map(|(_, mut function)| {
+            if let Some(name) = renamed.get(&function.name) {
+                function.name = *name;
+            }
+            function
+        })
+        .collect();
+    for expr in &mut program.exprs {
+        if let LoweredExpr::Call { callee, .. } = expr
+            && let Some(name) = renamed.get(callee)
+        {
+            *callee = *name;
+        }
+    }
+    for (_, function) in &mut program.method_inits {
+        if let Some(index) = remap.get(function.0 as usize) {
+            *function = FunctionId(*index);
+        }
+    }
+    removed
+}
+
+/// Base name, then `__` and the type arguments' layout codes, then the pass
+/// modes as `mangled_name` writes them (`pick__box`, `twice__f64__o`)
+fn shared_name(program: &LoweredProgram, function: usize, output: &AnalysisOutput) -> String {
+    let key = program.specializations.key(
+        program.functions[function]
+            .spec
+            .expect("shared functions are specialized"),
+    );
+    let mut name = program.name(key.base).to_string();
+    for (i, ty) in key.type_args.iter().enumerate() {
+        name.push_str(if i == 0 { "__" } else { "_" });
+        if let Some(layout) = layout_of(*ty, output) {
+            name.push_str(&layout.code());
+        }
+    }
+    push_pass_modes(&mut name, key.pass_modes);
+    name
+}
+
+/// Functions `function` calls or takes methods from
+fn callees(
+    program: &LoweredProgram,
+    function: &LoweredFunction,
+    by_name: &HashMap<StringId, usize>,
+) -> Vec<usize> {
+    let mut found = Vec::new();
+    let mut exprs = Vec::new();
+    for stmt in program.stmt_list(function.body) {
+        match *program.stmt(*stmt) {
+            LoweredStmt::VarDecl { value, .. } | LoweredStmt::Assign { value, .. } => {
+                exprs.push(value)
+            }
+            LoweredStmt::FieldAssign {
+                receiver, value, ..
+            } => exprs.extend([receiver, value]),
+            LoweredStmt::ExprStmt(expr) | LoweredStmt::Return(Some(expr)) => exprs.push(expr),
+            LoweredStmt::Return(None) | LoweredStmt::Drop(_) => {}
+        }
+    }
+    while let Some(expr) = exprs.pop() {
+        match *program.expr(expr) {
+            LoweredExpr::Literal(_) | LoweredExpr::Identifier(_) | LoweredExpr::This => {}
+            LoweredExpr::Call { callee, args } => {
+                found.extend(by_name.get(&callee));
+                exprs.extend(program.expr_list(args));
+            }
+            LoweredExpr::CallValue { callee, args } => {
+                exprs.push(callee);
+                exprs.extend(program.expr_list(args));
+            }
+            LoweredExpr::MethodCall { receiver, args, .. } => {
+                exprs.push(receiver);
+                exprs.extend(program.expr_list(args));
+            }
+            LoweredExpr::FieldAccess { receiver, .. } => exprs.push(receiver),
+            LoweredExpr::StructInit { fields, methods } => {
+                exprs.extend(
+                    program.field_inits[fields.indices()]
+                        .iter()
+                        .map(|(_, v)| *v),
+                );
+                found.extend(
+                    program.method_inits[methods.indices()]
+                        .iter()
+                        .map(|(_, f)| f.0 as usize),
+                );
+            }
+            LoweredExpr::List { elements } => exprs.extend(program.expr_list(elements)),
+            LoweredExpr::Match { subject, arms } => {
+                exprs.push(subject);
+                exprs.extend(program.match_arms[arms.indices()].iter().map(|a| a.result));
+            }
+            LoweredExpr::BoolOp { lhs, rhs, .. } => exprs.extend([lhs, rhs]),
+            LoweredExpr::Not(operand)
+            | LoweredExpr::Negate(operand)
+            | LoweredExpr::Copy(operand) => exprs.push(operand),
+        }
+    }
+    found
+}
+
+fn fresh(next_class: &mut u32) -> u32 {
+    *next_class += 1;
+    *next_class - 1
+}
+
+/// Structural comparison of two function bodies under the current groups
+struct Compare<'a> {
+    program: &'a LoweredProgram,
+    output: &'a AnalysisOutput,
+    classes: &'a [u32],
+    by_name: &'a HashMap<StringId, usize>,
+    /// Types of the variables in scope on each side, for drops
+    types: (HashMap<StringId, TypeId>, HashMap<StringId, TypeId>),
+}
+
+impl Compare<'_> {
+    /// Same machine representation
+    fn same_layout(&self, a: Option<TypeId>, b: Option<TypeId>) -> bool {
+        a == b
+            || match (a, b) {
+                (Some(a), Some(b)) => {
+                    let layout = layout_of(a, self.output);
+                    layout.is_some() && layout == layout_of(b, self.output)
+                }
+                _ => false,
+            }
+    }
+
+    /// Same type, for operations whose code depends on it
+    fn same_type(&self, a: Option<TypeId>, b: Option<TypeId>) -> bool {
+        a == b
+            || match (a, b) {
+                (Some(a), Some(b)) => self.output.resolve(a) == self.output.resolve(b),
+                _ => false,
+            }
+    }
+
+    fn functions(&mut self, a: usize, b: usize) -> bool {
+        let program = self.program;
+        let (fa, fb) = (&program.functions[a], &program.functions[b]);
+        let (pa, pb) = (program.params_of(fa), program.params_of(fb));
+        if pa.len() != pb.len()
+            || fa.this_type != fb.this_type
+            || !self.same_layout(fa.return_type, fb.return_type)
+        {
+            return false;
+        }
+        for (x, y) in pa.iter().zip(pb) {
+            if x.name != y.name
+                || x.pass_mode != y.pass_mode
+                || x.is_heap != y.is_heap
+                || !self.same_layout(Some(x.ty), Some(y.ty))
+            {
+                return false;
+            }
+            self.types.0.insert(x.name, x.ty);
+            self.types.1.insert(y.name, y.ty);
+        }
+        self.blocks(fa.body, fb.body)
+    }
+
+    fn blocks(&mut self, a: ListRange, b: ListRange) -> bool {
+        let program = self.program;
+        let (a, b) = (program.stmt_list(a), program.stmt_list(b));
+        a.len() == b.len() && a.iter().zip(b).all(|(x, y)| self.stmt(*x, *y))
+    }
+
+    fn stmt(&mut self, a: StmtId, b: StmtId) -> bool {
+        let program = self.program;
+        match (*program.stmt(a), *program.stmt(b)) {
+            (
+                LoweredStmt::VarDecl {
+                    name,
+                    value,
+                    is_heap,
+                    on_stack,
+                },
+                LoweredStmt::VarDecl {
+                    name: name_b,
+                    value: value_b,
+                    is_heap: is_heap_b,
+                    on_stack: on_stack_b,
+                },
+            ) => {
+                let same = name == name_b
+                    && is_heap == is_heap_b
+                    && on_stack == on_stack_b
+                    && self.expr(value, value_b);
+                if let (Some(x), Some(y)) = (program.expr_type(value), program.expr_type(value_b)) {
+                    self.types.0.insert(name, x);
+                    self.types.1.insert(name_b, y);
+                }
+                same
+            }
+            (
+                LoweredStmt::Assign { name, value },
+                LoweredStmt::Assign {
+                    name: name_b,
+                    value: value_b,
+                },
+            ) => name == name_b && self.expr(value, value_b),
+            (
+                LoweredStmt::FieldAssign {
+                    receiver,
+                    field,
+                    value,
+                },
+                LoweredStmt::FieldAssign {
+                    receiver: receiver_b,
+                    field: field_b,
+                    value: value_b,
+                },
+            ) => {
+                field == field_b && self.receiver(receiver, receiver_b) && self.expr(value, value_b)
+            }
+            (LoweredStmt::ExprStmt(x), LoweredStmt::ExprStmt(y)) => self.expr(x, y),
+            (LoweredStmt::Return(None), LoweredStmt::Return(None)) => true,
+            (LoweredStmt::Return(Some(x)), LoweredStmt::Return(Some(y))) => self.expr(x, y),
+            (LoweredStmt::Drop(x), LoweredStmt::Drop(y)) => {
+                x == y
+                    && self.same_type(self.types.0.get(&x).copied(), self.types.1.get(&y).copied())
+            }
+            _ => false,
+        }
+    }
+
+    fn lists(&mut self, a: ListRange, b: ListRange) -> bool {
+        let program = self.program;
+        let (a, b) = (program.expr_list(a), program.expr_list(b));
+        a.len() == b.len() && a.iter().zip(b).all(|(x, y)| self.expr(*x, *y))
+    }
+
+    /// An expression whose type selects a field or method
+    fn receiver(&mut self, a: ExprId, b: ExprId) -> bool {
+        let program = self.program;
+        self.same_type(program.expr_type(a), program.expr_type(b)) && self.expr(a, b)
+    }
+
+    /// Calls reach the same group, or the same built-in with the same types
+    fn callees(&self, a: StringId, b: StringId, args: (ListRange, ListRange)) -> bool {
+        match (self.by_name.get(&a), self.by_name.get(&b)) {
+            (Some(x), Some(y)) => self.classes[*x] == self.classes[*y],
+            (None, None) => {
+                let program = self.program;
+                let (xs, ys) = (program.expr_list(args.0), program.expr_list(args.1));
+                a == b
+                    && xs.len() == ys.len()
+                    && xs
+                        .iter()
+                        .zip(ys)
+                        .all(|(x, y)| self.same_type(program.expr_type(*x), program.expr_type(*y)))
+            }
+            _ => false,
+        }
+    }
+
+    fn expr(&mut self, a: ExprId, b: ExprId) -> bool {
+        let program = self.program;
+        let (ta, tb) = (program.expr_type(a), program.expr_type(b));
+        if !self.same_layout(ta, tb) {
+            return false;
+        }
+        match (*program.expr(a), *program.expr(b)) {
+            (LoweredExpr::Literal(x), LoweredExpr::Literal(y)) => x == y,
+            (LoweredExpr::Identifier(x), LoweredExpr::Identifier(y)) => x == y,
+            (LoweredExpr::This, LoweredExpr::This) => true,
+            (
+                LoweredExpr::Call { callee, args },
+                LoweredExpr::Call {
+                    callee: callee_b,
+                    args: args_b,
+                },
+            ) => self.callees(callee, callee_b, (args, args_b)) && self.lists(args, args_b),
+            (
+                LoweredExpr::CallValue { callee, args },
+                LoweredExpr::CallValue {
+                    callee: callee_b,
+                    args: args_b,
+                },
+            ) => self.receiver(callee, callee_b) && self.lists(args, args_b),
+            (
+                LoweredExpr::MethodCall {
+                    receiver,
+                    method,
+                    args,
+                },
+                LoweredExpr::MethodCall {
+                    receiver: receiver_b,
+                    method: method_b,
+                    args: args_b,
+                },
+            ) => {
+                method == method_b
+                    && self.receiver(receiver, receiver_b)
+                    && self.lists(args, args_b)
+            }
+            (
+                LoweredExpr::FieldAccess { receiver, field },
+                LoweredExpr::FieldAccess {
+                    receiver: receiver_b,
+                    field: field_b,
+                },
+            ) => field == field_b && self.receiver(receiver, receiver_b),
+            (
+                LoweredExpr::StructInit { fields, methods },
+                LoweredExpr::StructInit {
+                    fields: fields_b,
+                    methods: methods_b,
+                },
+            ) => {
+                let (fx, fy) = (
+                    &program.field_inits[fields.indices()],
+                    &program.field_inits[fields_b.indices()],
+                );
+                let (mx, my) = (
+                    &program.method_inits[methods.indices()],
+                    &program.method_inits[methods_b.indices()],
+                );
+                self.same_type(ta, tb)
+                    && fx.len() == fy.len()
+                    && fx
+                        .iter()
+                        .zip(fy)
+                        .all(|((n, x), (m, y))| n == m && self.expr(*x, *y))
+                    && mx.len() == my.len()
+                    && mx.iter().zip(my).all(|((n, x), (m, y))| {
+                        n == m && self.classes[x.0 as usize] == self.classes[y.0 as usize]
+                    })
+            }
+            (
+                LoweredExpr::List { elements },
+                LoweredExpr::List {
+                    elements: elements_b,
+                },
+            ) => self.same_type(ta, tb) && self.lists(elements, elements_b),
+            (
+                LoweredExpr::Match { subject, arms },
+                LoweredExpr::Match {
+                    subject: subject_b,
+                    arms: arms_b,
+                },
+            ) => {
+                let (x, y) = (
+                    &program.match_arms[arms.indices()],
+                    &program.match_arms[arms_b.indices()],
+                );
+                self.receiver(subject, subject_b)
+                    && x.len() == y.len()
+                    && x.iter()
+                        .zip(y)
+                        .all(|(x, y)| x.pattern == y.pattern && self.expr(x.result, y.result))
+            }
+            (
+                LoweredExpr::BoolOp { op, lhs, rhs },
+                LoweredExpr::BoolOp {
+                    op: op_b,
+                    lhs: lhs_b,
+                    rhs: rhs_b,
+                },
+            ) => op == op_b && self.expr(lhs, lhs_b) && self.expr(rhs, rhs_b),
+            (LoweredExpr::Not(x), LoweredExpr::Not(y)) => self.expr(x, y),
+            (LoweredExpr::Negate(x), LoweredExpr::Negate(y))
+            | (LoweredExpr::Copy(x), LoweredExpr::Copy(y)) => self.receiver(x, y),
+            _ => false,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::limits::CompilerLimits;
+    use crate::parser::parse;
+    use crate::semantic::SemanticAnalyzer;
+
+    #[test]
+    fn test_layouts() {
+        let limits = CompilerLimits::default();
+        let ast = parse(lex("x: 1\n", &limits).unwrap(), &limits).unwrap();
+        let mut output = SemanticAnalyzer::new(ast).analyze_with_types().unwrap();
+        let registry = &mut output.type_registry;
+        let string = registry.intern(Type::String);
+        let number = registry.intern(Type::Number);
+        let i64 = registry.intern(Type::Int(IntSize::I64));
+        let u64 = registry.intern(Type::UInt(UIntSize::U64));
+        let bool = registry.intern(Type::Bool);
+        let void = registry.intern(Type::Void);
+        let point = registry.intern(Type::Struct(crate::semantic::StructType {
+            fields: Vec::new(),
+            methods: Vec::new(),
+        }));
+
+        let layout = |ty| layout_of(ty, &output);
+        assert_eq!(layout(string), layout(point));
+        assert!(layout(string).unwrap().needs_drop);
+        assert_eq!(layout(i64), layout(u64));
+        assert_ne!(layout(number), layout(i64));
+        assert_eq!(layout(bool).unwrap().code(), "bool");
+        assert_eq!(layout(string).unwrap().code(), "box");
+        assert_eq!(layout(void), None);
+    }
+}
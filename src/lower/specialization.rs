@@ -0,0 +1,769 @@
+// Specialization - one concrete copy of a function per distinct `SpecKey`
+//
+// Generic instantiation and ref/own variants are both specializations: a key
+// is the function's lowered name, its type arguments, and which parameters
+// are passed by ownership. Keys are interned in a `SpecTable`, hashed once;
+// a worklist then copies each function body exactly once per key, rewriting
+// the calls in the copy, which may discover further keys. Type arguments are
+// only ever types already in the registry, so the set of keys is finite and
+// recursion (direct or through other functions) terminates.
+//
+// Only what is reachable survives: the entry statements and every top-level
+// non-generic function are the roots; the unspecialized originals are dropped.
+
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::hash::{BuildHasherDefault, Hasher};
+
+use super::LoweringError;
+use super::heap_analysis::is_heap_type;
+use super::ir::*;
+use crate::ast::NodeType;
+use crate::semantic::{AnalysisOutput, Type, TypeId, type_to_display_string};
+use crate::stable_hash::StableHasher;
+use crate::string_storage::{StringId, StringStorage};
+
+/// A specialization request: function, type arguments and pass modes
+///
+/// Bit `i` of `pass_modes` is set when parameter `i` is passed
+/// `ByOwnership`; unset bits, and parameters past the 64th, are `ByRef`. A
+/// key of no type arguments and no set bits is the function's default.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct SpecKey<'a> {
+    pub base: StringId,
+    pub type_args: &'a [TypeId],
+    pub pass_modes: u64,
+}
+
+impl SpecKey<'_> {
+    /// Stable hash of the key's parts; computed once per lookup
+    fn hash(&self) -> u64 {
+        let mut hasher = StableHasher::new();
+        hasher.u64(self.base.index() as u64);
+        hasher.u64(self.type_args.len() as u64);
+        for ty in self.type_args {
+            hasher.u64(ty.index() as u64);
+        }
+        hasher.u64(self.pass_modes);
+        hasher.finish_u64()
+    }
+}
+
+/// Index of an interned key in its `SpecTable`
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct SpecId(pub u32);
+
+#[derive(Debug, Clone)]
+struct StoredKey {
+    base: StringId,
+    type_args: ListRange,
+    pass_modes: u64,
+    /// Lowered name of the specialized function
+    name: StringId,
+}
+
+/// Passes precomputed `SpecKey` hashes through unchanged
+#[derive(Default)]
+struct KeyHash(u64);
+
+impl Hasher for KeyHash {
+    fn write(&mut self, _bytes: &[u8]) {
+        unreachable!("only u64 key hashes are hashed");
+    }
+
+    fn write_u64(&mut self, hash: u64) {
+        self.0 = hash;
+    }
+
+    fn finish(&self) -> u64 {
+        self.0
+    }
+}
+
+/// Interned specialization keys
+///
+/// Type arguments of every key share one pool, and the index maps a key's
+/// hash to the keys with that hash, so interning a key costs one hash and
+/// a comparison of small integer slices.
+#[derive(Debug, Clone, Default)]
+pub struct SpecTable {
+    keys: Vec<StoredKey>,
+    type_args: Vec<TypeId>,
+    index: HashMap<u64, Vec<SpecId>, BuildHasherDefault<KeyHash>>,
+}
+
+impl SpecTable {
+    pub fn len(&self) -> usize {
+        self.keys.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.keys.is_empty()
+    }
+
+    pub fn get(&self, key: SpecKey) -> Option<SpecId> {
+        self.find(key, key.hash())
+    }
+
+    fn find(&self, key: SpecKey, hash: u64) -> Option<SpecId> {
+        self.index
+            .get(&hash)?
+            .iter()
+            .copied()
+            .find(|&id| self.key(id) == key)
+    }
+
+    /// Id of `key`, and whether it was new; new keys are named with
+    /// `mangled_name`
+    pub fn intern(
+        &mut self,
+        key: SpecKey,
+        names: &mut StringStorage,
+        output: &AnalysisOutput,
+    ) -> (SpecId, bool) {
+        let hash = key.hash();
+        if let Some(id) = self.find(key, hash) {
+            return (id, false);
+        }
+        let id = SpecId(self.keys.len() as u32);
+        let name = names.intern(&mangled_name(key, names, output));
+        let type_args =
+            LoweredProgram::push_list(&mut self.type_args, key.type_args.iter().copied());
+        self.keys.push(StoredKey {
+            base: key.base,
+            type_args,
+            pass_modes: key.pass_modes,
+            name,
+        });
+        self.index.entry(hash).or_default().push(id);
+        (id, true)
+    }
+
+    pub fn key(&self, id: SpecId) -> SpecKey<'_> {
+        let stored = &self.keys[id.0 as usize];
+        SpecKey {
+            base: stored.base,
+            type_args: &self.type_args[stored.type_args.indices()],
+            pass_modes: stored.pass_modes,
+        }
+    }
+
+    /// Lowered name of the function specialized for `id`
+    pub fn name(&self, id: SpecId) -> StringId {
+        self.keys[id.0 as usize].name
+    }
+
+    /// Estimated heap bytes of the keys and their index
+    pub fn heap_bytes(&self) -> usize {
+        use crate::stats::{hash_map_bytes, vec_bytes};
+        vec_bytes(&self.keys)
+            + vec_bytes(&self.type_args)
+            + hash_map_bytes(&self.index)
+            + self.index.values().map(vec_bytes).sum::<usize>()
+    }
+}
+
+/// Name of a specialized function: the base name, then `__` and the type
+/// arguments, then `__` and one `r`/`o` per parameter up to the last owned
+/// one (`pick__Number`, `greet__o`, `process__String__ro`). The default key
+/// keeps the base name.
+pub fn mangled_name(key: SpecKey, names: &StringStorage, output: &AnalysisOutput) -> String {
+    let mut name = names.resolve(key.base).to_string();
+    for (i, ty) in key.type_args.iter().enumerate() {
+        name.push_str(if i == 0 { "__" } else { "_" });
+        let text = type_to_display_string(*ty, &output.type_registry);
+        let mut last_was_separator = false;
+        for c in text.chars() {
+            let separator = !c.is_ascii_alphanumeric();
+            if !separator {
+                name.push(c);
+            } else if !last_was_separator {
+                name.push('_');
+            }
+            last_was_separator = separator;
+        }
+    }
+    push_pass_modes(&mut name, key.pass_modes);
+    name
+}
+
+/// Appends `__` and one `r`/`o` per parameter up to the last owned one
+pub(super) fn push_pass_modes(name: &mut String, pass_modes: u64) {
+    if pass_modes != 0 {
+        name.push_str("__");
+        for i in 0..64 - pass_modes.leading_zeros() {
+            name.push(if pass_modes & (1 << i) != 0 { 'o' } else { 'r' });
+        }
+    }
+}
+
+/// What a call site needs to know about the function it calls
+struct Template {
+    function: LoweredFunction,
+    /// Names of the declared type parameters
+    type_params: Vec<String>,
+    /// Per parameter, the type parameter its annotation names
+    param_vars: Vec<Option<usize>>,
+    /// The type parameter the return annotation names
+    return_var: Option<usize>,
+    /// Declared at the top level of the program
+    is_top_level: bool,
+}
+
+/// Per-body state while a body is copied
+#[derive(Default)]
+struct Scope {
+    /// Types of parameters and locals, for expressions analysis left generic
+    types: HashMap<StringId, TypeId>,
+    /// Heap locals and owned parameters, which a last use may move
+    owned: HashSet<StringId>,
+    /// False for the entry statements, whose variables are globals that
+    /// functions read, so never moved
+    has_locals: bool,
+    /// Identifier occurrences not yet copied
+    uses: HashMap<StringId, u32>,
+    /// Identifiers already passed to a call whose arguments are still being
+    /// evaluated; moving them would free a value that call still reads
+    borrowed: Vec<StringId>,
+}
+
+struct Specializer<'a> {
+    output: &'a AnalysisOutput,
+    program: &'a mut LoweredProgram,
+    templates: Vec<Template>,
+    by_name: HashMap<StringId, usize>,
+    queue: VecDeque<SpecId>,
+    functions: Vec<LoweredFunction>,
+}
+
+/// Replaces the program's functions with their reachable specializations
+pub fn specialize(
+    program: &mut LoweredProgram,
+    output: &AnalysisOutput,
+) -> Result<(), LoweringError> {
+    let originals = std::mem::take(&mut program.functions);
+    let mut specializer = Specializer {
+        output,
+        program,
+        templates: Vec::with_capacity(originals.len()),
+        by_name: HashMap::new(),
+        queue: VecDeque::new(),
+        functions: Vec::new(),
+    };
+    for function in originals {
+        specializer.add_template(function);
+    }
+
+    for index in 0..specializer.templates.len() {
+        let template = &specializer.templates[index];
+        if template.is_top_level && template.type_params.is_empty() {
+            specializer.request(template.function.name, &[], 0);
+        }
+    }
+    let entry = specializer.program.entry;
+    let entry = specializer.block(entry, &mut Scope::default())?;
+    while let Some(id) = specializer.queue.pop_front() {
+        specializer.instantiate(id)?;
+    }
+
+    specializer.program.entry = entry;
+    specializer.program.functions = std::mem::take(&mut specializer.functions);
+    Ok(())
+}
+
+impl Specializer<'_> {
+    fn add_template(&mut self, function: LoweredFunction) {
+        let ast = &self.output.ast;
+        let view = ast.function_decl(function.decl);
+        let type_params: Vec<String> = view
+            .type_params_idx()
+            .map(|list| {
+                ast.children(list)
+                    .filter_map(|param| ast.nodes[param].first_child)
+                    .filter_map(|name| ast.node_text(name))
+                    .map(str::to_string)
+                    .collect()
+            })
+            .unwrap_or_default();
+        let var = |annotation: Option<&str>| {
+            annotation.and_then(|a| type_params.iter().position(|p| p == a))
+        };
+        let param_vars = view.params().map(|p| var(p.type_annotation())).collect();
+        let return_var = var(view.return_type_annotation());
+        let is_top_level = ast.nodes[function.decl]
+            .parent
+            .is_some_and(|parent| ast.nodes[parent].node_type == NodeType::Program);
+
+        self.by_name.insert(function.name, self.templates.len());
+        self.templates.push(Template {
+            function,
+            type_params,
+            param_vars,
+            return_var,
+            is_top_level,
+        });
+    }
+
+    /// Interns a key, queueing it when it is new
+    fn request(&mut self, base: StringId, type_args: &[TypeId], pass_modes: u64) -> SpecId {
+        let key = SpecKey {
+            base,
+            type_args,
+            pass_modes,
+        };
+        let table = &mut self.program.specializations;
+        let (id, new) = table.intern(key, &mut self.program.names, self.output);
+        if new {
+            self.queue.push_back(id);
+        }
+        id
+    }
+
+    fn is_unresolved(&self, ty: Option<TypeId>) -> bool {
+        match ty {
+            None => true,
+            Some(ty) => matches!(
+                self.output.resolve(ty),
+                Type::Var(_) | Type::TypeVar(_) | Type::TypeParameter { .. } | Type::Unknown
+            ),
+        }
+    }
+
+    /// Type of parameter `i` of `template` under `type_args`
+    fn param_type(&self, template: &Template, i: usize, type_args: &[TypeId]) -> TypeId {
+        match template.param_vars.get(i).copied().flatten() {
+            Some(var) => type_args[var],
+            None => self.program.params[template.function.params.indices()][i].ty,
+        }
+    }
+
+    fn return_type(&self, template: &Template, type_args: &[TypeId]) -> Option<TypeId> {
+        match template.return_var {
+            Some(var) => Some(type_args[var]),
+            None => template.function.return_type,
+        }
+    }
+
+    /// Copies a template's body for one key
+    fn instantiate(&mut self, id: SpecId) -> Result<(), LoweringError> {
+        let key = self.program.specializations.key(id);
+        let (base, type_args, pass_modes) = (key.base, key.type_args.to_vec(), key.pass_modes);
+        let template = &self.templates[self.by_name[&base]];
+        let function = template.function.clone();
+
+        let mut scope = Scope {
+            has_locals: true,
+            ..Default::default()
+        };
+        let mut params = Vec::with_capacity(function.params.len as usize);
+        for (i, param) in self.program.params[function.params.indices()]
+            .iter()
+            .enumerate()
+        {
+            let ty = self.param_type(template, i, &type_args);
+            let owned = i < 64 && pass_modes & (1 << i) != 0;
+            params.push(LoweredParam {
+                name: param.name,
+                ty,
+                pass_mode: if owned {
+                    PassMode::ByOwnership
+                } else {
+                    PassMode::ByRef
+                },
+                is_heap: is_heap_type(ty, self.output),
+            });
+            scope.types.insert(param.name, ty);
+            if owned {
+                scope.owned.insert(param.name);
+            }
+        }
+        let return_type = self.return_type(template, &type_args);
+        let params = LoweredProgram::push_list(&mut self.program.params, params);
+
+        count_uses(self.program, function.body, &mut scope.uses);
+        let body = self.block(function.body, &mut scope)?;
+        self.functions.push(LoweredFunction {
+            name: self.program.specializations.name(id),
+            params,
+            return_type,
+            body,
+            spec: Some(id),
+            ..function
+        });
+        Ok(())
+    }
+
+    fn block(&mut self, body: ListRange, scope: &mut Scope) -> Result<ListRange, LoweringError> {
+        let mut stmts = Vec::with_capacity(body.len as usize);
+        for i in body.indices() {
+            let stmt = self.program.stmt_lists[i];
+            stmts.push(self.stmt(stmt, scope)?);
+        }
+        Ok(LoweredProgram::push_list(
+            &mut self.program.stmt_lists,
+            stmts,
+        ))
+    }
+
+    fn stmt(&mut self, stmt: StmtId, scope: &mut Scope) -> Result<StmtId, LoweringError> {
+        let copy = match *self.program.stmt(stmt) {
+            LoweredStmt::VarDecl {
+                name,
+                value,
+                is_heap,
+                on_stack,
+            } => {
+                let value = self.expr(value, scope)?;
+                let ty = self.program.expr_type(value);
+                let is_heap = match ty {
+                    Some(ty) if !self.is_unresolved(Some(ty)) => {
+                        scope.types.insert(name, ty);
+                        is_heap_type(ty, self.output)
+                    }
+                    _ => is_heap,
+                };
+                if is_heap && scope.has_locals {
+                    scope.owned.insert(name);
+                } else {
+                    scope.owned.remove(&name);
+                }
+                LoweredStmt::VarDecl {
+                    name,
+                    value,
+                    is_heap,
+                    on_stack,
+                }
+            }
+            LoweredStmt::Assign { name, value } => LoweredStmt::Assign {
+                name,
+                value: self.expr(value, scope)?,
+            },
+            LoweredStmt::FieldAssign {
+                receiver,
+                field,
+                value,
+            } => LoweredStmt::FieldAssign {
+                receiver: self.expr(receiver, scope)?,
+                field,
+                value: self.expr(value, scope)?,
+            },
+            LoweredStmt::ExprStmt(expr) => LoweredStmt::ExprStmt(self.expr(expr, scope)?),
+            LoweredStmt::Return(expr) => LoweredStmt::Return(match expr {
+                Some(expr) => Some(self.expr(expr, scope)?),
+                None => None,
+            }),
+            LoweredStmt::Drop(name) => LoweredStmt::Drop(name),
+        };
+        Ok(self.program.add_stmt(copy))
+    }
+
+    fn list(&mut self, items: ListRange, scope: &mut Scope) -> Result<ListRange, LoweringError> {
+        let mut copies = Vec::with_capacity(items.len as usize);
+        for i in items.indices() {
+            let item = self.program.expr_lists[i];
+            copies.push(self.expr(item, scope)?);
+        }
+        Ok(LoweredProgram::push_list(
+            &mut self.program.expr_lists,
+            copies,
+        ))
+    }
+
+    fn expr(&mut self, expr: ExprId, scope: &mut Scope) -> Result<ExprId, LoweringError> {
+        let mut ty = self.program.expr_type(expr);
+        let copy = match *self.program.expr(expr) {
+            LoweredExpr::Identifier(name) => {
+                if let Some(count) = scope.uses.get_mut(&name) {
+                    *count = count.saturating_sub(1);
+                }
+                if self.is_unresolved(ty) {
+                    ty = scope.types.get(&name).copied().or(ty);
+                }
+                LoweredExpr::Identifier(name)
+            }
+            LoweredExpr::Call { callee, args } => {
+                return self.call(callee, args, ty, scope);
+            }
+            LoweredExpr::CallValue { callee, args } => LoweredExpr::CallValue {
+                callee: self.expr(callee, scope)?,
+                args: self.list(args, scope)?,
+            },
+            LoweredExpr::MethodCall {
+                receiver,
+                method,
+                args,
+            } => LoweredExpr::MethodCall {
+                receiver: self.expr(receiver, scope)?,
+                method,
+                args: self.list(args, scope)?,
+            },
+            LoweredExpr::FieldAccess { receiver, field } => {
+                let receiver = self.expr(receiver, scope)?;
+                if self.is_unresolved(ty) {
+                    ty = self.field_type(receiver, field).or(ty);
+                }
+                LoweredExpr::FieldAccess { receiver, field }
+            }
+            LoweredExpr::StructInit { fields, methods } => {
+                let mut field_copies = Vec::with_capacity(fields.len as usize);
+                for i in fields.indices() {
+                    let (name, value) = self.program.field_inits[i];
+                    field_copies.push((name, self.expr(value, scope)?));
+                }
+                let mut method_copies = Vec::with_capacity(methods.len as usize);
+                for i in methods.indices() {
+                    let (name, template) = self.program.method_inits[i];
+                    let base = self.templates[template.0 as usize].function.name;
+                    let spec = self.request(base, &[], 0);
+                    method_copies.push((name, FunctionId(spec.0)));
+                }
+                LoweredExpr::StructInit {
+                    fields: LoweredProgram::push_list(&mut self.program.field_inits, field_copies),
+                    methods: LoweredProgram::push_list(
+                        &mut self.program.method_inits,
+                        method_copies,
+                    ),
+                }
+            }
+            LoweredExpr::List { elements } => LoweredExpr::List {
+                elements: self.list(elements, scope)?,
+            },
+            LoweredExpr::Match { subject, arms } => {
+                let subject = self.expr(subject, scope)?;
+                let mut arm_copies = Vec::with_capacity(arms.len as usize);
+                for i in arms.indices() {
+                    let arm = self.program.match_arms[i];
+                    let result = self.expr(arm.result, scope)?;
+                    if self.is_unresolved(ty) && !self.is_unresolved(self.program.expr_type(result))
+                    {
+                        ty = self.program.expr_type(result);
+                    }
+                    arm_copies.push(MatchArm {
+                        pattern: arm.pattern,
+                        result,
+                    });
+                }
+                LoweredExpr::Match {
+                    subject,
+                    arms: LoweredProgram::push_list(&mut self.program.match_arms, arm_copies),
+                }
+            }
+            LoweredExpr::BoolOp { op, lhs, rhs } => LoweredExpr::BoolOp {
+                op,
+                lhs: self.expr(lhs, scope)?,
+                rhs: self.expr(rhs, scope)?,
+            },
+            LoweredExpr::Not(operand) => LoweredExpr::Not(self.expr(operand, scope)?),
+            LoweredExpr::Negate(operand) => LoweredExpr::Negate(self.expr(operand, scope)?),
+            LoweredExpr::Copy(operand) => LoweredExpr::Copy(self.expr(operand, scope)?),
+            literal @ (LoweredExpr::Literal(_) | LoweredExpr::This) => literal,
+        };
+        Ok(self.program.add_expr(copy, ty))
+    }
+
+    /// Copies a call, pointing it at the specialization its argument types
+    /// and pass modes select
+    fn call(
+        &mut self,
+        callee: StringId,
+        args: ListRange,
+        ty: Option<TypeId>,
+        scope: &mut Scope,
+    ) -> Result<ExprId, LoweringError> {
+        let Some(&template_index) = self.by_name.get(&callee) else {
+            // A built-in
+            let args = self.list(args, scope)?;
+            return Ok(self
+                .program
+                .add_expr(LoweredExpr::Call { callee, args }, ty));
+        };
+
+        let borrowed = scope.borrowed.len();
+        let mut copies = Vec::with_capacity(args.len as usize);
+        let mut movable = Vec::with_capacity(args.len as usize);
+        for i in args.indices() {
+            let arg = self.program.expr_lists[i];
+            let copy = self.expr(arg, scope)?;
+            movable.push(match *self.program.expr(copy) {
+                LoweredExpr::Identifier(name) => {
+                    let last_use = scope.uses.get(&name).is_none_or(|&n| n == 0);
+                    let movable =
+                        last_use && scope.owned.contains(&name) && !scope.borrowed.contains(&name);
+                    scope.borrowed.push(name);
+                    movable
+                }
+                LoweredExpr::FieldAccess { .. } | LoweredExpr::This | LoweredExpr::Match { .. } => {
+                    false
+                }
+                _ => true,
+            });
+            copies.push(copy);
+        }
+        scope.borrowed.truncate(borrowed);
+
+        let template = &self.templates[template_index];
+        let mut type_args = Vec::with_capacity(template.type_params.len());
+        for (var, name) in template.type_params.iter().enumerate() {
+            let bound = template
+                .param_vars
+                .iter()
+                .zip(&copies)
+                .find(|(param_var, arg)| {
+                    **param_var == Some(var) && !self.is_unresolved(self.program.expr_type(**arg))
+                })
+                .and_then(|(_, arg)| self.program.expr_type(*arg));
+            let Some(bound) = bound else {
+                return Err(LoweringError::at_node(
+                    format!(
+                        "Cannot infer type parameter '{}' of '{}'",
+                        name,
+                        self.program.name(callee)
+                    ),
+                    &self.output.ast,
+                    template.function.decl,
+                ));
+            };
+            type_args.push(bound);
+        }
+        let mut pass_modes = 0u64;
+        for (i, movable) in movable.iter().enumerate().take(64) {
+            if *movable && is_heap_type(self.param_type(template, i, &type_args), self.output) {
+                pass_modes |= 1 << i;
+            }
+        }
+        let ty = match self.is_unresolved(ty) {
+            true => self.return_type(template, &type_args).or(ty),
+            false => ty,
+        };
+
+        let spec = self.request(callee, &type_args, pass_modes);
+        let callee = self.program.specializations.name(spec);
+        let args = LoweredProgram::push_list(&mut self.program.expr_lists, copies);
+        Ok(self
+            .program
+            .add_expr(LoweredExpr::Call { callee, args }, ty))
+    }
+
+    fn field_type(&self, receiver: ExprId, field: StringId) -> Option<TypeId> {
+        let receiver_ty = self.program.expr_type(receiver)?;
+        let Type::Struct(struct_type) = self.output.resolve(receiver_ty) else {
+            return None;
+        };
+        let field = self.program.name(field);
+        struct_type
+            .fields
+            .iter()
+            .find(|f| f.name == field)
+            .map(|f| f.type_id)
+    }
+}
+
+/// Counts the identifiers of a body, not descending into other functions
+fn count_uses(program: &LoweredProgram, body: ListRange, uses: &mut HashMap<StringId, u32>) {
+    let mut exprs = Vec::new();
+    for stmt in program.stmt_list(body) {
+        match *program.stmt(*stmt) {
+            LoweredStmt::VarDecl { value, .. } | LoweredStmt::Assign { value, .. } => {
+                exprs.push(value)
+            }
+            LoweredStmt::FieldAssign {
+                receiver, value, ..
+            } => exprs.extend([receiver, value]),
+            LoweredStmt::ExprStmt(expr) | LoweredStmt::Return(Some(expr)) => exprs.push(expr),
+            LoweredStmt::Return(None) | LoweredStmt::Drop(_) => {}
+        }
+    }
+    while let Some(expr) = exprs.pop() {
+        match *program.expr(expr) {
+            LoweredExpr::Identifier(name) => *uses.entry(name).or_default() += 1,
+            LoweredExpr::Call { args, .. } => exprs.extend(program.expr_list(args)),
+            LoweredExpr::CallValue { callee, args } => {
+                exprs.push(callee);
+                exprs.extend(program.expr_list(args));
+            }
+            LoweredExpr::MethodCall { receiver, args, .. } => {
+                exprs.push(receiver);
+                exprs.extend(program.expr_list(args));
+            }
+            LoweredExpr::FieldAccess { receiver, .. } => exprs.push(receiver),
+            LoweredExpr::StructInit { fields, .. } => {
+                exprs.extend(program.field_inits[fields.indices()].iter().map(|f| f.1))
+            }
+            LoweredExpr::List { elements } => exprs.extend(program.expr_list(elements)),
+            LoweredExpr::Match { subject, arms } => {
+                exprs.push(subject);
+                exprs.extend(program.match_arms[arms.indices()].iter().map(|a| a.result));
+            }
+            LoweredExpr::BoolOp { lhs, rhs, .. } => exprs.extend([lhs, rhs]),
+            LoweredExpr::Not(operand)
+            | LoweredExpr::Negate(operand)
+            | LoweredExpr::Copy(operand) => exprs.push(operand),
+            LoweredExpr::Literal(_) | LoweredExpr::This => {}
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::limits::CompilerLimits;
+    use crate::parser::parse;
+    use crate::semantic::SemanticAnalyzer;
+
+    fn analyze(source: &str) -> AnalysisOutput {
+        let limits = CompilerLimits::default();
+        let ast = parse(lex(source, &limits).unwrap(), &limits).unwrap();
+        match SemanticAnalyzer::new(ast).analyze_with_types() {
+            Ok(output) => output,
+            Err(e) => panic!("analysis failed: {:?}", e.errors),
+        }
+    }
+
+    #[test]
+    fn test_spec_keys_are_interned() {
+        let mut output = analyze("x: 1\n");
+        let number = output.type_registry.intern(Type::Number);
+        let string = output.type_registry.intern(Type::String);
+        let mut names = StringStorage::new();
+        let process = names.intern("process");
+        let mut table = SpecTable::default();
+        let mut intern = |type_args: &[TypeId], pass_modes: u64| {
+            let key = SpecKey {
+                base: process,
+                type_args,
+                pass_modes,
+            };
+            table.intern(key, &mut names, &output)
+        };
+
+        let (first, new) = intern(&[number], 0);
+        assert!(new);
+        assert_eq!(intern(&[number], 0), (first, false));
+        let (other_type, new) = intern(&[string], 0);
+        assert!(new && other_type != first);
+        let (owned, new) = intern(&[number], 0b10);
+        assert!(new && owned != first);
+        assert_eq!(table.len(), 3);
+        assert_eq!(table.key(owned).type_args, &[number]);
+        assert_eq!(names.resolve(table.name(first)), "process__Number");
+        assert_eq!(names.resolve(table.name(owned)), "process__Number__ro");
+    }
+
+    #[test]
+    fn test_default_key_keeps_base_name() {
+        let output = analyze("x: 1\n");
+        let mut names = StringStorage::new();
+        let greet = names.intern("outer.greet");
+        let key = SpecKey {
+            base: greet,
+            type_args: &[],
+            pass_modes: 0,
+        };
+        assert_eq!(mangled_name(key, &names, &output), "outer.greet");
+        let owned = SpecKey {
+            pass_modes: 1,
+            ..key
+        };
+        assert_eq!(mangled_name(owned, &names, &output), "outer.greet__o");
+    }
+}
@@ -0,0 +1,542 @@
+// AST translation - builds a `LoweredProgram` from an analyzed AST
+//
+// Every FunctionDecl (top-level, nested, or a struct literal method) becomes
+// a `LoweredFunction` named after its lexical path, as in code generation.
+// Pipes become plain calls, and statements with no run-time effect (type
+// declarations, module headers, exports) are dropped.
+
+use std::collections::{HashMap, HashSet};
+
+use super::LoweringError;
+use super::heap_analysis::is_heap_type;
+use super::ir::*;
+use crate::ast::NodeType;
+use crate::lexer::TokenKind;
+use crate::semantic::{AnalysisOutput, Type, TypeId};
+use crate::string_storage::StringId;
+
+pub(super) struct Translator<'a> {
+    output: &'a AnalysisOutput,
+    program: LoweredProgram,
+    /// `StringStorage::intern` searches linearly; names repeat a lot
+    interned: HashMap<String, StringId>,
+    /// Lowered name of every FunctionDecl
+    function_names: HashMap<usize, StringId>,
+}
+
+impl<'a> Translator<'a> {
+    pub fn new(output: &'a AnalysisOutput) -> Self {
+        Translator {
+            output,
+            program: LoweredProgram::default(),
+            interned: HashMap::new(),
+            function_names: HashMap::new(),
+        }
+    }
+
+    pub fn finish(self) -> LoweredProgram {
+        self.program
+    }
+
+    fn error(&self, node: usize, message: String) -> LoweringError {
+        LoweringError::at_node(message, &self.output.ast, node)
+    }
+
+    fn intern(&mut self, text: &str) -> StringId {
+        if let Some(id) = self.interned.get(text) {
+            return *id;
+        }
+        let id = self.program.names.intern(text);
+        self.interned.insert(text.to_string(), id);
+        id
+    }
+
+    fn type_of(&self, node: usize) -> Option<TypeId> {
+        let ty = self.output.type_of(node)?;
+        Some(
+            self.output
+                .substitution
+                .apply(ty, &self.output.type_registry),
+        )
+    }
+
+    /// Lowers the program root: functions, plus top-level statements
+    pub fn program(&mut self) -> Result<(), LoweringError> {
+        let Some(root) = self.output.ast.root else {
+            return Ok(());
+        };
+        self.collect_names(root, &mut HashSet::new());
+        self.program.entry = self.block(root)?;
+        Ok(())
+    }
+
+    /// Names every FunctionDecl after its lexical path, before any body is
+    /// lowered, so calls can refer to functions declared further down
+    fn collect_names(&mut self, root: usize, used: &mut HashSet<String>) {
+        let output = self.output;
+        let ast = &output.ast;
+        let mut stack = vec![(root, Vec::<String>::new())];
+        while let Some((node, path)) = stack.pop() {
+            let mut child_path = path;
+            match ast.nodes[node].node_type {
+                NodeType::FunctionDecl => {
+                    let decl = ast.function_decl(node);
+                    child_path.push(decl.name().unwrap_or("anonymous").to_string());
+                    let base = child_path.join(".");
+                    let mut name = base.clone();
+                    let mut suffix = 1;
+                    while !used.insert(name.clone()) {
+                        name = format!("{}.{}", base, suffix);
+                        suffix += 1;
+                    }
+                    let id = self.intern(&name);
+                    self.function_names.insert(node, id);
+                }
+                // Struct literal methods are named after the variable
+                NodeType::VarDecl => {
+                    let view = ast.var_decl(node);
+                    if let (Some(name), Some(value)) = (view.name(), view.value_expr_idx()) {
+                        if ast.nodes[value].node_type == NodeType::StructInit {
+                            child_path.push(name.to_string());
+                        }
+                    }
+                }
+                _ => {}
+            }
+            let children: Vec<usize> = ast.children(node).collect();
+            // Reversed, so functions are named in source order
+            for child in children.into_iter().rev() {
+                stack.push((child, child_path.clone()));
+            }
+        }
+    }
+
+    /// Lowered name of the function `name` visible at `node`, the way
+    /// code generation resolves calls; `name` itself for built-ins
+    fn callee(&mut self, node: usize, name: &str) -> StringId {
+        let ast = &self.output.ast;
+        let mut current = ast.nodes[node].parent;
+        while let Some(idx) = current {
+            if matches!(
+                ast.nodes[idx].node_type,
+                NodeType::Block | NodeType::Program
+            ) {
+                let found = ast.children(idx).find(|&child| {
+                    ast.nodes[child].node_type == NodeType::FunctionDecl
+                        && ast.function_decl(child).name() == Some(name)
+                });
+                if let Some(decl) = found {
+                    return self.function_names[&decl];
+                }
+            }
+            current = ast.nodes[idx].parent;
+        }
+        self.intern(name)
+    }
+
+    /// Lowers the statements of a Block (or the Program root)
+    fn block(&mut self, block: usize) -> Result<ListRange, LoweringError> {
+        let children: Vec<usize> = self.output.ast.children(block).collect();
+        let mut stmts = Vec::with_capacity(children.len());
+        for child in children {
+            if let Some(stmt) = self.statement(child)? {
+                stmts.push(stmt);
+            }
+        }
+        Ok(LoweredProgram::push_list(
+            &mut self.program.stmt_lists,
+            stmts,
+        ))
+    }
+
+    fn statement(&mut self, node: usize) -> Result<Option<StmtId>, LoweringError> {
+        let ast = &self.output.ast;
+        let stmt = match ast.nodes[node].node_type {
+            NodeType::VarDecl => {
+                let view = ast.var_decl(node);
+                let (Some(name), Some(value_idx)) = (view.name(), view.value_expr_idx()) else {
+                    return Err(self.error(node, "Variable declaration has no value".to_string()));
+                };
+                let value = self.expr(value_idx)?;
+                let is_heap = self
+                    .type_of(node)
+                    .or(self.program.expr_type(value))
+                    .is_some_and(|ty| is_heap_type(ty, self.output));
+                let name = self.intern(name);
+                LoweredStmt::VarDecl {
+                    name,
+                    value,
+                    is_heap,
+                    on_stack: false,
+                }
+            }
+            NodeType::FunctionDecl => {
+                self.function(node, None)?;
+                return Ok(None);
+            }
+            NodeType::ReturnStmt => match ast.nodes[node].first_child {
+                Some(expr) => LoweredStmt::Return(Some(self.expr(expr)?)),
+                None => LoweredStmt::Return(None),
+            },
+            NodeType::PropertyAssignment => {
+                let access = ast.nodes[node]
+                    .first_child
+                    .expect("PropertyAssignment has a target");
+                let value_idx = ast.nodes[access]
+                    .next_sibling
+                    .expect("PropertyAssignment has a value");
+                let receiver_idx = ast.nodes[access]
+                    .first_child
+                    .expect("PropertyAccess has a receiver");
+                let field = ast.nodes[receiver_idx]
+                    .next_sibling
+                    .and_then(|f| ast.node_text(f))
+                    .unwrap_or("");
+                let field = self.intern(field);
+                let receiver = self.expr(receiver_idx)?;
+                let value = self.expr(value_idx)?;
+                LoweredStmt::FieldAssign {
+                    receiver,
+                    field,
+                    value,
+                }
+            }
+            NodeType::ExprStmt => match ast.nodes[node].first_child {
+                Some(expr) => LoweredStmt::ExprStmt(self.expr(expr)?),
+                None => return Ok(None),
+            },
+            NodeType::TypeDecl | NodeType::ModuleDecl | NodeType::Export => return Ok(None),
+            NodeType::Import => {
+                return Err(self.error(
+                    node,
+                    "Imports are not supported by lowering yet".to_string(),
+                ));
+            }
+            _ => LoweredStmt::ExprStmt(self.expr(node)?),
+        };
+        Ok(Some(self.program.add_stmt(stmt)))
+    }
+
+    /// Lowers a FunctionDecl and the functions nested in it
+    fn function(
+        &mut self,
+        decl: usize,
+        this_type: Option<TypeId>,
+    ) -> Result<FunctionId, LoweringError> {
+        let ast = &self.output.ast;
+        let view = ast.function_decl(decl);
+        let name = view.name().unwrap_or("anonymous");
+        let function_type = self.output.function_types.get(&decl).copied();
+        let Some(Type::Function(function_type)) = function_type.map(|ty| self.output.resolve(ty))
+        else {
+            return Err(self.error(decl, format!("Function '{}' has no resolved type", name)));
+        };
+
+        let mut params = Vec::with_capacity(function_type.params.len());
+        for param in &function_type.params {
+            let ty = self
+                .output
+                .substitution
+                .apply(param.type_id, &self.output.type_registry);
+            params.push(LoweredParam {
+                name: self.intern(&param.name),
+                ty,
+                pass_mode: PassMode::ByRef,
+                is_heap: is_heap_type(ty, self.output),
+            });
+        }
+        let params = LoweredProgram::push_list(&mut self.program.params, params);
+        let return_type = match self.output.resolve(function_type.return_type) {
+            Type::Void | Type::Unknown => None,
+            _ => Some(
+                self.output
+                    .substitution
+                    .apply(function_type.return_type, &self.output.type_registry),
+            ),
+        };
+
+        // Reserved before the body, so nested functions come after their parent
+        let id = FunctionId(self.program.functions.len() as u32);
+        let name = self.function_names[&decl];
+        self.program.functions.push(LoweredFunction {
+            name,
+            decl,
+            params,
+            return_type,
+            this_type,
+            body: ListRange::default(),
+            spec: None,
+        });
+        let body = match view.body_idx() {
+            Some(body) => self.block(body),
+            None => Ok(ListRange::default()),
+        };
+        self.program.functions[id.0 as usize].body = body?;
+        Ok(id)
+    }
+
+    fn expr(&mut self, node: usize) -> Result<ExprId, LoweringError> {
+        let ast = &self.output.ast;
+        let ty = self.type_of(node);
+        let expr = match ast.nodes[node].node_type {
+            NodeType::LiteralBoolean => LoweredExpr::Literal(self.literal(node)),
+            NodeType::LiteralNumber => LoweredExpr::Literal(self.literal(node)),
+            NodeType::LiteralString => {
+                if let Some(TokenKind::String(crate::lexer::StringKind::Interpolated)) =
+                    ast.nodes[node].token.as_ref().map(|t| &t.kind)
+                {
+                    return Err(self.error(
+                        node,
+                        "String interpolation is not supported by lowering yet".to_string(),
+                    ));
+                }
+                LoweredExpr::Literal(self.literal(node))
+            }
+            NodeType::Identifier => {
+                LoweredExpr::Identifier(self.intern(ast.node_text(node).unwrap_or("")))
+            }
+            NodeType::This => LoweredExpr::This,
+            NodeType::Not => LoweredExpr::Not(self.operand(node)?),
+            NodeType::Negate => LoweredExpr::Negate(self.operand(node)?),
+            NodeType::And | NodeType::Or => {
+                let op = match ast.nodes[node].node_type {
+                    NodeType::And => BoolOp::And,
+                    _ => BoolOp::Or,
+                };
+                let left = ast.nodes[node].first_child.expect("binary operand");
+                let right = ast.nodes[left].next_sibling.expect("binary operand");
+                let lhs = self.expr(left)?;
+                let rhs = self.expr(right)?;
+                LoweredExpr::BoolOp { op, lhs, rhs }
+            }
+            NodeType::FunctionCall => {
+                let ident = ast.nodes[node]
+                    .first_child
+                    .expect("FunctionCall has a name");
+                let callee = self.callee(node, ast.node_text(ident).unwrap_or(""));
+                let arg_nodes: Vec<usize> = ast.nodes[ident]
+                    .next_sibling
+                    .map(|list| ast.children(list).collect())
+                    .unwrap_or_default();
+                if let Some(&placeholder) = arg_nodes
+                    .iter()
+                    .find(|&&a| ast.nodes[a].node_type == NodeType::Placeholder)
+                {
+                    return Err(self.error(
+                        placeholder,
+                        "Partial application is not supported by lowering yet".to_string(),
+                    ));
+                }
+                let args = self.args(&arg_nodes, None)?;
+                LoweredExpr::Call { callee, args }
+            }
+            NodeType::MethodCall => {
+                let receiver_idx = ast.nodes[node]
+                    .first_child
+                    .expect("MethodCall has a receiver");
+                let method_idx = ast.nodes[receiver_idx]
+                    .next_sibling
+                    .expect("MethodCall has a method name");
+                let method = self.intern(ast.node_text(method_idx).unwrap_or(""));
+                let arg_nodes: Vec<usize> = ast.nodes[method_idx]
+                    .next_sibling
+                    .map(|list| ast.children(list).collect())
+                    .unwrap_or_default();
+                let receiver = self.expr(receiver_idx)?;
+                let args = self.args(&arg_nodes, None)?;
+                LoweredExpr::MethodCall {
+                    receiver,
+                    method,
+                    args,
+                }
+            }
+            NodeType::PropertyAccess => {
+                let receiver_idx = ast.nodes[node]
+                    .first_child
+                    .expect("PropertyAccess has a receiver");
+                let field = ast.nodes[receiver_idx]
+                    .next_sibling
+                    .and_then(|f| ast.node_text(f))
+                    .unwrap_or("");
+                let field = self.intern(field);
+                let receiver = self.expr(receiver_idx)?;
+                LoweredExpr::FieldAccess { receiver, field }
+            }
+            NodeType::Pipe => return self.pipe(node, ty),
+            NodeType::Match => {
+                let view = ast.match_expr(node);
+                let subject_idx = view.subject_expr_idx().expect("Match has a subject");
+                let subject = self.expr(subject_idx)?;
+                let mut arms = Vec::new();
+                for arm in view.arm_indices() {
+                    let arm_view = ast.match_arm(arm);
+                    let pattern = arm_view
+                        .pattern_child_idx()
+                        .expect("MatchArm has a pattern");
+                    let result = arm_view.result_expr_idx().expect("MatchArm has a result");
+                    let pattern = self.pattern(pattern)?;
+                    let result = self.expr(result)?;
+                    arms.push(MatchArm { pattern, result });
+                }
+                let arms = LoweredProgram::push_list(&mut self.program.match_arms, arms);
+                LoweredExpr::Match { subject, arms }
+            }
+            NodeType::StructInit => {
+                let mut fields = Vec::new();
+                let mut methods = Vec::new();
+                let members: Vec<usize> = ast.children(node).collect();
+                for member in members {
+                    let name_idx = ast.nodes[member]
+                        .first_child
+                        .expect("struct members are named");
+                    let name = self.intern(ast.node_text(name_idx).unwrap_or(""));
+                    let value_idx = ast.nodes[name_idx]
+                        .next_sibling
+                        .expect("struct members have a value");
+                    match ast.nodes[member].node_type {
+                        NodeType::StructInitField => {
+                            fields.push((name, self.expr(value_idx)?));
+                        }
+                        NodeType::StructInitMethod => {
+                            methods.push((name, self.function(value_idx, ty)?));
+                        }
+                        _ => {}
+                    }
+                }
+                let fields = LoweredProgram::push_list(&mut self.program.field_inits, fields);
+                let methods = LoweredProgram::push_list(&mut self.program.method_inits, methods);
+                LoweredExpr::StructInit { fields, methods }
+            }
+            NodeType::List => {
+                let elements: Vec<usize> = ast.children(node).collect();
+                let elements = self.args(&elements, None)?;
+                LoweredExpr::List { elements }
+            }
+            NodeType::Partial | NodeType::Placeholder => {
+                return Err(self.error(
+                    node,
+                    "Partial application is not supported by lowering yet".to_string(),
+                ));
+            }
+            NodeType::Compose => {
+                return Err(self.error(
+                    node,
+                    "Composition is not supported by lowering yet".to_string(),
+                ));
+            }
+            NodeType::Try => {
+                return Err(self.error(node, "'try' is not supported by lowering yet".to_string()));
+            }
+            other => {
+                return Err(self.error(node, format!("Unexpected {:?} in an expression", other)));
+            }
+        };
+        Ok(self.program.add_expr(expr, ty))
+    }
+
+    fn operand(&mut self, node: usize) -> Result<ExprId, LoweringError> {
+        let operand = self.output.ast.nodes[node]
+            .first_child
+            .expect("unary operation has an operand");
+        self.expr(operand)
+    }
+
+    /// Lowers argument nodes in order, putting `piped` where the `_` is
+    fn args(
+        &mut self,
+        nodes: &[usize],
+        mut piped: Option<ExprId>,
+    ) -> Result<ListRange, LoweringError> {
+        let mut args = Vec::with_capacity(nodes.len());
+        for &node in nodes {
+            if self.output.ast.nodes[node].node_type == NodeType::Placeholder {
+                match piped.take() {
+                    Some(arg) => args.push(arg),
+                    None => {
+                        return Err(self
+                            .error(node, "Only one '_' can receive the piped value".to_string()));
+                    }
+                }
+            } else {
+                args.push(self.expr(node)?);
+            }
+        }
+        Ok(LoweredProgram::push_list(
+            &mut self.program.expr_lists,
+            args,
+        ))
+    }
+
+    /// `value | f` and `value | f(a, _)` become `f(value)` and `f(a, value)`;
+    /// `value | f()` calls the function `f()` returns
+    fn pipe(&mut self, node: usize, ty: Option<TypeId>) -> Result<ExprId, LoweringError> {
+        let ast = &self.output.ast;
+        let left = ast.nodes[node].first_child.expect("Pipe has a left side");
+        let right = ast.nodes[left].next_sibling.expect("Pipe has a right side");
+        let piped = self.expr(left)?;
+
+        let expr = match ast.nodes[right].node_type {
+            NodeType::Identifier => {
+                let callee = self.callee(right, ast.node_text(right).unwrap_or(""));
+                let args = LoweredProgram::push_list(&mut self.program.expr_lists, [piped]);
+                LoweredExpr::Call { callee, args }
+            }
+            NodeType::FunctionCall => {
+                let ident = ast.nodes[right]
+                    .first_child
+                    .expect("FunctionCall has a name");
+                let arg_nodes: Vec<usize> = ast.nodes[ident]
+                    .next_sibling
+                    .map(|list| ast.children(list).collect())
+                    .unwrap_or_default();
+                let has_placeholder = arg_nodes
+                    .iter()
+                    .any(|&a| ast.nodes[a].node_type == NodeType::Placeholder);
+                if has_placeholder {
+                    let callee = self.callee(right, ast.node_text(ident).unwrap_or(""));
+                    let args = self.args(&arg_nodes, Some(piped))?;
+                    LoweredExpr::Call { callee, args }
+                } else {
+                    let callee = self.expr(right)?;
+                    let args = LoweredProgram::push_list(&mut self.program.expr_lists, [piped]);
+                    LoweredExpr::CallValue { callee, args }
+                }
+            }
+            _ => {
+                return Err(self.error(
+                    right,
+                    "Piping into this expression is not supported by lowering yet".to_string(),
+                ));
+            }
+        };
+        Ok(self.program.add_expr(expr, ty))
+    }
+
+    fn literal(&mut self, node: usize) -> Literal {
+        let ast = &self.output.ast;
+        match ast.nodes[node].node_type {
+            NodeType::LiteralBoolean => Literal::Bool(matches!(
+                ast.nodes[node].token.as_ref().map(|t| &t.kind),
+                Some(TokenKind::True)
+            )),
+            NodeType::LiteralNumber => {
+                Literal::Number(self.intern(ast.node_text(node).unwrap_or("0")))
+            }
+            _ => Literal::String(self.intern(ast.node_text(node).unwrap_or(""))),
+        }
+    }
+
+    fn pattern(&mut self, node: usize) -> Result<Pattern, LoweringError> {
+        let ast = &self.output.ast;
+        match ast.nodes[node].node_type {
+            NodeType::Placeholder => Ok(Pattern::Wildcard),
+            NodeType::LiteralBoolean | NodeType::LiteralNumber | NodeType::LiteralString => {
+                Ok(Pattern::Literal(self.literal(node)))
+            }
+            NodeType::Identifier => Ok(Pattern::Unit(
+                self.intern(ast.node_text(node).unwrap_or("")),
+            )),
+            _ => Err(self.error(node, "Unsupported match pattern".to_string())),
+        }
+    }
+}
@@ -0,0 +1,319 @@
+// Document analysis and AST queries for the LSP server
+//
+// Runs the lex → parse → semantic pipeline on an open document and answers
+// position-based queries (node under cursor, hover type, definition) against
+// the resulting AST. Cursor lookups go through the document's `SpanTable`.
+
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, Ordering};
+
+use crate::ast::{Ast, NodeType};
+use crate::limits::CompilerLimits;
+use crate::semantic::{AnalysisOutput, SemanticAnalyzer, type_to_display_string};
+use crate::spans::SpanTable;
+
+/// A problem reported at a lexer location (1-indexed line and column)
+#[derive(Debug, Clone, PartialEq)]
+pub struct Diagnostic {
+    pub line: usize,
+    pub column: usize,
+    pub message: String,
+}
+
+/// Result of analyzing one version of a document
+pub struct DocumentAnalysis {
+    pub version: i64,
+    pub diagnostics: Vec<Diagnostic>,
+    /// Full type information when analysis succeeded
+    pub output: Option<AnalysisOutput>,
+    /// The parsed AST when parsing succeeded but analysis reported errors
+    pub fallback_ast: Option<Ast>,
+    /// Byte spans of the AST nodes (present whenever an AST is)
+    pub spans: Option<SpanTable>,
+}
+
+impl DocumentAnalysis {
+    /// The best available AST for queries
+    pub fn ast(&self) -> Option<&Ast> {
+        self.output
+            .as_ref()
+            .map(|o| &o.ast)
+            .or(self.fallback_ast.as_ref())
+    }
+
+    /// Innermost AST node whose token covers a byte offset
+    pub fn node_at(&self, offset: usize) -> Option<usize> {
+        self.spans.as_ref()?.node_at(offset)
+    }
+}
+
+/// Analyzes a document; returns `None` if `cancel` was raised before completion
+pub fn analyze(
+    text: &str,
+    version: i64,
+    limits: &CompilerLimits,
+    cancel: &Arc<AtomicBool>,
+) -> Option<DocumentAnalysis> {
+    let failed = |line, column, message| DocumentAnalysis {
+        version,
+        diagnostics: vec![Diagnostic {
+            line,
+            column,
+            message,
+        }],
+        output: None,
+        fallback_ast: None,
+        spans: None,
+    };
+
+    let tokens = match crate::lexer::lex(text, limits) {
+        Ok(t) => t,
+        Err(e) => return Some(failed(e.line, e.column, e.message)),
+    };
+    if cancel.load(Ordering::Relaxed) {
+        return None;
+    }
+
+    let ast = match crate::parser::parse(tokens, limits) {
+        Ok(a) => a,
+        Err(e) => return Some(failed(e.line, e.column, e.message)),
+    };
+    if cancel.load(Ordering::Relaxed) {
+        return None;
+    }
+
+    let result = SemanticAnalyzer::new(ast)
+        .with_cancel_flag(Arc::clone(cancel))
+        .analyze_with_types();
+    if cancel.load(Ordering::Relaxed) {
+        return None;
+    }
+
+    Some(match result {
+        Ok(output) => DocumentAnalysis {
+            version,
+            diagnostics: Vec::new(),
+            spans: Some(SpanTable::build(&output.ast, text)),
+            output: Some(output),
+            fallback_ast: None,
+        },
+        Err(err) => DocumentAnalysis {
+            version,
+            diagnostics: err
+                .errors
+                .into_iter()
+                .map(|e| Diagnostic {
+                    line: e.line,
+                    column: e.column,
+                    message: e.message,
+                })
+                .collect(),
+            output: None,
+            spans: Some(SpanTable::build(&err.ast, text)),
+            fallback_ast: Some(err.ast),
+        },
+    })
+}
+
+/// Renders hover text (`name Type`) for the node at a byte offset
+pub fn hover(analysis: &DocumentAnalysis, offset: usize) -> Option<(usize, String)> {
+    let output = analysis.output.as_ref()?;
+    let ast = &output.ast;
+    let idx = analysis.node_at(offset)?;
+
+    let type_id = output.type_of(idx).or_else(|| {
+        // Declaration identifiers carry no type; their VarDecl does
+        let def = find_definition(ast, idx)?;
+        let parent = ast.nodes[def].parent?;
+        (ast.nodes[parent].node_type == NodeType::VarDecl)
+            .then(|| output.type_of(parent))
+            .flatten()
+    });
+
+    let rendered = match type_id {
+        Some(tid) => type_to_display_string(tid, &output.type_registry),
+        None => {
+            // Parameters keep their annotation as written
+            let def = find_definition(ast, idx)?;
+            let parent = ast.nodes[def].parent?;
+            if ast.nodes[parent].node_type != NodeType::Param {
+                return None;
+            }
+            ast.param(parent).type_annotation()?.to_string()
+        }
+    };
+
+    let label = match ast.nodes[idx].node_type {
+        NodeType::Identifier => format!("{} {}", ast.node_text(idx).unwrap_or(""), rendered),
+        _ => rendered,
+    };
+    Some((idx, label))
+}
+
+/// Resolves an identifier (or type annotation) to the identifier node that declares it
+///
+/// Resolution is lexical: enclosing blocks are searched from the innermost
+/// outwards, preferring the nearest declaration that precedes the use.
+/// Function and type declarations are visible anywhere in their block.
+pub fn find_definition(ast: &Ast, node_idx: usize) -> Option<usize> {
+    let node_type = ast.nodes[node_idx].node_type;
+    let name = ast.node_text(node_idx)?;
+
+    let looking_for_type = match node_type {
+        NodeType::Identifier => false,
+        NodeType::TypeAnnotation | NodeType::TypeName => true,
+        _ => return None,
+    };
+
+    // A declaring identifier resolves to itself
+    if let Some(parent) = ast.nodes[node_idx].parent {
+        let is_decl_ident = matches!(
+            ast.nodes[parent].node_type,
+            NodeType::VarDecl | NodeType::FunctionDecl | NodeType::Param | NodeType::TypeDecl
+        ) && ast.nodes[parent].first_child == Some(node_idx);
+        if is_decl_ident {
+            return Some(node_idx);
+        }
+    }
+
+    let mut scope = ast.nodes[node_idx].parent;
+    while let Some(scope_idx) = scope {
+        let scope_node = &ast.nodes[scope_idx];
+        match scope_node.node_type {
+            NodeType::Block | NodeType::Program => {
+                let mut found = None;
+                for child in ast.children(scope_idx) {
+                    let Some(ident) = ast.nodes[child].first_child else {
+                        continue;
+                    };
+                    if ast.node_text(ident) != Some(name) {
+                        continue;
+                    }
+                    let matches = match ast.nodes[child].node_type {
+                        NodeType::TypeDecl => looking_for_type,
+                        NodeType::FunctionDecl => !looking_for_type,
+                        // Variables must be declared before the use
+                        NodeType::VarDecl => !looking_for_type && ident < node_idx,
+                        _ => false,
+                    };
+                    if matches {
+                        found = Some(ident);
+                    }
+                }
+                if found.is_some() {
+                    return found;
+                }
+            }
+            NodeType::FunctionDecl if !looking_for_type => {
+                for param in ast.function_decl(scope_idx).params() {
+                    if param.name() == Some(name) {
+                        return ast.nodes[param.idx()].first_child;
+                    }
+                }
+            }
+            _ => {}
+        }
+        scope = scope_node.parent;
+    }
+    None
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn run(source: &str) -> DocumentAnalysis {
+        analyze(
+            source,
+            1,
+            &CompilerLimits::default(),
+            &Arc::new(AtomicBool::new(false)),
+        )
+        .unwrap()
+    }
+
+    #[test]
+    fn test_diagnostics_for_semantic_error() {
+        let analysis = run("x: 42\ny: nope\n");
+        assert_eq!(analysis.diagnostics.len(), 1);
+        assert_eq!(
+            (analysis.diagnostics[0].line, analysis.diagnostics[0].column),
+            (2, 4)
+        );
+        assert!(analysis.fallback_ast.is_some());
+    }
+
+    #[test]
+    fn test_diagnostics_for_parse_error() {
+        let analysis = run("x: (\n");
+        assert_eq!(analysis.diagnostics.len(), 1);
+        assert!(analysis.ast().is_none());
+    }
+
+    #[test]
+    fn test_cancelled_analysis() {
+        let cancel = Arc::new(AtomicBool::new(true));
+        assert!(analyze("x: 42\n", 1, &CompilerLimits::default(), &cancel).is_none());
+    }
+
+    #[test]
+    fn test_node_at_and_hover() {
+        let analysis = run("greeting: \"hi\"\nx: greeting\n");
+        let ast = analysis.ast().unwrap();
+
+        let idx = analysis.node_at(19).unwrap();
+        assert_eq!(ast.node_text(idx), Some("greeting"));
+        assert_eq!(hover(&analysis, 19).unwrap().1, "greeting String");
+
+        // Declaration identifier falls back to its VarDecl type
+        assert_eq!(hover(&analysis, 0).unwrap().1, "greeting String");
+        // String literal including its quotes
+        assert_eq!(hover(&analysis, 10).unwrap().1, "String");
+        assert!(hover(&analysis, 8).is_none()); // ':'
+    }
+
+    #[test]
+    fn test_find_definition_variable_and_param() {
+        let source = "x: 1\nf: (x Number) Number {\n    return x\n}\ny: x\n";
+        let analysis = run(source);
+        let ast = analysis.ast().unwrap();
+
+        // `x` inside the function resolves to the parameter
+        let use_in_body = analysis
+            .node_at(source.find("return x").unwrap() + 7)
+            .unwrap();
+        let def = find_definition(ast, use_in_body).unwrap();
+        assert_eq!(
+            ast.nodes[ast.nodes[def].parent.unwrap()].node_type,
+            NodeType::Param
+        );
+
+        // `x` at the top level resolves to the global
+        let use_global = analysis.node_at(source.rfind('x').unwrap()).unwrap();
+        let def = find_definition(ast, use_global).unwrap();
+        assert_eq!(ast.nodes[def].token.as_ref().unwrap().line, 1);
+    }
+
+    #[test]
+    fn test_find_definition_type() {
+        let source = "type Point: {\n    x Number\n}\np Point: { x: 1 }\n";
+        let analysis = run(source);
+        let ast = analysis.ast().unwrap();
+
+        let annotation = analysis.node_at(source.rfind("Point").unwrap()).unwrap();
+        assert_eq!(ast.nodes[annotation].node_type, NodeType::TypeAnnotation);
+        let def = find_definition(ast, annotation).unwrap();
+        assert_eq!(ast.nodes[def].node_type, NodeType::TypeName);
+    }
+
+    #[test]
+    fn test_find_definition_function_declared_later() {
+        let source = "main: () {\n    helper()\n}\nhelper: () { }\n";
+        let analysis = run(source);
+        let ast = analysis.ast().unwrap();
+
+        let call = analysis.node_at(source.find("helper").unwrap()).unwrap();
+        let def = find_definition(ast, call).unwrap();
+        assert_eq!(ast.nodes[def].token.as_ref().unwrap().line, 4);
+    }
+}
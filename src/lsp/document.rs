@@ -0,0 +1,137 @@
+// Open text documents and position conversion
+//
+// LSP positions are (line, character) pairs where `character` counts UTF-16
+// code units. The Suru lexer reports 1-indexed lines and columns that count
+// Unicode scalar values. These helpers convert both to byte offsets into the
+// document text and lexer locations to LSP positions.
+
+/// Zero-based LSP position (character in UTF-16 code units)
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub struct Position {
+    pub line: u32,
+    pub character: u32,
+}
+
+/// Half-open LSP range
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Range {
+    pub start: Position,
+    pub end: Position,
+}
+
+/// An open document as last sent by the client
+#[derive(Debug, Clone)]
+pub struct Document {
+    pub text: String,
+    pub version: i64,
+}
+
+impl Document {
+    pub fn new(text: String, version: i64) -> Self {
+        Self { text, version }
+    }
+
+    /// Applies a `didChange` content change (full text when `range` is None)
+    pub fn apply_change(&mut self, range: Option<Range>, new_text: &str) {
+        match range {
+            None => self.text = new_text.to_string(),
+            Some(range) => {
+                let start = offset_at(&self.text, range.start);
+                let end = offset_at(&self.text, range.end).max(start);
+                self.text.replace_range(start..end, new_text);
+            }
+        }
+    }
+}
+
+/// Converts an LSP position to a byte offset, clamping to the text bounds
+pub fn offset_at(text: &str, position: Position) -> usize {
+    let mut line_start = 0;
+    for _ in 0..position.line {
+        match text[line_start..].find('\n') {
+            Some(nl) => line_start += nl + 1,
+            None => return text.len(),
+        }
+    }
+
+    let mut units = 0;
+    for (i, ch) in text[line_start..].char_indices() {
+        if ch == '\n' || units >= position.character {
+            return line_start + i;
+        }
+        units += ch.len_utf16() as u32;
+    }
+    text.len()
+}
+
+/// Converts a lexer location (1-indexed line, 1-indexed char column) to an LSP position
+pub fn position_from_lexer(text: &str, line: usize, column: usize) -> Position {
+    let line_idx = line.saturating_sub(1);
+    let line_text = text.split('\n').nth(line_idx).unwrap_or("");
+    let character = line_text
+        .chars()
+        .take(column.saturating_sub(1))
+        .map(|c| c.len_utf16() as u32)
+        .sum();
+    Position {
+        line: line_idx as u32,
+        character,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn pos(line: u32, character: u32) -> Position {
+        Position { line, character }
+    }
+
+    #[test]
+    fn test_offset_at() {
+        let text = "ab\ncde\n";
+        assert_eq!(offset_at(text, pos(0, 0)), 0);
+        assert_eq!(offset_at(text, pos(0, 2)), 2);
+        assert_eq!(offset_at(text, pos(0, 99)), 2); // clamped to end of line
+        assert_eq!(offset_at(text, pos(1, 1)), 4);
+        assert_eq!(offset_at(text, pos(5, 0)), text.len());
+    }
+
+    #[test]
+    fn test_offset_at_utf16() {
+        // '😀' is 2 UTF-16 code units and 4 bytes
+        let text = "s: \"😀x\"";
+        assert_eq!(offset_at(text, pos(0, 4)), 4);
+        assert_eq!(offset_at(text, pos(0, 6)), 8);
+    }
+
+    #[test]
+    fn test_incremental_change() {
+        let mut doc = Document::new("x: 1\ny: 2\n".to_string(), 1);
+        doc.apply_change(
+            Some(Range {
+                start: pos(1, 3),
+                end: pos(1, 4),
+            }),
+            "42",
+        );
+        assert_eq!(doc.text, "x: 1\ny: 42\n");
+        doc.apply_change(
+            Some(Range {
+                start: pos(2, 0),
+                end: pos(2, 0),
+            }),
+            "z: y\n",
+        );
+        assert_eq!(doc.text, "x: 1\ny: 42\nz: y\n");
+        doc.apply_change(None, "w: 0\n");
+        assert_eq!(doc.text, "w: 0\n");
+    }
+
+    #[test]
+    fn test_position_from_lexer() {
+        let text = "a: \"é\"\nbb: a\n";
+        assert_eq!(position_from_lexer(text, 2, 5), pos(1, 4));
+        assert_eq!(position_from_lexer(text, 1, 6), pos(0, 5));
+    }
+}
@@ -0,0 +1,607 @@
+// Language server module - `suru lsp` over stdio
+//
+// Serves diagnostics, hover (types from `AnalysisOutput.node_types`) and
+// go-to-definition. Edits are applied incrementally to the open document
+// text and analysis runs on a background worker:
+//   - edits arriving within `DEBOUNCE` of each other are coalesced
+//   - every edit raises the cancel flag of the analysis still running for
+//     that document, so stale work stops at the next node it visits
+//   - hover/definition on a document whose analysis is behind re-analyze
+//     synchronously, so answers always match the text the client sees
+//
+// Analysis itself is not incremental: every version of a document is
+// lexed, parsed and analyzed from scratch, since type inference spans the
+// whole file. Analyses run outside the `analyses` lock, which is only held
+// to read or store a finished one.
+mod analysis;
+mod document;
+mod transport;
+
+pub use analysis::{Diagnostic, DocumentAnalysis, find_definition, hover};
+pub use document::{Document, Position, Range};
+pub use transport::{read_message, write_message};
+
+use std::collections::HashMap;
+use std::io::{self, BufRead, Write};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{self, Receiver, RecvTimeoutError, Sender};
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+
+use serde_json::{Value, json};
+
+use crate::limits::CompilerLimits;
+use crate::spans::SpanTable;
+
+/// Quiet period after an edit before analysis starts
+const DEBOUNCE: Duration = Duration::from_millis(15);
+
+// JSON-RPC error codes
+const INVALID_REQUEST: i64 = -32600;
+const METHOD_NOT_FOUND: i64 = -32601;
+const INVALID_PARAMS: i64 = -32602;
+
+/// Output stream shared by the request loop and the analysis worker
+type SharedWriter = Arc<Mutex<Box<dyn Write + Send>>>;
+
+/// State shared with the analysis worker
+struct Shared {
+    out: SharedWriter,
+    analyses: Mutex<HashMap<String, DocumentAnalysis>>,
+    limits: CompilerLimits,
+}
+
+impl Shared {
+    fn send(&self, message: &Value) {
+        let mut out = self.out.lock().unwrap_or_else(|e| e.into_inner());
+        // The client closing the stream ends the session on the read side
+        let _ = write_message(&mut **out, message);
+    }
+}
+
+/// A pending analysis of one document version
+struct Job {
+    uri: String,
+    version: i64,
+    text: String,
+    cancel: Arc<AtomicBool>,
+}
+
+/// Runs the language server until `exit` or end of input
+///
+/// Returns true when the client sent `shutdown` before `exit`.
+pub fn serve<R: BufRead>(
+    mut input: R,
+    output: Box<dyn Write + Send>,
+    limits: CompilerLimits,
+) -> io::Result<bool> {
+    let shared = Arc::new(Shared {
+        out: Arc::new(Mutex::new(output)),
+        analyses: Mutex::new(HashMap::new()),
+        limits,
+    });
+
+    let (jobs, rx) = mpsc::channel();
+    let worker = {
+        let shared = Arc::clone(&shared);
+        std::thread::spawn(move || analysis_worker(rx, shared))
+    };
+
+    let mut server = Server {
+        shared: Arc::clone(&shared),
+        jobs,
+        documents: HashMap::new(),
+        cancel_flags: HashMap::new(),
+        shutdown_requested: false,
+    };
+
+    let result = loop {
+        let message = match read_message(&mut input) {
+            Ok(Some(m)) => m,
+            Ok(None) => break Ok(()),
+            Err(e) => break Err(e),
+        };
+        if !server.dispatch(&message) {
+            break Ok(());
+        }
+    };
+
+    let clean = server.shutdown_requested;
+    drop(server); // closes the job channel so the worker drains and exits
+    let _ = worker.join();
+    result.map(|()| clean)
+}
+
+struct Server {
+    shared: Arc<Shared>,
+    jobs: Sender<Job>,
+    documents: HashMap<String, Document>,
+    cancel_flags: HashMap<String, Arc<AtomicBool>>,
+    shutdown_requested: bool,
+}
+
+impl Server {
+    /// Handles one message; returns false when the session should end
+    fn dispatch(&mut self, message: &Value) -> bool {
+        let method = message["method"].as_str().unwrap_or("");
+        let id = message.get("id").cloned();
+        let params = &message["params"];
+
+        if method == "exit" {
+            return false;
+        }
+
+        let Some(id) = id else {
+            self.notification(method, params);
+            return true;
+        };
+
+        if self.shutdown_requested {
+            self.error(id, INVALID_REQUEST, "Server is shutting down");
+            return true;
+        }
+
+        match method {
+            "initialize" => self.respond(id, initialize_result()),
+            "shutdown" => {
+                self.shutdown_requested = true;
+                self.respond(id, Value::Null);
+            }
+            "textDocument/hover" => match text_position(params) {
+                Some((uri, pos)) => {
+                    let result = self.hover(&uri, pos);
+                    self.respond(id, result);
+                }
+                None => self.error(id, INVALID_PARAMS, "Expected textDocument and position"),
+            },
+            "textDocument/definition" => match text_position(params) {
+                Some((uri, pos)) => {
+                    let result = self.definition(&uri, pos);
+                    self.respond(id, result);
+                }
+                None => self.error(id, INVALID_PARAMS, "Expected textDocument and position"),
+            },
+            _ => self.error(
+                id,
+                METHOD_NOT_FOUND,
+                &format!("Unhandled method '{}'", method),
+            ),
+        }
+        true
+    }
+
+    fn notification(&mut self, method: &str, params: &Value) {
+        let uri = params["textDocument"]["uri"]
+            .as_str()
+            .unwrap_or("")
+            .to_string();
+        match method {
+            "textDocument/didOpen" => {
+                let doc = &params["textDocument"];
+                let text = doc["text"].as_str().unwrap_or("").to_string();
+                let version = doc["version"].as_i64().unwrap_or(0);
+                self.documents
+                    .insert(uri.clone(), Document::new(text, version));
+                self.schedule(&uri);
+            }
+            "textDocument/didChange" => {
+                let Some(doc) = self.documents.get_mut(&uri) else {
+                    return;
+                };
+                if let Some(changes) = params["contentChanges"].as_array() {
+                    for change in changes {
+                        let text = change["text"].as_str().unwrap_or("");
+                        doc.apply_change(parse_range(&change["range"]), text);
+                    }
+                }
+                doc.version = params["textDocument"]["version"]
+                    .as_i64()
+                    .unwrap_or(doc.version + 1);
+                self.schedule(&uri);
+            }
+            "textDocument/didClose" => {
+                self.documents.remove(&uri);
+                if let Some(flag) = self.cancel_flags.remove(&uri) {
+                    flag.store(true, Ordering::Relaxed);
+                }
+                self.shared.analyses.lock().unwrap().remove(&uri);
+                self.shared
+                    .send(&publish_diagnostics(&uri, None, Vec::new()));
+            }
+            // initialized, $/cancelRequest, didSave, ... need no action
+            _ => {}
+        }
+    }
+
+    /// Cancels any in-flight analysis of `uri` and queues the current text
+    fn schedule(&mut self, uri: &str) {
+        let Some(doc) = self.documents.get(uri) else {
+            return;
+        };
+        let cancel = Arc::new(AtomicBool::new(false));
+        if let Some(old) = self
+            .cancel_flags
+            .insert(uri.to_string(), Arc::clone(&cancel))
+        {
+            old.store(true, Ordering::Relaxed);
+        }
+        let _ = self.jobs.send(Job {
+            uri: uri.to_string(),
+            version: doc.version,
+            text: doc.text.clone(),
+            cancel,
+        });
+    }
+
+    /// Runs `f` against an analysis of the document's current version
+    fn with_analysis<T>(
+        &self,
+        uri: &str,
+        f: impl FnOnce(&Document, &DocumentAnalysis) -> Option<T>,
+    ) -> Option<T> {
+        let doc = self.documents.get(uri)?;
+        let stale = (self.shared.analyses.lock().unwrap())
+            .get(uri)
+            .is_none_or(|a| a.version != doc.version);
+        if stale {
+            // The worker may store this version meanwhile; either is current
+            let fresh = Arc::new(AtomicBool::new(false));
+            let result = analysis::analyze(&doc.text, doc.version, &self.shared.limits, &fresh)?;
+            self.shared
+                .analyses
+                .lock()
+                .unwrap()
+                .insert(uri.to_string(), result);
+        }
+        let analyses = self.shared.analyses.lock().unwrap();
+        f(doc, analyses.get(uri)?)
+    }
+
+    fn hover(&self, uri: &str, pos: Position) -> Value {
+        self.with_analysis(uri, |doc, analysis| {
+            let (idx, label) = hover(analysis, document::offset_at(&doc.text, pos))?;
+            let range = node_range(&doc.text, analysis.spans.as_ref()?, idx)?;
+            Some(json!({
+                "contents": { "kind": "markdown", "value": format!("```suru\n{}\n```", label) },
+                "range": range_json(range),
+            }))
+        })
+        .unwrap_or(Value::Null)
+    }
+
+    fn definition(&self, uri: &str, pos: Position) -> Value {
+        self.with_analysis(uri, |doc, analysis| {
+            let node = analysis.node_at(document::offset_at(&doc.text, pos))?;
+            let def = find_definition(analysis.ast()?, node)?;
+            let range = node_range(&doc.text, analysis.spans.as_ref()?, def)?;
+            Some(json!({ "uri": uri, "range": range_json(range) }))
+        })
+        .unwrap_or(Value::Null)
+    }
+
+    fn respond(&self, id: Value, result: Value) {
+        self.shared
+            .send(&json!({ "jsonrpc": "2.0", "id": id, "result": result }));
+    }
+
+    fn error(&self, id: Value, code: i64, message: &str) {
+        self.shared.send(&json!({
+            "jsonrpc": "2.0",
+            "id": id,
+            "error": { "code": code, "message": message },
+        }));
+    }
+}
+
+/// Background analysis loop: debounce, analyze, publish
+fn analysis_worker(rx: Receiver<Job>, shared: Arc<Shared>) {
+    while let Ok(first) = rx.recv() {
+        // Coalesce bursts of edits, keeping only the latest job per document
+        let mut pending: Vec<Job> = vec![first];
+        loop {
+            match rx.recv_timeout(DEBOUNCE) {
+                Ok(job) => {
+                    pending.retain(|j| j.uri != job.uri);
+                    pending.push(job);
+                }
+                Err(RecvTimeoutError::Timeout) | Err(RecvTimeoutError::Disconnected) => break,
+            }
+        }
+
+        for job in pending {
+            if job.cancel.load(Ordering::Relaxed) {
+                continue;
+            }
+            let Some(result) =
+                analysis::analyze(&job.text, job.version, &shared.limits, &job.cancel)
+            else {
+                continue; // superseded by a newer edit
+            };
+
+            let diagnostics: Vec<Value> = result
+                .diagnostics
+                .iter()
+                .map(|d| diagnostic_json(&job.text, d))
+                .collect();
+
+            let mut analyses = shared.analyses.lock().unwrap();
+            if job.cancel.load(Ordering::Relaxed) {
+                continue;
+            }
+            analyses.insert(job.uri.clone(), result);
+            drop(analyses);
+
+            shared.send(&publish_diagnostics(
+                &job.uri,
+                Some(job.version),
+                diagnostics,
+            ));
+        }
+    }
+}
+
+// ========== JSON Helpers ==========
+
+fn initialize_result() -> Value {
+    json!({
+        "capabilities": {
+            "textDocumentSync": { "openClose": true, "change": 2 },
+            "hoverProvider": true,
+            "definitionProvider": true,
+        },
+        "serverInfo": { "name": "suru", "version": env!("CARGO_PKG_VERSION") },
+    })
+}
+
+fn publish_diagnostics(uri: &str, version: Option<i64>, diagnostics: Vec<Value>) -> Value {
+    let mut params = json!({ "uri": uri, "diagnostics": diagnostics });
+    if let Some(v) = version {
+        params["version"] = json!(v);
+    }
+    json!({ "jsonrpc": "2.0", "method": "textDocument/publishDiagnostics", "params": params })
+}
+
+fn diagnostic_json(text: &str, diagnostic: &Diagnostic) -> Value {
+    let start =
+        document::position_from_lexer(text, diagnostic.line.max(1), diagnostic.column.max(1));
+    // Underline the word at the error location (at least one character)
+    let offset = document::offset_at(text, start);
+    let word_len = text[offset..]
+        .chars()
+        .take_while(|c| c.is_ascii_alphanumeric() || *c == '_')
+        .map(|c| c.len_utf16() as u32)
+        .sum::<u32>()
+        .max(1);
+    let end = Position {
+        line: start.line,
+        character: start.character + word_len,
+    };
+
+    json!({
+        "range": range_json(Range { start, end }),
+        "severity": 1,
+        "source": "suru",
+        "message": diagnostic.message,
+    })
+}
+
+/// LSP range covering the token of an AST node
+fn node_range(text: &str, spans: &SpanTable, idx: usize) -> Option<Range> {
+    let span = spans.token_span(idx)?;
+    let position = |offset: usize| {
+        let (line, line_start) = spans.line_of(offset);
+        let character = text[line_start..offset].encode_utf16().count() as u32;
+        Position {
+            line: line as u32,
+            character,
+        }
+    };
+    Some(Range {
+        start: position(span.start),
+        end: position(span.end),
+    })
+}
+
+fn range_json(range: Range) -> Value {
+    json!({
+        "start": { "line": range.start.line, "character": range.start.character },
+        "end": { "line": range.end.line, "character": range.end.character },
+    })
+}
+
+fn parse_position(value: &Value) -> Option<Position> {
+    Some(Position {
+        line: value["line"].as_u64()? as u32,
+        character: value["character"].as_u64()? as u32,
+    })
+}
+
+fn parse_range(value: &Value) -> Option<Range> {
+    Some(Range {
+        start: parse_position(&value["start"])?,
+        end: parse_position(&value["end"])?,
+    })
+}
+
+fn text_position(params: &Value) -> Option<(String, Position)> {
+    let uri = params["textDocument"]["uri"].as_str()?.to_string();
+    Some((uri, parse_position(&params["position"])?))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// In-memory writer the test can inspect after the session ends
+    #[derive(Clone, Default)]
+    struct Capture(Arc<Mutex<Vec<u8>>>);
+
+    impl Write for Capture {
+        fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+            self.0.lock().unwrap().extend_from_slice(buf);
+            Ok(buf.len())
+        }
+        fn flush(&mut self) -> io::Result<()> {
+            Ok(())
+        }
+    }
+
+    fn session(messages: &[Value]) -> (bool, Vec<Value>) {
+        let mut input = Vec::new();
+        for m in messages {
+            write_message(&mut input, m).unwrap();
+        }
+        let capture = Capture::default();
+        let clean = serve(
+            io::Cursor::new(input),
+            Box::new(capture.clone()),
+            CompilerLimits::default(),
+        )
+        .unwrap();
+
+        let bytes = capture.0.lock().unwrap().clone();
+        let mut reader = io::Cursor::new(bytes);
+        let mut out = Vec::new();
+        while let Some(m) = read_message(&mut reader).unwrap() {
+            out.push(m);
+        }
+        (clean, out)
+    }
+
+    fn response(messages: &[Value], id: i64) -> &Value {
+        messages
+            .iter()
+            .find(|m| m["id"] == id)
+            .expect("missing response")
+    }
+
+    fn open(uri: &str, text: &str) -> Value {
+        json!({
+            "jsonrpc": "2.0",
+            "method": "textDocument/didOpen",
+            "params": { "textDocument": { "uri": uri, "languageId": "suru", "version": 1, "text": text } },
+        })
+    }
+
+    fn request(id: i64, method: &str, uri: &str, line: u32, character: u32) -> Value {
+        json!({
+            "jsonrpc": "2.0",
+            "id": id,
+            "method": method,
+            "params": {
+                "textDocument": { "uri": uri },
+                "position": { "line": line, "character": character },
+            },
+        })
+    }
+
+    fn end_session(id: i64) -> [Value; 2] {
+        [
+            json!({ "jsonrpc": "2.0", "id": id, "method": "shutdown" }),
+            json!({ "jsonrpc": "2.0", "method": "exit" }),
+        ]
+    }
+
+    #[test]
+    fn test_initialize_capabilities() {
+        let [shutdown, exit] = end_session(2);
+        let (clean, out) = session(&[
+            json!({ "jsonrpc": "2.0", "id": 1, "method": "initialize", "params": {} }),
+            shutdown,
+            exit,
+        ]);
+        assert!(clean);
+        let caps = &response(&out, 1)["result"]["capabilities"];
+        assert_eq!(caps["hoverProvider"], true);
+        assert_eq!(caps["definitionProvider"], true);
+        assert_eq!(caps["textDocumentSync"]["change"], 2);
+    }
+
+    #[test]
+    fn test_diagnostics_published_for_latest_version() {
+        let uri = "file:///main.suru";
+        let [shutdown, exit] = end_session(9);
+        let (_, out) = session(&[
+            open(uri, "x: 42\n"),
+            json!({
+                "jsonrpc": "2.0",
+                "method": "textDocument/didChange",
+                "params": {
+                    "textDocument": { "uri": uri, "version": 2 },
+                    "contentChanges": [{
+                        "range": { "start": { "line": 0, "character": 3 }, "end": { "line": 0, "character": 5 } },
+                        "text": "nope",
+                    }],
+                },
+            }),
+            shutdown,
+            exit,
+        ]);
+
+        let published: Vec<&Value> = out
+            .iter()
+            .filter(|m| m["method"] == "textDocument/publishDiagnostics")
+            .collect();
+        let last = published.last().expect("no diagnostics published");
+        assert_eq!(last["params"]["version"], 2);
+        let diags = last["params"]["diagnostics"].as_array().unwrap();
+        assert_eq!(diags.len(), 1);
+        assert!(diags[0]["message"].as_str().unwrap().contains("nope"));
+        assert_eq!(
+            diags[0]["range"]["start"],
+            json!({ "line": 0, "character": 3 })
+        );
+        assert_eq!(
+            diags[0]["range"]["end"],
+            json!({ "line": 0, "character": 7 })
+        );
+    }
+
+    #[test]
+    fn test_hover_and_definition() {
+        let uri = "file:///main.suru";
+        let [shutdown, exit] = end_session(9);
+        let (_, out) = session(&[
+            open(uri, "count: 42\ntotal: count\n"),
+            request(1, "textDocument/hover", uri, 1, 8),
+            request(2, "textDocument/definition", uri, 1, 8),
+            request(3, "textDocument/hover", uri, 0, 6),
+            shutdown,
+            exit,
+        ]);
+
+        let hover = &response(&out, 1)["result"];
+        assert_eq!(hover["contents"]["value"], "```suru\ncount Number\n```");
+        assert_eq!(
+            hover["range"]["start"],
+            json!({ "line": 1, "character": 7 })
+        );
+
+        let def = &response(&out, 2)["result"];
+        assert_eq!(def["uri"], uri);
+        assert_eq!(def["range"]["start"], json!({ "line": 0, "character": 0 }));
+        assert_eq!(def["range"]["end"], json!({ "line": 0, "character": 5 }));
+
+        // Whitespace/punctuation has no hover
+        assert_eq!(response(&out, 3)["result"], Value::Null);
+    }
+
+    #[test]
+    fn test_unknown_request_and_requests_after_shutdown() {
+        let (clean, out) = session(&[
+            json!({ "jsonrpc": "2.0", "id": 1, "method": "textDocument/rename", "params": {} }),
+            json!({ "jsonrpc": "2.0", "id": 2, "method": "shutdown" }),
+            json!({ "jsonrpc": "2.0", "id": 3, "method": "initialize", "params": {} }),
+            json!({ "jsonrpc": "2.0", "method": "exit" }),
+        ]);
+        assert!(clean);
+        assert_eq!(response(&out, 1)["error"]["code"], METHOD_NOT_FOUND);
+        assert_eq!(response(&out, 3)["error"]["code"], INVALID_REQUEST);
+    }
+
+    #[test]
+    fn test_exit_without_shutdown_is_unclean() {
+        let (clean, _) = session(&[json!({ "jsonrpc": "2.0", "method": "exit" })]);
+        assert!(!clean);
+    }
+}
@@ -0,0 +1,86 @@
+// LSP base protocol framing
+//
+// Each message is a JSON body preceded by HTTP-style headers:
+//   Content-Length: <bytes>\r\n
+//   \r\n
+//   <body>
+
+use std::io::{self, BufRead, Write};
+
+use serde_json::Value;
+
+/// Largest accepted message body (guards against bogus Content-Length values)
+const MAX_MESSAGE_LEN: usize = 64 * 1024 * 1024;
+
+/// Reads one message; returns `Ok(None)` on a clean end of input
+pub fn read_message<R: BufRead>(reader: &mut R) -> io::Result<Option<Value>> {
+    let mut content_length: Option<usize> = None;
+    let mut line = String::new();
+
+    loop {
+        line.clear();
+        if reader.read_line(&mut line)? == 0 {
+            return Ok(None);
+        }
+        let header = line.trim_end_matches(['\r', '\n']);
+        if header.is_empty() {
+            break;
+        }
+        if let Some((name, value)) = header.split_once(':') {
+            if name.eq_ignore_ascii_case("Content-Length") {
+                content_length = value.trim().parse().ok();
+            }
+        }
+    }
+
+    let len = content_length.ok_or_else(|| invalid("Missing Content-Length header"))?;
+    if len > MAX_MESSAGE_LEN {
+        return Err(invalid("Message too large"));
+    }
+
+    let mut body = vec![0; len];
+    reader.read_exact(&mut body)?;
+    serde_json::from_slice(&body)
+        .map(Some)
+        .map_err(|e| invalid(&format!("Invalid JSON message: {}", e)))
+}
+
+/// Writes one message with its Content-Length header
+pub fn write_message<W: Write + ?Sized>(writer: &mut W, message: &Value) -> io::Result<()> {
+    let body = message.to_string();
+    write!(writer, "Content-Length: {}\r\n\r\n", body.len())?;
+    writer.write_all(body.as_bytes())?;
+    writer.flush()
+}
+
+fn invalid(message: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, message.to_string())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::json;
+
+    #[test]
+    fn test_roundtrip() {
+        let message = json!({"jsonrpc": "2.0", "id": 1, "method": "initialize"});
+        let mut buf = Vec::new();
+        write_message(&mut buf, &message).unwrap();
+        write_message(&mut buf, &json!({"jsonrpc": "2.0", "method": "exit"})).unwrap();
+
+        let mut reader = io::Cursor::new(buf);
+        assert_eq!(read_message(&mut reader).unwrap(), Some(message));
+        assert_eq!(
+            read_message(&mut reader).unwrap().unwrap()["method"],
+            "exit"
+        );
+        assert_eq!(read_message(&mut reader).unwrap(), None);
+    }
+
+    #[test]
+    fn test_missing_content_length() {
+        let mut reader = io::Cursor::new(b"Content-Type: x\r\n\r\n{}".to_vec());
+        assert!(read_message(&mut reader).is_err());
+    }
+}
@@ -1,6 +1,11 @@
 use clap::Parser;
 use suru_lang::cli::{Cli, Commands};
-use suru_lang::{lexer, limits, parser, semantic};
+use suru_lang::driver::{self, CommandOutput};
+use suru_lang::stats::{self, CountingAllocator, Profile};
+
+// Counts allocations only once `--time-passes` or `--mem-report` enables it
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
 
 fn main() {
     std::process::exit(match run() {
@@ -18,97 +23,241 @@ fn run() -> Result<(), Box<dyn std::error::Error>> {
     match cli.command {
         Commands::Parse(args) => parse_command(args)?,
         Commands::Check(args) => check_command(args)?,
+        Commands::Lower(args) => lower_command(args)?,
+        Commands::Build(args) => build_command(args)?,
+        Commands::Run(args) => run_command(args)?,
+        Commands::Daemon(args) => daemon_command(args)?,
+        Commands::Lsp => lsp_command()?,
     }
 
     Ok(())
 }
 
+/// Prints captured command output and exits with its status on failure
+fn finish(output: CommandOutput) -> Result<(), Box<dyn std::error::Error>> {
+    output.emit();
+    if output.exit_code != 0 {
+        std::process::exit(output.exit_code);
+    }
+    Ok(())
+}
+
 fn check_command(args: suru_lang::cli::CheckArgs) -> Result<(), Box<dyn std::error::Error>> {
-    let limits = match limits::CompilerLimits::from_project_toml("project.toml") {
-        Ok(l) => {
-            l.validate()?;
-            l
+    let trace = args.trace.as_deref();
+    start_trace(trace)?;
+    if let Some(dir) = args.watch {
+        return watch_command(&dir, args.jobs, args.poll, trace);
+    }
+    let file = args.file.ok_or("Expected a file path or --watch <dir>")?;
+
+    // Prefer a running daemon with warm caches; reports measure this process
+    #[cfg(unix)]
+    if !args.time_passes && !args.stats && !args.mem_report && trace.is_none() {
+        if let Some(output) =
+            suru_lang::daemon::try_forward(suru_lang::daemon::RequestKind::Check, &file)
+        {
+            return finish(output);
         }
-        Err(_) => limits::CompilerLimits::default(),
+    }
+
+    let limits = driver::load_limits(".")?;
+    let mut profile = new_profile(args.time_passes, args.mem_report);
+    let output = driver::check_file_profiled(&file, &limits, &mut profile);
+    write_trace(trace)?;
+    finish(with_reports(output, &profile, args.stats))
+}
+
+fn lower_command(args: suru_lang::cli::LowerArgs) -> Result<(), Box<dyn std::error::Error>> {
+    let limits = driver::load_limits(".")?;
+    let options = suru_lang::lower::LowerOptions { share_generics: args.share_generics };
+    let mut profile = new_profile(args.time_passes, args.mem_report);
+    let output = driver::lower_file_profiled(&args.file, &options, &limits, &mut profile);
+    finish(with_reports(output, &profile, false))
+}
+
+fn build_command(args: suru_lang::cli::BuildArgs) -> Result<(), Box<dyn std::error::Error>> {
+    let limits = driver::load_limits(".")?;
+    let output = match &args.output {
+        Some(path) => std::path::PathBuf::from(path),
+        None => driver::default_executable_path(&args.file),
+    };
+    let options = suru_lang::codegen::BuildOptions {
+        opt_level: args.opt_level,
+        target_cpu: args.target_cpu,
+        codegen_units: args.codegen_units,
+        cache_dir: (!args.no_cache).then(driver::default_cache_dir),
     };
+    let mut profile = new_profile(args.time_passes, false);
+    let result = driver::build_file_profiled(&args.file, &output, &options, &limits, &mut profile);
+    finish(with_reports(result, &profile, args.stats))
+}
 
-    let source = std::fs::read_to_string(&args.file)
-        .map_err(|e| format!("Failed to read '{}': {}", args.file, e))?;
+fn run_command(args: suru_lang::cli::RunArgs) -> Result<(), Box<dyn std::error::Error>> {
+    let limits = driver::load_limits(".")?;
+    let mut profile = new_profile(args.time_passes, false);
+    let mode = if args.native { driver::RunMode::Native } else { driver::RunMode::Jit };
+    let result = driver::run_file_profiled(&args.file, mode, &limits, &mut profile);
+    finish(with_reports(result, &profile, false))
+}
 
-    if source.len() > limits.max_input_size {
-        return Err(format!(
-            "Input too large: {} bytes (max: {})",
-            source.len(),
-            limits.max_input_size
-        )
-        .into());
+fn watch_command(
+    dir: &str,
+    jobs: Option<usize>,
+    poll: bool,
+    trace: Option<&str>,
+) -> Result<(), Box<dyn std::error::Error>> {
+    use suru_lang::watch::{Project, ThreadPool, Watcher};
+
+    let root = std::path::Path::new(dir);
+    if !root.is_dir() {
+        return Err(format!("'{}' is not a directory", dir).into());
     }
 
-    let tokens = lexer::lex(&source, &limits)?;
-    let ast = parser::parse(tokens, &limits)?;
-    let analyzer = semantic::SemanticAnalyzer::new(ast);
+    let limits = driver::load_limits(root)?;
+    let pool = match jobs {
+        Some(n) => ThreadPool::new(n),
+        None => ThreadPool::with_available_parallelism(),
+    };
+    // Start watching before the initial check so no edit is missed
+    let mut watcher = Watcher::new(root, poll);
+    println!(
+        "Watching {} ({}, {} thread{})",
+        root.display(),
+        watcher.kind(),
+        pool.size(),
+        if pool.size() == 1 { "" } else { "s" }
+    );
 
-    match analyzer.analyze() {
-        Ok(_) => {
-            println!("No errors found.");
-            Ok(())
-        }
-        Err(errors) => {
-            for error in &errors {
-                eprintln!("{error}");
-            }
-            std::process::exit(1);
-        }
+    let mut project = Project::new(root, limits);
+    let mut stdout = std::io::stdout();
+    project.round(&pool, &[root.to_path_buf()], &mut stdout)?;
+    write_trace(trace)?;
+    loop {
+        let changed = watcher.wait()?;
+        project.round(&pool, &changed, &mut stdout)?;
+        write_trace(trace)?;
     }
 }
 
 fn parse_command(args: suru_lang::cli::ParseArgs) -> Result<(), Box<dyn std::error::Error>> {
-    // Load compiler limits from project.toml or use defaults
-    let limits = match limits::CompilerLimits::from_project_toml("project.toml") {
-        Ok(l) => {
-            l.validate()?;
-            l
-        }
-        Err(_) => {
-            // Silently use defaults
-            limits::CompilerLimits::default()
+    let trace = args.trace.as_deref();
+    start_trace(trace)?;
+
+    // Prefer a running daemon with warm caches; reports measure this process
+    #[cfg(unix)]
+    if !args.time_passes && !args.stats && !args.mem_report && trace.is_none() {
+        if let Some(output) =
+            suru_lang::daemon::try_forward(suru_lang::daemon::RequestKind::Parse, &args.file)
+        {
+            return finish(output);
         }
+    }
+
+    // Load compiler limits from project.toml or use defaults
+    let limits = driver::load_limits(".")?;
+
+    // Lex, parse, run semantic analysis and print annotated output
+    let mut profile = new_profile(args.time_passes, args.mem_report);
+    let output = driver::parse_file_profiled(&args.file, &limits, &mut profile);
+    write_trace(trace)?;
+    finish(with_reports(output, &profile, args.stats))
+}
+
+/// Starts recording trace spans when `--trace` was given
+#[cfg(feature = "trace")]
+fn start_trace(path: Option<&str>) -> Result<(), Box<dyn std::error::Error>> {
+    if path.is_some() {
+        suru_lang::trace::start();
+    }
+    Ok(())
+}
+
+#[cfg(not(feature = "trace"))]
+fn start_trace(path: Option<&str>) -> Result<(), Box<dyn std::error::Error>> {
+    match path {
+        Some(_) => Err("--trace needs a build with `--features trace`".into()),
+        None => Ok(()),
+    }
+}
+
+/// Writes the spans recorded since the last write to the `--trace` file
+#[cfg(feature = "trace")]
+fn write_trace(path: Option<&str>) -> Result<(), Box<dyn std::error::Error>> {
+    if let Some(path) = path {
+        suru_lang::trace::write_chrome_json(std::path::Path::new(path))
+            .map_err(|e| format!("Failed to write trace '{}': {}", path, e))?;
+    }
+    Ok(())
+}
+
+#[cfg(not(feature = "trace"))]
+fn write_trace(_path: Option<&str>) -> Result<(), Box<dyn std::error::Error>> {
+    Ok(())
+}
+
+/// Profile for one command; `--time-passes` and `--mem-report` also turn on
+/// allocation counting (the memory report then includes the heap peak)
+fn new_profile(time_passes: bool, mem_report: bool) -> Profile {
+    if time_passes || mem_report {
+        stats::enable_alloc_counting();
+    }
+    let profile = if time_passes {
+        Profile::enabled()
+    } else {
+        Profile::default()
     };
+    if mem_report {
+        profile.with_mem_report()
+    } else {
+        profile
+    }
+}
 
-    // Read source file
-    let source = std::fs::read_to_string(&args.file)
-        .map_err(|e| format!("Failed to read '{}': {}", args.file, e))?;
-
-    // Check input size limit
-    if source.len() > limits.max_input_size {
-        return Err(format!(
-            "Input too large: {} bytes (max: {})",
-            source.len(),
-            limits.max_input_size
-        )
-        .into());
-    }
-
-    // Lex and parse
-    let tokens = lexer::lex(&source, &limits)?;
-    let ast = parser::parse(tokens, &limits)?;
-
-    // Run semantic analysis and print annotated output
-    let analyzer = semantic::SemanticAnalyzer::new(ast);
-    match analyzer.analyze_with_types() {
-        Ok(output) => {
-            print!("{}", output.to_annotated_string());
-        }
-        Err(err) => {
-            // Show the plain AST so the parse structure is still visible
-            print!("{}", err.ast.to_string());
-            eprintln!("\nSemantic errors:");
-            for error in &err.errors {
-                eprintln!("  {error}");
-            }
-            std::process::exit(1);
-        }
+/// Appends the `--time-passes`, `--stats` and `--mem-report` tables to stderr
+fn with_reports(mut output: CommandOutput, profile: &Profile, show_counts: bool) -> CommandOutput {
+    if profile.is_enabled() {
+        output.stderr.push_str(&profile.render_passes());
+    }
+    if show_counts {
+        output.stderr.push_str(&profile.render_counts());
+    }
+    if let Some(memory) = &profile.memory {
+        output.stderr.push_str(&memory.render());
     }
+    output
+}
 
+fn lsp_command() -> Result<(), Box<dyn std::error::Error>> {
+    let limits = driver::load_limits(".")?;
+    let stdin = std::io::stdin();
+    let clean = suru_lang::lsp::serve(stdin.lock(), Box::new(std::io::stdout()), limits)?;
+    // LSP: exit code 1 when the client exits without a prior shutdown request
+    if !clean {
+        std::process::exit(1);
+    }
     Ok(())
 }
+
+#[cfg(unix)]
+fn daemon_command(args: suru_lang::cli::DaemonArgs) -> Result<(), Box<dyn std::error::Error>> {
+    use suru_lang::daemon;
+
+    let socket = daemon::socket_path(args.socket.as_deref());
+    let socket = socket.as_path();
+
+    if args.stop {
+        daemon::request(socket, &daemon::Request::Shutdown)
+            .map_err(|e| format!("No daemon listening on '{}': {}", socket.display(), e))?;
+        println!("Daemon stopped.");
+        return Ok(());
+    }
+
+    println!("Daemon listening on {}", socket.display());
+    daemon::serve(socket, std::time::Duration::from_millis(args.poll_ms))?;
+    Ok(())
+}
+
+#[cfg(not(unix))]
+fn daemon_command(_args: suru_lang::cli::DaemonArgs) -> Result<(), Box<dyn std::error::Error>> {
+    Err("The compiler daemon requires Unix domain sockets".into())
+}
@@ -67,7 +67,7 @@ impl<'a> Parser<'a> {
             };
 
             let op_node = AstNode::new(op_node_type);
-            let op_node_idx = self.ast.add_node(op_node);
+            let op_node_idx = self.add_node(op_node)?;
 
             // Add children: left then right
             self.ast.add_child(op_node_idx, left_idx);
@@ -94,7 +94,7 @@ impl<'a> Parser<'a> {
 
                 // Create not node
                 let not_node = AstNode::new(NodeType::Not);
-                let not_node_idx = self.ast.add_node(not_node);
+                let not_node_idx = self.add_node(not_node)?;
 
                 // Add operand as child
                 self.ast.add_child(not_node_idx, operand_idx);
@@ -111,7 +111,7 @@ impl<'a> Parser<'a> {
 
                 // Create negate node
                 let negate_node = AstNode::new(NodeType::Negate);
-                let negate_node_idx = self.ast.add_node(negate_node);
+                let negate_node_idx = self.add_node(negate_node)?;
 
                 // Add operand as child
                 self.ast.add_child(negate_node_idx, operand_idx);
@@ -128,7 +128,7 @@ impl<'a> Parser<'a> {
 
                 // Create try node
                 let try_node = AstNode::new(NodeType::Try);
-                let try_node_idx = self.ast.add_node(try_node);
+                let try_node_idx = self.add_node(try_node)?;
 
                 // Add operand as child
                 self.ast.add_child(try_node_idx, operand_idx);
@@ -145,7 +145,7 @@ impl<'a> Parser<'a> {
 
                 // Create partial node
                 let partial_node = AstNode::new(NodeType::Partial);
-                let partial_node_idx = self.ast.add_node(partial_node);
+                let partial_node_idx = self.add_node(partial_node)?;
 
                 // Add operand as child
                 self.ast.add_child(partial_node_idx, operand_idx);
@@ -163,7 +163,7 @@ impl<'a> Parser<'a> {
             TokenKind::True | TokenKind::False => {
                 let literal_node =
                     AstNode::new_terminal(NodeType::LiteralBoolean, self.clone_current_token());
-                let literal_node_idx = self.ast.add_node(literal_node);
+                let literal_node_idx = self.add_node(literal_node)?;
                 self.advance();
                 Ok(literal_node_idx)
             }
@@ -171,7 +171,7 @@ impl<'a> Parser<'a> {
             TokenKind::Number(_) => {
                 let literal_node =
                     AstNode::new_terminal(NodeType::LiteralNumber, self.clone_current_token());
-                let literal_node_idx = self.ast.add_node(literal_node);
+                let literal_node_idx = self.add_node(literal_node)?;
                 self.advance();
                 Ok(literal_node_idx)
             }
@@ -179,7 +179,7 @@ impl<'a> Parser<'a> {
             TokenKind::String(_) => {
                 let literal_node =
                     AstNode::new_terminal(NodeType::LiteralString, self.clone_current_token());
-                let literal_node_idx = self.ast.add_node(literal_node);
+                let literal_node_idx = self.add_node(literal_node)?;
                 self.advance();
                 Ok(literal_node_idx)
             }
@@ -187,7 +187,7 @@ impl<'a> Parser<'a> {
             TokenKind::Underscore => {
                 let placeholder_node =
                     AstNode::new_terminal(NodeType::Placeholder, self.clone_current_token());
-                let placeholder_node_idx = self.ast.add_node(placeholder_node);
+                let placeholder_node_idx = self.add_node(placeholder_node)?;
                 self.advance();
                 Ok(placeholder_node_idx)
             }
@@ -195,7 +195,7 @@ impl<'a> Parser<'a> {
             // this keyword
             TokenKind::This => {
                 let this_node = AstNode::new_terminal(NodeType::This, self.clone_current_token());
-                let this_node_idx = self.ast.add_node(this_node);
+                let this_node_idx = self.add_node(this_node)?;
                 self.advance();
                 Ok(this_node_idx)
             }
@@ -204,7 +204,7 @@ impl<'a> Parser<'a> {
             TokenKind::Identifier => {
                 let ident_node =
                     AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-                let ident_node_idx = self.ast.add_node(ident_node);
+                let ident_node_idx = self.add_node(ident_node)?;
                 self.advance();
                 Ok(ident_node_idx)
             }
@@ -229,7 +229,7 @@ impl<'a> Parser<'a> {
 
         // Create FunctionCall node
         let call_node = AstNode::new(NodeType::FunctionCall);
-        let call_node_idx = self.ast.add_node(call_node);
+        let call_node_idx = self.add_node(call_node)?;
 
         // Add identifier as first child
         self.ast.add_child(call_node_idx, ident_idx);
@@ -276,7 +276,7 @@ impl<'a> Parser<'a> {
 
         // Create ArgList node
         let arg_list_node = AstNode::new(NodeType::ArgList);
-        let arg_list_idx = self.ast.add_node(arg_list_node);
+        let arg_list_idx = self.add_node(arg_list_node)?;
 
         // Parse arguments (comma-separated list)
         loop {
@@ -327,14 +327,14 @@ impl<'a> Parser<'a> {
         }
 
         let name_node = AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-        let name_idx = self.ast.add_node(name_node);
+        let name_idx = self.add_node(name_node)?;
         self.advance();
 
         // Check if this is a method call (has '(') or property access (no '(')
         if self.current_token().kind == TokenKind::LParen {
             // METHOD CALL: receiver.method(args)
             let call_node = AstNode::new(NodeType::MethodCall);
-            let call_node_idx = self.ast.add_node(call_node);
+            let call_node_idx = self.add_node(call_node)?;
 
             // Add receiver and method name as first two children
             self.ast.add_child(call_node_idx, receiver_idx);
@@ -348,7 +348,7 @@ impl<'a> Parser<'a> {
         } else {
             // PROPERTY ACCESS: receiver.property
             let access_node = AstNode::new(NodeType::PropertyAccess);
-            let access_node_idx = self.ast.add_node(access_node);
+            let access_node_idx = self.add_node(access_node)?;
 
             // Add receiver and property name as children
             self.ast.add_child(access_node_idx, receiver_idx);
@@ -845,6 +845,36 @@ Program
         assert!(err.message.contains("too deep"));
     }
 
+    #[test]
+    fn test_ast_node_limit() {
+        // Program, VarDecl, Identifier, FunctionCall, Identifier, ArgList, 3 literals
+        let source = "x: add(1, 2, 3)\n";
+        let limits = |max_ast_nodes| crate::limits::CompilerLimits {
+            max_ast_nodes,
+            ..Default::default()
+        };
+
+        let at_limit = limits(9);
+        assert!(parse(lex(source, &at_limit).unwrap(), &at_limit).is_ok());
+
+        let below = limits(8);
+        let err = parse(lex(source, &below).unwrap(), &below).unwrap_err();
+        assert!(err.message.contains("AST node limit exceeded"), "{}", err);
+        assert_eq!(err.line, 1);
+    }
+
+    #[test]
+    fn test_nodes_preallocated_from_token_count() {
+        let limits = crate::limits::CompilerLimits::default();
+        let tokens = lex("x: add(1, 2, 3)\n", &limits).unwrap();
+        let token_count = tokens.list.len();
+
+        // The node vector is sized once up front and never grows
+        let ast = parse(tokens, &limits).unwrap();
+        assert!(ast.nodes.len() <= token_count);
+        assert_eq!(ast.nodes.capacity(), token_count);
+    }
+
     // ========== METHOD CALL TESTS ==========
 
     // Basic method calls
@@ -1,4 +1,5 @@
 use super::error::ParseError;
+use crate::ast::AstNode;
 use crate::lexer::{Token, TokenKind};
 
 // Operator precedence levels
@@ -40,6 +41,15 @@ impl<'a> super::Parser<'a> {
         Ok(())
     }
 
+    /// Helper: Add a node to the AST, failing at the current token when the
+    /// node limit is reached
+    #[inline]
+    pub(super) fn add_node(&mut self, node: AstNode) -> Result<usize, ParseError> {
+        self.ast
+            .add_node(node)
+            .map_err(|e| ParseError::from_token(e.to_string(), self.current_token(), self.current))
+    }
+
     /// Helper: Consume a specific token kind or error
     pub(super) fn consume(&mut self, kind: TokenKind, expected: &str) -> Result<(), ParseError> {
         let token = self.current_token();
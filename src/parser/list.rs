@@ -15,7 +15,7 @@ impl<'a> Parser<'a> {
 
         // Create List node
         let list_node = AstNode::new(NodeType::List);
-        let list_idx = self.ast.add_node(list_node);
+        let list_idx = self.add_node(list_node)?;
 
         // Parse elements (comma-separated list)
         loop {
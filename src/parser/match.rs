@@ -14,7 +14,7 @@ impl<'a> Parser<'a> {
 
         // Create Match node
         let match_node = AstNode::new(NodeType::Match);
-        let match_idx = self.ast.add_node(match_node);
+        let match_idx = self.add_node(match_node)?;
 
         // Parse subject expression
         let subject_idx = self.parse_match_subject(depth + 1)?;
@@ -39,7 +39,7 @@ impl<'a> Parser<'a> {
 
         // Create MatchSubject wrapper node
         let subject_node = AstNode::new(NodeType::MatchSubject);
-        let subject_idx = self.ast.add_node(subject_node);
+        let subject_idx = self.add_node(subject_node)?;
 
         // Parse the expression being matched
         let expr_idx = self.parse_expression(depth + 1, 0)?;
@@ -54,7 +54,7 @@ impl<'a> Parser<'a> {
 
         // Create MatchArms container
         let arms_node = AstNode::new(NodeType::MatchArms);
-        let arms_idx = self.ast.add_node(arms_node);
+        let arms_idx = self.add_node(arms_node)?;
 
         let mut arm_count = 0;
 
@@ -94,7 +94,7 @@ impl<'a> Parser<'a> {
 
         // Create MatchArm node
         let arm_node = AstNode::new(NodeType::MatchArm);
-        let arm_idx = self.ast.add_node(arm_node);
+        let arm_idx = self.add_node(arm_node)?;
 
         // 1. Parse pattern (wrapped in MatchPattern)
         let pattern_idx = self.parse_match_pattern(depth + 1)?;
@@ -120,7 +120,7 @@ impl<'a> Parser<'a> {
 
         // Create MatchPattern wrapper
         let pattern_node = AstNode::new(NodeType::MatchPattern);
-        let pattern_idx = self.ast.add_node(pattern_node);
+        let pattern_idx = self.add_node(pattern_node)?;
 
         let token = self.current_token();
         let pattern_expr_idx = match &token.kind {
@@ -128,7 +128,7 @@ impl<'a> Parser<'a> {
             TokenKind::Underscore => {
                 let placeholder_node =
                     AstNode::new_terminal(NodeType::Placeholder, self.clone_current_token());
-                let placeholder_idx = self.ast.add_node(placeholder_node);
+                let placeholder_idx = self.add_node(placeholder_node)?;
                 self.advance();
                 placeholder_idx
             }
@@ -137,7 +137,7 @@ impl<'a> Parser<'a> {
             TokenKind::Number(_) => {
                 let literal_node =
                     AstNode::new_terminal(NodeType::LiteralNumber, self.clone_current_token());
-                let literal_idx = self.ast.add_node(literal_node);
+                let literal_idx = self.add_node(literal_node)?;
                 self.advance();
                 literal_idx
             }
@@ -146,7 +146,7 @@ impl<'a> Parser<'a> {
             TokenKind::String(_) => {
                 let literal_node =
                     AstNode::new_terminal(NodeType::LiteralString, self.clone_current_token());
-                let literal_idx = self.ast.add_node(literal_node);
+                let literal_idx = self.add_node(literal_node)?;
                 self.advance();
                 literal_idx
             }
@@ -155,7 +155,7 @@ impl<'a> Parser<'a> {
             TokenKind::True | TokenKind::False => {
                 let literal_node =
                     AstNode::new_terminal(NodeType::LiteralBoolean, self.clone_current_token());
-                let literal_idx = self.ast.add_node(literal_node);
+                let literal_idx = self.add_node(literal_node)?;
                 self.advance();
                 literal_idx
             }
@@ -164,7 +164,7 @@ impl<'a> Parser<'a> {
             TokenKind::Identifier => {
                 let ident_node =
                     AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-                let ident_idx = self.ast.add_node(ident_node);
+                let ident_idx = self.add_node(ident_node)?;
                 self.advance();
                 ident_idx
             }
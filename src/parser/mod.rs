@@ -29,12 +29,13 @@ pub struct Parser<'a> {
 
 impl<'a> Parser<'a> {
     pub fn new(tokens: Tokens, limits: &'a crate::limits::CompilerLimits) -> Self {
-        let mut ast = Ast::new(tokens.string_storage.clone(), limits.clone());
-
-        // Create the Program root node
-        let program_node = AstNode::new(NodeType::Program);
-        let root_idx = ast.add_node(program_node);
-        ast.root = Some(root_idx);
+        // Real code produces roughly 0.5-0.8 nodes per token, so one node
+        // per token builds the whole tree without growing the vector
+        let ast = Ast::with_capacity(
+            tokens.string_storage.clone(),
+            limits.clone(),
+            tokens.list.len(),
+        );
 
         Self {
             tokens,
@@ -46,6 +47,10 @@ impl<'a> Parser<'a> {
 
     // Main parsing entry point
     pub fn parse(mut self) -> Result<Ast, ParseError> {
+        // Create the Program root node
+        let root_idx = self.add_node(AstNode::new(NodeType::Program))?;
+        self.ast.root = Some(root_idx);
+
         self.parse_statements(0)?;
         Ok(self.ast)
     }
@@ -53,6 +58,7 @@ impl<'a> Parser<'a> {
 
 // Public API function
 pub fn parse(tokens: Tokens, limits: &crate::limits::CompilerLimits) -> Result<Ast, ParseError> {
+    let _span = crate::trace_span!("parser", "parse");
     let parser = Parser::new(tokens, limits);
     parser.parse()
 }
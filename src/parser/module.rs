@@ -25,11 +25,11 @@ impl<'a> Parser<'a> {
 
         // Create ModuleDecl node
         let module_decl_node = AstNode::new(NodeType::ModuleDecl);
-        let module_decl_idx = self.ast.add_node(module_decl_node);
+        let module_decl_idx = self.add_node(module_decl_node)?;
 
         // Create ModulePath node
         let path_node = AstNode::new_terminal(NodeType::ModulePath, token);
-        let path_idx = self.ast.add_node(path_node);
+        let path_idx = self.add_node(path_node)?;
         self.ast.add_child(module_decl_idx, path_idx);
 
         Ok(module_decl_idx)
@@ -48,10 +48,10 @@ impl<'a> Parser<'a> {
 
         // Create Export and ExportList nodes
         let export_node = AstNode::new(NodeType::Export);
-        let export_idx = self.ast.add_node(export_node);
+        let export_idx = self.add_node(export_node)?;
 
         let export_list_node = AstNode::new(NodeType::ExportList);
-        let export_list_idx = self.ast.add_node(export_list_node);
+        let export_list_idx = self.add_node(export_list_node)?;
         self.ast.add_child(export_idx, export_list_idx);
 
         // Parse export list
@@ -70,7 +70,7 @@ impl<'a> Parser<'a> {
             }
 
             let ident_node = AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-            let ident_idx = self.ast.add_node(ident_node);
+            let ident_idx = self.add_node(ident_node)?;
             self.ast.add_child(export_list_idx, ident_idx);
             self.advance();
 
@@ -118,10 +118,10 @@ impl<'a> Parser<'a> {
 
         // Create Import and ImportList nodes
         let import_node = AstNode::new(NodeType::Import);
-        let import_idx = self.ast.add_node(import_node);
+        let import_idx = self.add_node(import_node)?;
 
         let import_list_node = AstNode::new(NodeType::ImportList);
-        let import_list_idx = self.ast.add_node(import_list_node);
+        let import_list_idx = self.add_node(import_list_node)?;
         self.ast.add_child(import_idx, import_list_idx);
 
         // Parse import items
@@ -175,7 +175,7 @@ impl<'a> Parser<'a> {
         self.skip_newlines();
 
         let item_node = AstNode::new(NodeType::ImportItem);
-        let item_idx = self.ast.add_node(item_node);
+        let item_idx = self.add_node(item_node)?;
 
         match self.peek_kind() {
             TokenKind::LBrace => {
@@ -195,7 +195,7 @@ impl<'a> Parser<'a> {
                 // Star import: *: math
                 let star_node =
                     AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-                let star_idx = self.ast.add_node(star_node);
+                let star_idx = self.add_node(star_node)?;
                 self.ast.add_child(item_idx, star_idx);
                 self.advance();
 
@@ -227,7 +227,7 @@ impl<'a> Parser<'a> {
                 if self.peek_kind_is(TokenKind::Colon) && !had_newlines {
                     // Aliased: alias: math.module
                     let alias_node = AstNode::new_terminal(NodeType::ImportAlias, first_token);
-                    let alias_idx = self.ast.add_node(alias_node);
+                    let alias_idx = self.add_node(alias_node)?;
                     self.ast.add_child(item_idx, alias_idx);
 
                     self.advance(); // consume ':'
@@ -257,7 +257,7 @@ impl<'a> Parser<'a> {
         self.consume(TokenKind::LBrace, "'{'")?;
 
         let selective_node = AstNode::new(NodeType::ImportSelective);
-        let selective_idx = self.ast.add_node(selective_node);
+        let selective_idx = self.add_node(selective_node)?;
 
         loop {
             self.skip_newlines();
@@ -275,7 +275,7 @@ impl<'a> Parser<'a> {
 
             let selector_node =
                 AstNode::new_terminal(NodeType::ImportSelector, self.clone_current_token());
-            let selector_idx = self.ast.add_node(selector_node);
+            let selector_idx = self.add_node(selector_node)?;
             self.ast.add_child(selective_idx, selector_idx);
             self.advance();
 
@@ -392,12 +392,12 @@ impl<'a> Parser<'a> {
                 string_id: Some(string_id),
             };
             let ident_node = AstNode::new_terminal(NodeType::Identifier, token);
-            let ident_idx = self.ast.add_node(ident_node);
+            let ident_idx = self.add_node(ident_node)?;
             Ok(ident_idx)
         } else {
             // Simple identifier
             let ident_node = AstNode::new_terminal(NodeType::Identifier, first_token);
-            let ident_idx = self.ast.add_node(ident_node);
+            let ident_idx = self.add_node(ident_node)?;
             Ok(ident_idx)
         }
     }
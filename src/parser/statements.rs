@@ -150,7 +150,7 @@ impl<'a> Parser<'a> {
 
         // Wrap in ExprStmt
         let expr_stmt = AstNode::new(NodeType::ExprStmt);
-        let expr_stmt_idx = self.ast.add_node(expr_stmt);
+        let expr_stmt_idx = self.add_node(expr_stmt)?;
         self.ast.add_child(expr_stmt_idx, expr_idx);
 
         // Expect newline, EOF, or RBrace (end of block)
@@ -179,7 +179,7 @@ impl<'a> Parser<'a> {
 
         // Wrap in ExprStmt
         let expr_stmt = AstNode::new(NodeType::ExprStmt);
-        let expr_stmt_idx = self.ast.add_node(expr_stmt);
+        let expr_stmt_idx = self.add_node(expr_stmt)?;
         self.ast.add_child(expr_stmt_idx, match_idx);
 
         // Expect newline, EOF, or RBrace (end of block)
@@ -221,7 +221,7 @@ impl<'a> Parser<'a> {
 
         // Create PropertyAssignment node
         let node = AstNode::new(NodeType::PropertyAssignment);
-        let node_idx = self.ast.add_node(node);
+        let node_idx = self.add_node(node)?;
         self.ast.add_child(node_idx, lhs_idx);
         self.ast.add_child(node_idx, rhs_idx);
 
@@ -249,10 +249,10 @@ impl<'a> Parser<'a> {
 
         // Create nodes
         let var_decl_node = AstNode::new(NodeType::VarDecl);
-        let var_decl_idx = self.ast.add_node(var_decl_node);
+        let var_decl_idx = self.add_node(var_decl_node)?;
 
         let ident_node = AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-        let ident_idx = self.ast.add_node(ident_node);
+        let ident_idx = self.add_node(ident_node)?;
         self.ast.add_child(var_decl_idx, ident_idx);
 
         self.advance(); // consume identifier
@@ -266,7 +266,7 @@ impl<'a> Parser<'a> {
                 // This is a type annotation: identifier TypeName : expr
                 let type_node =
                     AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-                let type_idx = self.ast.add_node(type_node);
+                let type_idx = self.add_node(type_node)?;
                 self.ast.add_child(var_decl_idx, type_idx);
                 self.advance(); // consume type name
             }
@@ -308,7 +308,7 @@ impl<'a> Parser<'a> {
 
         // Create ReturnStmt node
         let return_stmt_node = AstNode::new(NodeType::ReturnStmt);
-        let return_stmt_idx = self.ast.add_node(return_stmt_node);
+        let return_stmt_idx = self.add_node(return_stmt_node)?;
 
         // Check if there's a return value
         self.skip_newlines();
@@ -360,7 +360,7 @@ impl<'a> Parser<'a> {
 
         // Create Block node
         let block_node = AstNode::new(NodeType::Block);
-        let block_idx = self.ast.add_node(block_node);
+        let block_idx = self.add_node(block_node)?;
 
         // Parse statements until '}'
         loop {
@@ -397,11 +397,11 @@ impl<'a> Parser<'a> {
 
         // Create Param node
         let param_node = AstNode::new(NodeType::Param);
-        let param_idx = self.ast.add_node(param_node);
+        let param_idx = self.add_node(param_node)?;
 
         // Create Identifier node for parameter name
         let ident_node = AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-        let ident_idx = self.ast.add_node(ident_node);
+        let ident_idx = self.add_node(ident_node)?;
         self.ast.add_child(param_idx, ident_idx);
         self.advance(); // Consume parameter name
 
@@ -411,7 +411,7 @@ impl<'a> Parser<'a> {
             // This is a type annotation
             let type_node =
                 AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-            let type_idx = self.ast.add_node(type_node);
+            let type_idx = self.add_node(type_node)?;
             self.ast.add_child(param_idx, type_idx);
             self.advance(); // Consume type name
         }
@@ -428,7 +428,7 @@ impl<'a> Parser<'a> {
 
         // Create ParamList node
         let param_list_node = AstNode::new(NodeType::ParamList);
-        let param_list_idx = self.ast.add_node(param_list_node);
+        let param_list_idx = self.add_node(param_list_node)?;
 
         // Skip newlines (allow formatting like `(\n)`)
         self.skip_newlines();
@@ -483,7 +483,7 @@ impl<'a> Parser<'a> {
         }
 
         let ident_node = AstNode::new_terminal(NodeType::Identifier, self.clone_current_token());
-        let ident_idx = self.ast.add_node(ident_node);
+        let ident_idx = self.add_node(ident_node)?;
         self.advance(); // Consume identifier
 
         // Check for optional type parameters: ident<T, U>
@@ -502,7 +502,7 @@ impl<'a> Parser<'a> {
 
         // Create FunctionDecl node (before adding children)
         let func_decl_node = AstNode::new(NodeType::FunctionDecl);
-        let func_decl_idx = self.ast.add_node(func_decl_node);
+        let func_decl_idx = self.add_node(func_decl_node)?;
 
         // Add children: identifier, optional type params, and params
         self.ast.add_child(func_decl_idx, ident_idx);
@@ -517,7 +517,7 @@ impl<'a> Parser<'a> {
             // This is a return type annotation
             let return_type_node =
                 AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-            let return_type_idx = self.ast.add_node(return_type_node);
+            let return_type_idx = self.add_node(return_type_node)?;
             self.ast.add_child(func_decl_idx, return_type_idx);
             self.advance(); // Consume return type
         }
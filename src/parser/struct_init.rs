@@ -13,7 +13,7 @@ impl<'a> Parser<'a> {
 
         // Create StructInit node
         let struct_init = AstNode::new(NodeType::StructInit);
-        let struct_init_idx = self.ast.add_node(struct_init);
+        let struct_init_idx = self.add_node(struct_init)?;
 
         // Parse fields/methods until '}'
         loop {
@@ -108,7 +108,7 @@ impl<'a> Parser<'a> {
         } else {
             AstNode::new(NodeType::StructInitField)
         };
-        let field_idx = self.ast.add_node(field_node);
+        let field_idx = self.add_node(field_node)?;
 
         // Add name as first child (with privacy flag if needed)
         let name_node = if is_private {
@@ -116,7 +116,7 @@ impl<'a> Parser<'a> {
         } else {
             AstNode::new_terminal(NodeType::Identifier, name_token)
         };
-        let name_idx = self.ast.add_node(name_node);
+        let name_idx = self.add_node(name_node)?;
         self.ast.add_child(field_idx, name_idx);
 
         // Parse field value expression
@@ -141,7 +141,7 @@ impl<'a> Parser<'a> {
         } else {
             AstNode::new(NodeType::StructInitMethod)
         };
-        let method_idx = self.ast.add_node(method_node);
+        let method_idx = self.add_node(method_node)?;
 
         // Clone name_token for use in FunctionDecl (needed for both StructInitMethod name and FunctionDecl name)
         let func_name_token = name_token.clone();
@@ -152,7 +152,7 @@ impl<'a> Parser<'a> {
         } else {
             AstNode::new_terminal(NodeType::Identifier, name_token)
         };
-        let name_idx = self.ast.add_node(name_node);
+        let name_idx = self.add_node(name_node)?;
         self.ast.add_child(method_idx, name_idx);
 
         // Parse parameter list
@@ -161,11 +161,11 @@ impl<'a> Parser<'a> {
 
         // Create FunctionDecl node (reuse existing)
         let func_decl = AstNode::new(NodeType::FunctionDecl);
-        let func_decl_idx = self.ast.add_node(func_decl);
+        let func_decl_idx = self.add_node(func_decl)?;
 
         // Add function name as first child (for AST consistency with regular FunctionDecl)
         let func_name_node = AstNode::new_terminal(NodeType::Identifier, func_name_token);
-        let func_name_idx = self.ast.add_node(func_name_node);
+        let func_name_idx = self.add_node(func_name_node)?;
         self.ast.add_child(func_decl_idx, func_name_idx);
 
         // Add params as second child of function
@@ -176,7 +176,7 @@ impl<'a> Parser<'a> {
         if self.current_token().kind == TokenKind::Identifier {
             let return_type =
                 AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-            let return_type_idx = self.ast.add_node(return_type);
+            let return_type_idx = self.add_node(return_type)?;
             self.ast.add_child(func_decl_idx, return_type_idx);
             self.advance();
         }
@@ -15,12 +15,12 @@ impl<'a> Parser<'a> {
         // Parse type name
         let name_token = self.clone_current_token();
         let type_name_node = AstNode::new_terminal(NodeType::TypeName, name_token);
-        let type_name_idx = self.ast.add_node(type_name_node);
+        let type_name_idx = self.add_node(type_name_node)?;
         self.consume(TokenKind::Identifier, "type name")?;
 
         // Create TypeDecl node
         let type_decl_node = AstNode::new(NodeType::TypeDecl);
-        let type_decl_idx = self.ast.add_node(type_decl_node);
+        let type_decl_idx = self.add_node(type_decl_node)?;
 
         // Add type name as first child
         self.ast.add_child(type_decl_idx, type_name_idx);
@@ -46,7 +46,7 @@ impl<'a> Parser<'a> {
 
         // Create TypeBody container
         let type_body_node = AstNode::new(NodeType::TypeBody);
-        let type_body_idx = self.ast.add_node(type_body_node);
+        let type_body_idx = self.add_node(type_body_node)?;
 
         match self.current_token().kind {
             TokenKind::Newline | TokenKind::Eof => {
@@ -94,7 +94,7 @@ impl<'a> Parser<'a> {
 
         // Create TypeParams node
         let params_node = AstNode::new(NodeType::TypeParams);
-        let params_idx = self.ast.add_node(params_node);
+        let params_idx = self.add_node(params_node)?;
 
         // Parse parameter list
         loop {
@@ -106,11 +106,11 @@ impl<'a> Parser<'a> {
 
             // Create TypeParam node
             let type_param_node = AstNode::new(NodeType::TypeParam);
-            let type_param_idx = self.ast.add_node(type_param_node);
+            let type_param_idx = self.add_node(type_param_node)?;
 
             // Add parameter name as identifier child
             let name_node = AstNode::new_terminal(NodeType::Identifier, param_name_token);
-            let name_idx = self.ast.add_node(name_node);
+            let name_idx = self.add_node(name_node)?;
             self.ast.add_child(type_param_idx, name_idx);
 
             // Check for constraint (: Constraint)
@@ -125,7 +125,7 @@ impl<'a> Parser<'a> {
 
                 let constraint_node =
                     AstNode::new_terminal(NodeType::TypeConstraint, self.clone_current_token());
-                let constraint_idx = self.ast.add_node(constraint_node);
+                let constraint_idx = self.add_node(constraint_node)?;
                 self.advance(); // Consume constraint
                 self.ast.add_child(type_param_idx, constraint_idx);
             }
@@ -163,7 +163,7 @@ impl<'a> Parser<'a> {
 
         // Create StructBody node
         let struct_body_node = AstNode::new(NodeType::StructBody);
-        let struct_body_idx = self.ast.add_node(struct_body_node);
+        let struct_body_idx = self.add_node(struct_body_node)?;
 
         // Parse members (fields and methods)
         loop {
@@ -189,17 +189,17 @@ impl<'a> Parser<'a> {
                 TokenKind::Identifier => {
                     // Field: name Type
                     let field_node = AstNode::new(NodeType::StructField);
-                    let field_idx = self.ast.add_node(field_node);
+                    let field_idx = self.add_node(field_node)?;
 
                     // Add field name as identifier child
                     let name_node = AstNode::new_terminal(NodeType::Identifier, member_name_token);
-                    let name_idx = self.ast.add_node(name_node);
+                    let name_idx = self.add_node(name_node)?;
                     self.ast.add_child(field_idx, name_idx);
 
                     // Add type annotation child
                     let type_node =
                         AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-                    let type_idx = self.ast.add_node(type_node);
+                    let type_idx = self.add_node(type_node)?;
                     self.advance(); // Consume type
                     self.ast.add_child(field_idx, type_idx);
 
@@ -219,11 +219,11 @@ impl<'a> Parser<'a> {
 
                     // Create StructMethod node
                     let method_node = AstNode::new(NodeType::StructMethod);
-                    let method_idx = self.ast.add_node(method_node);
+                    let method_idx = self.add_node(method_node)?;
 
                     // Add method name as identifier child
                     let name_node = AstNode::new_terminal(NodeType::Identifier, member_name_token);
-                    let name_idx = self.ast.add_node(name_node);
+                    let name_idx = self.add_node(name_node)?;
                     self.ast.add_child(method_idx, name_idx);
 
                     // Add function type as second child
@@ -259,11 +259,11 @@ impl<'a> Parser<'a> {
 
         // Create FunctionType node
         let func_type_node = AstNode::new(NodeType::FunctionType);
-        let func_type_idx = self.ast.add_node(func_type_node);
+        let func_type_idx = self.add_node(func_type_node)?;
 
         // Create FunctionTypeParams node
         let params_node = AstNode::new(NodeType::FunctionTypeParams);
-        let params_idx = self.ast.add_node(params_node);
+        let params_idx = self.add_node(params_node)?;
         self.ast.add_child(func_type_idx, params_idx);
 
         // Parse parameters (all must have types)
@@ -291,16 +291,16 @@ impl<'a> Parser<'a> {
 
             // Create StructField node for parameter (reuse pattern)
             let field_node = AstNode::new(NodeType::StructField);
-            let field_idx = self.ast.add_node(field_node);
+            let field_idx = self.add_node(field_node)?;
 
             // Add parameter name as identifier child
             let name_node = AstNode::new_terminal(NodeType::Identifier, param_name_token);
-            let name_idx = self.ast.add_node(name_node);
+            let name_idx = self.add_node(name_node)?;
             self.ast.add_child(field_idx, name_idx);
 
             // Add type annotation child
             let type_node = AstNode::new_terminal(NodeType::TypeAnnotation, param_type_token);
-            let type_idx = self.ast.add_node(type_node);
+            let type_idx = self.add_node(type_node)?;
             self.ast.add_child(field_idx, type_idx);
 
             // Add parameter to params list
@@ -328,7 +328,7 @@ impl<'a> Parser<'a> {
         }
         let return_type_node =
             AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-        let return_type_idx = self.ast.add_node(return_type_node);
+        let return_type_idx = self.add_node(return_type_node)?;
         self.advance(); // Consume return type
         self.ast.add_child(func_type_idx, return_type_idx);
 
@@ -345,7 +345,7 @@ impl<'a> Parser<'a> {
                 // Type reference
                 let type_node =
                     AstNode::new_terminal(NodeType::TypeAnnotation, self.clone_current_token());
-                let type_idx = self.ast.add_node(type_node);
+                let type_idx = self.add_node(type_node)?;
                 self.advance(); // Consume identifier
                 Ok(type_idx)
             }
@@ -369,7 +369,7 @@ impl<'a> Parser<'a> {
         if self.current_token().kind == TokenKind::Comma {
             // Create UnionTypeList and add first type as child
             let union_list_node = AstNode::new(NodeType::UnionTypeList);
-            let union_list_idx = self.ast.add_node(union_list_node);
+            let union_list_idx = self.add_node(union_list_node)?;
             self.ast.add_child(union_list_idx, result_idx);
 
             // Parse remaining types in union
@@ -396,7 +396,7 @@ impl<'a> Parser<'a> {
 
             // Create IntersectionType node
             let intersection_node = AstNode::new(NodeType::IntersectionType);
-            let intersection_idx = self.ast.add_node(intersection_node);
+            let intersection_idx = self.add_node(intersection_node)?;
 
             // Add left and right as children
             self.ast.add_child(intersection_idx, result_idx);
@@ -0,0 +1,224 @@
+// Cooperative analysis budgets
+//
+// Generalizes the cancel flag: besides a host raising the flag, an analysis
+// stops when it exceeds one of the `CompilerLimits` analysis budgets
+// (`max_analysis_millis`, `max_type_vars`, `max_constraints`,
+// `max_memory_bytes`). The analyzer polls once per visited node and once per
+// solved constraint; an interrupted analysis returns a single error naming
+// the reason.
+//
+// Counters are compared on every poll. The clock and the memory estimate are
+// read on the first poll and every `SLOW_POLL_INTERVAL` polls after that, so
+// polling stays cheap.
+
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::time::Instant;
+
+use crate::limits::CompilerLimits;
+
+/// Polls between clock and memory checks
+const SLOW_POLL_INTERVAL: u32 = 64;
+
+/// Why an analysis stopped early
+#[derive(Debug, Clone, PartialEq)]
+pub(super) enum Interrupt {
+    /// The host raised the cancel flag
+    Cancelled,
+    /// A budget from `CompilerLimits` ran out
+    LimitExceeded { limit: &'static str, max: usize },
+}
+
+impl Interrupt {
+    pub fn message(&self) -> String {
+        match self {
+            Interrupt::Cancelled => "Analysis cancelled".to_string(),
+            Interrupt::LimitExceeded { limit, max } => {
+                format!("Analysis limit exceeded: {} (max: {})", limit, max)
+            }
+        }
+    }
+}
+
+/// Resources used so far, as counted by the analyzer
+pub(super) struct Usage {
+    pub type_vars: usize,
+    pub constraints: usize,
+}
+
+pub(super) struct AnalysisBudget {
+    cancel_flag: Option<Arc<AtomicBool>>,
+    max_millis: usize,
+    max_type_vars: usize,
+    max_constraints: usize,
+    max_memory_bytes: usize,
+    started: Option<Instant>,
+    polls: u32,
+    interrupt: Option<Interrupt>,
+}
+
+impl AnalysisBudget {
+    pub fn new(limits: &CompilerLimits) -> Self {
+        AnalysisBudget {
+            cancel_flag: None,
+            max_millis: limits.max_analysis_millis,
+            max_type_vars: limits.max_type_vars,
+            max_constraints: limits.max_constraints,
+            max_memory_bytes: limits.max_memory_bytes,
+            started: None,
+            polls: 0,
+            interrupt: None,
+        }
+    }
+
+    pub fn set_cancel_flag(&mut self, flag: Arc<AtomicBool>) {
+        self.cancel_flag = Some(flag);
+    }
+
+    /// Starts the analysis clock
+    pub fn start(&mut self) {
+        self.started = Some(Instant::now());
+    }
+
+    /// The reason analysis stopped, once it has
+    pub fn interrupt(&self) -> Option<&Interrupt> {
+        self.interrupt.as_ref()
+    }
+
+    /// Checks every budget; true once the analysis should stop
+    ///
+    /// `memory_bytes` is only called on slow polls.
+    pub fn poll(&mut self, usage: Usage, memory_bytes: impl FnOnce() -> usize) -> bool {
+        if self.interrupt.is_some() {
+            return true;
+        }
+        self.interrupt = self.check(usage, memory_bytes);
+        self.interrupt.is_some()
+    }
+
+    fn check(&mut self, usage: Usage, memory_bytes: impl FnOnce() -> usize) -> Option<Interrupt> {
+        let exceeded = |limit, max| Some(Interrupt::LimitExceeded { limit, max });
+
+        if self
+            .cancel_flag
+            .as_ref()
+            .is_some_and(|f| f.load(Ordering::Relaxed))
+        {
+            return Some(Interrupt::Cancelled);
+        }
+        if usage.type_vars > self.max_type_vars {
+            return exceeded("max_type_vars", self.max_type_vars);
+        }
+        if usage.constraints > self.max_constraints {
+            return exceeded("max_constraints", self.max_constraints);
+        }
+
+        let slow = self.polls % SLOW_POLL_INTERVAL == 0;
+        self.polls = self.polls.wrapping_add(1);
+        if !slow {
+            return None;
+        }
+        if let Some(started) = self.started {
+            if started.elapsed().as_millis() > self.max_millis as u128 {
+                return exceeded("max_analysis_millis", self.max_millis);
+            }
+        }
+        if memory_bytes() > self.max_memory_bytes {
+            return exceeded("max_memory_bytes", self.max_memory_bytes);
+        }
+        None
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn usage(type_vars: usize, constraints: usize) -> Usage {
+        Usage {
+            type_vars,
+            constraints,
+        }
+    }
+
+    #[test]
+    fn test_counters_checked_on_every_poll() {
+        let limits = CompilerLimits {
+            max_type_vars: 10,
+            max_constraints: 100,
+            ..CompilerLimits::default()
+        };
+        let mut budget = AnalysisBudget::new(&limits);
+        budget.start();
+        assert!(!budget.poll(usage(10, 100), || 0));
+        assert!(!budget.poll(usage(10, 100), || 0));
+        assert!(budget.poll(usage(10, 101), || 0));
+        assert_eq!(
+            budget.interrupt().unwrap().message(),
+            "Analysis limit exceeded: max_constraints (max: 100)"
+        );
+
+        // Sticky: later polls keep reporting the first reason
+        assert!(budget.poll(usage(11, 0), || 0));
+        assert_eq!(
+            budget.interrupt(),
+            Some(&Interrupt::LimitExceeded {
+                limit: "max_constraints",
+                max: 100
+            })
+        );
+    }
+
+    #[test]
+    fn test_clock_and_memory_checked_on_slow_polls() {
+        let limits = CompilerLimits {
+            max_memory_bytes: 1000,
+            ..CompilerLimits::default()
+        };
+        let mut budget = AnalysisBudget::new(&limits);
+        let mut estimates = 0;
+        let mut estimate = |bytes| {
+            estimates += 1;
+            bytes
+        };
+
+        // The first poll is slow; the fast ones after it never estimate
+        assert!(!budget.poll(usage(0, 0), || estimate(1000)));
+        for _ in 1..SLOW_POLL_INTERVAL {
+            assert!(!budget.poll(usage(0, 0), || estimate(1001)));
+        }
+        assert_eq!(estimates, 1);
+        assert!(budget.interrupt().is_none());
+
+        // The next slow poll sees the growth
+        assert!(budget.poll(usage(0, 0), || 1001));
+        assert_eq!(
+            budget.interrupt().unwrap().message(),
+            "Analysis limit exceeded: max_memory_bytes (max: 1000)"
+        );
+    }
+
+    #[test]
+    fn test_cancel_flag_and_clock() {
+        let flag = Arc::new(AtomicBool::new(false));
+        let mut budget = AnalysisBudget::new(&CompilerLimits::default());
+        budget.set_cancel_flag(Arc::clone(&flag));
+        assert!(!budget.poll(usage(0, 0), || 0));
+        flag.store(true, Ordering::Relaxed);
+        assert!(budget.poll(usage(0, 0), || 0));
+        assert_eq!(budget.interrupt(), Some(&Interrupt::Cancelled));
+
+        let limits = CompilerLimits {
+            max_analysis_millis: 1,
+            ..CompilerLimits::default()
+        };
+        let mut budget = AnalysisBudget::new(&limits);
+        budget.start();
+        std::thread::sleep(std::time::Duration::from_millis(5));
+        assert!(budget.poll(usage(0, 0), || 0));
+        assert_eq!(
+            budget.interrupt().unwrap().message(),
+            "Analysis limit exceeded: max_analysis_millis (max: 1)"
+        );
+    }
+}
@@ -1,6 +1,7 @@
 use std::collections::HashMap;
 
 mod assignment_type_checking;
+mod budget;
 mod expression_type_inference;
 mod function_body_analysis;
 mod function_call_type_checking;
@@ -19,7 +20,10 @@ mod mutation_analysis;
 mod name_resolution;
 
 pub use module_registry::ModuleRegistry;
-pub use multi_file_analyzer::{FileAnalysisResult, MultiFileAnalyzer, SourceFile};
+pub use multi_file_analyzer::{
+    FileAnalysisResult, ModuleInfo, MultiFileAnalyzer, SourceFile, build_registry, module_info,
+    package_modules,
+};
 mod property_access_type_checking;
 mod return_type_validation;
 mod struct_init_type_checking;
@@ -97,8 +101,8 @@ impl std::error::Error for SemanticError {}
 pub struct AnalysisOutput {
     /// The analyzed AST
     pub ast: crate::ast::Ast,
-    /// Map from AST node index to its inferred TypeId
-    pub node_types: HashMap<usize, TypeId>,
+    /// Inferred TypeId per AST node, indexed by node (`None` for untyped nodes)
+    pub node_types: Vec<Option<TypeId>>,
     /// The type registry used during analysis (needed to resolve TypeIds)
     pub type_registry: TypeRegistry,
     /// Mutation bitmasks for each function declaration.
@@ -109,9 +113,26 @@ pub struct AnalysisOutput {
     /// Key: (struct TypeId, method name).
     /// Value: true if the method body contains a `this.field: value` assignment.
     pub method_this_mutations: HashMap<(TypeId, String), bool>,
+    /// Declared function type of each function declaration.
+    /// Key: FunctionDecl AST node index.
+    pub function_types: HashMap<usize, TypeId>,
+    /// Final type variable bindings, for resolving types nested inside
+    /// struct fields and function signatures
+    pub substitution: Substitution,
 }
 
 impl AnalysisOutput {
+    /// Inferred type of an AST node
+    pub fn type_of(&self, node_idx: usize) -> Option<TypeId> {
+        self.node_types.get(node_idx).copied().flatten()
+    }
+
+    /// Resolves a TypeId through the final substitution
+    pub fn resolve(&self, type_id: TypeId) -> &Type {
+        let resolved = self.substitution.apply(type_id, &self.type_registry);
+        self.type_registry.resolve(resolved)
+    }
+
     /// Renders the AST as a string with inferred type annotations inline on each node.
     ///
     /// Each node that has a resolved type gets a `[Type]` suffix, e.g.:
@@ -124,10 +145,37 @@ impl AnalysisOutput {
         let annotations: HashMap<usize, String> = self
             .node_types
             .iter()
-            .map(|(&idx, &tid)| (idx, type_to_display_string(tid, &self.type_registry)))
+            .enumerate()
+            .filter_map(|(idx, tid)| Some((idx, type_to_display_string((*tid)?, &self.type_registry))))
             .collect();
         self.ast.to_annotated_string(&annotations)
     }
+
+    /// Heap bytes held by the AST, strings, type registry and node types
+    ///
+    /// The analyzer's working state (substitution, scopes, variable and
+    /// return tables) is gone by now; `Profile::with_mem_report` captures it
+    /// at the end of analysis instead.
+    pub fn mem_report(&self) -> crate::stats::MemReport {
+        let mut report = crate::stats::MemReport::default();
+        push_output_entries(&mut report, &self.ast, &self.node_types, &self.type_registry);
+        report
+    }
+}
+
+/// Memory report entries for the structures that outlive analysis
+fn push_output_entries(
+    report: &mut crate::stats::MemReport,
+    ast: &crate::ast::Ast,
+    node_types: &[Option<TypeId>],
+    registry: &TypeRegistry,
+) {
+    use crate::stats::vec_bytes;
+    report.push("Ast.nodes", ast.nodes.len(), vec_bytes(&ast.nodes));
+    report.push("StringStorage", ast.string_storage.len(), ast.string_storage.heap_bytes());
+    report.push("TypeRegistry.types", registry.len(), registry.types_heap_bytes());
+    report.push("TypeRegistry.cache", registry.len(), registry.cache_heap_bytes());
+    report.push("node_types", node_types.len(), size_of_val(node_types));
 }
 
 /// Carries the AST and error list when semantic analysis fails.
@@ -281,6 +329,20 @@ impl SymbolTable {
     pub fn is_empty(&self) -> bool {
         self.symbols.is_empty()
     }
+
+    /// Estimated heap bytes of the table and the names it owns
+    pub fn heap_bytes(&self) -> usize {
+        crate::stats::hash_map_bytes(&self.symbols)
+            + self
+                .symbols
+                .iter()
+                .map(|(key, symbol)| {
+                    key.capacity()
+                        + symbol.name.capacity()
+                        + symbol.type_name.as_ref().map_or(0, String::capacity)
+                })
+                .sum::<usize>()
+    }
 }
 
 impl Default for SymbolTable {
@@ -372,6 +434,24 @@ impl ScopeStack {
         }
     }
 
+    /// Inserts a built-in symbol into the prelude scope.
+    ///
+    /// The prelude sits above the global scope, so lookups find built-ins
+    /// while programs remain free to declare their own symbol of the same name.
+    /// Returns true if inserted, false if the prelude already has the name.
+    pub fn insert_prelude(&mut self, symbol: Symbol) -> bool {
+        let prelude_idx = match self.scopes[0].parent {
+            Some(idx) => idx,
+            None => {
+                let idx = self.scopes.len();
+                self.scopes.push(Scope::new(ScopeKind::Global, None));
+                self.scopes[0].parent = Some(idx);
+                idx
+            }
+        };
+        self.scopes[prelude_idx].insert_symbol(symbol)
+    }
+
     /// Returns true if a symbol exists in the current scope chain
     pub fn contains(&self, name: &str) -> bool {
         self.lookup(name).is_some()
@@ -382,6 +462,18 @@ impl ScopeStack {
         self.current_stack.len() - 1
     }
 
+    /// Number of scopes created so far (scopes are never freed)
+    pub fn scope_count(&self) -> usize {
+        self.scopes.len()
+    }
+
+    /// Estimated heap bytes of all scopes and their symbol tables
+    pub fn heap_bytes(&self) -> usize {
+        crate::stats::vec_bytes(&self.scopes)
+            + crate::stats::vec_bytes(&self.current_stack)
+            + self.scopes.iter().map(|s| s.symbols.heap_bytes()).sum::<usize>()
+    }
+
     /// Returns true if current scope is inside a function or block (mutable context)
     /// Variables declared in mutable scopes can be reassigned.
     pub fn is_in_mutable_scope(&self) -> bool {
@@ -409,14 +501,16 @@ pub struct SemanticAnalyzer {
     errors: Vec<SemanticError>,
 
     // Hindley-Milner type inference infrastructure
-    /// Maps AST nodes to their inferred types
-    node_types: HashMap<usize, TypeId>,
+    /// Inferred type per AST node, indexed by node (`None` until typed)
+    node_types: Vec<Option<TypeId>>,
     /// Collected type constraints
     constraints: Vec<Constraint>,
     /// Current substitution (solution to constraints)
     substitution: Substitution,
     /// Counter for generating fresh type variables
     next_type_var: u32,
+    /// Constraints handed to unification so far (for `--stats`)
+    constraints_solved: usize,
 
     // Assignment type checking
     /// Maps (scope_index, variable_name) to their TypeId for reassignment checking
@@ -468,6 +562,8 @@ pub struct SemanticAnalyzer {
     /// Key: (struct TypeId, method name).
     /// Populated by `compute_all_mutations` after type unification.
     method_this_mutations: HashMap<(TypeId, String), bool>,
+    /// Declared function type per FunctionDecl AST node index
+    function_types: HashMap<usize, TypeId>,
 
     // Multi-file module support
     /// Shared module registry for cross-file import resolution (None in single-file mode)
@@ -477,6 +573,11 @@ pub struct SemanticAnalyzer {
     /// Set of module names in the current package batch (for submodule visibility enforcement)
     /// None in single-file mode — all imports allowed
     package_modules: Option<std::collections::HashSet<String>>,
+
+    // Cooperative interruption
+    /// Cancel flag set by the host (e.g. the LSP server) and the analysis
+    /// budgets from `CompilerLimits`, polled while analyzing
+    budget: budget::AnalysisBudget,
 }
 
 /// Represents a deferred method check for structural type compatibility
@@ -510,22 +611,33 @@ pub(super) struct DeferredMatchExhaustivenessCheck {
     pub match_node_idx: usize,
 }
 
+/// Runs one analysis phase under a trace span and the profile timer
+fn phase<R>(profile: &mut crate::stats::Profile, name: &'static str, run: impl FnOnce() -> R) -> R {
+    let _span = crate::trace_span!("semantic", name);
+    profile.time(name, run)
+}
+
 impl SemanticAnalyzer {
     /// Creates a new semantic analyzer with the given AST
     pub fn new(ast: crate::ast::Ast) -> Self {
         let mut type_registry = TypeRegistry::new();
         Self::register_builtin_types(&mut type_registry);
+        let mut scopes = ScopeStack::new();
+        Self::register_builtin_functions(&mut scopes, &mut type_registry);
 
+        let node_count = ast.nodes.len();
+        let budget = budget::AnalysisBudget::new(ast.limits());
         SemanticAnalyzer {
             ast,
-            scopes: ScopeStack::new(),
+            scopes,
             type_registry,
             errors: Vec::new(),
             // Initialize Hindley-Milner infrastructure
-            node_types: HashMap::new(),
+            node_types: vec![None; node_count],
             constraints: Vec::new(),
             substitution: Substitution::new(),
             next_type_var: 0,
+            constraints_solved: 0,
             // Initialize assignment type checking
             variable_types: HashMap::new(),
             // Initialize return type tracking
@@ -546,10 +658,13 @@ impl SemanticAnalyzer {
             function_decl_info: Vec::new(),
             function_mutations: HashMap::new(),
             method_this_mutations: HashMap::new(),
+            function_types: HashMap::new(),
             // Initialize multi-file module support
             module_registry: None,
             exported_symbol_names: Vec::new(),
             package_modules: None,
+            // Initialize cooperative interruption
+            budget,
         }
     }
 
@@ -575,6 +690,47 @@ impl SemanticAnalyzer {
         self
     }
 
+    /// Sets a flag that cancels the analysis when raised.
+    ///
+    /// The flag is polled once per visited node and per solved constraint,
+    /// together with the analysis budgets of the AST's `CompilerLimits`; a
+    /// cancelled analysis stops early and returns a single
+    /// `"Analysis cancelled"` error.
+    pub fn with_cancel_flag(mut self, flag: std::sync::Arc<std::sync::atomic::AtomicBool>) -> Self {
+        self.budget.set_cancel_flag(flag);
+        self
+    }
+
+    /// Polls the cancel flag and analysis budgets; true once analysis should stop
+    fn is_interrupted(&mut self) -> bool {
+        let usage = budget::Usage {
+            type_vars: self.next_type_var as usize,
+            constraints: self.constraints_solved + self.constraints.len(),
+        };
+        // Constant-time estimate of the largest tables; strings owned by
+        // types and symbols, and per-scope symbol tables, are left out
+        let memory_bytes = || {
+            use crate::stats::{hash_map_bytes, vec_bytes};
+            vec_bytes(&self.ast.nodes)
+                + vec_bytes(&self.node_types)
+                + vec_bytes(&self.constraints)
+                + self.type_registry.table_bytes()
+                + self.substitution.heap_bytes()
+                + hash_map_bytes(&self.variable_types)
+                + hash_map_bytes(&self.function_returns)
+        };
+        self.budget.poll(usage, memory_bytes)
+    }
+
+    /// The single error reported by an interrupted analysis
+    fn interrupted_error(self) -> AnalysisError {
+        let message = self.budget.interrupt().map_or_else(String::new, |i| i.message());
+        AnalysisError {
+            ast: self.ast,
+            errors: vec![SemanticError::new(message, 0, 0)],
+        }
+    }
+
     /// Records a semantic error
     fn record_error(&mut self, error: SemanticError) {
         self.errors.push(error);
@@ -594,12 +750,15 @@ impl SemanticAnalyzer {
 
     /// Records the inferred type for an AST node
     fn set_node_type(&mut self, node_idx: usize, type_id: TypeId) {
-        self.node_types.insert(node_idx, type_id);
+        if node_idx >= self.node_types.len() {
+            self.node_types.resize(node_idx + 1, None);
+        }
+        self.node_types[node_idx] = Some(type_id);
     }
 
     /// Gets the inferred type for an AST node (if any)
     pub fn get_node_type(&self, node_idx: usize) -> Option<TypeId> {
-        self.node_types.get(&node_idx).copied()
+        self.node_types.get(node_idx).copied().flatten()
     }
 
     /// Adds a type equality constraint
@@ -705,6 +864,23 @@ impl SemanticAnalyzer {
         registry.intern(Type::Float(FloatSize::F64));
     }
 
+    /// Registers the built-in functions in the prelude scope
+    ///
+    /// `print` accepts a value of any type; code generation picks the
+    /// formatting from the argument's inferred type.
+    fn register_builtin_functions(scopes: &mut ScopeStack, registry: &mut TypeRegistry) {
+        let unknown = registry.intern(Type::Unknown);
+        let void = registry.intern(Type::Void);
+        let print = registry.intern(Type::Function(FunctionType {
+            params: vec![FunctionParam { name: "value".to_string(), type_id: unknown }],
+            return_type: void,
+        }));
+        scopes.insert_prelude(
+            Symbol::new("print".to_string(), Some("(?)".to_string()), SymbolKind::Function)
+                .with_type_id(print),
+        );
+    }
+
     /// Checks if a given name is a built-in type
     fn is_builtin_type(name: &str) -> bool {
         matches!(
@@ -823,49 +999,106 @@ impl SemanticAnalyzer {
     /// On success returns [`AnalysisOutput`] with the AST, node types, and type registry.
     /// On failure returns [`AnalysisError`] with the AST and error list — callers can render
     /// the AST without having to pre-render it before passing it to the analyzer.
-    pub fn analyze_with_types(mut self) -> Result<AnalysisOutput, AnalysisError> {
+    pub fn analyze_with_types(self) -> Result<AnalysisOutput, AnalysisError> {
+        self.analyze_profiled(&mut crate::stats::Profile::default())
+    }
+
+    /// Like [`analyze_with_types`], timing each phase into `profile` and
+    /// recording type, constraint and type variable counts.
+    pub fn analyze_profiled(
+        mut self,
+        profile: &mut crate::stats::Profile,
+    ) -> Result<AnalysisOutput, AnalysisError> {
+        let _span = crate::trace_span!("semantic", "analyze");
+        self.budget.start();
         if let Some(root_idx) = self.ast.root {
             // Phase 1: Collect constraints by traversing AST
-            self.visit_node(root_idx);
+            phase(profile, "constraint collection", || self.visit_node(root_idx));
+
+            if self.is_interrupted() {
+                return Err(self.interrupted_error());
+            }
 
             // Phase 2: Solve constraints via unification
-            if let Err(errors) = self.solve_constraints() {
+            if let Err(errors) = phase(profile, "unification", || self.solve_constraints()) {
                 self.errors.extend(errors);
             }
+            if self.is_interrupted() {
+                return Err(self.interrupted_error());
+            }
 
             // Phase 2.5: Verify deferred structural type checks
-            self.verify_deferred_checks();
+            phase(profile, "deferred checks", || self.verify_deferred_checks());
 
             // Phase 2.6: Verify match pattern exhaustiveness
-            self.verify_match_exhaustiveness();
+            phase(profile, "match exhaustiveness", || self.verify_match_exhaustiveness());
 
             // Phase 2.7: Solve any new constraints from deferred checks
             if !self.constraints.is_empty() {
-                if let Err(errors) = self.solve_constraints() {
+                if let Err(errors) =
+                    phase(profile, "unification (deferred)", || self.solve_constraints())
+                {
                     self.errors.extend(errors);
                 }
+                if self.is_interrupted() {
+                    return Err(self.interrupted_error());
+                }
             }
 
             // Phase 3: Apply final substitution to all node types
-            self.apply_substitution();
+            phase(profile, "substitution", || self.apply_substitution());
 
             // Phase 4: Compute mutation analysis using fully-resolved types
-            self.compute_all_mutations();
+            phase(profile, "mutation analysis", || self.compute_all_mutations());
+        }
+
+        profile.counts.types = self.type_registry.len();
+        profile.counts.constraints = self.constraints_solved;
+        profile.counts.type_variables = self.next_type_var as usize;
+        if profile.wants_mem_report() {
+            profile.memory = Some(self.mem_report());
         }
 
         if self.errors.is_empty() {
+            let mut node_types = self.node_types;
+            node_types.resize(self.ast.nodes.len(), None);
             Ok(AnalysisOutput {
                 ast: self.ast,
-                node_types: self.node_types,
+                node_types,
                 type_registry: self.type_registry,
                 function_mutations: self.function_mutations,
                 method_this_mutations: self.method_this_mutations,
+                function_types: self.function_types,
+                substitution: self.substitution,
             })
         } else {
             Err(AnalysisError { ast: self.ast, errors: self.errors })
         }
     }
 
+    /// Heap bytes held by the analyzer's structures at this point
+    fn mem_report(&self) -> crate::stats::MemReport {
+        use crate::stats::{hash_map_bytes, vec_bytes};
+
+        let mut report = crate::stats::MemReport::default();
+        push_output_entries(&mut report, &self.ast, &self.node_types, &self.type_registry);
+        report.push("Substitution", self.substitution.len(), self.substitution.heap_bytes());
+        report.push("ScopeStack.scopes", self.scopes.scope_count(), self.scopes.heap_bytes());
+        report.push(
+            "variable_types",
+            self.variable_types.len(),
+            hash_map_bytes(&self.variable_types)
+                + self.variable_types.keys().map(|(_, name)| name.capacity()).sum::<usize>(),
+        );
+        report.push(
+            "function_returns",
+            self.function_returns.len(),
+            hash_map_bytes(&self.function_returns)
+                + self.function_returns.values().map(vec_bytes).sum::<usize>(),
+        );
+        report
+    }
+
     /// Computes mutation analysis for all collected function declarations.
     ///
     /// Must be called after `apply_substitution()` so that param TypeIds are
@@ -929,6 +1162,13 @@ impl SemanticAnalyzer {
     fn visit_node(&mut self, node_idx: usize) {
         use crate::ast::NodeType;
 
+        if self.is_interrupted() {
+            return;
+        }
+
+        #[cfg(feature = "trace")]
+        let _span = self.visit_span(node_idx);
+
         let node = &self.ast.nodes[node_idx];
 
         match node.node_type {
@@ -976,6 +1216,35 @@ impl SemanticAnalyzer {
         }
     }
 
+    /// Trace span for the visitor families worth seeing in a profile:
+    /// declarations (named after the declared symbol), module statements and
+    /// compound expressions; leaves get an inert span
+    #[cfg(feature = "trace")]
+    fn visit_span(&self, node_idx: usize) -> crate::trace::Span {
+        use crate::ast::NodeType;
+
+        let family = match self.ast.nodes[node_idx].node_type {
+            NodeType::FunctionDecl => "function",
+            NodeType::TypeDecl => "type",
+            NodeType::VarDecl => "variable",
+            NodeType::ModuleDecl => "module",
+            NodeType::Import => "import",
+            NodeType::Export => "export",
+            NodeType::StructInit => "struct_init",
+            NodeType::FunctionCall => "call",
+            NodeType::MethodCall => "method_call",
+            NodeType::Match => "match",
+            NodeType::Pipe => "pipe",
+            NodeType::Partial => "partial",
+            NodeType::Try => "try",
+            _ => return crate::trace::Span::none(),
+        };
+        crate::trace::Span::enter("semantic", family, || {
+            let name_idx = self.ast.nodes[node_idx].first_child?;
+            self.ast.node_text(name_idx).map(str::to_string)
+        })
+    }
+
     /// Visits all children of a node
     fn visit_children(&mut self, node_idx: usize) {
         if let Some(first_child_idx) = self.ast.nodes[node_idx].first_child {
@@ -1197,6 +1466,23 @@ mod tests {
         assert_eq!(stack.current_scope().kind, ScopeKind::Global);
     }
 
+    #[test]
+    fn test_scope_stack_prelude_shadowing() {
+        let mut stack = ScopeStack::new();
+        let builtin = Symbol::new("print".to_string(), None, SymbolKind::Function);
+        assert!(stack.insert_prelude(builtin.clone()));
+        assert!(!stack.insert_prelude(builtin));
+
+        // Visible from the global scope, but not declared in it
+        assert!(stack.lookup("print").is_some());
+        assert!(stack.current_scope().lookup_local("print").is_none());
+        assert_eq!(stack.depth(), 0);
+
+        // A global declaration of the same name shadows the built-in
+        assert!(stack.insert(Symbol::new("print".to_string(), None, SymbolKind::Variable)));
+        assert_eq!(stack.lookup("print").unwrap().kind, SymbolKind::Variable);
+    }
+
     #[test]
     fn test_scope_stack_depth() {
         let mut stack = ScopeStack::new();
@@ -1495,4 +1781,134 @@ mod tests {
         // Should succeed with semantic analysis implemented
         assert!(result.is_ok());
     }
+
+    #[test]
+    fn test_cancel_flag_stops_analysis() {
+        use std::sync::Arc;
+        use std::sync::atomic::AtomicBool;
+
+        let limits = crate::limits::CompilerLimits::default();
+        let tokens = lex("x: 42\ny: x\n", &limits).unwrap();
+        let ast = parse(tokens, &limits).unwrap();
+        let flag = Arc::new(AtomicBool::new(true));
+
+        let result = SemanticAnalyzer::new(ast).with_cancel_flag(flag).analyze();
+        let errors = result.unwrap_err();
+        assert_eq!(errors.len(), 1);
+        assert_eq!(errors[0].message, "Analysis cancelled");
+    }
+
+    #[test]
+    fn test_analysis_budgets_stop_with_an_error() {
+        // 200 constraints (one per call) and 200 type variables (one per `[]`)
+        let source = "f: (x Number) Number { return x }\n".to_string()
+            + &(0..200).map(|i| format!("c{i}: f({i})\ne{i}: []\n")).collect::<String>();
+        let analyze_with = |limits: crate::limits::CompilerLimits| {
+            let tokens = lex(&source, &limits).unwrap();
+            let ast = parse(tokens, &limits).unwrap();
+            SemanticAnalyzer::new(ast).analyze()
+        };
+        let defaults = crate::limits::CompilerLimits::default;
+
+        assert!(analyze_with(defaults()).is_ok());
+        for (limits, message) in [
+            (
+                crate::limits::CompilerLimits { max_type_vars: 50, ..defaults() },
+                "Analysis limit exceeded: max_type_vars (max: 50)",
+            ),
+            (
+                crate::limits::CompilerLimits { max_constraints: 100, ..defaults() },
+                "Analysis limit exceeded: max_constraints (max: 100)",
+            ),
+            (
+                crate::limits::CompilerLimits { max_memory_bytes: 4096, ..defaults() },
+                "Analysis limit exceeded: max_memory_bytes (max: 4096)",
+            ),
+        ] {
+            let errors = analyze_with(limits).unwrap_err();
+            assert_eq!(errors.len(), 1);
+            assert_eq!(errors[0].message, message);
+        }
+    }
+
+    #[test]
+    fn test_constraint_budget_counts_each_constraint_once() {
+        // Exactly 201 constraints: one for the return, one per call
+        let source = "f: (x Number) Number { return x }\n".to_string()
+            + &(0..200).map(|i| format!("c{i}: f({i})\n")).collect::<String>();
+        let analyze_with = |max_constraints| {
+            let limits = crate::limits::CompilerLimits {
+                max_constraints,
+                ..crate::limits::CompilerLimits::default()
+            };
+            let tokens = lex(&source, &limits).unwrap();
+            let ast = parse(tokens, &limits).unwrap();
+            SemanticAnalyzer::new(ast).analyze()
+        };
+
+        assert!(analyze_with(201).is_ok());
+        let errors = analyze_with(200).unwrap_err();
+        assert_eq!(errors[0].message, "Analysis limit exceeded: max_constraints (max: 200)");
+    }
+
+    #[test]
+    fn test_unraised_cancel_flag_allows_analysis() {
+        use std::sync::Arc;
+        use std::sync::atomic::AtomicBool;
+
+        let limits = crate::limits::CompilerLimits::default();
+        let tokens = lex("x: 42\n", &limits).unwrap();
+        let ast = parse(tokens, &limits).unwrap();
+        let flag = Arc::new(AtomicBool::new(false));
+
+        assert!(SemanticAnalyzer::new(ast).with_cancel_flag(flag).analyze().is_ok());
+    }
+
+    #[test]
+    fn test_node_types_dense_and_substituted() {
+        let limits = crate::limits::CompilerLimits::default();
+        let tokens = lex("f: (x Number) Number { return x }\nn: f(1)\n", &limits).unwrap();
+        let ast = parse(tokens, &limits).unwrap();
+        let output = SemanticAnalyzer::new(ast).analyze_with_types().unwrap();
+
+        assert_eq!(output.node_types.len(), output.ast.nodes.len());
+        // The Program node carries no type
+        assert_eq!(output.type_of(output.ast.root.unwrap()), None);
+        // Final substitution resolved the call result in place
+        let n_decl = output.ast.children(output.ast.root.unwrap()).nth(1).unwrap();
+        let n_type = output.type_of(n_decl).unwrap();
+        assert_eq!(type_to_display_string(n_type, &output.type_registry), "Number");
+    }
+
+    #[test]
+    fn test_mem_report_covers_analyzer_structures() {
+        let limits = crate::limits::CompilerLimits::default();
+        let source = "type Point: { x Number, y Number }\nadd: (a Number, b Number) Number { return a }\nn: add(1, 2)\nempty: []\n";
+        let ast = parse(lex(source, &limits).unwrap(), &limits).unwrap();
+
+        let mut profile = crate::stats::Profile::default().with_mem_report();
+        let output = SemanticAnalyzer::new(ast).analyze_profiled(&mut profile).unwrap();
+        let report = profile.memory.expect("report requested");
+
+        for name in [
+            "Ast.nodes",
+            "StringStorage",
+            "TypeRegistry.types",
+            "TypeRegistry.cache",
+            "node_types",
+            "ScopeStack.scopes",
+            "variable_types",
+            "function_returns",
+        ] {
+            let entry = report.get(name).unwrap();
+            assert!(entry.len > 0 && entry.bytes > 0, "{}: {:?}", name, entry);
+        }
+        assert!(report.get("Substitution").is_some());
+        assert_eq!(report.get("Ast.nodes").unwrap().len, output.ast.nodes.len());
+
+        // The output keeps the structures that outlive analysis
+        let kept = output.mem_report();
+        assert_eq!(kept.entries.len(), 5);
+        assert_eq!(kept.get("StringStorage"), report.get("StringStorage"));
+    }
 }
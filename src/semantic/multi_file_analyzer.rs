@@ -60,69 +60,38 @@ impl MultiFileAnalyzer {
     /// 3. Second pass: run full `SemanticAnalyzer` on each file, sharing
     ///    the registry so imports can be resolved.
     pub fn analyze(&self) -> HashMap<String, FileAnalysisResult> {
+        let _span = crate::trace_span!("multi_file", "analyze");
+
         // ── Step 1: parse all files ──────────────────────────────────────────
         let mut parsed: Vec<(String, Result<Ast, String>)> = Vec::new();
         for sf in &self.sources {
+            let _span = crate::trace_span!("multi_file", "parse_file", sf.name);
             let result = self.parse_source(&sf.source);
             parsed.push((sf.name.clone(), result));
         }
 
         // ── Step 2: first pass — collect module info ─────────────────────────
-        let registry = Rc::new(RefCell::new(ModuleRegistry::new()));
-        let mut file_module_names: HashMap<String, Option<String>> = HashMap::new();
-
-        // Sub-step A: collect (name, module_name, is_submodule, exports) without registering
-        let mut collected: Vec<(String, Option<String>, bool, Vec<String>)> = Vec::new();
-        for (name, result) in &parsed {
-            if let Ok(ast) = result {
-                let (module_name, export_names, is_submodule) = extract_module_info(ast);
-                file_module_names.insert(name.clone(), module_name.clone());
-                collected.push((name.clone(), module_name, is_submodule, export_names));
-            } else {
-                file_module_names.insert(name.clone(), None);
-                collected.push((name.clone(), None, false, Vec::new()));
-            }
-        }
-
-        // Sub-step B: find the single main (non-submodule) module name in this batch,
-        // then register all modules with proper parent links.
-        let main_module_name: Option<String> = collected
+        let infos: Vec<ModuleInfo> = {
+            let _span = crate::trace_span!("multi_file", "module_info");
+            parsed
+                .iter()
+                .map(|(_, result)| result.as_ref().map(module_info).unwrap_or_default())
+                .collect()
+        };
+        let file_module_names: HashMap<String, Option<String>> = parsed
             .iter()
-            .find(|(_, _, is_sub, _)| !is_sub)
-            .and_then(|(_, mod_name, _, _)| mod_name.clone());
-
-        for (_, module_name, is_submodule, export_names) in &collected {
-            if let Some(mod_name) = module_name {
-                let mut reg = registry.borrow_mut();
-                if *is_submodule {
-                    if let Some(ref parent) = main_module_name {
-                        reg.register_submodule_with_parent(mod_name.clone(), parent.clone());
-                    } else {
-                        reg.register_submodule(mod_name.clone());
-                    }
-                } else {
-                    reg.register_module(mod_name.clone());
-                }
-                for export_name in export_names {
-                    reg.add_export(
-                        mod_name,
-                        ModuleExportedSymbol::new(export_name.clone(), SymbolKind::Variable),
-                    );
-                }
-            }
-        }
-
-        // Collect all module names in this batch for submodule visibility enforcement
-        let package_modules: HashSet<String> = file_module_names
-            .values()
-            .filter_map(|opt| opt.as_ref())
-            .cloned()
+            .zip(&infos)
+            .map(|((name, _), info)| (name.clone(), info.module_name.clone()))
             .collect();
 
+        let registry = Rc::new(RefCell::new(build_registry(&infos)));
+        let package_modules = package_modules(&infos);
+
         // ── Step 3: second pass — full semantic analysis ─────────────────────
         let mut results: HashMap<String, FileAnalysisResult> = HashMap::new();
 
         for (name, parse_result) in parsed {
+            let _span = crate::trace_span!("multi_file", "analyze_file", name);
             match parse_result {
                 Err(parse_error) => {
                     // File failed to parse — report as a semantic error
@@ -161,6 +130,89 @@ impl MultiFileAnalyzer {
     }
 }
 
+/// Module-level facts about one file gathered by the first pass
+///
+/// Plain data (`Send`), so callers analyzing files on several threads can
+/// share one snapshot and build a registry per thread.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct ModuleInfo {
+    pub module_name: Option<String>,
+    pub is_submodule: bool,
+    pub exports: Vec<String>,
+    /// Module paths named by `import` statements, as written (`math`, `Calculator.utils`)
+    pub imports: Vec<String>,
+}
+
+/// First-pass scan of a parsed file
+pub fn module_info(ast: &Ast) -> ModuleInfo {
+    let (module_name, exports, is_submodule) = extract_module_info(ast);
+    ModuleInfo { module_name, is_submodule, exports, imports: extract_imports(ast) }
+}
+
+/// Builds the shared module registry from the first-pass info of a batch
+///
+/// Submodules are linked to the batch's main module: the module declared by
+/// the first file that is not a submodule.
+pub fn build_registry(infos: &[ModuleInfo]) -> ModuleRegistry {
+    let main_module_name: Option<String> = infos
+        .iter()
+        .find(|info| !info.is_submodule)
+        .and_then(|info| info.module_name.clone());
+
+    let mut reg = ModuleRegistry::new();
+    for info in infos {
+        if let Some(mod_name) = &info.module_name {
+            if info.is_submodule {
+                if let Some(ref parent) = main_module_name {
+                    reg.register_submodule_with_parent(mod_name.clone(), parent.clone());
+                } else {
+                    reg.register_submodule(mod_name.clone());
+                }
+            } else {
+                reg.register_module(mod_name.clone());
+            }
+            for export_name in &info.exports {
+                reg.add_export(
+                    mod_name,
+                    ModuleExportedSymbol::new(export_name.clone(), SymbolKind::Variable),
+                );
+            }
+        }
+    }
+    reg
+}
+
+/// All module names declared in a batch (for submodule visibility enforcement)
+pub fn package_modules(infos: &[ModuleInfo]) -> HashSet<String> {
+    infos.iter().filter_map(|info| info.module_name.clone()).collect()
+}
+
+/// Module paths imported by a file: the module identifier of every `ImportItem`
+///
+/// The module is the last child of the item in all four import forms.
+pub fn extract_imports(ast: &Ast) -> Vec<String> {
+    let Some(root_idx) = ast.root else {
+        return Vec::new();
+    };
+
+    let mut imports = Vec::new();
+    for child_idx in ast.children(root_idx) {
+        if ast.nodes[child_idx].node_type != NodeType::Import {
+            continue;
+        }
+        // Import → ImportList → ImportItem+
+        let Some(list_idx) = ast.nodes[child_idx].first_child else { continue };
+        for item_idx in ast.children(list_idx) {
+            if let Some(module_idx) = ast.children(item_idx).last() {
+                if let Some(path) = ast.node_text(module_idx) {
+                    imports.push(path.to_string());
+                }
+            }
+        }
+    }
+    imports
+}
+
 /// Lightweight first-pass scan: extracts module name, exported symbol names,
 /// and whether the module is a submodule directly from the AST without running
 /// full type-checking.
@@ -257,6 +309,15 @@ mod tests {
         assert!(!is_submodule);
     }
 
+    #[test]
+    fn test_extract_imports_all_forms() {
+        let source = "import { math, m: Calculator.utils, *: io, {sin, cos}: trig }\n";
+        let limits = CompilerLimits::default();
+        let tokens = crate::lexer::lex(source, &limits).unwrap();
+        let ast = crate::parser::parse(tokens, &limits).unwrap();
+        assert_eq!(extract_imports(&ast), vec!["math", "Calculator.utils", "io", "trig"]);
+    }
+
     #[test]
     fn test_extract_module_info_submodule() {
         let limits = CompilerLimits::default();
@@ -291,6 +291,7 @@ impl SemanticAnalyzer {
         let symbol = Symbol::new(name.clone(), Some(signature), SymbolKind::Function)
             .with_type_id(func_type_id);
         self.scopes.insert(symbol);
+        self.function_types.insert(node_idx, func_type_id);
 
         // Enter function context for return type tracking
         self.enter_function_context(node_idx);
@@ -627,6 +628,20 @@ mod tests {
         assert!(errors[0].message.contains("Function 'foo' is not defined"));
     }
 
+    #[test]
+    fn test_builtin_print() {
+        let source = "main: () {\n    print(\"Hello\")\n    print(42)\n}\n";
+        let result = analyze_source(source);
+        assert!(result.is_ok(), "print should be a built-in: {:?}", result.err());
+    }
+
+    #[test]
+    fn test_builtin_print_can_be_shadowed() {
+        let source = "print: (s String) Number {\n    return 1\n}\nx: print(\"a\")";
+        let result = analyze_source(source);
+        assert!(result.is_ok(), "User print should shadow the built-in: {:?}", result.err());
+    }
+
     #[test]
     fn test_function_call_not_a_function() {
         // Calling a variable as a function
@@ -53,18 +53,21 @@ impl SemanticAnalyzer {
     pub(super) fn solve_constraints(&mut self) -> Result<(), Vec<SemanticError>> {
         let mut errors = Vec::new();
 
-        // Process each constraint
-        // Clone constraints to avoid borrow checker issues
-        let constraints = self.constraints.clone();
+        // Taken, not cloned: the pending list is empty while solving, so the
+        // budget counts each constraint once, as it is solved, and later
+        // passes do not re-process it
+        let constraints = std::mem::take(&mut self.constraints);
         for constraint in constraints {
+            // The caller reports an interrupted analysis
+            if self.is_interrupted() {
+                break;
+            }
             if let Err(e) = self.unify(constraint.left, constraint.right, constraint.source) {
                 errors.push(e);
             }
+            self.constraints_solved += 1;
         }
 
-        // Clear constraints to avoid re-processing on subsequent passes
-        self.constraints.clear();
-
         if errors.is_empty() {
             Ok(())
         } else {
@@ -87,12 +90,11 @@ impl SemanticAnalyzer {
     /// After: node 1 → Number, node 2 → Array(Number)
     /// ```
     pub(super) fn apply_substitution(&mut self) {
-        let keys: Vec<usize> = self.node_types.keys().copied().collect();
-        for node_idx in keys {
-            if let Some(ty) = self.node_types.get(&node_idx) {
-                let final_ty = self.substitution.apply(*ty, &self.type_registry);
-                self.node_types.insert(node_idx, final_ty);
-            }
+        // In place: the substitution and registry are disjoint borrows
+        let substitution = &self.substitution;
+        let registry = &self.type_registry;
+        for ty in self.node_types.iter_mut().flatten() {
+            *ty = substitution.apply(*ty, registry);
         }
     }
 }
@@ -253,6 +253,30 @@ pub enum Type {
     Error,
 }
 
+impl Type {
+    /// Heap bytes owned by this type (names and field, method, parameter and
+    /// alternative lists); referenced types are counted where they are stored
+    pub(crate) fn heap_bytes(&self) -> usize {
+        use crate::stats::vec_bytes;
+        match self {
+            Type::NamedUnit(name) | Type::TypeVar(name) => name.capacity(),
+            Type::TypeParameter { name, .. } => name.capacity(),
+            Type::Struct(s) => {
+                vec_bytes(&s.fields)
+                    + vec_bytes(&s.methods)
+                    + s.fields.iter().map(|f| f.name.capacity()).sum::<usize>()
+                    + s.methods.iter().map(|m| m.name.capacity()).sum::<usize>()
+            }
+            Type::Union(alternatives) => vec_bytes(alternatives),
+            Type::Function(f) => {
+                vec_bytes(&f.params) + f.params.iter().map(|p| p.name.capacity()).sum::<usize>()
+            }
+            Type::Generic { type_params, .. } => vec_bytes(type_params),
+            _ => 0,
+        }
+    }
+}
+
 // ========== TypeRegistry ==========
 
 /// Registry for type interning and deduplication
@@ -334,6 +358,16 @@ impl TypeRegistry {
         self.get(type_id)
     }
 
+    /// Finds the TypeId of an already interned type without interning it
+    pub fn lookup(&self, ty: &Type) -> Option<TypeId> {
+        self.cache.get(ty).copied()
+    }
+
+    /// Iterates over all interned types with their TypeIds
+    pub fn iter(&self) -> impl Iterator<Item = (TypeId, &Type)> {
+        self.types.iter().enumerate().map(|(idx, ty)| (TypeId(idx), ty))
+    }
+
     /// Returns the number of unique types in the registry
     pub fn len(&self) -> usize {
         self.types.len()
@@ -344,6 +378,23 @@ impl TypeRegistry {
         self.types.is_empty()
     }
 
+    /// Heap bytes of the type vector and cache table alone (constant time)
+    pub(crate) fn table_bytes(&self) -> usize {
+        crate::stats::vec_bytes(&self.types) + crate::stats::hash_map_bytes(&self.cache)
+    }
+
+    /// Estimated heap bytes of the type storage, including what types own
+    pub fn types_heap_bytes(&self) -> usize {
+        crate::stats::vec_bytes(&self.types) + self.types.iter().map(Type::heap_bytes).sum::<usize>()
+    }
+
+    /// Estimated heap bytes of the interning cache; its keys are clones of
+    /// the stored types, so they own as much again
+    pub fn cache_heap_bytes(&self) -> usize {
+        crate::stats::hash_map_bytes(&self.cache)
+            + self.cache.keys().map(Type::heap_bytes).sum::<usize>()
+    }
+
     /// Returns true if any registered union type contains both `t1` and `t2` as alternatives.
     ///
     /// Used during unification to allow two different NamedUnit types to unify when
@@ -490,6 +541,11 @@ impl Substitution {
     pub fn len(&self) -> usize {
         self.map.len()
     }
+
+    /// Estimated heap bytes of the binding table
+    pub fn heap_bytes(&self) -> usize {
+        crate::stats::hash_map_bytes(&self.map)
+    }
 }
 
 // ========== Display Helpers ==========
@@ -603,6 +659,20 @@ mod tests {
         assert_eq!(registry.len(), 2);
     }
 
+    #[test]
+    fn test_lookup_and_iter() {
+        let mut registry = TypeRegistry::new();
+        let num_id = registry.intern(Type::Number);
+        let unit_id = registry.intern(Type::NamedUnit("Success".to_string()));
+
+        assert_eq!(registry.lookup(&Type::Number), Some(num_id));
+        assert_eq!(registry.lookup(&Type::String), None);
+        assert_eq!(registry.len(), 2);
+
+        let all: Vec<(TypeId, &Type)> = registry.iter().collect();
+        assert_eq!(all, vec![(num_id, &Type::Number), (unit_id, &Type::NamedUnit("Success".to_string()))]);
+    }
+
     #[test]
     fn test_get_primitive() {
         let mut registry = TypeRegistry::new();
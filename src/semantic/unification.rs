@@ -47,44 +47,30 @@ impl SemanticAnalyzer {
             return Ok(());
         }
 
-        let type1 = self.type_registry.resolve(t1).clone();
-        let type2 = self.type_registry.resolve(t2).clone();
-
-        match (&type1, &type2) {
-            // ========== Type Variable Cases ==========
+        // ========== Type Variable Cases ==========
 
+        // Handled before the types are cloned below: binding a variable is
+        // the common case and only needs its id
+        let var_of = |ty| match self.type_registry.resolve(ty) {
+            Type::Var(var) => Some(*var),
+            _ => None,
+        };
+        match (var_of(t1), var_of(t2)) {
             // Var-Var: bind first to second
-            (Type::Var(v1), Type::Var(v2)) => {
-                self.substitution.insert(*v1, t2);
-                Ok(())
-            }
-
-            // Var-Type: bind variable to type (with occurs check)
-            (Type::Var(var), _) => {
-                if self.occurs_check(*var, t2) {
-                    Err(self.make_error(
-                        format!("Infinite type: type variable '{}' occurs in type", var.id()),
-                        source,
-                    ))
-                } else {
-                    self.substitution.insert(*var, t2);
-                    Ok(())
-                }
+            (Some(v1), Some(_)) => {
+                self.substitution.insert(v1, t2);
+                return Ok(());
             }
+            // Var-Type and Type-Var: bind the variable (with occurs check)
+            (Some(var), None) => return self.bind(var, t2, source),
+            (None, Some(var)) => return self.bind(var, t1, source),
+            (None, None) => {}
+        }
 
-            // Type-Var: symmetric case
-            (_, Type::Var(var)) => {
-                if self.occurs_check(*var, t1) {
-                    Err(self.make_error(
-                        format!("Infinite type: type variable '{}' occurs in type", var.id()),
-                        source,
-                    ))
-                } else {
-                    self.substitution.insert(*var, t1);
-                    Ok(())
-                }
-            }
+        let type1 = self.type_registry.resolve(t1).clone();
+        let type2 = self.type_registry.resolve(t2).clone();
 
+        match (&type1, &type2) {
             // ========== Primitive Types ==========
             (Type::Unit, Type::Unit)
             | (Type::Number, Type::Number)
@@ -248,6 +234,18 @@ impl SemanticAnalyzer {
         }
     }
 
+    /// Binds `var` to `ty` unless `var` occurs in it
+    fn bind(&mut self, var: TypeVarId, ty: TypeId, source: usize) -> Result<(), SemanticError> {
+        if self.occurs_check(var, ty) {
+            return Err(self.make_error(
+                format!("Infinite type: type variable '{}' occurs in type", var.id()),
+                source,
+            ));
+        }
+        self.substitution.insert(var, ty);
+        Ok(())
+    }
+
     /// Occurs check: does type variable occur in type?
     ///
     /// Prevents infinite types like `'a = Array('a)` by checking if
@@ -427,4 +425,43 @@ mod tests {
         // These should unify because 'a is already bound to Number
         assert!(analyzer.unify(arr_var, arr_num, 0).is_ok());
     }
+
+    #[test]
+    fn test_unify_identical_structs_allocation_free() {
+        use crate::alloc_budget::assert_no_allocations;
+        use crate::semantic::{StructField, StructType};
+
+        let mut analyzer = test_analyzer();
+        let number = analyzer.type_registry.intern(Type::Number);
+        let point = || {
+            Type::Struct(StructType {
+                fields: ["x", "y"]
+                    .iter()
+                    .map(|name| StructField {
+                        name: name.to_string(),
+                        type_id: number,
+                        is_private: false,
+                    })
+                    .collect(),
+                methods: Vec::new(),
+            })
+        };
+        let a = analyzer.type_registry.intern(point());
+        let b = analyzer.type_registry.intern(point());
+
+        // Structurally identical types intern to one id; unifying them is a
+        // comparison, not a traversal
+        assert_eq!(a, b);
+        assert_no_allocations(|| analyzer.unify(a, b, 0)).unwrap();
+
+        // Binding a type variable to a struct walks the struct for the occurs
+        // check but copies nothing. The first binding allocates the
+        // substitution's table, so it is made outside the budget.
+        let warm = analyzer.fresh_type_var();
+        analyzer.unify(warm, number, 0).unwrap();
+        let var = analyzer.fresh_type_var();
+        assert_no_allocations(|| analyzer.unify(var, a, 0)).unwrap();
+        assert_no_allocations(|| analyzer.unify(a, var, 0)).unwrap();
+        assert_eq!(analyzer.substitution.apply(var, &analyzer.type_registry), a);
+    }
 }
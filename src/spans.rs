@@ -0,0 +1,276 @@
+// Source spans for AST nodes and a position → node index
+//
+// Tokens only record where they start (1-indexed line and char column).
+// `SpanTable` resolves those to byte offsets in the source text once, then
+// answers:
+//   - `token_span(idx)`: bytes covered by the node's own token
+//   - `span(idx)`: bytes covered by the node and its whole subtree
+//   - `node_at(offset)`: innermost node whose token covers a byte offset,
+//     by binary search over token spans sorted by start (O(log n))
+//   - `nodes_in(start, end)`: token-bearing nodes overlapping a byte range
+//     (O(log n + k)), in source order
+
+use crate::ast::Ast;
+use crate::lexer::{Token, TokenKind};
+use crate::string_storage::StringStorage;
+
+/// Half-open byte range in the source text
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Span {
+    pub start: usize,
+    pub end: usize,
+}
+
+impl Span {
+    pub fn contains(&self, offset: usize) -> bool {
+        self.start <= offset && offset < self.end
+    }
+}
+
+/// Entry of the sorted token index
+#[derive(Debug, Clone, Copy)]
+struct IndexEntry {
+    start: usize,
+    end: usize,
+    depth: usize,
+    node: usize,
+}
+
+/// Byte spans for every node of an AST plus a sorted position index
+#[derive(Debug)]
+pub struct SpanTable {
+    token_spans: Vec<Option<Span>>,
+    spans: Vec<Option<Span>>,
+    /// Token spans sorted by (start, depth); tokens never overlap, so the
+    /// only entries sharing a start are nodes sharing one token
+    index: Vec<IndexEntry>,
+    /// Byte offset where each line starts
+    line_starts: Vec<usize>,
+}
+
+impl SpanTable {
+    /// Builds the table for an AST parsed from `source`
+    pub fn build(ast: &Ast, source: &str) -> Self {
+        let line_starts: Vec<usize> = std::iter::once(0)
+            .chain(source.match_indices('\n').map(|(i, _)| i + 1))
+            .collect();
+
+        let mut table = SpanTable {
+            token_spans: vec![None; ast.nodes.len()],
+            spans: vec![None; ast.nodes.len()],
+            index: Vec::new(),
+            line_starts,
+        };
+
+        for (idx, node) in ast.nodes.iter().enumerate() {
+            let Some(token) = &node.token else { continue };
+            let Some(start) = table.offset(source, token.line, token.column) else {
+                continue;
+            };
+            let end = (start + token_byte_len(token, &ast.string_storage)).min(source.len());
+            table.token_spans[idx] = Some(Span { start, end });
+        }
+
+        if let Some(root) = ast.root {
+            table.index_subtree(ast, root);
+        }
+        table.index.sort_unstable_by_key(|e| (e.start, e.depth));
+        table
+    }
+
+    /// Post-order walk computing subtree spans and collecting index entries
+    fn index_subtree(&mut self, ast: &Ast, root: usize) {
+        // (node, depth, children visited)
+        let mut stack = vec![(root, 0usize, false)];
+        while let Some((idx, depth, expanded)) = stack.pop() {
+            if !expanded {
+                stack.push((idx, depth, true));
+                for child in ast.children(idx) {
+                    stack.push((child, depth + 1, false));
+                }
+                continue;
+            }
+
+            let mut span = self.token_spans[idx];
+            if let Some(own) = span {
+                if own.end > own.start {
+                    self.index.push(IndexEntry {
+                        start: own.start,
+                        end: own.end,
+                        depth,
+                        node: idx,
+                    });
+                }
+            }
+            for child in ast.children(idx) {
+                if let Some(c) = self.spans[child] {
+                    span = Some(match span {
+                        Some(s) => Span {
+                            start: s.start.min(c.start),
+                            end: s.end.max(c.end),
+                        },
+                        None => c,
+                    });
+                }
+            }
+            self.spans[idx] = span;
+        }
+    }
+
+    /// Byte offset of a lexer location (1-indexed line, 1-indexed char column)
+    pub fn offset(&self, source: &str, line: usize, column: usize) -> Option<usize> {
+        let line_start = *self.line_starts.get(line.checked_sub(1)?)?;
+        let line_text = &source[line_start..];
+        let skip = column.checked_sub(1)?;
+        let within = line_text
+            .char_indices()
+            .nth(skip)
+            .map_or(line_text.len(), |(i, _)| i);
+        Some(line_start + within)
+    }
+
+    /// Zero-based line and the byte offset where that line starts
+    pub fn line_of(&self, offset: usize) -> (usize, usize) {
+        let line = self.line_starts.partition_point(|&s| s <= offset) - 1;
+        (line, self.line_starts[line])
+    }
+
+    /// Bytes covered by the node's own token
+    pub fn token_span(&self, node_idx: usize) -> Option<Span> {
+        self.token_spans.get(node_idx).copied().flatten()
+    }
+
+    /// Bytes covered by the node and all of its descendants
+    pub fn span(&self, node_idx: usize) -> Option<Span> {
+        self.spans.get(node_idx).copied().flatten()
+    }
+
+    /// Innermost node whose token covers `offset`
+    pub fn node_at(&self, offset: usize) -> Option<usize> {
+        let after = self.index.partition_point(|e| e.start <= offset);
+        let entry = self.index[..after].last()?;
+        (offset < entry.end).then_some(entry.node)
+    }
+
+    /// Token-bearing nodes overlapping `[start, end)` in source order
+    ///
+    /// Nodes sharing a token are yielded outermost first.
+    pub fn nodes_in(&self, start: usize, end: usize) -> impl Iterator<Item = usize> + '_ {
+        // Disjoint spans sorted by start are also sorted by end
+        let first = self.index.partition_point(|e| e.end <= start);
+        self.index[first..]
+            .iter()
+            .take_while(move |e| e.start < end)
+            .map(|e| e.node)
+    }
+}
+
+/// Length of a token in source bytes
+pub fn token_byte_len(token: &Token, storage: &StringStorage) -> usize {
+    let text_len = || token.text(storage).map_or(0, str::len);
+    match token.kind {
+        TokenKind::Identifier | TokenKind::Number(_) => text_len(),
+        TokenKind::String(_) => text_len() + 2, // quotes or backticks
+        TokenKind::Module | TokenKind::Import | TokenKind::Export | TokenKind::Return => 6,
+        TokenKind::Partial => 7,
+        TokenKind::Match | TokenKind::False => 5,
+        TokenKind::Type | TokenKind::True | TokenKind::This => 4,
+        TokenKind::Try | TokenKind::And | TokenKind::Not => 3,
+        TokenKind::Or => 2,
+        TokenKind::Newline | TokenKind::Eof => 0,
+        _ => 1,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::ast::NodeType;
+    use crate::limits::CompilerLimits;
+
+    fn build(source: &str) -> (Ast, SpanTable) {
+        let limits = CompilerLimits::default();
+        let tokens = crate::lexer::lex(source, &limits).unwrap();
+        let ast = crate::parser::parse(tokens, &limits).unwrap();
+        let table = SpanTable::build(&ast, source);
+        (ast, table)
+    }
+
+    #[test]
+    fn test_token_and_subtree_spans() {
+        let source = "count: 42\ntotal: count\n";
+        let (ast, table) = build(source);
+
+        let idx = table.node_at(source.find("count\n").unwrap()).unwrap();
+        assert_eq!(ast.node_text(idx), Some("count"));
+        let span = table.token_span(idx).unwrap();
+        assert_eq!(&source[span.start..span.end], "count");
+
+        // The enclosing VarDecl covers `total: count`
+        let decl = ast.nodes[idx].parent.unwrap();
+        assert_eq!(ast.nodes[decl].node_type, NodeType::VarDecl);
+        let span = table.span(decl).unwrap();
+        assert_eq!(&source[span.start..span.end], "total: count");
+    }
+
+    #[test]
+    fn test_node_at_boundaries_and_gaps() {
+        let source = "x: \"hé\"\n";
+        let (ast, table) = build(source);
+
+        assert_eq!(ast.node_text(table.node_at(0).unwrap()), Some("x"));
+        assert!(table.node_at(2).is_none()); // space between ':' and the string
+        let string = table.node_at(3).unwrap();
+        assert_eq!(ast.nodes[string].node_type, NodeType::LiteralString);
+        // Multi-byte content: the closing quote is the last byte of the token
+        assert_eq!(table.node_at(source.len() - 2), Some(string));
+        assert!(table.node_at(source.len() + 10).is_none());
+    }
+
+    #[test]
+    fn test_shared_token_resolves_to_deepest_node() {
+        let source = "type Point: {\n    x Number\n}\np Point: { x: 1 }\n";
+        let (ast, table) = build(source);
+        let idx = table.node_at(source.rfind("Point").unwrap()).unwrap();
+        assert_eq!(ast.node_text(idx), Some("Point"));
+        assert!(ast.nodes[idx].first_child.is_none());
+    }
+
+    #[test]
+    fn test_nodes_in_range() {
+        let source = "a: 1\nb: 2\nc: 3\n";
+        let (ast, table) = build(source);
+        let start = source.find("b").unwrap();
+        let end = source.find("c").unwrap();
+        let texts: Vec<&str> = table
+            .nodes_in(start, end)
+            .filter_map(|idx| ast.node_text(idx))
+            .collect();
+        assert_eq!(texts, vec!["b", "2"]);
+
+        let inside: Vec<usize> = table.nodes_in(start + 1, start + 2).collect();
+        assert!(inside.is_empty()); // ':' has no node
+
+        // A range starting inside a token still yields that token
+        let (ast, table) = build("total: 1\n");
+        let texts: Vec<&str> = table
+            .nodes_in(2, 3)
+            .filter_map(|idx| ast.node_text(idx))
+            .collect();
+        assert_eq!(texts, vec!["total"]);
+    }
+
+    #[test]
+    fn test_offset_and_line_of() {
+        let source = "s: \"é\"\nt: s\n";
+        let (_, table) = build(source);
+        assert_eq!(table.offset(source, 1, 5), Some(4));
+        assert_eq!(table.offset(source, 1, 6), Some(6)); // past 'é' (2 bytes)
+        assert_eq!(table.offset(source, 2, 4), Some(11));
+        assert_eq!(table.offset(source, 9, 1), None);
+        assert_eq!(table.line_of(0), (0, 0));
+        assert_eq!(table.line_of(7), (0, 0)); // the newline itself
+        assert_eq!(table.line_of(8), (1, 8));
+        assert_eq!(table.line_of(11), (1, 8));
+    }
+}
@@ -0,0 +1,80 @@
+// Stable hashing
+//
+// Hashes that must come out the same on every build, platform and Rust
+// release - object cache keys, the split of functions into codegen units -
+// cannot use `DefaultHasher`. They, and the specialization table's key
+// hash, use this one FNV-1a.
+
+/// FNV-1a over 128 bits: wide enough that a collision between cache keys
+/// is not a concern
+pub(crate) struct StableHasher(u128);
+
+impl StableHasher {
+    const OFFSET: u128 = 0x6c62_272e_07bb_0142_62b8_2175_6295_c58d;
+    const PRIME: u128 = 0x0000_0000_0100_0000_0000_0000_0000_013b;
+
+    pub fn new() -> Self {
+        StableHasher(Self::OFFSET)
+    }
+
+    pub fn bytes(&mut self, bytes: &[u8]) {
+        for byte in bytes {
+            self.0 ^= *byte as u128;
+            self.0 = self.0.wrapping_mul(Self::PRIME);
+        }
+    }
+
+    pub fn u64(&mut self, value: u64) {
+        self.bytes(&value.to_le_bytes());
+    }
+
+    pub fn u128(&mut self, value: u128) {
+        self.bytes(&value.to_le_bytes());
+    }
+
+    /// Length-prefixed, so adjacent strings cannot run into each other
+    pub fn str(&mut self, text: &str) {
+        self.u64(text.len() as u64);
+        self.bytes(text.as_bytes());
+    }
+
+    pub fn finish(&self) -> u128 {
+        self.0
+    }
+
+    /// The hash folded to 64 bits, for tables and bucketing
+    pub fn finish_u64(&self) -> u64 {
+        (self.0 >> 64) as u64 ^ self.0 as u64
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_stable_hasher_separates_strings() {
+        let hash = |parts: &[&str]| {
+            let mut hasher = StableHasher::new();
+            for part in parts {
+                hasher.str(part);
+            }
+            hasher.finish()
+        };
+        assert_eq!(hash(&["ab", "c"]), hash(&["ab", "c"]));
+        assert_ne!(hash(&["ab", "c"]), hash(&["a", "bc"]));
+        assert_ne!(hash(&[]), hash(&[""]));
+    }
+
+    #[test]
+    fn test_stable_hasher_is_fnv1a() {
+        // Published FNV-1a 128 test vectors
+        let hash = |text: &str| {
+            let mut hasher = StableHasher::new();
+            hasher.bytes(text.as_bytes());
+            hasher.finish()
+        };
+        assert_eq!(hash(""), 0x6c62272e07bb014262b821756295c58d);
+        assert_eq!(hash("a"), 0xd228cb696f1a8caf78912b704e4a8964);
+    }
+}
@@ -0,0 +1,433 @@
+// Compiler pass timing, allocation counting and size statistics
+//
+// `Profile` collects what `--time-passes` and `--stats` print:
+//   - one `PassReport` per timed pass (wall time, allocation count and the
+//     peak heap growth while the pass ran)
+//   - `Counts` of tokens, AST nodes, interned strings, types, constraints
+//     and type variables
+//   - with `--mem-report`, a `MemReport` of the heap bytes held by each
+//     major compiler structure at the end of analysis
+//
+// Allocation numbers come from `CountingAllocator`, which the `suru` binary
+// installs as the global allocator. It only counts after
+// `enable_alloc_counting()`, so normal runs pay one relaxed load per
+// allocation. Library users that install a different allocator get timings
+// without allocation columns.
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::collections::HashMap;
+use std::fmt::Write;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::time::{Duration, Instant};
+
+static COUNTING: AtomicBool = AtomicBool::new(false);
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+static CURRENT_BYTES: AtomicUsize = AtomicUsize::new(0);
+static PEAK_BYTES: AtomicUsize = AtomicUsize::new(0);
+
+/// System allocator that counts allocations and live bytes when enabled
+pub struct CountingAllocator;
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let ptr = unsafe { System.alloc(layout) };
+        if !ptr.is_null() && COUNTING.load(Ordering::Relaxed) {
+            record_alloc(layout.size());
+        }
+        ptr
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        let ptr = unsafe { System.alloc_zeroed(layout) };
+        if !ptr.is_null() && COUNTING.load(Ordering::Relaxed) {
+            record_alloc(layout.size());
+        }
+        ptr
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) };
+        if COUNTING.load(Ordering::Relaxed) {
+            record_dealloc(layout.size());
+        }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let new_ptr = unsafe { System.realloc(ptr, layout, new_size) };
+        if !new_ptr.is_null() && COUNTING.load(Ordering::Relaxed) {
+            // A realloc is one allocation event; only the size delta is live
+            ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+            if new_size >= layout.size() {
+                grow(new_size - layout.size());
+            } else {
+                record_dealloc(layout.size() - new_size);
+            }
+        }
+        new_ptr
+    }
+}
+
+fn record_alloc(size: usize) {
+    ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+    grow(size);
+}
+
+fn grow(size: usize) {
+    let current = CURRENT_BYTES.fetch_add(size, Ordering::Relaxed) + size;
+    PEAK_BYTES.fetch_max(current, Ordering::Relaxed);
+}
+
+fn record_dealloc(size: usize) {
+    // Blocks allocated before counting started can be freed after it; clamp
+    // at zero rather than wrap
+    let _ = CURRENT_BYTES.fetch_update(Ordering::Relaxed, Ordering::Relaxed, |c| {
+        Some(c.saturating_sub(size))
+    });
+}
+
+/// Starts counting allocations (process-wide, cannot be turned off)
+pub fn enable_alloc_counting() {
+    COUNTING.store(true, Ordering::Relaxed);
+}
+
+/// Point-in-time view of the allocation counters
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct AllocSnapshot {
+    /// Allocations (including reallocations) since counting started
+    pub allocations: u64,
+    /// Bytes currently live, counting only blocks allocated while enabled
+    pub current_bytes: usize,
+    /// Highest `current_bytes` since the last `reset_peak`
+    pub peak_bytes: usize,
+}
+
+/// Current counter values
+pub fn snapshot() -> AllocSnapshot {
+    AllocSnapshot {
+        allocations: ALLOCATIONS.load(Ordering::Relaxed),
+        current_bytes: CURRENT_BYTES.load(Ordering::Relaxed),
+        peak_bytes: PEAK_BYTES.load(Ordering::Relaxed),
+    }
+}
+
+/// Restarts peak tracking from the current live byte count
+pub fn reset_peak() {
+    PEAK_BYTES.store(CURRENT_BYTES.load(Ordering::Relaxed), Ordering::Relaxed);
+}
+
+/// True when counting is enabled and a `CountingAllocator` is installed
+pub fn alloc_counting_active() -> bool {
+    COUNTING.load(Ordering::Relaxed) && ALLOCATIONS.load(Ordering::Relaxed) > 0
+}
+
+/// Cost of one timed pass
+#[derive(Debug, Clone)]
+pub struct PassReport {
+    pub name: &'static str,
+    pub wall: Duration,
+    /// `None` when allocations are not being counted
+    pub allocations: Option<u64>,
+    /// Peak heap growth over the live bytes at the start of the pass
+    pub peak_bytes: Option<usize>,
+}
+
+/// Sizes of the data structures built for one file
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct Counts {
+    pub tokens: usize,
+    pub ast_nodes: usize,
+    pub interned_strings: usize,
+    pub types: usize,
+    pub constraints: usize,
+    pub type_variables: usize,
+}
+
+/// Heap bytes held by one structure
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct MemEntry {
+    pub name: &'static str,
+    /// Number of elements (nodes, strings, types, map entries, ...)
+    pub len: usize,
+    /// Estimated heap bytes, including memory owned by the elements
+    pub bytes: usize,
+}
+
+/// Memory footprint of the compiler's data structures
+///
+/// Byte counts are estimates computed from capacities and element sizes;
+/// they ignore allocator overhead, so they undercount slightly.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct MemReport {
+    pub entries: Vec<MemEntry>,
+}
+
+impl MemReport {
+    pub fn push(&mut self, name: &'static str, len: usize, bytes: usize) {
+        self.entries.push(MemEntry { name, len, bytes });
+    }
+
+    /// Entry by structure name
+    pub fn get(&self, name: &str) -> Option<&MemEntry> {
+        self.entries.iter().find(|e| e.name == name)
+    }
+
+    pub fn total_bytes(&self) -> usize {
+        self.entries.iter().map(|e| e.bytes).sum()
+    }
+
+    /// `--mem-report` table, largest structure first
+    ///
+    /// When allocations are being counted, the peak heap of the process is
+    /// appended so unaccounted memory stands out.
+    pub fn render(&self) -> String {
+        let total = self.total_bytes();
+        let mut entries = self.entries.clone();
+        entries.sort_by(|a, b| b.bytes.cmp(&a.bytes));
+
+        let mut out = String::new();
+        let _ = writeln!(
+            out,
+            "{:<28} {:>10} {:>12} {:>7}",
+            "structure", "entries", "bytes", "share"
+        );
+        for e in &entries {
+            let share = if total == 0 {
+                0.0
+            } else {
+                e.bytes as f64 * 100.0 / total as f64
+            };
+            let _ = writeln!(
+                out,
+                "{:<28} {:>10} {:>12} {:>6.1}%",
+                e.name,
+                e.len,
+                format_bytes(e.bytes),
+                share
+            );
+        }
+        let mut footer = vec![("total", total)];
+        if alloc_counting_active() {
+            footer.push(("peak heap", snapshot().peak_bytes));
+        }
+        for (name, bytes) in footer {
+            let _ = writeln!(out, "{:<28} {:>10} {:>12}", name, "", format_bytes(bytes));
+        }
+        out
+    }
+}
+
+/// Heap bytes of a vector's buffer (not of what its elements own)
+pub(crate) fn vec_bytes<T>(v: &Vec<T>) -> usize {
+    v.capacity() * std::mem::size_of::<T>()
+}
+
+/// Heap bytes of a hash map's table (not of what its keys and values own)
+///
+/// The table holds a power-of-two number of buckets kept at most 7/8 full,
+/// plus one control byte per bucket and a trailing group of control bytes.
+pub(crate) fn hash_map_bytes<K, V, S>(map: &HashMap<K, V, S>) -> usize {
+    let capacity = map.capacity();
+    if capacity == 0 {
+        return 0;
+    }
+    let buckets = if capacity < 8 {
+        (capacity + 1).next_power_of_two()
+    } else {
+        (capacity * 8 / 7).next_power_of_two()
+    };
+    buckets * (std::mem::size_of::<(K, V)>() + 1) + 16
+}
+
+/// Pass timings and counts for one compilation
+///
+/// The default profile is disabled: `time` just runs the pass, and counts are
+/// still filled in (they are cheap). The memory report is only built when
+/// asked for with `with_mem_report`.
+#[derive(Debug, Clone, Default)]
+pub struct Profile {
+    enabled: bool,
+    mem_report: bool,
+    pub passes: Vec<PassReport>,
+    pub counts: Counts,
+    /// Set at the end of semantic analysis when a memory report was requested
+    pub memory: Option<MemReport>,
+}
+
+impl Profile {
+    /// Profile that records pass timings
+    pub fn enabled() -> Self {
+        Profile {
+            enabled: true,
+            ..Default::default()
+        }
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.enabled
+    }
+
+    /// Also records a `MemReport` at the end of semantic analysis
+    pub fn with_mem_report(mut self) -> Self {
+        self.mem_report = true;
+        self
+    }
+
+    pub fn wants_mem_report(&self) -> bool {
+        self.mem_report
+    }
+
+    /// Runs `pass`, recording its wall time and allocations when enabled
+    pub fn time<R>(&mut self, name: &'static str, pass: impl FnOnce() -> R) -> R {
+        if !self.enabled {
+            return pass();
+        }
+
+        let counting = alloc_counting_active();
+        if counting {
+            reset_peak();
+        }
+        let before = snapshot();
+        let start = Instant::now();
+        let result = pass();
+        let wall = start.elapsed();
+        let after = snapshot();
+
+        self.passes.push(PassReport {
+            name,
+            wall,
+            allocations: counting.then(|| after.allocations - before.allocations),
+            peak_bytes: counting.then(|| after.peak_bytes.saturating_sub(before.current_bytes)),
+        });
+        result
+    }
+
+    /// `--time-passes` table
+    pub fn render_passes(&self) -> String {
+        let mut out = String::new();
+        let _ = writeln!(
+            out,
+            "{:<28} {:>10} {:>10} {:>12}",
+            "pass", "time", "allocs", "peak"
+        );
+        for pass in &self.passes {
+            let _ = writeln!(
+                out,
+                "{:<28} {:>10} {:>10} {:>12}",
+                pass.name,
+                format_duration(pass.wall),
+                pass.allocations.map_or("-".to_string(), |n| n.to_string()),
+                pass.peak_bytes.map_or("-".to_string(), format_bytes),
+            );
+        }
+        let total: Duration = self.passes.iter().map(|p| p.wall).sum();
+        let _ = writeln!(out, "{:<28} {:>10}", "total", format_duration(total));
+        out
+    }
+
+    /// `--stats` table
+    pub fn render_counts(&self) -> String {
+        let c = &self.counts;
+        let mut out = String::new();
+        for (name, value) in [
+            ("tokens", c.tokens),
+            ("AST nodes", c.ast_nodes),
+            ("interned strings", c.interned_strings),
+            ("types", c.types),
+            ("constraints", c.constraints),
+            ("type variables", c.type_variables),
+        ] {
+            let _ = writeln!(out, "{:<28} {:>10}", name, value);
+        }
+        out
+    }
+}
+
+fn format_duration(d: Duration) -> String {
+    format!("{:.3}ms", d.as_secs_f64() * 1000.0)
+}
+
+fn format_bytes(bytes: usize) -> String {
+    const UNITS: [&str; 4] = ["B", "KiB", "MiB", "GiB"];
+    let mut value = bytes as f64;
+    let mut unit = 0;
+    while value >= 1024.0 && unit < UNITS.len() - 1 {
+        value /= 1024.0;
+        unit += 1;
+    }
+    if unit == 0 {
+        format!("{} B", bytes)
+    } else {
+        format!("{:.1} {}", value, UNITS[unit])
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_disabled_profile_records_nothing() {
+        let mut profile = Profile::default();
+        assert_eq!(profile.time("pass", || 7), 7);
+        assert!(profile.passes.is_empty());
+    }
+
+    #[test]
+    fn test_enabled_profile_renders_passes_and_counts() {
+        let mut profile = Profile::enabled();
+        profile.time("lex", || std::hint::black_box(vec![0u8; 64]));
+        profile.time("parse", || ());
+        profile.counts.tokens = 12;
+
+        let passes = profile.render_passes();
+        let names: Vec<&str> = passes
+            .lines()
+            .map(|l| l.split_whitespace().next().unwrap())
+            .collect();
+        assert_eq!(names, vec!["pass", "lex", "parse", "total"]);
+
+        let counts = profile.render_counts();
+        assert!(counts.lines().next().unwrap().ends_with(" 12"));
+        assert_eq!(counts.lines().count(), 6);
+    }
+
+    #[test]
+    fn test_mem_report_renders_largest_first() {
+        let mut report = MemReport::default();
+        report.push("small", 1, 1024);
+        report.push("large", 10, 3 * 1024);
+        assert_eq!(report.total_bytes(), 4096);
+
+        let table = report.render();
+        let rows: Vec<Vec<&str>> = table
+            .lines()
+            .map(|l| l.split_whitespace().collect())
+            .collect();
+        assert_eq!(rows[1][0], "large");
+        assert_eq!(rows[1][4], "75.0%");
+        assert_eq!(rows[2][0], "small");
+        assert_eq!(rows[3][..3], ["total", "4.0", "KiB"]);
+    }
+
+    #[test]
+    fn test_container_byte_estimates() {
+        let v: Vec<u64> = Vec::with_capacity(10);
+        assert_eq!(vec_bytes(&v), 80);
+
+        let mut map: HashMap<u32, u32> = HashMap::new();
+        assert_eq!(hash_map_bytes(&map), 0);
+        map.insert(1, 2);
+        // At least one bucket of (u32, u32) plus its control byte
+        assert!(hash_map_bytes(&map) >= 9);
+        let small = hash_map_bytes(&map);
+        map.extend((0..1000).map(|i| (i, i)));
+        assert!(hash_map_bytes(&map) >= 1000 * 9 && hash_map_bytes(&map) > small);
+    }
+
+    #[test]
+    fn test_format_bytes() {
+        assert_eq!(format_bytes(512), "512 B");
+        assert_eq!(format_bytes(1536), "1.5 KiB");
+        assert_eq!(format_bytes(3 * 1024 * 1024), "3.0 MiB");
+    }
+}
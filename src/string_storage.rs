@@ -2,6 +2,13 @@
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub struct StringId(usize);
 
+impl StringId {
+    /// Position of the string in its storage
+    pub fn index(&self) -> usize {
+        self.0
+    }
+}
+
 /// String storage for deduplicating identifiers and string literals
 /// Uses Vec-only implementation with linear search for simplicity
 #[derive(Debug, Clone)]
@@ -48,6 +55,12 @@ impl StringStorage {
     pub fn is_empty(&self) -> bool {
         self.strings.is_empty()
     }
+
+    /// Estimated heap bytes of the storage and the strings it owns
+    pub fn heap_bytes(&self) -> usize {
+        crate::stats::vec_bytes(&self.strings)
+            + self.strings.iter().map(String::capacity).sum::<usize>()
+    }
 }
 
 impl Default for StringStorage {
@@ -110,4 +123,23 @@ mod tests {
         assert_eq!(storage.resolve(id1), "");
         assert_eq!(storage.len(), 1);
     }
+
+    #[test]
+    fn test_intern_allocation_budget() {
+        use crate::alloc_budget::{assert_allocations_at_most, assert_no_allocations};
+
+        let mut storage = StringStorage::new();
+        let words: Vec<String> = (0..100).map(|i| format!("word{i}")).collect();
+
+        // A new string costs its own buffer plus, at most, growing the table
+        for word in &words {
+            assert_allocations_at_most(2, || storage.intern(word));
+        }
+        // Re-interning finds the existing entry without allocating
+        assert_no_allocations(|| {
+            for word in &words {
+                storage.intern(word);
+            }
+        });
+    }
 }
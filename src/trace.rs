@@ -0,0 +1,227 @@
+// Hierarchical tracing spans exported as Chrome trace-event JSON
+//
+// Built only with the `trace` cargo feature. Without it `trace_span!`
+// expands to `()`, its arguments are never evaluated and this module is
+// empty, so instrumented code compiles to exactly what it was before.
+//
+// With the feature, spans are still inert until `start()` is called
+// (`--trace out.json`). Each span is a guard: creating it notes the start
+// time, dropping it records a complete ("X") event on the current thread.
+// Nesting falls out of the timestamps, so the viewer
+// (chrome://tracing, Perfetto) shows per-thread flame graphs:
+//
+//     let _span = trace_span!("semantic", "function", name);
+
+/// Opens a span that closes when the returned guard is dropped
+///
+/// `trace_span!(category, name)` or `trace_span!(category, name, detail)`;
+/// `detail` (anything `Display`, e.g. a file or function name) is only
+/// evaluated while tracing is running.
+#[cfg(feature = "trace")]
+#[macro_export]
+macro_rules! trace_span {
+    ($cat:expr, $name:expr) => {
+        $crate::trace::Span::enter($cat, $name, || None)
+    };
+    ($cat:expr, $name:expr, $detail:expr) => {
+        $crate::trace::Span::enter($cat, $name, || Some(($detail).to_string()))
+    };
+}
+
+/// Opens a span that closes when the returned guard is dropped (disabled)
+#[cfg(not(feature = "trace"))]
+#[macro_export]
+macro_rules! trace_span {
+    ($cat:expr, $name:expr) => {
+        ()
+    };
+    ($cat:expr, $name:expr, $detail:expr) => {
+        ()
+    };
+}
+
+#[cfg(feature = "trace")]
+pub use collector::*;
+
+#[cfg(feature = "trace")]
+mod collector {
+    use std::cell::Cell;
+    use std::io;
+    use std::path::Path;
+    use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+    use std::sync::{Mutex, OnceLock};
+    use std::time::Instant;
+
+    use serde_json::{Value, json};
+
+    static RUNNING: AtomicBool = AtomicBool::new(false);
+    static NEXT_TID: AtomicU64 = AtomicU64::new(1);
+    static EPOCH: OnceLock<Instant> = OnceLock::new();
+    static EVENTS: Mutex<Vec<Event>> = Mutex::new(Vec::new());
+    static THREADS: Mutex<Vec<(u64, String)>> = Mutex::new(Vec::new());
+
+    thread_local! {
+        static TID: Cell<u64> = const { Cell::new(0) };
+    }
+
+    /// One finished span
+    #[derive(Debug, Clone)]
+    struct Event {
+        cat: &'static str,
+        name: &'static str,
+        detail: Option<String>,
+        tid: u64,
+        start_us: f64,
+        dur_us: f64,
+    }
+
+    /// Starts recording spans (process-wide)
+    pub fn start() {
+        EPOCH.get_or_init(Instant::now);
+        RUNNING.store(true, Ordering::Relaxed);
+    }
+
+    pub fn is_running() -> bool {
+        RUNNING.load(Ordering::Relaxed)
+    }
+
+    /// Small per-thread id for the trace, naming the thread on first use
+    fn current_tid() -> u64 {
+        TID.with(|tid| {
+            if tid.get() == 0 {
+                let id = NEXT_TID.fetch_add(1, Ordering::Relaxed);
+                let thread = std::thread::current();
+                let name = thread
+                    .name()
+                    .map_or_else(|| format!("thread-{id}"), str::to_string);
+                THREADS.lock().unwrap().push((id, name));
+                tid.set(id);
+            }
+            tid.get()
+        })
+    }
+
+    /// Guard for an open span; inert when tracing is not running
+    #[must_use = "a span closes when its guard is dropped"]
+    pub struct Span {
+        open: Option<(Event, Instant)>,
+    }
+
+    impl Span {
+        /// Span that records nothing
+        pub fn none() -> Self {
+            Span { open: None }
+        }
+
+        pub fn enter(
+            cat: &'static str,
+            name: &'static str,
+            detail: impl FnOnce() -> Option<String>,
+        ) -> Self {
+            if !is_running() {
+                return Span::none();
+            }
+            let event = Event {
+                cat,
+                name,
+                detail: detail(),
+                tid: current_tid(),
+                start_us: 0.0,
+                dur_us: 0.0,
+            };
+            Span {
+                open: Some((event, Instant::now())),
+            }
+        }
+    }
+
+    impl Drop for Span {
+        fn drop(&mut self) {
+            let Some((mut event, start)) = self.open.take() else {
+                return;
+            };
+            let epoch = *EPOCH.get().expect("trace started");
+            event.start_us = start.duration_since(epoch).as_secs_f64() * 1e6;
+            event.dur_us = start.elapsed().as_secs_f64() * 1e6;
+            EVENTS.lock().unwrap().push(event);
+        }
+    }
+
+    /// Takes the recorded spans as a Chrome trace-event document
+    ///
+    /// Recording continues; the next call returns only newer spans.
+    pub fn take_chrome_json() -> Value {
+        let events = std::mem::take(&mut *EVENTS.lock().unwrap());
+        let pid = std::process::id();
+
+        let mut trace: Vec<Value> = THREADS
+            .lock()
+            .unwrap()
+            .iter()
+            .map(|(tid, name)| {
+                json!({ "name": "thread_name", "ph": "M", "pid": pid, "tid": tid,
+                        "args": { "name": name } })
+            })
+            .collect();
+        trace.extend(events.into_iter().map(|e| {
+            let mut event = json!({
+                "name": e.name, "cat": e.cat, "ph": "X", "pid": pid, "tid": e.tid,
+                "ts": e.start_us, "dur": e.dur_us,
+            });
+            if let Some(detail) = e.detail {
+                event["args"] = json!({ "detail": detail });
+            }
+            event
+        }));
+
+        json!({ "traceEvents": trace, "displayTimeUnit": "ms" })
+    }
+
+    /// Writes the spans recorded so far to `path`
+    pub fn write_chrome_json(path: &Path) -> io::Result<()> {
+        let json = serde_json::to_string(&take_chrome_json()).map_err(io::Error::other)?;
+        std::fs::write(path, json)
+    }
+
+    #[cfg(test)]
+    mod tests {
+        use super::*;
+
+        #[test]
+        fn test_nested_spans_export_as_complete_events() {
+            start();
+            {
+                let _outer = crate::trace_span!("test", "outer_span", "file.suru");
+                let _inner = crate::trace_span!("test", "inner_span");
+            }
+            std::thread::Builder::new()
+                .name("trace-worker".to_string())
+                .spawn(|| drop(crate::trace_span!("test", "worker_span")))
+                .unwrap()
+                .join()
+                .unwrap();
+
+            // Other tests may record spans concurrently; look only at ours
+            let trace = take_chrome_json();
+            let events = trace["traceEvents"].as_array().unwrap();
+            let find = |name: &str| events.iter().find(|e| e["name"] == name).unwrap().clone();
+
+            let (outer, inner, worker) =
+                (find("outer_span"), find("inner_span"), find("worker_span"));
+            assert_eq!(outer["ph"], "X");
+            assert_eq!(outer["args"]["detail"], "file.suru");
+            assert!(inner.get("args").is_none());
+            assert_eq!(outer["tid"], inner["tid"]);
+            assert_ne!(outer["tid"], worker["tid"]);
+
+            // The inner span lies within the outer one
+            let ts = |e: &Value| e["ts"].as_f64().unwrap();
+            let end = |e: &Value| ts(e) + e["dur"].as_f64().unwrap();
+            assert!(ts(&inner) >= ts(&outer) && end(&inner) <= end(&outer));
+
+            assert!(events.iter().any(|e| e["ph"] == "M"
+                && e["tid"] == worker["tid"]
+                && e["args"]["name"] == "trace-worker"));
+        }
+    }
+}
@@ -0,0 +1,431 @@
+// Watch mode - `suru check --watch <dir>`
+//
+// Checks every `.suru` file under a directory on a thread pool, then waits
+// for file changes and re-checks only what they affect. Each round has two
+// parallel phases:
+//   1. changed files are read and scanned for their `ModuleInfo` (module
+//      name, exports, imports)
+//   2. affected files are analyzed against a module registry built from the
+//      updated info, reporting diagnostics as each file finishes
+//
+// A file is affected when it changed itself, when one of its imports now
+// resolves to a different module (modules added, removed or renamed), or
+// when a module it imports changed its exports. Edits that leave a module's
+// interface alone only re-check the edited file.
+mod notify;
+mod pool;
+
+pub use notify::Watcher;
+pub use pool::ThreadPool;
+
+use std::cell::RefCell;
+use std::collections::{BTreeMap, BTreeSet, HashSet};
+use std::io::{self, Write};
+use std::path::{Path, PathBuf};
+use std::rc::Rc;
+use std::sync::{Arc, mpsc};
+use std::time::Instant;
+
+use crate::limits::CompilerLimits;
+use crate::semantic::{
+    ModuleInfo, ModuleRegistry, SemanticAnalyzer, build_registry, module_info, package_modules,
+};
+
+/// Extension of Suru source files
+pub const SOURCE_EXTENSION: &str = "suru";
+
+/// Diagnostics for one checked file
+#[derive(Debug, Clone, PartialEq)]
+pub struct FileReport {
+    pub path: PathBuf,
+    pub errors: Vec<String>,
+}
+
+/// Outcome of one check round
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub struct RoundSummary {
+    pub checked: usize,
+    pub failed: usize,
+}
+
+/// A source file as of its last change
+struct FileEntry {
+    /// File contents, or the error reading them
+    source: Result<Arc<str>, String>,
+    /// First-pass info (default when the file does not parse)
+    info: ModuleInfo,
+}
+
+/// All source files under a directory with their module info
+pub struct Project {
+    root: PathBuf,
+    limits: CompilerLimits,
+    files: BTreeMap<PathBuf, FileEntry>,
+}
+
+impl Project {
+    /// Creates an empty project; the first `update(&[root])` loads the tree
+    pub fn new(root: impl Into<PathBuf>, limits: CompilerLimits) -> Self {
+        Project { root: root.into(), limits, files: BTreeMap::new() }
+    }
+
+    pub fn root(&self) -> &Path {
+        &self.root
+    }
+
+    /// Number of known source files
+    pub fn len(&self) -> usize {
+        self.files.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.files.is_empty()
+    }
+
+    /// Reloads changed paths (files or directories) and returns the files
+    /// that need checking, in path order
+    pub fn update(&mut self, pool: &ThreadPool, changed: &[PathBuf]) -> Vec<PathBuf> {
+        let _span = crate::trace_span!("watch", "update");
+        // Expand directories: everything on disk below them, plus known
+        // files below them (which may have been deleted)
+        let mut targets: BTreeSet<PathBuf> = BTreeSet::new();
+        for path in changed {
+            if path.is_dir() {
+                walk(path, &mut |_| {}, &mut |file| {
+                    targets.insert(file.to_path_buf());
+                });
+            }
+            targets.extend(self.files.keys().filter(|f| f.starts_with(path)).cloned());
+            if is_source_file(path) {
+                targets.insert(path.clone());
+            }
+        }
+        if targets.is_empty() {
+            return Vec::new();
+        }
+
+        let before = self.resolution();
+
+        // Phase 1: re-read and scan the targets in parallel
+        let (tx, rx) = mpsc::channel();
+        let mut pending = 0;
+        for path in &targets {
+            if !path.is_file() {
+                self.files.remove(path);
+                continue;
+            }
+            let (tx, path, limits) = (tx.clone(), path.clone(), self.limits.clone());
+            pool.execute(move || {
+                let entry = load(&path, &limits);
+                let _ = tx.send((path, entry));
+            });
+            pending += 1;
+        }
+        drop(tx);
+        for (path, entry) in rx.iter().take(pending) {
+            self.files.insert(path, entry);
+        }
+
+        let after = self.resolution();
+        self.affected(&targets, &before, &after)
+    }
+
+    /// Module each file's imports resolve to, plus the package's module set
+    fn resolution(&self) -> Resolution {
+        let infos: Vec<ModuleInfo> = self.files.values().map(|f| f.info.clone()).collect();
+        let registry = build_registry(&infos);
+        let resolved = self
+            .files
+            .iter()
+            .map(|(path, f)| (path.clone(), resolve_imports(&f.info, &registry)))
+            .collect();
+        let interfaces = self
+            .files
+            .values()
+            .filter_map(|f| {
+                let name = f.info.module_name.clone()?;
+                Some((name, (f.info.is_submodule, f.info.exports.clone())))
+            })
+            .collect();
+        Resolution { resolved, interfaces, packages: package_modules(&infos) }
+    }
+
+    /// Files to re-check once `targets` have been reloaded
+    fn affected(
+        &self,
+        targets: &BTreeSet<PathBuf>,
+        before: &Resolution,
+        after: &Resolution,
+    ) -> Vec<PathBuf> {
+        // Modules whose interface differs, including added and removed ones
+        let changed_modules: HashSet<&String> = before
+            .interfaces
+            .keys()
+            .chain(after.interfaces.keys())
+            .filter(|m| before.interfaces.get(*m) != after.interfaces.get(*m))
+            .collect();
+        let packages_changed = before.packages != after.packages;
+
+        self.files
+            .keys()
+            .filter(|path| {
+                if targets.contains(*path) {
+                    return true;
+                }
+                let Some(now) = after.resolved.get(*path) else { return false };
+                !now.is_empty()
+                    && (packages_changed
+                        || before.resolved.get(*path) != Some(now)
+                        || now.iter().flatten().any(|m| changed_modules.contains(m)))
+            })
+            .cloned()
+            .collect()
+    }
+
+    /// Checks `files` on the pool, calling `on_report` as each one finishes
+    pub fn check(&self, pool: &ThreadPool, files: &[PathBuf], mut on_report: impl FnMut(FileReport)) {
+        let infos: Arc<Vec<ModuleInfo>> =
+            Arc::new(self.files.values().map(|f| f.info.clone()).collect());
+
+        let (tx, rx) = mpsc::channel();
+        let mut pending = 0;
+        for path in files {
+            let Some(entry) = self.files.get(path) else { continue };
+            let (tx, path, limits) = (tx.clone(), path.clone(), self.limits.clone());
+            let (source, infos) = (entry.source.clone(), Arc::clone(&infos));
+            pool.execute(move || {
+                let _span = crate::trace_span!("watch", "check_file", path.display());
+                let errors = match source {
+                    Ok(source) => check_source(&source, &infos, &limits),
+                    Err(e) => vec![e],
+                };
+                let _ = tx.send(FileReport { path, errors });
+            });
+            pending += 1;
+        }
+        drop(tx);
+
+        for report in rx.iter().take(pending) {
+            on_report(report);
+        }
+    }
+
+    /// Applies changes, checks the affected files and prints their
+    /// diagnostics (`path: error`) followed by a one-line summary
+    ///
+    /// Prints nothing when the changes affect no source file.
+    pub fn round<W: Write>(
+        &mut self,
+        pool: &ThreadPool,
+        changed: &[PathBuf],
+        out: &mut W,
+    ) -> io::Result<RoundSummary> {
+        let _span = crate::trace_span!("watch", "round");
+        let start = Instant::now();
+        let files = self.update(pool, changed);
+        if files.is_empty() {
+            return Ok(RoundSummary::default());
+        }
+
+        let mut summary = RoundSummary::default();
+        let mut result = Ok(());
+        self.check(pool, &files, |report| {
+            summary.checked += 1;
+            if !report.errors.is_empty() {
+                summary.failed += 1;
+            }
+            for error in &report.errors {
+                if result.is_ok() {
+                    result = writeln!(out, "{}: {}", report.path.display(), error);
+                }
+            }
+            if result.is_ok() {
+                result = out.flush();
+            }
+        });
+        result?;
+
+        writeln!(
+            out,
+            "Checked {} file{} in {} ms: {}",
+            summary.checked,
+            if summary.checked == 1 { "" } else { "s" },
+            start.elapsed().as_millis(),
+            match summary.failed {
+                0 => "no errors found.".to_string(),
+                1 => "1 file with errors.".to_string(),
+                n => format!("{} files with errors.", n),
+            }
+        )?;
+        out.flush()?;
+        Ok(summary)
+    }
+}
+
+/// Import resolution of every file, used to diff before and after a change
+struct Resolution {
+    resolved: BTreeMap<PathBuf, Vec<Option<String>>>,
+    /// Module name → (is submodule, exported names)
+    interfaces: BTreeMap<String, (bool, Vec<String>)>,
+    packages: HashSet<String>,
+}
+
+fn resolve_imports(info: &ModuleInfo, registry: &ModuleRegistry) -> Vec<Option<String>> {
+    info.imports
+        .iter()
+        .map(|path| registry.resolve_qualified_path(path).map(str::to_string))
+        .collect()
+}
+
+/// Reads a file and runs the first pass over it
+fn load(path: &Path, limits: &CompilerLimits) -> FileEntry {
+    let source = match crate::driver::read_source(path, limits) {
+        Ok(s) => Arc::<str>::from(s),
+        Err(e) => return FileEntry { source: Err(e), info: ModuleInfo::default() },
+    };
+    let info = crate::lexer::lex(&source, limits)
+        .ok()
+        .and_then(|tokens| crate::parser::parse(tokens, limits).ok())
+        .map(|ast| module_info(&ast))
+        .unwrap_or_default();
+    FileEntry { source: Ok(source), info }
+}
+
+/// Full pipeline for one file against the package's module info
+fn check_source(source: &str, infos: &[ModuleInfo], limits: &CompilerLimits) -> Vec<String> {
+    let tokens = match crate::lexer::lex(source, limits) {
+        Ok(t) => t,
+        Err(e) => return vec![e.to_string()],
+    };
+    let ast = match crate::parser::parse(tokens, limits) {
+        Ok(a) => a,
+        Err(e) => return vec![e.to_string()],
+    };
+    // Registries are not Send; each job builds its own from the snapshot
+    let analyzer = SemanticAnalyzer::new(ast)
+        .with_module_registry(Rc::new(RefCell::new(build_registry(infos))))
+        .with_package_modules(package_modules(infos));
+    match analyzer.analyze() {
+        Ok(_) => Vec::new(),
+        Err(errors) => errors.iter().map(|e| e.to_string()).collect(),
+    }
+}
+
+pub(crate) fn is_source_file(path: &Path) -> bool {
+    path.extension().is_some_and(|ext| ext == SOURCE_EXTENSION)
+}
+
+/// Hidden directories and build output are never watched or checked
+pub(crate) fn is_ignored_dir(path: &Path) -> bool {
+    path.file_name()
+        .and_then(|n| n.to_str())
+        .is_some_and(|n| n.starts_with('.') || n == "target")
+}
+
+/// Recursively visits the directories and source files below `dir`
+pub(crate) fn walk(dir: &Path, on_dir: &mut impl FnMut(&Path), on_file: &mut impl FnMut(&Path)) {
+    on_dir(dir);
+    let Ok(entries) = std::fs::read_dir(dir) else { return };
+    let mut paths: Vec<PathBuf> = entries.filter_map(|e| Some(e.ok()?.path())).collect();
+    paths.sort();
+    for path in paths {
+        if path.is_dir() {
+            if !is_ignored_dir(&path) {
+                walk(&path, on_dir, on_file);
+            }
+        } else if is_source_file(&path) {
+            on_file(&path);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const MATH: &str = "module math\nadd: (x Number, y Number) Number { return x }\nexport { add }\n";
+
+    fn temp_project(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("suru_watch_{}_{}", name, std::process::id()));
+        let _ = std::fs::remove_dir_all(&dir);
+        std::fs::create_dir_all(dir.join("lib")).unwrap();
+        std::fs::create_dir_all(dir.join("target")).unwrap();
+        std::fs::write(dir.join("lib/math.suru"), MATH).unwrap();
+        std::fs::write(dir.join("main.suru"), "import { math }\n").unwrap();
+        std::fs::write(dir.join("other.suru"), "x: 42\n").unwrap();
+        std::fs::write(dir.join("target/out.suru"), "ignored: nope\n").unwrap();
+        dir
+    }
+
+    fn names(root: &Path, files: &[PathBuf]) -> Vec<String> {
+        files
+            .iter()
+            .map(|f| f.strip_prefix(root).unwrap().display().to_string())
+            .collect()
+    }
+
+    #[test]
+    fn test_initial_round_reports_incrementally() {
+        let dir = temp_project("round");
+        std::fs::write(dir.join("bad.suru"), "y: nope\n").unwrap();
+        let pool = ThreadPool::new(2);
+        let mut project = Project::new(&dir, CompilerLimits::default());
+
+        let mut out = Vec::new();
+        let summary = project.round(&pool, &[dir.clone()], &mut out).unwrap();
+        assert_eq!(summary, RoundSummary { checked: 4, failed: 1 });
+
+        let out = String::from_utf8(out).unwrap();
+        let lines: Vec<&str> = out.lines().collect();
+        assert_eq!(lines.len(), 2);
+        assert!(lines[0].starts_with(&format!("{}: Semantic error", dir.join("bad.suru").display())));
+        assert!(lines[1].starts_with("Checked 4 files in "));
+        assert!(lines[1].ends_with("1 file with errors."));
+
+        // A change to a non-source file checks nothing and prints nothing
+        let mut out = Vec::new();
+        let summary = project.round(&pool, &[dir.join("notes.txt")], &mut out).unwrap();
+        assert_eq!(summary, RoundSummary::default());
+        assert!(out.is_empty());
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_update_selects_changed_files_and_dependents() {
+        let dir = temp_project("deps");
+        let pool = ThreadPool::new(2);
+        let mut project = Project::new(&dir, CompilerLimits::default());
+        let all = project.update(&pool, &[dir.clone()]);
+        assert_eq!(names(&dir, &all), ["lib/math.suru", "main.suru", "other.suru"]);
+
+        // Body edit: the module's interface is unchanged
+        let math = dir.join("lib/math.suru");
+        std::fs::write(&math, MATH.replace("return x", "return y")).unwrap();
+        assert_eq!(names(&dir, &project.update(&pool, &[math.clone()])), ["lib/math.suru"]);
+
+        // New export: importers are re-checked too
+        std::fs::write(&math, format!("{}sub: (x Number) Number {{ return x }}\nexport {{ sub }}\n", MATH))
+            .unwrap();
+        assert_eq!(
+            names(&dir, &project.update(&pool, &[math.clone()])),
+            ["lib/math.suru", "main.suru"]
+        );
+
+        // Deleting the module leaves only its importer to check
+        std::fs::remove_file(&math).unwrap();
+        assert_eq!(names(&dir, &project.update(&pool, &[math.clone()])), ["main.suru"]);
+        assert_eq!(project.len(), 2);
+
+        let mut reports = Vec::new();
+        project.check(&pool, &[dir.join("main.suru")], |r| reports.push(r));
+        assert!(reports[0].errors[0].contains("Module 'math' not found"));
+
+        // A deleted directory is handled like its files being deleted
+        std::fs::write(&math, MATH).unwrap();
+        project.update(&pool, &[dir.join("lib")]);
+        assert_eq!(project.len(), 3);
+        std::fs::remove_dir_all(dir.join("lib")).unwrap();
+        assert_eq!(names(&dir, &project.update(&pool, &[dir.join("lib")])), ["main.suru"]);
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+}
@@ -0,0 +1,400 @@
+// File change notification for watch mode
+//
+// On Linux the watcher uses inotify directly: one watch per directory,
+// added recursively and extended as directories appear. Elsewhere, when
+// inotify is unavailable (e.g. the watch limit is exhausted) or when polling
+// is requested, it rescans the tree and compares modification stamps.
+//
+// `wait` reports the paths that changed once the tree has been quiet for a
+// short period, so an editor's save sequence becomes a single round.
+
+use std::collections::{BTreeSet, HashMap};
+use std::io;
+use std::path::{Path, PathBuf};
+use std::time::{Duration, Instant};
+
+use super::walk;
+use crate::file_stamp::FileStamp;
+
+/// Quiet time after the last event before a batch of changes is reported
+const QUIET_PERIOD: Duration = Duration::from_millis(50);
+
+/// Interval between tree scans when polling
+pub const POLL_INTERVAL: Duration = Duration::from_millis(200);
+
+pub enum Watcher {
+    #[cfg(target_os = "linux")]
+    Inotify(inotify::Inotify),
+    Poll(Poller),
+}
+
+impl Watcher {
+    /// Watches `root`, preferring inotify unless `force_poll` is set
+    pub fn new(root: &Path, force_poll: bool) -> Self {
+        #[cfg(target_os = "linux")]
+        if !force_poll {
+            if let Ok(watcher) = inotify::Inotify::new(root) {
+                return Watcher::Inotify(watcher);
+            }
+        }
+        let _ = force_poll;
+        Watcher::Poll(Poller::new(root, POLL_INTERVAL))
+    }
+
+    /// Name of the notification mechanism in use
+    pub fn kind(&self) -> &'static str {
+        match self {
+            #[cfg(target_os = "linux")]
+            Watcher::Inotify(_) => "inotify",
+            Watcher::Poll(_) => "polling",
+        }
+    }
+
+    /// Blocks until something under the root changes
+    pub fn wait(&mut self) -> io::Result<Vec<PathBuf>> {
+        loop {
+            let changed = self.wait_timeout(None)?;
+            if !changed.is_empty() {
+                return Ok(changed);
+            }
+        }
+    }
+
+    /// Waits up to `timeout` (forever when `None`) for changes; returns an
+    /// empty list when none arrived in time
+    ///
+    /// Returned paths are changed source files or directories whose contents
+    /// must be rescanned (created, moved or deleted directories).
+    pub fn wait_timeout(&mut self, timeout: Option<Duration>) -> io::Result<Vec<PathBuf>> {
+        match self {
+            #[cfg(target_os = "linux")]
+            Watcher::Inotify(w) => w.wait_timeout(timeout),
+            Watcher::Poll(p) => Ok(p.wait_timeout(timeout)),
+        }
+    }
+}
+
+// ========== Polling ==========
+
+pub struct Poller {
+    root: PathBuf,
+    interval: Duration,
+    stamps: HashMap<PathBuf, FileStamp>,
+}
+
+impl Poller {
+    pub fn new(root: &Path, interval: Duration) -> Self {
+        Poller { root: root.to_path_buf(), interval, stamps: scan(root) }
+    }
+
+    fn wait_timeout(&mut self, timeout: Option<Duration>) -> Vec<PathBuf> {
+        let deadline = timeout.map(|t| Instant::now() + t);
+        loop {
+            let sleep = match deadline {
+                Some(d) => self.interval.min(d.saturating_duration_since(Instant::now())),
+                None => self.interval,
+            };
+            std::thread::sleep(sleep);
+
+            let current = scan(&self.root);
+            let mut changed: BTreeSet<PathBuf> = BTreeSet::new();
+            for (path, stamp) in &current {
+                if self.stamps.get(path) != Some(stamp) {
+                    changed.insert(path.clone());
+                }
+            }
+            for path in self.stamps.keys() {
+                if !current.contains_key(path) {
+                    changed.insert(path.clone());
+                }
+            }
+            self.stamps = current;
+
+            if !changed.is_empty() {
+                return changed.into_iter().collect();
+            }
+            if deadline.is_some_and(|d| Instant::now() >= d) {
+                return Vec::new();
+            }
+        }
+    }
+}
+
+fn scan(root: &Path) -> HashMap<PathBuf, FileStamp> {
+    let mut stamps = HashMap::new();
+    walk(root, &mut |_| {}, &mut |file| {
+        if let Ok(meta) = std::fs::metadata(file) {
+            stamps.insert(file.to_path_buf(), FileStamp::from_metadata(&meta));
+        }
+    });
+    stamps
+}
+
+// ========== inotify ==========
+
+#[cfg(target_os = "linux")]
+mod inotify {
+    use std::collections::{BTreeSet, HashMap};
+    use std::ffi::{CString, OsStr};
+    use std::io;
+    use std::os::fd::{AsRawFd, FromRawFd, OwnedFd};
+    use std::os::unix::ffi::OsStrExt;
+    use std::path::{Path, PathBuf};
+    use std::time::{Duration, Instant};
+
+    use super::super::{is_ignored_dir, is_source_file, walk};
+    use super::QUIET_PERIOD;
+
+    const WATCH_MASK: u32 = libc::IN_CLOSE_WRITE
+        | libc::IN_MODIFY
+        | libc::IN_CREATE
+        | libc::IN_DELETE
+        | libc::IN_MOVED_FROM
+        | libc::IN_MOVED_TO;
+
+    const EVENT_HEADER_LEN: usize = std::mem::size_of::<libc::inotify_event>();
+
+    pub struct Inotify {
+        fd: OwnedFd,
+        root: PathBuf,
+        /// Watch descriptor → watched directory
+        dirs: HashMap<i32, PathBuf>,
+        buffer: Vec<u8>,
+    }
+
+    impl Inotify {
+        pub fn new(root: &Path) -> io::Result<Self> {
+            // SAFETY: plain syscall; the returned descriptor is owned below
+            let fd = unsafe { libc::inotify_init1(libc::IN_NONBLOCK | libc::IN_CLOEXEC) };
+            if fd < 0 {
+                return Err(io::Error::last_os_error());
+            }
+            let mut watcher = Inotify {
+                // SAFETY: `fd` is a freshly created descriptor nobody else owns
+                fd: unsafe { OwnedFd::from_raw_fd(fd) },
+                root: root.to_path_buf(),
+                dirs: HashMap::new(),
+                buffer: vec![0; 64 * 1024],
+            };
+            watcher.watch_tree(root)?;
+            Ok(watcher)
+        }
+
+        /// Adds a watch for `dir` and every directory below it
+        fn watch_tree(&mut self, dir: &Path) -> io::Result<()> {
+            let mut result = Ok(());
+            walk(dir, &mut |d| {
+                if result.is_ok() {
+                    result = self.add_watch(d);
+                }
+            }, &mut |_| {});
+            result
+        }
+
+        fn add_watch(&mut self, dir: &Path) -> io::Result<()> {
+            let path = CString::new(dir.as_os_str().as_bytes())
+                .map_err(|e| io::Error::new(io::ErrorKind::InvalidInput, e))?;
+            // SAFETY: valid descriptor and NUL-terminated path
+            let wd = unsafe { libc::inotify_add_watch(self.fd.as_raw_fd(), path.as_ptr(), WATCH_MASK) };
+            if wd < 0 {
+                let err = io::Error::last_os_error();
+                // The directory vanished before we got to it
+                return if err.raw_os_error() == Some(libc::ENOENT) { Ok(()) } else { Err(err) };
+            }
+            self.dirs.insert(wd, dir.to_path_buf());
+            Ok(())
+        }
+
+        pub fn wait_timeout(&mut self, timeout: Option<Duration>) -> io::Result<Vec<PathBuf>> {
+            let mut changed = BTreeSet::new();
+            let deadline = timeout.map(|t| Instant::now() + t);
+
+            // Wait for the first event, then keep draining until quiet
+            loop {
+                let wait = match deadline {
+                    Some(d) => d.saturating_duration_since(Instant::now()),
+                    None => Duration::MAX,
+                };
+                if !self.poll(wait)? {
+                    if deadline.is_some_and(|d| Instant::now() >= d) {
+                        return Ok(Vec::new());
+                    }
+                    continue;
+                }
+                self.read_events(&mut changed)?;
+                break;
+            }
+            while self.poll(QUIET_PERIOD)? {
+                self.read_events(&mut changed)?;
+            }
+            Ok(changed.into_iter().collect())
+        }
+
+        /// Waits until the descriptor is readable; false on timeout
+        fn poll(&self, timeout: Duration) -> io::Result<bool> {
+            let timeout_ms = if timeout == Duration::MAX {
+                -1
+            } else {
+                timeout.as_millis().min(i32::MAX as u128) as i32
+            };
+            let mut pfd = libc::pollfd { fd: self.fd.as_raw_fd(), events: libc::POLLIN, revents: 0 };
+            // SAFETY: one valid pollfd
+            let n = unsafe { libc::poll(&mut pfd, 1, timeout_ms) };
+            if n < 0 {
+                let err = io::Error::last_os_error();
+                return if err.kind() == io::ErrorKind::Interrupted { Ok(false) } else { Err(err) };
+            }
+            Ok(n > 0)
+        }
+
+        /// Reads all queued events, collecting changed sources and directories
+        fn read_events(&mut self, changed: &mut BTreeSet<PathBuf>) -> io::Result<()> {
+            loop {
+                // SAFETY: the buffer is valid for writes of its full length
+                let n = unsafe {
+                    libc::read(
+                        self.fd.as_raw_fd(),
+                        self.buffer.as_mut_ptr().cast(),
+                        self.buffer.len(),
+                    )
+                };
+                if n < 0 {
+                    let err = io::Error::last_os_error();
+                    match err.kind() {
+                        io::ErrorKind::WouldBlock => return Ok(()),
+                        io::ErrorKind::Interrupted => continue,
+                        _ => return Err(err),
+                    }
+                }
+
+                let n = n as usize;
+                let mut offset = 0;
+                while offset + EVENT_HEADER_LEN <= n {
+                    // SAFETY: the kernel wrote a full header at `offset`
+                    let event: libc::inotify_event = unsafe {
+                        std::ptr::read_unaligned(self.buffer.as_ptr().add(offset).cast())
+                    };
+                    let name_start = offset + EVENT_HEADER_LEN;
+                    let name_end = (name_start + event.len as usize).min(n);
+                    let name: Vec<u8> = self.buffer[name_start..name_end]
+                        .iter()
+                        .copied()
+                        .take_while(|&b| b != 0)
+                        .collect();
+                    offset = name_end;
+                    self.handle_event(&event, &name, changed)?;
+                }
+            }
+        }
+
+        fn handle_event(
+            &mut self,
+            event: &libc::inotify_event,
+            name: &[u8],
+            changed: &mut BTreeSet<PathBuf>,
+        ) -> io::Result<()> {
+            if event.mask & libc::IN_Q_OVERFLOW != 0 {
+                // Events were lost: rescan (and re-watch) everything
+                let root = self.root.clone();
+                self.watch_tree(&root)?;
+                changed.insert(root);
+                return Ok(());
+            }
+            if event.mask & libc::IN_IGNORED != 0 {
+                self.dirs.remove(&event.wd);
+                return Ok(());
+            }
+
+            let Some(dir) = self.dirs.get(&event.wd) else { return Ok(()) };
+            let path = dir.join(OsStr::from_bytes(name));
+
+            if event.mask & libc::IN_ISDIR != 0 {
+                if is_ignored_dir(&path) {
+                    return Ok(());
+                }
+                if event.mask & (libc::IN_CREATE | libc::IN_MOVED_TO) != 0 {
+                    self.watch_tree(&path)?;
+                }
+                changed.insert(path);
+            } else if is_source_file(&path) {
+                changed.insert(path);
+            }
+            Ok(())
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn temp_dir(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("suru_watch_{}_{}", name, std::process::id()));
+        let _ = std::fs::remove_dir_all(&dir);
+        std::fs::create_dir_all(&dir).unwrap();
+        dir
+    }
+
+    /// Waits until `path` shows up in a batch (other batches may come first)
+    fn expect_change(watcher: &mut Watcher, path: &Path) {
+        let deadline = Instant::now() + Duration::from_secs(5);
+        while Instant::now() < deadline {
+            let changed = watcher.wait_timeout(Some(Duration::from_millis(500))).unwrap();
+            if changed.iter().any(|p| p == path) {
+                return;
+            }
+        }
+        panic!("no change reported for {}", path.display());
+    }
+
+    #[cfg(target_os = "linux")]
+    #[test]
+    fn test_inotify_watcher() {
+        let dir = temp_dir("inotify");
+        let mut watcher = Watcher::new(&dir, false);
+        assert_eq!(watcher.kind(), "inotify");
+        assert!(watcher.wait_timeout(Some(Duration::from_millis(50))).unwrap().is_empty());
+
+        let file = dir.join("main.suru");
+        std::fs::write(&file, "x: 42\n").unwrap();
+        expect_change(&mut watcher, &file);
+
+        // Directories created after the watch started are reported and watched
+        let sub = dir.join("sub");
+        std::fs::create_dir(&sub).unwrap();
+        expect_change(&mut watcher, &sub);
+        let nested = sub.join("util.suru");
+        std::fs::write(&nested, "y: 1\n").unwrap();
+        expect_change(&mut watcher, &nested);
+
+        std::fs::remove_file(&file).unwrap();
+        expect_change(&mut watcher, &file);
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_polling_watcher() {
+        let dir = temp_dir("poll");
+        let mut watcher = Watcher::Poll(Poller::new(&dir, Duration::from_millis(20)));
+        assert_eq!(watcher.kind(), "polling");
+
+        let file = dir.join("main.suru");
+        std::fs::write(&file, "x: 42\n").unwrap();
+        expect_change(&mut watcher, &file);
+
+        // Non-source files are ignored
+        std::fs::write(dir.join("notes.txt"), "hi").unwrap();
+        assert!(watcher.wait_timeout(Some(Duration::from_millis(100))).unwrap().is_empty());
+
+        // Polling reports the files inside new directories
+        let sub = dir.join("sub");
+        std::fs::create_dir(&sub).unwrap();
+        let nested = sub.join("util.suru");
+        std::fs::write(&nested, "y: 1\n").unwrap();
+        expect_change(&mut watcher, &nested);
+
+        std::fs::remove_file(&file).unwrap();
+        expect_change(&mut watcher, &file);
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+}
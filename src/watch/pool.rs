@@ -0,0 +1,115 @@
+// Fixed-size worker thread pool
+//
+// Jobs are boxed closures pulled from a shared channel; results travel back
+// through whatever channel the job captured. Dropping the pool closes the
+// queue and joins the workers after they finish the jobs already queued.
+
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Mutex};
+use std::thread::JoinHandle;
+
+type Job = Box<dyn FnOnce() + Send + 'static>;
+
+pub struct ThreadPool {
+    sender: Option<Sender<Job>>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl ThreadPool {
+    /// Starts `size` workers (at least one)
+    pub fn new(size: usize) -> Self {
+        let (sender, receiver) = mpsc::channel::<Job>();
+        let receiver = Arc::new(Mutex::new(receiver));
+
+        let workers = (0..size.max(1))
+            .map(|i| {
+                let receiver = Arc::clone(&receiver);
+                std::thread::Builder::new()
+                    .name(format!("suru-check-{}", i))
+                    .spawn(move || worker_loop(&receiver))
+                    .expect("failed to spawn worker thread")
+            })
+            .collect();
+
+        ThreadPool { sender: Some(sender), workers }
+    }
+
+    /// Pool sized to the available parallelism
+    pub fn with_available_parallelism() -> Self {
+        Self::new(std::thread::available_parallelism().map_or(1, |n| n.get()))
+    }
+
+    pub fn size(&self) -> usize {
+        self.workers.len()
+    }
+
+    /// Queues a job for the next idle worker
+    pub fn execute<F: FnOnce() + Send + 'static>(&self, job: F) {
+        if let Some(sender) = &self.sender {
+            // Workers only exit once the sender is dropped
+            let _ = sender.send(Box::new(job));
+        }
+    }
+}
+
+fn worker_loop(receiver: &Mutex<Receiver<Job>>) {
+    loop {
+        // Hold the lock only while taking a job, not while running it
+        let job = match receiver.lock() {
+            Ok(rx) => rx.recv(),
+            Err(_) => return,
+        };
+        match job {
+            Ok(job) => job(),
+            Err(_) => return, // queue closed
+        }
+    }
+}
+
+impl Drop for ThreadPool {
+    fn drop(&mut self) {
+        drop(self.sender.take());
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_runs_all_jobs_across_workers() {
+        let pool = ThreadPool::new(4);
+        assert_eq!(pool.size(), 4);
+
+        let (tx, rx) = mpsc::channel();
+        for i in 0..64 {
+            let tx = tx.clone();
+            pool.execute(move || {
+                tx.send((i, std::thread::current().name().map(str::to_string)))
+                    .unwrap()
+            });
+        }
+        drop(tx);
+
+        let mut results: Vec<_> = rx.iter().collect();
+        results.sort();
+        assert_eq!(results.len(), 64);
+        assert!(results.iter().all(|(_, name)| name.as_deref().unwrap().starts_with("suru-check-")));
+    }
+
+    #[test]
+    fn test_drop_finishes_queued_jobs() {
+        let counter = Arc::new(Mutex::new(0));
+        {
+            let pool = ThreadPool::new(1);
+            for _ in 0..10 {
+                let counter = Arc::clone(&counter);
+                pool.execute(move || *counter.lock().unwrap() += 1);
+            }
+        }
+        assert_eq!(*counter.lock().unwrap(), 10);
+    }
+}
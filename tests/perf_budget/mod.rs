@@ -0,0 +1,363 @@
+// Performance budgets for tests/run cases
+//
+// A test directory may contain a `perf.toml` next to `main.suru`:
+//
+//     tolerance = 0.10              # a measurement may exceed its budget by 10%
+//
+//     [compile]                     # `suru build main.suru`
+//     max_time_ms = 2000
+//     max_peak_rss_kb = 131072
+//
+//     [run]                         # the executable `suru build` produced
+//     max_time_ms = 2000
+//     max_instructions = 500000000
+//
+// Every key is optional. Peak RSS comes from `wait4` on the child process
+// and instruction counts (user space only) from a `perf_event` counter
+// inherited by the child; where either is unavailable (not Linux, no PMU,
+// `perf_event_paranoid` too strict) that budget is skipped with a note
+// instead of failing.
+
+use std::io::Read;
+use std::path::Path;
+use std::process::{Command, ExitStatus, Stdio};
+use std::time::{Duration, Instant};
+
+use serde::Deserialize;
+
+/// Default for `tolerance` when perf.toml does not set it
+pub const DEFAULT_TOLERANCE: f64 = 0.10;
+
+/// Contents of a perf.toml
+#[derive(Debug, Clone, Default, Deserialize)]
+#[serde(deny_unknown_fields)]
+pub struct PerfBudgets {
+    pub tolerance: Option<f64>,
+    #[serde(default)]
+    pub compile: Budget,
+    #[serde(default)]
+    pub run: Budget,
+}
+
+/// Limits for one stage; `None` means unbounded
+#[derive(Debug, Clone, Default, Deserialize)]
+#[serde(deny_unknown_fields)]
+pub struct Budget {
+    pub max_time_ms: Option<u64>,
+    pub max_peak_rss_kb: Option<u64>,
+    pub max_instructions: Option<u64>,
+}
+
+impl PerfBudgets {
+    /// Reads `<test_dir>/perf.toml`, or `None` when the test has no budgets
+    pub fn load(test_dir: &Path) -> Result<Option<Self>, String> {
+        let path = test_dir.join("perf.toml");
+        if !path.exists() {
+            return Ok(None);
+        }
+        let text = std::fs::read_to_string(&path)
+            .map_err(|e| format!("failed to read {}: {}", path.display(), e))?;
+        Self::parse(&text)
+            .map(Some)
+            .map_err(|e| format!("{}: {}", path.display(), e))
+    }
+
+    pub fn parse(text: &str) -> Result<Self, String> {
+        let budgets: PerfBudgets = toml::from_str(text).map_err(|e| e.to_string())?;
+        if budgets.tolerance.is_some_and(|t| !(t >= 0.0)) {
+            return Err("tolerance must be a non-negative fraction".to_string());
+        }
+        Ok(budgets)
+    }
+
+    pub fn tolerance(&self) -> f64 {
+        self.tolerance.unwrap_or(DEFAULT_TOLERANCE)
+    }
+}
+
+impl Budget {
+    pub fn is_empty(&self) -> bool {
+        self.max_time_ms.is_none()
+            && self.max_peak_rss_kb.is_none()
+            && self.max_instructions.is_none()
+    }
+
+    /// Checks `m` against this budget, returning one message per exceeded
+    /// limit. Limits whose measurement is unavailable are reported on stderr
+    /// and skipped.
+    pub fn check(&self, stage: &str, m: &Measurement, tolerance: f64) -> Vec<String> {
+        let mut failures = Vec::new();
+        let mut limit = |what: &str, unit: &str, budget: Option<u64>, measured: Option<u64>| {
+            let Some(budget) = budget else { return };
+            let Some(measured) = measured else {
+                eprintln!(
+                    "note: {} {} budget skipped: not measurable here",
+                    stage, what
+                );
+                return;
+            };
+            if measured as f64 > budget as f64 * (1.0 + tolerance) {
+                failures.push(format!(
+                    "{} {}: {}{} exceeds budget {}{} by more than {:.0}%",
+                    stage,
+                    what,
+                    measured,
+                    unit,
+                    budget,
+                    unit,
+                    tolerance * 100.0
+                ));
+            }
+        };
+        limit(
+            "time",
+            "ms",
+            self.max_time_ms,
+            Some(m.wall.as_millis() as u64),
+        );
+        limit("peak RSS", "KiB", self.max_peak_rss_kb, m.peak_rss_kb);
+        limit("instructions", "", self.max_instructions, m.instructions);
+        failures
+    }
+}
+
+/// Outcome and cost of one child process
+#[derive(Debug)]
+pub struct Measurement {
+    pub status: ExitStatus,
+    pub stdout: Vec<u8>,
+    pub stderr: Vec<u8>,
+    pub wall: Duration,
+    pub peak_rss_kb: Option<u64>,
+    pub instructions: Option<u64>,
+}
+
+/// Runs `command` to completion, capturing its output and measuring it
+pub fn measure(command: &mut Command) -> std::io::Result<Measurement> {
+    command
+        .stdin(Stdio::null())
+        .stdout(Stdio::piped())
+        .stderr(Stdio::piped());
+
+    // Opened before the spawn so the child inherits it; it starts counting
+    // when the child execs
+    let counter = sys::InstructionCounter::open();
+    let start = Instant::now();
+    let mut child = command.spawn()?;
+
+    let drain = |pipe: Option<Box<dyn Read + Send>>| {
+        std::thread::spawn(move || {
+            let mut buf = Vec::new();
+            if let Some(mut pipe) = pipe {
+                let _ = pipe.read_to_end(&mut buf);
+            }
+            buf
+        })
+    };
+    let stdout = drain(
+        child
+            .stdout
+            .take()
+            .map(|p| Box::new(p) as Box<dyn Read + Send>),
+    );
+    let stderr = drain(
+        child
+            .stderr
+            .take()
+            .map(|p| Box::new(p) as Box<dyn Read + Send>),
+    );
+
+    let (status, peak_rss_kb) = sys::wait(&mut child)?;
+    let wall = start.elapsed();
+
+    Ok(Measurement {
+        status,
+        stdout: stdout.join().unwrap_or_default(),
+        stderr: stderr.join().unwrap_or_default(),
+        wall,
+        peak_rss_kb,
+        instructions: counter.and_then(|c| c.read()),
+    })
+}
+
+#[cfg(target_os = "linux")]
+mod sys {
+    use std::os::fd::{FromRawFd, OwnedFd};
+    use std::os::unix::process::ExitStatusExt;
+    use std::process::{Child, ExitStatus};
+
+    /// Waits for `child`, returning its status and peak RSS in KiB
+    pub fn wait(child: &mut Child) -> std::io::Result<(ExitStatus, Option<u64>)> {
+        let pid = child.id() as libc::pid_t;
+        let mut status = 0;
+        let mut usage: libc::rusage = unsafe { std::mem::zeroed() };
+        loop {
+            let rc = unsafe { libc::wait4(pid, &mut status, 0, &mut usage) };
+            if rc == pid {
+                break;
+            }
+            let err = std::io::Error::last_os_error();
+            if err.kind() != std::io::ErrorKind::Interrupted {
+                return Err(err);
+            }
+        }
+        // ru_maxrss is in KiB on Linux
+        Ok((ExitStatus::from_raw(status), Some(usage.ru_maxrss as u64)))
+    }
+
+    /// `struct perf_event_attr` up to PERF_ATTR_SIZE_VER0
+    #[repr(C)]
+    struct PerfEventAttr {
+        type_: u32,
+        size: u32,
+        config: u64,
+        sample_period: u64,
+        sample_type: u64,
+        read_format: u64,
+        flags: u64,
+        wakeup_events: u32,
+        bp_type: u32,
+        bp_addr: u64,
+    }
+
+    const PERF_TYPE_HARDWARE: u32 = 0;
+    const PERF_COUNT_HW_INSTRUCTIONS: u64 = 1;
+    const PERF_FLAG_FD_CLOEXEC: libc::c_ulong = 1 << 3;
+
+    const DISABLED: u64 = 1 << 0;
+    const INHERIT: u64 = 1 << 1;
+    const EXCLUDE_KERNEL: u64 = 1 << 5;
+    const EXCLUDE_HV: u64 = 1 << 6;
+    const ENABLE_ON_EXEC: u64 = 1 << 12;
+
+    /// User-space instruction counter on the calling thread
+    ///
+    /// The counter itself stays disabled; children spawned from this thread
+    /// inherit it, enable it on exec, and fold their counts back into it
+    /// when they exit.
+    pub struct InstructionCounter(OwnedFd);
+
+    impl InstructionCounter {
+        pub fn open() -> Option<Self> {
+            let attr = PerfEventAttr {
+                type_: PERF_TYPE_HARDWARE,
+                size: std::mem::size_of::<PerfEventAttr>() as u32,
+                config: PERF_COUNT_HW_INSTRUCTIONS,
+                sample_period: 0,
+                sample_type: 0,
+                read_format: 0,
+                flags: DISABLED | INHERIT | EXCLUDE_KERNEL | EXCLUDE_HV | ENABLE_ON_EXEC,
+                wakeup_events: 0,
+                bp_type: 0,
+                bp_addr: 0,
+            };
+            let fd = unsafe {
+                libc::syscall(
+                    libc::SYS_perf_event_open,
+                    &attr as *const PerfEventAttr,
+                    0 as libc::pid_t,
+                    -1 as libc::c_int,
+                    -1 as libc::c_int,
+                    PERF_FLAG_FD_CLOEXEC,
+                )
+            };
+            (fd >= 0).then(|| InstructionCounter(unsafe { OwnedFd::from_raw_fd(fd as i32) }))
+        }
+
+        /// Instructions retired by exited children; call after reaping them
+        pub fn read(&self) -> Option<u64> {
+            use std::os::fd::AsRawFd;
+            let mut value = 0u64;
+            let n = unsafe {
+                libc::read(
+                    self.0.as_raw_fd(),
+                    &mut value as *mut u64 as *mut libc::c_void,
+                    std::mem::size_of::<u64>(),
+                )
+            };
+            (n == std::mem::size_of::<u64>() as isize).then_some(value)
+        }
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+mod sys {
+    use std::process::{Child, ExitStatus};
+
+    pub fn wait(child: &mut Child) -> std::io::Result<(ExitStatus, Option<u64>)> {
+        Ok((child.wait()?, None))
+    }
+
+    pub struct InstructionCounter;
+
+    impl InstructionCounter {
+        pub fn open() -> Option<Self> {
+            None
+        }
+
+        pub fn read(&self) -> Option<u64> {
+            None
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn measurement(wall_ms: u64, peak_rss_kb: Option<u64>) -> Measurement {
+        Measurement {
+            status: ExitStatus::default(),
+            stdout: Vec::new(),
+            stderr: Vec::new(),
+            wall: Duration::from_millis(wall_ms),
+            peak_rss_kb,
+            instructions: None,
+        }
+    }
+
+    #[test]
+    fn test_budgets_apply_tolerance() {
+        let budgets = PerfBudgets::parse(
+            "tolerance = 0.5\n[compile]\nmax_time_ms = 100\nmax_peak_rss_kb = 1000\nmax_instructions = 10\n",
+        )
+        .unwrap();
+        assert!(budgets.run.is_empty());
+
+        // 149ms is within 50% of 100ms; unmeasured instructions are skipped
+        let within = measurement(149, Some(1000));
+        assert!(
+            budgets
+                .compile
+                .check("compile", &within, budgets.tolerance())
+                .is_empty()
+        );
+
+        let over = measurement(151, Some(1501));
+        let failures = budgets.compile.check("compile", &over, budgets.tolerance());
+        assert_eq!(failures.len(), 2, "{:?}", failures);
+        assert!(failures[0].starts_with("compile time: 151ms exceeds budget 100ms"));
+
+        assert_eq!(
+            PerfBudgets::parse("").unwrap().tolerance(),
+            DEFAULT_TOLERANCE
+        );
+        assert!(PerfBudgets::parse("[compile]\nmax_time = 1\n").is_err());
+        assert!(PerfBudgets::parse("tolerance = -1.0\n").is_err());
+    }
+
+    #[test]
+    fn test_measure_child_process() {
+        let m = measure(Command::new(env!("CARGO_BIN_EXE_suru-lang")).arg("--help")).unwrap();
+        assert!(m.status.success());
+        assert!(String::from_utf8_lossy(&m.stdout).contains("Suru language compiler"));
+        if cfg!(target_os = "linux") {
+            assert!(m.peak_rss_kb.is_some_and(|kb| kb > 0));
+        }
+        // Present only where perf_event is usable; a whole process retires
+        // far more than a handful of instructions
+        if let Some(n) = m.instructions {
+            assert!(n > 1000, "{} instructions", n);
+        }
+    }
+}
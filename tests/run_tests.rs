@@ -1,7 +1,16 @@
+mod perf_budget;
+
 use std::fs;
 use std::path::{Path, PathBuf};
 use std::process::Command;
 
+use perf_budget::{PerfBudgets, measure};
+
+/// The compiler binary built for this test run
+fn suru() -> Command {
+    Command::new(env!("CARGO_BIN_EXE_suru-lang"))
+}
+
 /// Find all test directories in tests/run/
 fn find_run_tests() -> Vec<PathBuf> {
     let run_dir = Path::new("tests/run");
@@ -45,14 +54,10 @@ fn run_test_case(test_dir: &Path) -> Result<(), String> {
     let expected_output = fs::read_to_string(&expected_output_file)
         .map_err(|e| format!("Test '{}': failed to read expected_output.txt: {}", test_name, e))?;
 
+    let budgets = PerfBudgets::load(test_dir).map_err(|e| format!("Test '{}': {}", test_name, e))?;
+
     // Run the suru run command
-    // Note: We use cargo run -- run instead of calling suru directly
-    let output = Command::new("cargo")
-        .arg("run")
-        .arg("--")
-        .arg("run")
-        .arg(&main_file)
-        .output()
+    let output = suru().arg("run").arg(&main_file).output()
         .map_err(|e| format!("Test '{}': failed to execute suru run: {}", test_name, e))?;
 
     // Check if the command succeeded
@@ -77,11 +82,104 @@ fn run_test_case(test_dir: &Path) -> Result<(), String> {
         ));
     }
 
+    // Check run budgets from perf.toml
+    match budgets {
+        Some(budgets) if !budgets.run.is_empty() => check_run_budgets(test_dir, &budgets),
+        _ => Ok(()),
+    }
+}
+
+/// Temporary path for a test case's executable
+fn executable_path(test_name: &str, stage: &str) -> PathBuf {
+    std::env::temp_dir().join(format!("suru-{}-{}-{}", stage, test_name, std::process::id()))
+}
+
+/// Build a test case with `suru build`, measuring the compiler
+fn build(test_dir: &Path, executable: &Path) -> Result<perf_budget::Measurement, String> {
+    let test_name = test_dir.file_name()
+        .and_then(|n| n.to_str())
+        .unwrap_or("unknown");
+
+    let output = measure(suru().arg("build").arg(test_dir.join("main.suru")).arg("-o").arg(executable))
+        .map_err(|e| format!("Test '{}': failed to execute suru build: {}", test_name, e))?;
+    if !output.status.success() {
+        let _ = fs::remove_file(executable);
+        return Err(format!(
+            "Test '{}': suru build failed with exit code {:?}\nStderr: {}",
+            test_name,
+            output.status.code(),
+            String::from_utf8_lossy(&output.stderr)
+        ));
+    }
+    Ok(output)
+}
+
+/// Check a test case's run budgets against the executable `suru build`
+/// produces, so the compiler's own cost is not counted
+fn check_run_budgets(test_dir: &Path, budgets: &PerfBudgets) -> Result<(), String> {
+    let test_name = test_dir.file_name()
+        .and_then(|n| n.to_str())
+        .unwrap_or("unknown");
+
+    let executable = executable_path(test_name, "run");
+    build(test_dir, &executable)?;
+    let output = measure(&mut Command::new(&executable));
+    let _ = fs::remove_file(&executable);
+    let output = output
+        .map_err(|e| format!("Test '{}': failed to execute {}: {}", test_name, executable.display(), e))?;
+    if !output.status.success() {
+        return Err(format!(
+            "Test '{}': built executable failed with exit code {:?}\nStderr: {}",
+            test_name,
+            output.status.code(),
+            String::from_utf8_lossy(&output.stderr)
+        ));
+    }
+
+    let failures = budgets.run.check("run", &output, budgets.tolerance());
+    if !failures.is_empty() {
+        return Err(format!("Test '{}': {}", test_name, failures.join("; ")));
+    }
+    Ok(())
+}
+
+/// Check a test case's compile budgets from perf.toml, if it has any
+fn check_compile_budgets(test_dir: &Path) -> Result<(), String> {
+    let test_name = test_dir.file_name()
+        .and_then(|n| n.to_str())
+        .unwrap_or("unknown");
+
+    let budgets = match PerfBudgets::load(test_dir) {
+        Ok(Some(budgets)) if !budgets.compile.is_empty() => budgets,
+        Ok(_) => return Ok(()),
+        Err(e) => return Err(format!("Test '{}': {}", test_name, e)),
+    };
+
+    // The compile stage is `suru build`: front end, code generation and link
+    let executable = executable_path(test_name, "compile");
+    let output = build(test_dir, &executable)?;
+    let _ = fs::remove_file(&executable);
+
+    let failures = budgets.compile.check("compile", &output, budgets.tolerance());
+    if !failures.is_empty() {
+        return Err(format!("Test '{}': {}", test_name, failures.join("; ")));
+    }
     Ok(())
 }
 
 #[test]
-#[ignore] // Remove this when 'suru run' command is implemented
+fn test_compile_budgets() {
+    let failures: Vec<String> = find_run_tests()
+        .iter()
+        .filter_map(|dir| check_compile_budgets(dir).err())
+        .collect();
+
+    if !failures.is_empty() {
+        panic!("{} budget(s) exceeded:\n  {}", failures.len(), failures.join("\n  "));
+    }
+}
+
+#[test]
 fn test_run_integration() {
     let test_dirs = find_run_tests();
 
@@ -120,7 +218,6 @@ fn test_run_integration() {
 
 // Individual test for each test case - makes it easier to run specific tests
 #[test]
-#[ignore] // Remove this when 'suru run' command is implemented
 fn test_run_hello_world() {
     let test_dir = Path::new("tests/run/hello_world");
     if let Err(e) = run_test_case(test_dir) {